@@ -4,6 +4,6 @@
 #include "common.h"
 
 // --- Menu ---
-void admin_menu(int client_socket, User user);
+MenuExit admin_menu(int client_socket, User user);
 
 #endif
\ No newline at end of file
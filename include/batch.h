@@ -0,0 +1,32 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "common.h"
+
+/*
+--- Batch Mode (./client -b script) ---
+
+-> The interactive client waits for a prompt containing "Enter" before it sends the next line,
+   which makes it useless for scripts. Batch mode instead speaks the pipelined protocol
+   (pipeline.h): it sends PIPELINE_HELLO, then one request per script line, without waiting for
+   replies, and matches every reply to its line by request id.
+-> Script format: one request per line, without the id ("BALANCE SB10001"). Blank lines and lines
+   starting with '#' are skipped. The first request must be AUTH or RESUME; it is sent alone.
+   A line "WAIT" holds back the next requests until every earlier one has replied, for steps
+   that depend on each other (deposit, then check the balance).
+-> Output: one line per request, "<line> <latency ms> <reply>", in completion order, then a
+   summary with throughput and latency percentiles. -q prints only the summary.
+-> Up to 'window' requests are in flight at once (at most PIPELINE_MAX_INFLIGHT).
+*/
+
+#define BATCH_WINDOW 32 // Default requests in flight
+
+// Exit codes of ./client -b
+#define BATCH_EXIT_OK 0     // Every request answered OK
+#define BATCH_EXIT_FAILED 1 // At least one request answered ERR
+#define BATCH_EXIT_ERROR 2  // Could not run: bad script, connection lost, AUTH refused
+
+// Runs the script read from script_fd on sock (freshly connected). Returns a BATCH_EXIT_* code.
+int batch_run(int sock, int script_fd, int window, int quiet);
+
+#endif
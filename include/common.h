@@ -14,9 +14,11 @@
 #include <sys/types.h>  // For lseek
 #include <pthread.h>    // For threads
 #include <time.h>
+#include <stdint.h>     // For uint64_t
 
 // Project-Specific Definitions
 #define PORT 8080
+#define UNIX_SOCKET_PATH "/tmp/bank_server.sock" // Local (AF_UNIX) endpoint for clients on the same host
 #define MAX_BUFFER 1024
 
 // File Paths
@@ -26,6 +28,8 @@
 #define FEEDBACK_FILE "data/feedback.dat"
 #define TRANSACTION_FILE "data/transactions.dat"
 #define JOURNAL_FILE "data/journal.log"
+#define LEDGER_LOCK_FILE "data/ledger.lock" // Byte-range locks shared by server processes
+#define INSTRUCTION_FILE "data/instructions.dat" // Standing instructions (scheduler.c)
 
 // Data Structures (Unchanged from our last refactor) 
 
@@ -37,6 +41,13 @@ typedef enum
     ADMINISTRATOR
 } UserRole;
 
+// How a role menu ended: the user chose Logout, or the client went away (or timed out)
+typedef enum
+{
+    MENU_LOGOUT,
+    MENU_DISCONNECTED
+} MenuExit;
+
 typedef struct
 {
     int userId;
@@ -118,11 +129,54 @@ typedef struct
     double oldBalance; // The balance BEFORE the change (for UNDO)
 } JournalEntry;
 
+typedef enum
+{
+    INSTRUCTION_ACTIVE,    // Waiting for nextAttempt
+    INSTRUCTION_RUNNING,   // Claimed by the scheduler, transfer in progress
+    INSTRUCTION_DONE,      // Last payment made (one-off, or remainingRuns reached 0)
+    INSTRUCTION_CANCELLED, // Cancelled by the customer
+    INSTRUCTION_FAILED     // One-off payment that failed every retry
+} InstructionStatus;
+
+// A standing instruction: pay amount from fromAccountId to toAccountNumber every intervalSeconds
+typedef struct
+{
+    int instructionId;
+    int ownerUserId;
+    int fromAccountId;
+    char fromAccountNumber[20];
+    char toAccountNumber[20];
+    double amount;
+    int intervalSeconds;      // 0: pay once
+    int remainingRuns;        // Payments left, 0: until cancelled
+    InstructionStatus status;
+    int failures;             // Failed attempts at the current run (reset when it is paid or given up)
+    int lastResult;           // LedgerResult of the last attempt, -1: none yet (scheduler.h)
+    time_t dueTime;           // The run being paid
+    time_t nextAttempt;       // When the scheduler tries it: dueTime, or later while retrying
+    time_t lastAttempt;
+    int totalRuns;            // Payments made
+    int totalFailures;        // Failed attempts, retries included
+} StandingInstruction;
+
 // Generic Utility Function Prototypes
 // These could potentially move to a utils.h/utils.c
 void write_string(int fd, const char *str);
 int my_strcmp(const char *s1, const char *s2);
 int read_client_input(int client_socket, char *buffer, int size);
+
+// Called by read_client_input after every complete line (NULL when unused).
+// The server sets it to record connection activity for idle timeouts.
+extern void (*client_input_hook)(int client_socket);
+
+// Nanoseconds the calling thread has spent blocked in read_client_input (stats.c subtracts it
+// from handler times; event loops save and restore it per coroutine)
+extern __thread uint64_t client_wait_ns;
+
+// Blocks until fd is ready for events (POLLIN/POLLOUT) on a non-blocking socket.
+// Uses fd_wait_hook when set (the server's event loops yield there), poll() otherwise.
+int wait_for_fd(int fd, short events);
+extern int (*fd_wait_hook)(int fd, short events);
 int is_valid_number(const char *str);
 int is_valid_email(const char *str);
 int is_valid_phone(const char *str);
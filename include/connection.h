@@ -0,0 +1,64 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include "common.h"
+#include "timer_wheel.h"
+#include <stdatomic.h>
+
+#define LOGIN_TIMEOUT_SECONDS 60 // A new connection must finish logging in within this time
+#define IDLE_TIMEOUT_SECONDS 600 // A logged-in connection is dropped after this long without input
+
+// Why the timer closed a connection
+typedef enum
+{
+    REAP_NONE,
+    REAP_LOGIN, // Login phase took too long (or the client never sent anything)
+    REAP_IDLE   // Logged in, but no input for the idle timeout
+} ReapReason;
+
+typedef struct Connection
+{
+    int client_socket;
+    atomic_int userId;           // 0 while the connection is still in the login phase
+    char peer[INET6_ADDRSTRLEN]; // Remote address ("local" for non-IP sockets)
+    uint64_t connected_ms;       // monotonic_ms() at accept time
+    atomic_uint_fast64_t last_input_ms;
+    ReapReason reaped;
+    TimerEntry deadline;
+    struct Connection *prev, *next; // Registry of open connections
+} Connection;
+
+// Sets the timeouts (seconds, > 0). Call before the first connection_open.
+void connection_set_timeouts(int login_seconds, int idle_seconds);
+
+// Registers a new connection, arms its login deadline and makes it the calling thread's current
+// connection. Also installs the read_client_input activity hook. Returns NULL if out of memory.
+Connection *connection_open(int client_socket);
+
+// Marks the login phase as finished: from now on only the idle timeout applies
+void connection_logged_in(Connection *conn, int userId);
+
+// Records input activity (called through client_input_hook)
+void connection_touch(Connection *conn);
+
+// Disarms the deadline, unregisters and frees conn. Does not close the socket.
+// Returns the reap reason, so the caller can tell the user why the session ended.
+ReapReason connection_close(Connection *conn);
+
+// The connection handled by the calling thread (or NULL)
+Connection *connection_current();
+
+// Switches the calling thread's current connection (event loops do this per coroutine)
+void connection_set_current(Connection *conn);
+
+// Shuts every open connection down with 'how' (SHUT_RD lets handlers finish the current operation,
+// SHUT_RDWR ends them at once). Connections registered afterwards are shut for input immediately.
+void connection_drain_all(int how);
+
+// Number of registered (not yet closed) connections
+int connection_open_count();
+
+// Writes open/reaped connection counters to fd
+void connection_report(int fd);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include "common.h"
+
+/*
+--- Coroutine Sessions ---
+
+-> By default every client gets its own thread, which sleeps inside read() while the user thinks.
+   That costs a thread (and its stack) per connected user.
+-> With ./server -e N, N event-loop threads run all interactive sessions as coroutines instead.
+   The menu code is unchanged: when read_client_input() or write_string() would block, the
+   session yields back to its loop thread (wait_for_fd → coroutine_wait_fd), which runs other
+   sessions until epoll reports the socket ready, then resumes the session where it stopped.
+-> A session stays on the loop thread that started it. Code running in a session must not hold
+   a pthread mutex across a socket read/write, since the yield would keep it locked while other
+   sessions on the same loop thread try to take it.
+-> Pipelined sessions wait on condition variables and join their workers, which would stall
+   every session of the loop. handle_client moves them to a thread of their own.
+*/
+
+#define COROUTINE_STACK_SIZE (256 * 1024) // Virtual size; only the pages a session touches use memory
+#define EVENT_LOOP_MAX 64
+
+typedef void (*CoroutineEntry)(void *arg);
+
+// Starts 'threads' event-loop threads and installs the wait hook used by common_utils.
+// Returns the number of loops running (0 on failure).
+int event_loop_start(int threads);
+
+// 1 once event_loop_start succeeded
+int event_loop_active();
+
+// 1 when called from inside a coroutine
+int coroutine_running();
+
+// Runs entry(arg) as a new coroutine on one of the loops (round-robin). Returns 0 or -1.
+int coroutine_spawn(CoroutineEntry entry, void *arg);
+
+// Suspends the calling coroutine until fd is ready for events (POLLIN/POLLOUT).
+// Returns 0 when ready, -1 if the caller is not a coroutine (the caller should poll() instead).
+int coroutine_wait_fd(int fd, short events);
+
+// Sleeps without blocking the loop thread when called from a coroutine (plain sleep otherwise)
+void coroutine_sleep(unsigned int seconds);
+
+// Writes per-loop counters to fd
+void event_loop_report(int fd);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef CRED_CACHE_H
+#define CRED_CACHE_H
+
+#include "common.h"
+
+/*
+--- Credential Cache ---
+
+-> check_login used to scan users.dat for the record and then open, lock and read it again, for
+   every attempt. During a login storm every session thread does that on the same file.
+-> The cache keeps the User record (role, isActive, password verifier and the name the menus
+   greet with) of every user who tried to log in, keyed by userId. A hit needs no disk access.
+-> Every write of a user record (updateUser) invalidates its entry. A reader that missed takes a
+   ticket (cred_cache_begin) before reading the disk; cred_cache_store drops the record if the
+   user was invalidated in between, so a slow reader can never put an old record back.
+-> The cache is per process. Only the server's own writes invalidate it; the .dat files must not
+   be edited behind a running server's back.
+*/
+
+#define CRED_CACHE_SHARDS 64       // Independently locked shards (power of two)
+#define CRED_CACHE_SHARD_BUCKETS 16 // Initial buckets per shard (power of two, doubles as it grows)
+
+// Copies the cached record of userId into *out. Returns 1 on a hit, 0 on a miss.
+int cred_cache_lookup(int userId, User *out);
+
+// Call before reading userId's record from disk; pass the result to cred_cache_store.
+unsigned long cred_cache_begin(int userId);
+
+// Caches record (read from disk after cred_cache_begin returned ticket), unless it was
+// invalidated since.
+void cred_cache_store(const User *record, unsigned long ticket);
+
+// Forgets userId (call whenever its record on disk changes)
+void cred_cache_invalidate(int userId);
+
+// Writes hit/miss counters to fd
+void cred_cache_report(int fd);
+
+// Writes the cache size and counters to fd in the Prometheus text format (metrics.h)
+void cred_cache_metrics(int fd);
+
+#endif
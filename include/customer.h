@@ -4,14 +4,16 @@
 #include "common.h"
 
 // Menu
-void account_selection_menu(int client_socket, User user);
-void customer_menu(int client_socket, User user, int accountId);
+MenuExit account_selection_menu(int client_socket, User user);
+MenuExit customer_menu(int client_socket, User user, int accountId); // MENU_LOGOUT: back to account selection
 
 // Action Handlers
 void handle_view_balance(int client_socket, int accountId);
 void handle_deposit(int client_socket, int accountId);
 void handle_withdraw(int client_socket, int accountId);
 void handle_transfer_funds(int client_socket, int senderAccountId);
+void handle_batch_transfer(int client_socket, int senderAccountId);
+void handle_standing_instructions(int client_socket, int userId, int accountId);
 void handle_view_transaction_history(int client_socket, int accountId);
 void handle_apply_loan(int client_socket, int userId);
 void handle_view_loan_status(int client_socket, int userId);
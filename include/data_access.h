@@ -3,9 +3,12 @@
 
 #include "common.h"
 
-// Locking Functions
-int set_file_lock(int fd, int lock_type);
-int set_record_lock(int fd, int record_num, int record_size, int lock_type);
+// Locking Functions (the macros record the calling function for the lock profiler)
+int set_file_lock_at(int fd, int lock_type, const char *site);
+int set_record_lock_at(int fd, int record_num, int record_size, int lock_type, const char *site);
+#define set_file_lock(fd, lock_type) set_file_lock_at(fd, lock_type, __func__)
+#define set_record_lock(fd, record_num, record_size, lock_type) \
+    set_record_lock_at(fd, record_num, record_size, lock_type, __func__)
 
 // ID Generation
 int get_next_user_id();
@@ -33,6 +36,12 @@ Loan getLoan(int loanId);
 Feedback getFeedback(int feedbackId);
 int getAccountsByOwnerId(int ownerUserId, Account *accountList, int maxAccounts);
 
+// Batch Access (one scan, one open or one fsync for a whole set of records)
+int getAccountsByNumbers(char (*accNums)[20], int count, Account *accounts, int *record_nums); // Returns how many were found
+int getAccountsAt(const int *record_nums, int count, Account *accounts); // Re-reads known records, 0 or -1
+int updateAccountsAt(const Account *accounts, const int *record_nums, int count); // All records, then one fsync
+int addTransactions(Transaction *transactions, int count); // Assigns ids, one append + fsync
+
 // Data Writing/Updating 
 int addUser(User newUser); // Returns 0 on success, -1 on error
 int addAccount(Account newAccount);
@@ -41,6 +50,9 @@ int addFeedback(Feedback newFeedback);
 int addTransaction(Transaction newTransaction);
 
 int updateUser(User userToUpdate); // Updates the user record with matching userId
+// Called by updateUser after every write of a user record (NULL when unused). The server sets it
+// to token_revoke_user, so a role, password or status change ends every resumable session.
+extern void (*user_updated_hook)(int userId);
 int updateAccount(Account accountToUpdate);
 int updateLoan(Loan loanToUpdate);
 int updateFeedback(Feedback feedbackToUpdate);
@@ -49,7 +61,8 @@ int updateFeedback(Feedback feedbackToUpdate);
 void generate_new_account_number(char *new_acc_num);
 
 // Journaling Functions
-void journal_log_entry(JournalEntry entry);
+int journal_log_entry(JournalEntry entry); // Returns 0, or -1 if the entry is not in the journal
+int journal_log_entries(const JournalEntry *entries, int count); // One write + fsync for a whole group
 void journal_log_clear(); // To clear the log after a successful recovery
 
 #endif
\ No newline at end of file
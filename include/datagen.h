@@ -0,0 +1,42 @@
+#ifndef DATAGEN_H
+#define DATAGEN_H
+
+#include "common.h"
+
+/*
+--- Synthetic Data Generator (./admin_util -g N) ---
+
+-> Appends N generated users and everything that hangs off them to the data files, after the
+   default records admin_util always writes. Records are built in memory and written through
+   DATAGEN_WRITE_BUFFER-sized buffers, so a file takes a handful of write() calls per MB
+   instead of one per record.
+-> The same seed always produces the same data (apart from timestamps, which end at "now").
+-> Distributions:
+   users         0.5% managers, 2% employees, the rest customers, all with password
+                 DATAGEN_PASSWORD (hashed once: PBKDF2 per user would take hours for millions)
+   accounts      1 per customer (60%), 2 (30%) or 3 (10%), opened with a heavy-tailed deposit
+   transactions  on average txns_per_account per account, in time order over the last
+                 DATAGEN_HISTORY_DAYS days: 45% deposits, 35% withdrawals, 20% transfers to a
+                 random account. Activity is skewed: low-numbered accounts are the busiest.
+                 Withdrawals and transfers never overdraw, and each account's final balance is
+                 the newBalance of its last transaction.
+   loans         8% of customers, PENDING 40% / PROCESSING 20% / APPROVED 30% / REJECTED 10%,
+                 assigned to a random employee unless pending
+   feedback      5% of customers, half of it reviewed
+*/
+
+#define DATAGEN_WRITE_BUFFER (4 << 20) // Bytes buffered per data file
+#define DATAGEN_PASSWORD "test123"
+#define DATAGEN_HISTORY_DAYS 365
+
+typedef struct
+{
+    int users;             // Users to generate
+    int txns_per_account;  // Average transactions per account
+    unsigned long seed;
+} DatagenOptions;
+
+// Appends the generated data to the data files. Returns 0, or -1 on a write or memory error.
+int datagen_run(const DatagenOptions *options);
+
+#endif
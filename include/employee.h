@@ -4,7 +4,7 @@
 #include "common.h"
 
 // Menu
-void employee_menu(int client_socket, User user);
+MenuExit employee_menu(int client_socket, User user);
 
 // Action Handlers
 void handle_add_user(int client_socket, UserRole role_to_add);
@@ -0,0 +1,60 @@
+#ifndef FAULT_H
+#define FAULT_H
+
+#include "common.h"
+
+/*
+--- Fault Injection ---
+
+-> FAULT_POINT("name") marks a place in the commit path where a crash is interesting. When the
+   server is started with BANK_CRASH_POINT=name:N, the Nth time any thread passes that point the
+   process SIGKILLs itself: no cleanup, no flushing, exactly like a power cut for everything not
+   yet written (data already written survives, it is in the page cache).
+-> Unarmed, a point costs one load and a predictable branch. Building with
+   -DNO_FAULT_INJECTION removes the points altogether.
+-> Points (the order a transfer passes them):
+*/
+
+#define CRASH_JOURNAL_BEFORE_START "journal.before_start"   // Journal locked, nothing logged yet
+#define CRASH_JOURNAL_AFTER_START "journal.after_start"     // Both undo entries logged, no update
+#define CRASH_TRANSFER_BETWEEN_UPDATES "transfer.between_updates" // Sender debited, receiver not credited
+#define CRASH_TRANSFER_BEFORE_COMMIT "transfer.before_commit"     // Both updated, no commit entry
+#define CRASH_TRANSFER_AFTER_COMMIT "transfer.after_commit" // Committed, history rows not written
+#define CRASH_BATCH_MID_UPDATE "batch.mid_update"       // Batch: first account record written, no fsync yet
+#define CRASH_IO_BEFORE_FSYNC "io.before_fsync"             // Any write+fsync: written, not synced
+#define CRASH_POST_AFTER_UPDATE "post.after_update"         // Deposit/withdraw: balance written, no history row
+#define CRASH_RECOVERY_MID_ROLLBACK "recovery.mid_rollback" // Recovery restored one record
+
+// The transfer points, in order (used by crash_harness to cycle through them)
+#define FAULT_TRANSFER_POINTS                                                                            \
+    {                                                                                                    \
+        CRASH_JOURNAL_BEFORE_START, CRASH_JOURNAL_AFTER_START, CRASH_TRANSFER_BETWEEN_UPDATES,           \
+            CRASH_BATCH_MID_UPDATE, CRASH_TRANSFER_BEFORE_COMMIT, CRASH_TRANSFER_AFTER_COMMIT,           \
+            CRASH_IO_BEFORE_FSYNC                                                                        \
+    }
+
+#define FAULT_ENV "BANK_CRASH_POINT" // "name" (first hit) or "name:N" (Nth hit)
+
+extern int fault_armed; // Set by fault_init when FAULT_ENV names a point
+
+// Reads FAULT_ENV. Call once at startup.
+void fault_init();
+
+// Counts a pass through name and crashes if it is the armed hit (use FAULT_POINT)
+void fault_hit(const char *name);
+
+#ifdef NO_FAULT_INJECTION
+#define FAULT_POINT(name) \
+    do                    \
+    {                     \
+    } while (0)
+#else
+#define FAULT_POINT(name)       \
+    do                          \
+    {                           \
+        if (fault_armed)        \
+            fault_hit(name);    \
+    } while (0)
+#endif
+
+#endif
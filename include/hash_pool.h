@@ -0,0 +1,36 @@
+#ifndef HASH_POOL_H
+#define HASH_POOL_H
+
+#include "common.h"
+
+/*
+--- Hashing Pool ---
+
+-> A password hash costs tens of milliseconds of CPU (see password.h). Done on the session
+   thread, a burst of logins would occupy every core and stall menus, transfers and accepts.
+-> Instead, hashing runs on a fixed set of hash_pool threads fed by a bounded FIFO queue. At most
+   HASH_POOL_THREADS cores ever hash, however many users log in at once. When
+   HASH_POOL_QUEUE_MAX jobs are already waiting, new ones are refused at once (HASH_POOL_BUSY)
+   rather than queued for seconds: the user is told to try again.
+-> The caller waits for its result on an eventfd through wait_for_fd(), so a coroutine session
+   yields to its event loop instead of blocking the loop thread.
+-> Before hash_pool_start() (admin_util) the functions simply hash on the calling thread.
+*/
+
+#define HASH_POOL_THREADS 2     // Default number of hashing threads (server -w)
+#define HASH_POOL_QUEUE_MAX 64  // Jobs allowed to wait for a hashing thread
+#define HASH_POOL_BUSY -1       // Returned when the queue is full
+
+// Starts the hashing threads. Returns the number started.
+int hash_pool_start(int threads);
+
+// Hashes password into stored (PASSWORD_FIELD_SIZE bytes). Returns 0, or HASH_POOL_BUSY / -1.
+int hash_pool_hash(const char *password, char *stored);
+
+// Checks password against a stored verifier. Returns 1 (match), 0 (no match) or HASH_POOL_BUSY.
+int hash_pool_verify(const char *password, const char *stored);
+
+// Writes queue depth, wait and hashing time counters to fd
+void hash_pool_report(int fd);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "common.h"
+#include <stdint.h> // For uint64_t
+
+/*
+--- Latency Histogram ---
+
+-> Log-linear buckets: every power of two is split into 2^HISTOGRAM_SUB_BITS equal buckets, so a
+   recorded value is known to within 12.5% whatever its size (1 us or 10 s), with a fixed
+   496-bucket array and no allocation.
+-> Recording is an array increment. It is not synchronized: give every thread its own histogram
+   and merge them for the report.
+-> The _shared variants are for a histogram one thread records into while others read it: still
+   no lock and no atomic read-modify-write, just relaxed loads and stores (so a reader never sees
+   a torn counter; a merge taken mid-record may be one value behind).
+-> Values are unitless; callers record microseconds.
+*/
+
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_BUCKETS ((65 - HISTOGRAM_SUB_BITS) << HISTOGRAM_SUB_BITS)
+
+typedef struct
+{
+    unsigned long counts[HISTOGRAM_BUCKETS];
+    unsigned long count;
+    uint64_t sum;
+    uint64_t max;
+} Histogram;
+
+// Adds one value
+void histogram_record(Histogram *h, uint64_t value);
+
+// Adds every value of from to into
+void histogram_merge(Histogram *into, const Histogram *from);
+
+// histogram_record for a histogram other threads merge from (only one thread may record)
+void histogram_record_shared(Histogram *h, uint64_t value);
+
+// histogram_merge from a histogram another thread is recording into
+void histogram_merge_shared(Histogram *into, const Histogram *from);
+
+// Smallest bucket bound at or above percentile (0-100) of the values, capped at the maximum.
+// 0 for an empty histogram.
+uint64_t histogram_percentile(const Histogram *h, double percentile);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef IO_BACKEND_H
+#define IO_BACKEND_H
+
+#include "common.h"
+
+/*
+--- I/O Backend ---
+
+-> Data-file I/O (the .dat files in data/, the journal) and pipelined socket I/O go through these wrappers.
+-> IO_BACKEND_SYSCALL: plain read/write/pread/pwrite/fsync, exactly as before.
+-> IO_BACKEND_URING: requests are queued on one shared io_uring. Each call still blocks its
+   caller until the result is there, but many threads share one ring, so one io_uring_enter()
+   can submit the requests of several sessions and collect several completions.
+   io_write_fsync() submits the write and the fsync as one linked pair: one syscall instead of two.
+-> The backend is chosen once at startup (./server -o uring). If the kernel refuses io_uring,
+   io_backend_init() falls back to IO_BACKEND_SYSCALL.
+-> Data files are opened with io_open(), which remembers which data file each fd is, so the
+   read/write/fsync wrappers can charge their calls and bytes to it (stats.h, I/O accounting).
+*/
+
+#define IO_URING_ENTRIES 1024 // Submission queue size (the completion queue is twice as big)
+#define IO_TRACKED_FDS 65536  // fds above this are accounted as "(other)"
+
+typedef enum
+{
+    IO_BACKEND_SYSCALL,
+    IO_BACKEND_URING
+} IoBackendKind;
+
+// Selects the backend. Returns the one actually in use.
+IoBackendKind io_backend_init(IoBackendKind requested);
+const char *io_backend_name();
+
+// open() that records which data file fd refers to (for I/O accounting)
+int io_open(const char *path, int flags, mode_t mode);
+
+// Same contract as the syscalls they replace (return value, errno on -1)
+ssize_t io_read(int fd, void *buf, size_t len); // At (and advancing) the file position
+ssize_t io_pread(int fd, void *buf, size_t len, off_t offset);
+ssize_t io_write(int fd, const void *buf, size_t len); // At the file position (or the end with O_APPEND)
+ssize_t io_pwrite(int fd, const void *buf, size_t len, off_t offset);
+int io_fsync(int fd);
+
+// Writes len bytes at offset (-1: file position / O_APPEND end) and fsyncs if the write was
+// complete. Returns the write's result; a failed fsync is reported as -1.
+ssize_t io_write_fsync(int fd, const void *buf, size_t len, off_t offset);
+
+// Socket receive/send (send never raises SIGPIPE)
+ssize_t io_recv(int fd, void *buf, size_t len);
+ssize_t io_send(int fd, const void *buf, size_t len);
+
+// Writes backend counters to fd
+void io_backend_report(int fd);
+
+#endif
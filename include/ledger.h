@@ -0,0 +1,62 @@
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include "common.h"
+
+// Outcome of a balance-changing operation
+typedef enum
+{
+    LEDGER_OK = 0,
+    LEDGER_NOT_FOUND,    // Account does not exist
+    LEDGER_INACTIVE,     // One of the accounts is deactivated
+    LEDGER_SAME_ACCOUNT, // Transfer source and destination are the same
+    LEDGER_INSUFFICIENT, // Not enough balance
+    LEDGER_WRITE_FAILED, // accounts.dat or the journal could not be written
+    LEDGER_LOG_FAILED,   // Balance updated, but the transactions.dat entry was not written
+    LEDGER_BAD_BATCH,    // Batch transfer: no legs, too many legs, or an amount that is not positive
+    LEDGER_BAD_AMOUNT    // Standing instruction: amount not positive or above INSTRUCTION_MAX_AMOUNT
+} LedgerResult;
+
+#define LEDGER_BATCH_MAX 512 // Credits in one batch transfer
+
+// One credit of a batch transfer
+typedef struct
+{
+    char accountNumber[20];
+    double amount;
+} LedgerLeg;
+
+// Deposit/withdraw on a single account (type is DEPOSIT or WITHDRAWAL).
+// On LEDGER_OK / LEDGER_LOG_FAILED, *updated holds the account after the change.
+LedgerResult ledger_post(int accountId, TransactionType type, double amount, Account *updated);
+
+// Journaled transfer between two accounts (the commit path of handle_transfer_funds).
+// Balances are re-read under the account locks, so the checks done by the caller are advisory.
+LedgerResult ledger_transfer(int senderAccountId, int receiverAccountId, double amount,
+                             Account *sender, Account *receiver);
+
+/*
+--- Batch Transfer (payroll, disbursements) ---
+
+-> One debit of senderAccountId, one credit per leg, all or nothing: if any leg is invalid
+   (unknown or inactive account, the sender itself, amount <= 0) or the legs add up to more than
+   the balance, nothing is written and *failed_leg is the first bad leg (-1: the sender or the
+   batch as a whole).
+-> All receivers are found in one scan of accounts.dat and locked together (stripes and lock
+   bytes ascending, the same order as ledger_transfer). The whole batch is one journal group:
+   every undo entry in one write, every account record written with one fsync, one commit.
+   The history rows (one TRANSFER_OUT and one TRANSFER_IN per leg) are one append. So a batch
+   costs four fsyncs however many legs it has, where N transfers cost 6*N.
+-> Legs to the same account are credited together (one undo entry, one record write).
+*/
+LedgerResult ledger_transfer_batch(int senderAccountId, const LedgerLeg *legs, int count, Account *sender,
+                                   int *failed_leg);
+
+// Truncates the journal if its last group is committed (called on graceful shutdown, so the next
+// start has nothing to replay). Returns 0 if the journal is now empty, -1 if it was left for recovery.
+int ledger_checkpoint();
+
+// Short human-readable description of a result code
+const char *ledger_result_str(LedgerResult result);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef LIFECYCLE_H
+#define LIFECYCLE_H
+
+#include "common.h"
+
+/*
+--- Server Lifecycle (Signals, Drain, Hot Restart) ---
+
+-> SIGTERM / SIGINT: graceful shutdown. Stop accepting, let every session finish the operation
+   it is running, checkpoint the journal and exit. Recovery at the next start has nothing to do.
+-> SIGUSR2: hot restart. The server re-executes its binary (the file on disk, so a freshly
+   deployed build) and hands over the listening sockets. Once the new process reports it is
+   serving, the old one stops accepting and drains like on SIGTERM. Connections queued on the
+   sockets are never refused: both processes accept from the same kernel sockets meanwhile.
+-> One server per data directory: an OFD lock on INSTANCE_LOCK_FILE is taken before anything is
+   bound or recovered, so a second ./server refuses to start instead of rolling back the running
+   server's journal. A hot restart hands the locked file description to the new process.
+-> Signals are not handled in signal handlers. lifecycle_init() blocks them in main before any
+   thread exists (so every thread inherits the mask), and lifecycle_run() collects them with
+   sigwaitinfo() on the main thread, where any function may be called.
+*/
+
+#define DRAIN_TIMEOUT_SECONDS 30         // Sessions still open after this are cut off
+#define RESTART_READY_TIMEOUT_SECONDS 10 // New process must report ready within this time
+#define LISTEN_FDS_ENV "BANK_LISTEN_FDS" // Inherited listening sockets (see listener_export)
+#define READY_FD_ENV "BANK_READY_FD"     // Pipe the new process writes one byte to once serving
+#define LOCK_FD_ENV "BANK_LOCK_FD"       // Inherited, already locked INSTANCE_LOCK_FILE
+#define INSTANCE_LOCK_FILE "data/server.lock"
+
+typedef void (*SignalCallback)(int sig);
+
+// Blocks the lifecycle signals and remembers how to re-execute this binary.
+// Call first thing in main(), before any thread is created.
+void lifecycle_init(int argc, char *argv[]);
+
+// Routes sig to callback (on the main thread). Call before any thread is created.
+void lifecycle_on_signal(int sig, SignalCallback callback);
+
+// Takes the instance lock (or adopts the one a hot restart handed over). Returns 0, or -1 if
+// another server process holds it. Call before binding or recovering anything.
+int lifecycle_lock_instance();
+
+// Listening sockets handed over by a previous server process, or NULL on a normal start
+const char *lifecycle_inherited_listeners();
+
+// Tells the previous process (if any) that this one is accepting connections
+void lifecycle_ready();
+
+// Waits for signals and handles them. Only returns by exiting the process.
+void lifecycle_run();
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef LISTENER_H
+#define LISTENER_H
+
+#include "common.h"
+
+#define LISTENER_MAX 32       // Upper limit for acceptor threads (-a)
+#define LISTEN_BACKLOG 128    // Pending connections per listening socket
+
+// Called on the acceptor thread for every accepted connection
+typedef void (*ConnectionCallback)(int client_socket);
+
+// Opens 'count' listening sockets on port, each with SO_REUSEPORT so the kernel spreads new
+// connections over them. Falls back to one shared socket if SO_REUSEPORT is unavailable.
+// Returns the number of acceptors prepared, or -1 if nothing could be bound.
+int listener_open(int count, int port);
+
+// Adds one more acceptor listening on an AF_UNIX stream socket at path (any stale socket file
+// is removed first). Call after listener_open. Returns 0, or -1 if the socket could not be bound.
+int listener_open_unix(const char *path);
+
+// Starts one acceptor thread per prepared socket. Each calls on_accept for new connections.
+void listener_run(ConnectionCallback on_accept);
+
+// Blocks until every acceptor thread has exited
+void listener_join();
+
+// Wakes every acceptor thread, waits for them to exit and closes this process's copies of the
+// listening sockets (the sockets themselves stay open in any process that inherited them).
+// release = 1 also removes the AF_UNIX socket file; a hot restart passes 0.
+void listener_stop(int release);
+
+// Writes "fd=label;fd=label..." describing the listening sockets into spec, for a new process
+// started with execve to adopt. Returns the number of acceptors, or -1 if spec is too small.
+int listener_export(char *spec, size_t size);
+
+// Takes over listening sockets inherited from the previous process (see listener_export)
+// instead of binding new ones. Returns the number of acceptors, or -1 if none were usable.
+int listener_adopt(const char *spec);
+
+// Writes per-acceptor accept counters to fd (client socket or STDOUT_FILENO)
+void listener_report(int fd);
+
+#endif
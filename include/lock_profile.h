@@ -0,0 +1,41 @@
+#ifndef LOCK_PROFILE_H
+#define LOCK_PROFILE_H
+
+#include "common.h"
+
+/*
+--- Lock Profiler ---
+
+-> set_file_lock and set_record_lock are macros (data_access.h) that pass the calling function's
+   name, so every fcntl lock is attributed to a target (data file and whole-file/record scope),
+   a mode (read/write) and a call site.
+-> Per target and site: acquisitions, contended acquisitions (a non-blocking F_SETLK failed
+   first, so the caller had to wait in F_SETLKW), total and maximum wait, total and maximum hold
+   (lock to unlock).
+-> fcntl locks belong to the process: two threads of the server never wait for each other
+   through them, only for another process (admin_util, the old server during a hot restart). The
+   "overlap" column counts acquisitions made while another thread of this server held a
+   conflicting lock on the same file (a scan's read lock against an append's write lock, ...):
+   the stalls the file locks would cause if they excluded threads.
+-> Off until lock_profile_enable(); then an uncontended lock costs an fstat, two clock reads and
+   a few relaxed atomic adds on top of the fcntl.
+*/
+
+#define LOCK_PROFILE_SITES 256 // Distinct (target, scope, mode, site) combinations tracked
+#define LOCK_PROFILE_FILES 64  // Distinct data files tracked for overlaps
+#define LOCK_PROFILE_HELD 16   // Locks one thread can hold at once and still get a hold time
+#define LOCK_PROFILE_TOP 12    // Rows in the report
+
+// Turns profiling on (the server calls this at startup)
+void lock_profile_enable();
+
+// fcntl(fd, F_SETLKW, fl) with profiling. whole_file: the lock covers the file (set_file_lock).
+int lock_profile_fcntl(int fd, struct flock *fl, int whole_file, const char *site);
+
+// Writes the most contended locks (by total wait, then overlaps, then hold time) to fd
+void lock_profile_report(int fd);
+
+// Writes every lock site's counters to fd in the Prometheus text format (metrics.h)
+void lock_profile_metrics(int fd);
+
+#endif
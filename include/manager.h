@@ -4,7 +4,7 @@
 #include "common.h"
 
 // Menu
-void manager_menu(int client_socket, User user);
+MenuExit manager_menu(int client_socket, User user);
 
 // Action Handlers
 void handle_set_account_status(int client_socket, int admin_mode);
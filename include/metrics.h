@@ -0,0 +1,40 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "common.h"
+
+/*
+--- Metrics Endpoint ---
+
+-> A plain HTTP/1.0 server on 127.0.0.1:METRICS_PORT (./server -m port, -m 0 turns it off)
+   answers GET /metrics with the Prometheus text format:
+     curl -s http://127.0.0.1:9180/metrics
+-> It runs on its own thread with its own listening socket: a scrape never goes through the
+   acceptors, the session threads or the event loops. The modules' counters are read the same
+   way the admin reports read them (relaxed atomic loads, per-thread shards merged under the
+   registry mutex that recording never takes).
+-> The page is written into a memfd first and sent with a Content-Length, so a slow scraper
+   holds the metrics thread (with a send timeout) and nothing else.
+-> Counters are cumulative (_total); rates such as ops/s come from the scraper
+   (rate(bank_handler_latency_seconds_count[1m])).
+*/
+
+#define METRICS_PORT 9180          // Default loopback port
+#define METRICS_IO_TIMEOUT_SECONDS 2 // Per request: reading it and sending the page
+
+// Writes the whole metrics page to fd (the server's collector)
+typedef void (*MetricsWriter)(int fd);
+
+// Binds 127.0.0.1:port and starts the metrics thread. Returns 0, or -1 if the port is unavailable.
+int metrics_start(int port, MetricsWriter writer);
+
+// "# HELP name help" and "# TYPE name type" lines
+void metrics_header(int fd, const char *name, const char *type, const char *help);
+
+// One sample: name{labels} value. labels may be NULL or "" (no braces then).
+void metrics_value(int fd, const char *name, const char *labels, double value);
+
+// Writes the scrape counter to fd
+void metrics_report(int fd);
+
+#endif
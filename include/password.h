@@ -0,0 +1,38 @@
+#ifndef PASSWORD_H
+#define PASSWORD_H
+
+#include "common.h"
+
+/*
+--- Password Storage ---
+
+-> User.password no longer holds the password. It holds a verifier:
+       $1$<salt>$<hash>
+   salt: PASSWORD_SALT_BYTES random bytes, hash: the first PASSWORD_HASH_BYTES of
+   PBKDF2-HMAC-SHA256(password, salt, PASSWORD_HASH_ITERATIONS), both in the crypt(3) base64
+   alphabet. The whole string (44 chars) fits the 50-byte field, so users.dat keeps its layout.
+-> The iteration count makes every guess cost thousands of SHA-256 blocks. That is the point
+   (a stolen users.dat is expensive to crack) and also why logins hash on hash_pool threads.
+-> Records written before hashing existed hold the plain password. password_verify still accepts
+   them (password_is_legacy), and check_login replaces them with a verifier on the first login.
+-> SHA-256 is implemented here (FIPS 180-4), so the project still needs nothing but libc/pthread.
+*/
+
+#define PASSWORD_SCHEME "$1$"
+#define PASSWORD_HASH_ITERATIONS 10000
+#define PASSWORD_SALT_BYTES 6  // 8 characters encoded
+#define PASSWORD_HASH_BYTES 24 // 32 characters encoded
+#define PASSWORD_FIELD_SIZE 50 // sizeof(User.password)
+
+// Hashes password with a fresh random salt into stored (PASSWORD_FIELD_SIZE bytes).
+// Expensive: runs on the calling thread. Returns 0, or -1 if no random salt was available.
+int password_hash(const char *password, char *stored);
+
+// Returns 1 if password matches the stored verifier (or legacy plain password), 0 otherwise.
+// Expensive for verifiers: runs on the calling thread.
+int password_verify(const char *password, const char *stored);
+
+// 1 if stored is a plain password from before hashing was introduced
+int password_is_legacy(const char *stored);
+
+#endif
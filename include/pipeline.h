@@ -0,0 +1,59 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "common.h"
+
+/*
+--- Pipelined Request Protocol ---
+
+-> A machine client sends PIPELINE_HELLO instead of a role number at the first prompt.
+   The server answers "PIPELINE READY" and from then on the connection speaks this line protocol.
+-> Request:  <id> <OP> [args...]\n        (<id> is any token chosen by the client, e.g. a counter,
+                                           at most PIPELINE_MAX_ID bytes; a longer one is answered
+                                           "? ERR ..." and not run)
+   Reply:    <id> OK [payload]\n  or  <id> ERR <reason>\n
+-> The first request must be "AUTH <userId> <password>" or "RESUME <token>" (customers only).
+   AUTH returns a session token that a later connection can RESUME with. After that the client may
+   send any number of requests without waiting; they run concurrently and replies come back in
+   completion order, so the client matches them by <id>.
+-> Requests that must happen in order (e.g. a deposit then a balance check) must wait for the reply.
+-> BATCH is one debit and up to LEDGER_BATCH_MAX credits, all or nothing (ledger_transfer_batch).
+   A refused batch answers "ERR leg <n>: <reason>" for the first bad leg (numbered from 1).
+   A request line may be up to PIPELINE_MAX_LINE - 1 bytes; a longer one is refused ("? ERR ..."),
+   never cut.
+-> SCHEDULE stores a standing instruction (scheduler.h) paid every <every> seconds (0: once),
+   first after [delay] seconds, [count] times (0 or left out: until cancelled). The scheduler
+   pays it, not the connection: INSTRUCTIONS shows the outcome.
+
+   OP         Arguments                       OK payload
+   AUTH       <userId> <password>             <userId> <firstName> <token>
+   RESUME     <token>                         <userId> <firstName> <token>
+   ACCOUNTS                                   <count> <accNum>:<balance> ...
+   BALANCE    <accNum>                        <accNum> <balance>
+   DEPOSIT    <accNum> <amount>               <newBalance>
+   WITHDRAW   <accNum> <amount>               <newBalance>
+   TRANSFER   <fromAccNum> <toAccNum> <amt>   <newSenderBalance>
+   HISTORY    <accNum> [limit]                <count> <txnId>,<type>,<amount>,<balance>,<other>,<time> ...
+   BATCH      <fromAccNum> <to>:<amt>[,...]   <newSenderBalance> <legCount>
+   SCHEDULE   <fromAccNum> <toAccNum> <amt> <every> [delay] [count]
+                                              <instructionId> <firstRunEpoch>
+   INSTRUCTIONS                               <count> <id>,<from>,<to>,<amt>,<every>,<next>,<status>,<runs>,
+                                                      <failures>,<remaining> ...
+   CANCEL     <instructionId>                 <instructionId>
+   PING                                       PONG
+   QUIT                                       BYE (sent after every earlier request has replied)
+*/
+
+#define PIPELINE_HELLO "PIPELINE"
+#define PIPELINE_WORKERS 4        // Requests executed concurrently per connection
+#define PIPELINE_MAX_INFLIGHT 256 // Queued requests before the reader stops reading (backpressure)
+#define PIPELINE_HISTORY_LIMIT 50 // Default number of transactions returned by HISTORY
+#define PIPELINE_MAX_LINE 16384   // Longest request line (room for a full BATCH)
+#define PIPELINE_MAX_ID 32        // Longest request id
+
+// Runs a whole pipelined session on client_socket (after PIPELINE_HELLO was received).
+// Returns when the client sends QUIT or disconnects. Does not close the socket.
+// Blocks its thread (condition waits, joins): never call it from an event-loop coroutine.
+void pipeline_session(int client_socket);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef RATE_LIMIT_H
+#define RATE_LIMIT_H
+
+#include "common.h"
+
+/*
+--- Rate Limiting ---
+
+-> Every menu choice and every pipelined request takes one token from three token buckets: the
+   user's, the remote address's and the global one. A login attempt takes one from the address
+   and global buckets and from the login bucket of the userId being tried, so guessing one
+   account's password from many addresses is throttled too.
+-> A bucket refills at 'rate' tokens per second up to 'burst'. An empty bucket rejects the
+   request before its handler runs: no data file is touched, no lock is taken. Checking costs a
+   hash lookup and a few arithmetic operations under a striped mutex.
+-> Limits come from RATE_LIMIT_CONFIG (see rate_limit_load for the format) and are re-read on
+   SIGHUP. A missing file means the built-in defaults below. Rate 0 disables a limit.
+*/
+
+#define RATE_LIMIT_CONFIG "data/rate_limits.conf"
+#define RATE_BUCKETS 4096       // Hash buckets for per-user/per-address token buckets
+#define RATE_LOCK_STRIPES 64    // Mutexes protecting them (bucket % stripes)
+#define RATE_SWEEP_SECONDS 60   // Full (idle) buckets are freed this often
+
+// Built-in defaults: tokens per second, burst
+#define RATE_USER_DEFAULT 20, 40
+#define RATE_ADDRESS_DEFAULT 100, 200
+#define RATE_GLOBAL_DEFAULT 0, 0 // Unlimited
+#define RATE_LOGIN_DEFAULT 1, 5
+
+typedef enum
+{
+    RATE_OK = 0,
+    RATE_USER,    // This user sends too fast
+    RATE_ADDRESS, // This remote address sends too fast
+    RATE_GLOBAL,  // The whole server is over its limit
+    RATE_LOGIN,   // Too many login attempts for this userId
+    RATE_KINDS
+} RateResult;
+
+// Loads the limits file and arms the sweep timer. Call after timer_wheel_start.
+void rate_limit_start();
+
+// Re-reads path. Keeps the current limits if the file has an error. Returns 0 or -1.
+// Format, one limit per line ('#' starts a comment):  user|address|global|login <rate> <burst>
+int rate_limit_load(const char *path);
+
+// Charges one request of userId from address. RATE_OK or the limit that rejected it.
+RateResult rate_limit_request(int userId, const char *address);
+
+// Charges one login attempt for userId from address
+RateResult rate_limit_login(int userId, const char *address);
+
+// read_client_input for menu choices: rejected choices are answered with a short message and
+// read again, so the menu (and its data-file reads) only runs for admitted input.
+// Returns like read_client_input.
+int read_menu_choice(int client_socket, char *buffer, int size, int userId);
+
+// Text for a rejection
+const char *rate_limit_str(RateResult result);
+
+// Writes the limits and rejection counters to fd
+void rate_limit_report(int fd);
+
+#endif
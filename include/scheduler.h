@@ -0,0 +1,75 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "common.h"
+#include "ledger.h" // For LedgerResult
+
+/*
+--- Standing Instructions (Scheduled Transfers) ---
+
+-> A standing instruction (common.h) pays a fixed amount from one of the customer's accounts to
+   any account number, once or every intervalSeconds, optionally a fixed number of times (rent,
+   SIPs). Instructions are records of INSTRUCTION_FILE and survive restarts. instructionId is
+   the record number + 1 (ids are handed out under the file's append lock, nothing is deleted).
+-> The scheduler thread keeps a min-heap of (nextAttempt, record number) and sleeps until the
+   earliest is due, or at most SCHEDULER_POLL_MS to pick up instructions another server process
+   appended. It is not a timer wheel callback: a batch does fsyncs, and the tick thread must stay
+   free for connection deadlines. Heap entries are hints; the record decides.
+-> Everything due at once is one batch of up to SCHEDULER_BATCH instructions:
+     1. claim:  every record is set to INSTRUCTION_RUNNING, one fsync for all of them
+     2. pay:    instructions from the same account are one ledger_transfer_batch (receivers
+                resolved in one scan). If that is refused, each is paid alone with
+                ledger_transfer, the commit path of handle_transfer_funds, so one bad
+                instruction does not hold back the others.
+     3. record: outcome, next run and counters in every record (one fsync), and one line per
+                attempt in SCHEDULER_LOG_FILE (one write + fsync)
+-> A failed attempt is retried after INSTRUCTION_RETRY_SECONDS, doubling each time, at most
+   INSTRUCTION_MAX_RETRIES times and never past the next run. Then that run is given up (a
+   one-off instruction ends as INSTRUCTION_FAILED). Runs missed while no server was up are paid
+   once, not once per missed interval.
+-> At most once: a record still INSTRUCTION_RUNNING when a scheduler takes over was cut off by a
+   crash between claim and record, and may or may not have been paid. It is not paid again; its
+   last result says so and the customer can check the transaction history.
+-> One server process schedules at a time (an OFD lock on SCHEDULER_LOCK_FILE). During a hot
+   restart the old process lets go when it starts draining and the new one takes over.
+*/
+
+#define SCHEDULER_LOCK_FILE "data/scheduler.lock"
+#define SCHEDULER_LOG_FILE "data/instruction_runs.log"
+#define SCHEDULER_BATCH 256           // Instructions claimed, paid and recorded together
+#define SCHEDULER_POLL_MS 1000        // Longest sleep (new records, ownership)
+#define INSTRUCTION_RETRY_SECONDS 60  // First retry after a failed attempt (then 120, 240, ...)
+#define INSTRUCTION_MAX_RETRIES 3     // Retries of one run before it is given up
+#define INSTRUCTION_LIST_MAX 20       // Instructions shown to a customer
+#define INSTRUCTION_MAX_AMOUNT 10000000.0 // Largest payment of one run (also bounds the listings)
+
+#define INSTRUCTION_NOT_RUN -1     // lastResult before the first attempt
+#define INSTRUCTION_INTERRUPTED -2 // lastResult of a run cut off by a crash (not retried)
+
+// Starts the scheduler thread. Call after run_server_recovery().
+void scheduler_start();
+
+// Lets the current batch finish and stops the thread (drain). Another process may take over.
+void scheduler_stop();
+
+// Stores a new instruction. The caller fills ownerUserId, fromAccountId, toAccountNumber, amount
+// (> 0), intervalSeconds (>= 0), remainingRuns (>= 0) and dueTime (first payment); the rest is set
+// here, instructionId included. LEDGER_BAD_AMOUNT if amount is not in (0, INSTRUCTION_MAX_AMOUNT].
+// Checks the accounts like a transfer: LEDGER_NOT_FOUND (or not the owner's account),
+// LEDGER_INACTIVE, LEDGER_SAME_ACCOUNT, LEDGER_WRITE_FAILED.
+LedgerResult scheduler_add(StandingInstruction *instruction);
+
+// The owner's instructions, cancelled ones left out; the newest max if there are more
+int scheduler_list(int ownerUserId, StandingInstruction *list, int max);
+
+// Returns 0, or -1 if there is no such instruction of ownerUserId that is still active
+int scheduler_cancel(int ownerUserId, int instructionId);
+
+const char *instruction_status_str(InstructionStatus status);
+const char *instruction_result_str(int lastResult);
+
+// Ownership, queue length and outcome counters
+void scheduler_report(int fd);
+void scheduler_metrics(int fd);
+
+#endif
@@ -3,9 +3,16 @@
 
 #include "common.h"
 
+// check_login failure codes (in the returned User.userId)
+#define LOGIN_NOT_FOUND 0    // Unknown user or wrong password
+#define LOGIN_ERROR -1       // users.dat could not be read
+#define LOGIN_DEACTIVATED -2 // Correct password, but the user is deactivated
+#define LOGIN_BUSY -3        // Password hashing pool saturated: try again shortly
+
 // Core Server Functions
 void *handle_client(void *client_socket_ptr); // Main thread function
 User check_login(int userId, char *password); // Authentication logic
 void run_server_recovery(); // ecovery function
+void server_report_stats(int fd); // Writes server counters (admin statistics)
 
 #endif
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "common.h"
+
+// Number of independently locked shards in the session registry (power of two)
+#define SESSION_SHARDS 64
+// Initial buckets per shard (power of two, doubles as the shard grows)
+#define SESSION_SHARD_BUCKETS 16
+
+// session_add results
+#define SESSION_ADDED 0
+#define SESSION_DUPLICATE 1 // userId is already logged in
+#define SESSION_FULL 2      // Out of memory for a new entry
+
+// Registers userId as logged in (one login per userId).
+int session_add(int userId);
+// Removes userId from the registry. Returns 0 if it was present, -1 otherwise.
+int session_remove(int userId);
+// Number of logged-in users (sums the shards, so only approximate while logins are happening)
+int session_count();
+
+#endif
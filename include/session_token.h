@@ -0,0 +1,34 @@
+#ifndef SESSION_TOKEN_H
+#define SESSION_TOKEN_H
+
+#include "common.h"
+
+#define TOKEN_LENGTH 32         // Hex characters in a token (128 random bits)
+#define TOKEN_TTL_SECONDS 900   // A token stays valid this long after its last use
+#define TOKEN_SWEEP_SECONDS 30  // How often the sweep timer removes expired tokens
+#define TOKEN_RESUME_CMD "RESUME" // Sent instead of a role number: "RESUME <token>"
+
+// Creates a token for a freshly authenticated user. token_out needs TOKEN_LENGTH + 1 bytes.
+// Returns 0 on success, -1 if no token could be created.
+int token_issue(const User *user, char *token_out);
+
+// Looks up a token. On success copies the user it was issued to, extends its expiry and returns 0.
+// Returns -1 if the token is unknown or expired.
+int token_resume(const char *token, User *user_out);
+
+// Extends a token's expiry (called when its connection drops, to open the resume window)
+void token_touch(const char *token);
+
+// Invalidates one token (explicit logout)
+void token_revoke(const char *token);
+
+// Invalidates every token issued to userId (updateUser calls it: role, password or status changed)
+void token_revoke_user(int userId);
+
+// Number of live tokens
+int token_count();
+
+// Arms the periodic sweep that expires tokens (runs on the timer wheel). Call once from main().
+void token_start_reaper();
+
+#endif
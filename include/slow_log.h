@@ -0,0 +1,34 @@
+#ifndef SLOW_LOG_H
+#define SLOW_LOG_H
+
+#include "common.h"
+
+/*
+--- Slow-Operation Log ---
+
+-> Every outermost timed operation (a menu handler of customer.c, employee.c, manager.c or
+   admin.c, a pipelined request, check_login) that took at least the threshold in server time
+   (client input waits excluded, as in stats.h) appends one line to SLOW_LOG_FILE:
+     2026-10-19T09:14:03.512Z slow_op handler="handle_view_transaction_history" user=2
+       elapsed_ms=148.210 records_scanned=52113 read_bytes=3335232 lock_waits=0 lock_wait_ms=0.000 fsyncs=0
+-> The numbers come from the session's StatsContext, counted while the operation ran: data file
+   reads (one record per read in a scan), bytes read, fsyncs, and data file locks that had to
+   wait for another process (lock_profile.c).
+-> Asynchronous: the session only copies the entry into a bounded queue under a mutex that the
+   logger thread holds just long enough to take the queued entries. Formatting and the write
+   happen on the logger thread. When the queue is full the entry is dropped and counted, so a
+   stalled disk never stalls a session.
+*/
+
+#define SLOW_LOG_FILE "data/slow_ops.log"
+#define SLOW_LOG_QUEUE 256          // Entries waiting for the logger thread
+#define SLOW_OP_THRESHOLD_MS 100    // Default threshold (./server -s ms, 0: off)
+
+// Opens SLOW_LOG_FILE, starts the logger thread and hooks into stats_stop.
+// Returns 0, or -1 if the file could not be opened.
+int slow_log_start(int threshold_ms);
+
+// Writes the threshold and the logged/dropped counters to fd
+void slow_log_report(int fd);
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "common.h"
+#include <stdint.h> // For uint64_t
+
+/*
+--- Handler and Data Access Latency ---
+
+-> Every menu handler, pipelined operation, ledger call and data access primitive is timed into
+   a latency histogram (histogram.h) per StatId. The count of a histogram doubles as the call
+   counter.
+-> Lock-free: each thread records into its own shard of histograms (allocated on its first
+   record), so recording never waits for another thread. A report merges the live shards plus
+   the shards of threads that already exited.
+-> Interactive handlers wait for the user in between (amount, account number, ...). The time a
+   session spent blocked in read_client_input during a handler is subtracted, so the numbers are
+   server time, comparable with the pipelined operations.
+-> Off until stats_enable(): admin_util, loadgen and data_bench share data_access.c but do not
+   pay for the clock reads.
+
+--- I/O Accounting ---
+
+-> io_backend.c charges every data-file read, write and fsync (calls, bytes, fsync time) to a
+   StatFile and to the originating handler: the outermost StatId being timed on the calling
+   thread (stats_context.handler). A getUser inside handle_deposit counts as handle_deposit; I/O outside
+   any handler (startup, recovery) is charged to "(no handler)".
+-> The counters live in the same per-thread shards as the histograms: a read or write costs a
+   few thread-local adds, an fsync two extra clock reads.
+*/
+
+typedef enum
+{
+    // Login
+    STAT_CHECK_LOGIN,
+    // Customer menu
+    STAT_VIEW_BALANCE,
+    STAT_DEPOSIT,
+    STAT_WITHDRAW,
+    STAT_TRANSFER_FUNDS,
+    STAT_TRANSACTION_HISTORY,
+    STAT_APPLY_LOAN,
+    STAT_LOAN_STATUS,
+    STAT_VIEW_MY_DETAILS,
+    STAT_ADD_FEEDBACK,
+    STAT_FEEDBACK_STATUS,
+    STAT_CHANGE_PASSWORD,
+    STAT_BATCH_TRANSFER,
+    STAT_STANDING_INSTRUCTIONS,
+    // Employee, manager and admin menus
+    STAT_ADD_USER,
+    STAT_ADD_NEW_ACCOUNT,
+    STAT_MODIFY_USER,
+    STAT_CUSTOMER_TRANSACTIONS,
+    STAT_ASSIGNED_LOANS,
+    STAT_PROCESS_LOAN,
+    STAT_SET_ACCOUNT_STATUS,
+    STAT_ASSIGN_LOAN,
+    STAT_REVIEW_FEEDBACK,
+    // Pipelined operations
+    STAT_OP_ACCOUNTS,
+    STAT_OP_BALANCE,
+    STAT_OP_DEPOSIT,
+    STAT_OP_WITHDRAW,
+    STAT_OP_TRANSFER,
+    STAT_OP_HISTORY,
+    STAT_OP_BATCH,
+    STAT_OP_SCHEDULE,
+    STAT_OP_INSTRUCTIONS,
+    STAT_OP_CANCEL,
+    // Scheduler (one batch of due standing instructions)
+    STAT_SCHEDULER_BATCH,
+    // Ledger
+    STAT_LEDGER_POST,
+    STAT_LEDGER_TRANSFER,
+    STAT_LEDGER_TRANSFER_BATCH,
+    // Data access
+    STAT_GET_USER,
+    STAT_GET_ACCOUNT,
+    STAT_GET_ACCOUNT_BY_NUM,
+    STAT_GET_LOAN,
+    STAT_GET_FEEDBACK,
+    STAT_ACCOUNTS_BY_OWNER,
+    STAT_ACCOUNTS_BY_NUMBERS,
+    STAT_GET_ACCOUNTS_AT,
+    STAT_APPEND_RECORD,
+    STAT_UPDATE_RECORD,
+    STAT_UPDATE_ACCOUNTS_AT,
+    STAT_ADD_TRANSACTIONS,
+    STAT_JOURNAL_ENTRY,
+    STAT_JOURNAL_ENTRIES,
+    STAT_COUNT
+} StatId;
+
+#define STATS_IO_TOP 15 // (file, handler) rows in the I/O report
+
+typedef enum
+{
+    STAT_FILE_USERS,
+    STAT_FILE_ACCOUNTS,
+    STAT_FILE_TRANSACTIONS,
+    STAT_FILE_LOANS,
+    STAT_FILE_FEEDBACK,
+    STAT_FILE_JOURNAL,
+    STAT_FILE_INSTRUCTIONS,
+    STAT_FILE_OTHER,
+    STAT_FILE_COUNT
+} StatFile;
+
+typedef enum
+{
+    STAT_IO_READ,
+    STAT_IO_WRITE,
+    STAT_IO_FSYNC
+} StatIoKind;
+
+typedef struct
+{
+    uint64_t start_ns;       // 0: stats disabled when the timer started
+    uint64_t client_wait_ns; // The session's client_wait_ns at the start
+    int outer_handler;       // stats_context.handler at the start, restored by stats_stop
+} StatTimer;
+
+// What the calling session is doing. Event loops save and restore it per coroutine.
+typedef struct
+{
+    int handler; // Outermost StatId being timed (-1: none); I/O is charged to it
+    int user_id; // Logged-in user (0: none), for the slow-operation log
+    // Since the outermost timer started
+    uint64_t reads, read_bytes; // A scan reads one record per call, so reads = records scanned
+    uint64_t fsyncs;
+    uint64_t lock_waits, lock_wait_ns; // Data file locks that had to wait (lock_profile.c)
+} StatsContext;
+
+extern __thread StatsContext stats_context;
+
+// Called with the context of every outermost operation that took at least threshold_ns
+typedef void (*StatsSlowHook)(StatId id, const StatsContext *context, uint64_t elapsed_ns);
+
+// Turns recording on (the server calls this at startup)
+void stats_enable();
+
+// Installs the slow-operation hook (slow_log.c). threshold_ns = 0 or hook = NULL: none.
+void stats_set_slow_hook(uint64_t threshold_ns, StatsSlowHook hook);
+
+// Name of a StatId ("handle_deposit", "pipeline TRANSFER", ...)
+const char *stats_name(StatId id);
+
+// The session's logged-in user, for the slow-operation log
+void stats_set_user(int userId);
+
+// A data file lock had to wait waited_ns for another process (lock_profile.c)
+void stats_lock_waited(uint64_t waited_ns);
+
+StatTimer stats_start(StatId id);
+
+// Records the time since timer started, minus the client input waits in between
+void stats_stop(StatId id, StatTimer timer);
+
+// Times one statement: STATS_TIME(STAT_DEPOSIT, handle_deposit(client_socket, accountId));
+#define STATS_TIME(id, statement)                 \
+    do                                            \
+    {                                             \
+        StatTimer stats_timer_ = stats_start(id); \
+        statement;                                \
+        stats_stop(id, stats_timer_);             \
+    } while (0)
+
+// Writes count, mean, p50/p90/p99 and max of every StatId called so far to fd
+void stats_report(int fd);
+
+// Which data file a path is (USER_FILE, ...; anything else is STAT_FILE_OTHER)
+StatFile stats_file_of(const char *path);
+
+// Monotonic nanoseconds to time an fsync with, 0 while stats are off
+uint64_t stats_clock();
+
+// Charges one I/O call on file to stats_context.handler. bytes: the call's result (ignored unless > 0);
+// started: stats_clock() before an fsync, for its latency.
+void stats_io(StatFile file, StatIoKind kind, ssize_t bytes, uint64_t started);
+
+// Writes per-file totals and the heaviest (file, handler) pairs to fd
+void stats_io_report(int fd);
+
+// Writes the latency summaries and I/O counters to fd in the Prometheus text format (metrics.h)
+void stats_metrics(int fd);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+#define TIMER_TICK_MS 100  // Resolution of the wheel
+#define TIMER_WHEEL_BITS 6 // 64 slots per level
+#define TIMER_WHEEL_LEVELS 4 // 64^4 ticks (about 19 days at 100 ms) before delays are clamped
+
+typedef void (*TimerCallback)(void *arg);
+
+// Intrusive doubly-linked list node (a wheel slot is a sentinel of this type)
+typedef struct TimerLink
+{
+    struct TimerLink *prev;
+    struct TimerLink *next;
+} TimerLink;
+
+// Embed one of these in the object that owns the timer. Zero-initialize before first use.
+typedef struct
+{
+    TimerLink link;     // Must stay the first member
+    uint64_t expires;   // Tick at which the callback runs
+    TimerCallback callback;
+    void *arg;
+    int armed;
+} TimerEntry;
+
+// Starts the tick thread. Call once from main() before arming timers.
+void timer_wheel_start();
+
+// Schedules callback(arg) to run on the tick thread after delay_ms (rounded up to a tick).
+// Re-arming an armed entry moves it. Callbacks may re-arm their own entry.
+void timer_arm(TimerEntry *timer, unsigned int delay_ms, TimerCallback callback, void *arg);
+
+// Disarms the entry. If its callback is running right now, waits for it to return,
+// so the owner may free the entry afterwards. Returns 1 if the timer was still pending.
+int timer_cancel(TimerEntry *timer);
+
+// Milliseconds on CLOCK_MONOTONIC (shared time base for deadlines)
+uint64_t monotonic_ms();
+
+#endif
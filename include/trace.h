@@ -0,0 +1,59 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "common.h"
+#include <stdint.h> // For uint64_t
+
+/*
+--- Span Tracing ---
+
+-> A span is a name, a start and an end (CLOCK_MONOTONIC nanoseconds) and the track it ran on.
+   Every stats timer (stats.h: handlers, pipelined ops, ledger calls, getAccount*, append_record,
+   update_record, journal_log_entry) ends in a span, and so do every data file fsync, the
+   ledger's lock waits and the parsing of a pipelined request. One transfer therefore shows as
+   nested bars: parse request, pipeline TRANSFER > ledger_transfer > wait account locks,
+   getAccount, wait journal lock, journal_log_entry > fsync journal.log, update_record >
+   fsync accounts.dat, append_record > fsync transactions.dat, ...
+-> Each thread writes into its own ring of TRACE_RING_SPANS spans; the oldest are overwritten.
+   Recording is lock-free and wait-free: a few relaxed stores and one release store per span.
+   Every slot carries a sequence number, so a dump running at the same time skips a slot that
+   is being overwritten instead of reading half of it.
+-> When a thread exits its ring is kept (the dump still shows its spans) and handed to the next
+   new thread, so memory grows with the number of threads alive at once, not ever created.
+-> trace_dump() writes the rings in the Chrome trace event format (JSON, "X" complete events),
+   which chrome://tracing, Perfetto (ui.perfetto.dev) and speedscope open directly. The server
+   dumps to TRACE_FILE on SIGQUIT and from the admin menu.
+-> Tracks: the kernel thread id, or for a session running as a coroutine (-e) a track of its
+   own, since several coroutines interleave on one event-loop thread.
+-> Off until trace_enable(). The timer and fsync spans reuse the stats clock reads; only the
+   parse and lock wait spans read the clock themselves.
+*/
+
+#define TRACE_RING_SPANS 2048           // Spans kept per ring (one ring per live thread, reused)
+#define TRACE_FILE "data/trace.json"
+#define TRACE_COROUTINE_TRACKS 1000000  // Coroutine tracks start here (above any thread id)
+
+// Track of the calling thread's current session (0: the thread id). Event loops save and
+// restore it per coroutine.
+extern __thread int trace_track;
+
+// Turns recording on (the server calls this at startup)
+void trace_enable();
+
+// Monotonic nanoseconds to start a span with, 0 while tracing is off
+uint64_t trace_begin();
+
+// Records the span [start_ns, end_ns]. name must be a string that lives forever (a literal).
+// start_ns 0 (tracing was off at the start) records nothing.
+void trace_span(const char *name, uint64_t start_ns, uint64_t end_ns);
+
+// Records the span from start_ns (trace_begin) to now
+void trace_end(const char *name, uint64_t start_ns);
+
+// A new track number for a coroutine
+int trace_new_track();
+
+// Writes every ring to path as Chrome trace JSON. Returns the number of spans written, or -1.
+long trace_dump(const char *path);
+
+#endif
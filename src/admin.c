@@ -3,12 +3,16 @@
 #include "manager.h"     // For shared handle_set_account_status
 #include "customer.h"    // For shared handle_view_my_details, handle_change_password
 #include "data_access.h" // Needed by shared functions
+#include "server.h"      // For server_report_stats
+#include "rate_limit.h"  // For read_menu_choice
+#include "stats.h"       // For STATS_TIME, stats_report, stats_io_report
+#include "trace.h"       // For trace_dump
 #include "common.h"      // For structs, enums, read_client_input, write_string
 #include <stdio.h>       // For sprintf
 #include <stdlib.h>      // For atoi
 
 // --- Admin Menu ---
-void admin_menu(int client_socket, User user)
+MenuExit admin_menu(int client_socket, User user)
 {
     char buffer[MAX_BUFFER];
     while (1)
@@ -20,10 +24,15 @@ void admin_menu(int client_socket, User user)
         write_string(client_socket, "3. Activate/Deactivate Any User & Accounts\n");
         write_string(client_socket, "4. View My Personal Details\n");
         write_string(client_socket, "5. Change My Password\n");
-        write_string(client_socket, "6. Logout\n");
+        write_string(client_socket, "6. Server Statistics\n");
+        write_string(client_socket, "7. Handler Latency\n");
+        write_string(client_socket, "8. Dump Request Trace\n");
+        write_string(client_socket, "9. Logout\n");
         write_string(client_socket, "Enter your choice: ");
 
-        read_client_input(client_socket, buffer, MAX_BUFFER);
+        // Check for disconnect (or a connection reaped by the idle timeout)
+        if (read_menu_choice(client_socket, buffer, MAX_BUFFER, user.userId) == -1)
+            return MENU_DISCONNECTED;
         int choice = atoi(buffer);
         switch (choice)
         {
@@ -33,7 +42,7 @@ void admin_menu(int client_socket, User user)
             int role = atoi(buffer);
             if (role == 1 || role == 2)
             {
-                handle_add_user(client_socket, (UserRole)role);
+                STATS_TIME(STAT_ADD_USER, handle_add_user(client_socket, (UserRole)role));
             }
             else
             {
@@ -41,20 +50,40 @@ void admin_menu(int client_socket, User user)
             }
             break;
         case 2:
-            handle_modify_user_details(client_socket, 1); 
+            STATS_TIME(STAT_MODIFY_USER, handle_modify_user_details(client_socket, 1)); 
             break;
         case 3:
-            handle_set_account_status(client_socket, 1);
+            STATS_TIME(STAT_SET_ACCOUNT_STATUS, handle_set_account_status(client_socket, 1));
             break;
         case 4:
-            handle_view_my_details(client_socket, user);
+            STATS_TIME(STAT_VIEW_MY_DETAILS, handle_view_my_details(client_socket, user));
             break;
         case 5:
-            handle_change_password(client_socket, user.userId);
+            STATS_TIME(STAT_CHANGE_PASSWORD, handle_change_password(client_socket, user.userId));
             break;
         case 6:
+            write_string(client_socket, "\n--- Server Statistics ---\n");
+            server_report_stats(client_socket);
+            break;
+        case 7:
+            write_string(client_socket, "\n--- Handler Latency ---\n");
+            stats_report(client_socket);
+            stats_io_report(client_socket);
+            break;
+        case 8:
+        {
+            long spans = trace_dump(TRACE_FILE);
+            if (spans < 0)
+                sprintf(buffer, "Could not write %s.\n", TRACE_FILE);
+            else
+                sprintf(buffer, "%ld span(s) written to %s (open it in chrome://tracing or ui.perfetto.dev).\n",
+                        spans, TRACE_FILE);
+            write_string(client_socket, buffer);
+            break;
+        }
+        case 9:
             write_string(client_socket, "Logging out. Goodbye!\n");
-            return; 
+            return MENU_LOGOUT;
         default:
             write_string(client_socket, "Invalid choice.\n");
         }
@@ -1,8 +1,36 @@
 #include "common.h"
+#include "password.h" // Passwords are stored as salted hashes
+#include "datagen.h"  // For the synthetic data generator (-g)
+#include <stdio.h>    // For snprintf
 
-int main()
+// Usage: ./admin_util                       default users and accounts only
+//        ./admin_util -g N [-t T] [-s SEED]  plus N generated users with their accounts, ~T
+//                                            transactions per account (default 10), loans and
+//                                            feedback; the same SEED (default 1) gives the same data
+int main(int argc, char *argv[])
 {
     int fd_user, fd_account;
+    DatagenOptions generate = {0, 10, 1};
+    int opt;
+    while ((opt = getopt(argc, argv, "g:t:s:")) != -1)
+    {
+        if (opt == 'g')
+            generate.users = atoi(optarg);
+        else if (opt == 't')
+            generate.txns_per_account = atoi(optarg);
+        else if (opt == 's')
+            generate.seed = strtoul(optarg, NULL, 10);
+        else
+        {
+            write_string(STDOUT_FILENO, "Usage: ./admin_util [-g users [-t txns_per_account] [-s seed]]\n");
+            return 1;
+        }
+    }
+    if (generate.users < 0 || generate.txns_per_account < 0)
+    {
+        write_string(STDOUT_FILENO, "Counts must not be negative.\n");
+        return 1;
+    }
 
     fd_user = open(USER_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
     if (fd_user == -1)
@@ -21,13 +49,14 @@ int main()
     open(LOAN_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
     open(FEEDBACK_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
     open(TRANSACTION_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    open(INSTRUCTION_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
 
     // --- User 1: Administrator ---  
     User admin;
     admin.userId = 1;
     admin.role = ADMINISTRATOR;
     admin.isActive = 1;
-    strcpy(admin.password, "admin123");
+    password_hash("admin123", admin.password);
     strcpy(admin.firstName, "Admin");
     strcpy(admin.lastName, "User");
     strcpy(admin.phone, "9876543210");
@@ -41,7 +70,7 @@ int main()
     customer.userId = 2;
     customer.role = CUSTOMER;
     customer.isActive = 1;
-    strcpy(customer.password, "cust123");
+    password_hash("cust123", customer.password);
     strcpy(customer.firstName, "Ravi");
     strcpy(customer.lastName, "Kumar");
     strcpy(customer.phone, "8888888888");
@@ -55,7 +84,7 @@ int main()
     employee.userId = 3;
     employee.role = EMPLOYEE;
     employee.isActive = 1;
-    strcpy(employee.password, "emp123");
+    password_hash("emp123", employee.password);
     strcpy(employee.firstName, "Priya");
     strcpy(employee.lastName, "Sharma");
     strcpy(employee.phone, "7777777777");
@@ -69,7 +98,7 @@ int main()
     manager.userId = 4;
     manager.role = MANAGER;
     manager.isActive = 1;
-    strcpy(manager.password, "man123");
+    password_hash("man123", manager.password);
     strcpy(manager.firstName, "Vikram");
     strcpy(manager.lastName, "Singh");
     strcpy(manager.phone, "6666666666");
@@ -104,5 +133,21 @@ int main()
 
     write_string(STDOUT_FILENO, "All data files initialized successfully.\n");
 
+    if (generate.users > 0)
+    {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (datagen_run(&generate) == -1)
+        {
+            write_string(STDOUT_FILENO, "Data generation failed.\n");
+            return 1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        char buffer[96];
+        snprintf(buffer, sizeof(buffer), "Generated in %.2f s (password for generated users: %s).\n",
+                 (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9, DATAGEN_PASSWORD);
+        write_string(STDOUT_FILENO, buffer);
+    }
+
     return 0;
 }
\ No newline at end of file
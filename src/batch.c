@@ -0,0 +1,296 @@
+// src/batch.c
+#include "batch.h"    // Exit codes and batch_run
+#include "pipeline.h" // For PIPELINE_HELLO, PIPELINE_MAX_INFLIGHT
+#include <netinet/tcp.h> // For TCP_NODELAY
+#include <poll.h>     // For poll
+#include <signal.h>   // For ignoring SIGPIPE
+#include <stdint.h>   // For uint64_t
+#include <stdio.h>    // For snprintf
+
+#define LINE_BUFFER PIPELINE_MAX_LINE // A script line is one request (a BATCH can be long)
+
+typedef struct
+{
+    int fd;
+    int eof;
+    int start;
+    int end;
+    char buf[LINE_BUFFER];
+} LineReader;
+
+typedef struct
+{
+    int line;        // Script line number
+    int done;        // Reply received
+    uint64_t sent_us;
+    uint64_t latency_us;
+} Step;
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Moves the next complete line out of the buffer. A last line without '\n' counts once the
+// input has ended. Returns its length, or -1 if no complete line is buffered.
+static int take_line(LineReader *reader, char *out, int size)
+{
+    char *start = reader->buf + reader->start;
+    char *newline = memchr(start, '\n', reader->end - reader->start);
+    if (newline == NULL && !(reader->eof && reader->start < reader->end))
+        return -1;
+
+    int line_end = (newline != NULL) ? (int)(newline - reader->buf) : reader->end;
+    int len = 0;
+    for (int i = reader->start; i < line_end; i++)
+    {
+        if (reader->buf[i] != '\r' && len < size - 1)
+            out[len++] = reader->buf[i];
+    }
+    out[len] = '\0';
+    reader->start = (newline != NULL) ? line_end + 1 : line_end;
+    return len;
+}
+
+// One read() into the buffer. Returns the byte count, 0 at end of input, -1 on error.
+static int fill(LineReader *reader)
+{
+    if (reader->start > 0)
+    {
+        memmove(reader->buf, reader->buf + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+    if (reader->end == LINE_BUFFER)
+        reader->end = 0; // A single line longer than the buffer: drop it rather than stall
+
+    ssize_t n;
+    do
+    {
+        n = read(reader->fd, reader->buf + reader->end, LINE_BUFFER - reader->end);
+    } while (n == -1 && errno == EINTR);
+    if (n == 0)
+        reader->eof = 1;
+    if (n > 0)
+        reader->end += n;
+    return (int)n;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Prints the throughput and latency summary for steps[1..count) (step 0 is the AUTH)
+static void print_summary(Step *steps, int count, int failed, uint64_t elapsed_us)
+{
+    char buffer[256];
+    int measured = count - 1;
+    write_string(STDOUT_FILENO, "--- Batch Summary ---\n");
+    snprintf(buffer, sizeof(buffer), "Requests: %d (ok %d, err %d) in %.3f s = %.0f req/s\n", measured,
+             measured - failed, failed, elapsed_us / 1e6, elapsed_us ? measured * 1e6 / elapsed_us : 0.0);
+    write_string(STDOUT_FILENO, buffer);
+    if (measured <= 0)
+        return;
+
+    uint64_t *latencies = malloc(sizeof(uint64_t) * measured);
+    if (latencies == NULL)
+        return;
+    uint64_t total = 0;
+    for (int i = 0; i < measured; i++)
+    {
+        latencies[i] = steps[i + 1].latency_us;
+        total += latencies[i];
+    }
+    qsort(latencies, measured, sizeof(uint64_t), compare_u64);
+    snprintf(buffer, sizeof(buffer), "Latency ms: avg %.3f  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+             total / 1000.0 / measured, latencies[measured / 2] / 1000.0, latencies[measured * 90 / 100] / 1000.0,
+             latencies[measured * 99 / 100] / 1000.0, latencies[measured - 1] / 1000.0);
+    write_string(STDOUT_FILENO, buffer);
+    free(latencies);
+}
+
+// Sends PIPELINE_HELLO and waits for "PIPELINE READY". Returns 0 or -1.
+static int handshake(int sock, LineReader *replies)
+{
+    char line[LINE_BUFFER];
+    write_string(sock, PIPELINE_HELLO "\n");
+    while (1)
+    {
+        while (take_line(replies, line, sizeof(line)) != -1)
+        {
+            // The welcome menu's last prompt has no newline, so READY ends up on the same line
+            if (strstr(line, "PIPELINE READY") != NULL)
+                return 0;
+        }
+        if (fill(replies) <= 0)
+            return -1;
+    }
+}
+
+int batch_run(int sock, int script_fd, int window, int quiet)
+{
+    // A server that goes away must show up as a lost connection, not kill the client
+    signal(SIGPIPE, SIG_IGN);
+    // Requests are small and sent back to back: without this, Nagle holds each one until the
+    // previous one is acknowledged and the measured latency is mostly delayed-ACK time.
+    // (Fails harmlessly on a unix socket.)
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (window < 1)
+        window = 1;
+    if (window > PIPELINE_MAX_INFLIGHT)
+        window = PIPELINE_MAX_INFLIGHT;
+
+    static LineReader script, replies; // Static: two LINE_BUFFER (16 KB) buffers
+    script.fd = script_fd;
+    replies.fd = sock;
+
+    if (handshake(sock, &replies) == -1)
+    {
+        write_string(STDOUT_FILENO, "Batch: server did not accept the pipelined protocol.\n");
+        return BATCH_EXIT_ERROR;
+    }
+
+    Step *steps = NULL;
+    int count = 0, capacity = 0;
+    int inflight = 0, waiting = 0, failed = 0, line_no = 0;
+    int result = BATCH_EXIT_OK;
+    uint64_t started_us = 0;
+    char line[LINE_BUFFER], request[LINE_BUFFER + 16];
+
+    while (1)
+    {
+        // --- Send as much of the script as the window allows ---
+        int len;
+        while (!waiting && inflight < window && (len = take_line(&script, line, sizeof(line))) != -1)
+        {
+            line_no++;
+            if (len == 0 || line[0] == '#')
+                continue;
+            if (my_strcmp(line, "WAIT") == 0)
+            {
+                waiting = (inflight > 0);
+                continue;
+            }
+            if (count == 0 && strncmp(line, "AUTH ", 5) != 0 && strncmp(line, "RESUME ", 7) != 0)
+            {
+                snprintf(request, sizeof(request), "Batch: line %d: the first request must be AUTH or RESUME.\n",
+                         line_no);
+                write_string(STDOUT_FILENO, request);
+                result = BATCH_EXIT_ERROR;
+                goto done;
+            }
+
+            if (count == capacity)
+            {
+                capacity = capacity ? capacity * 2 : 1024;
+                Step *grown = realloc(steps, sizeof(Step) * capacity);
+                if (grown == NULL)
+                {
+                    perror("batch: realloc");
+                    result = BATCH_EXIT_ERROR;
+                    goto done;
+                }
+                steps = grown;
+            }
+            steps[count].line = line_no;
+            steps[count].done = 0;
+            steps[count].sent_us = now_us();
+            snprintf(request, sizeof(request), "%d %s\n", count, line);
+            write_string(sock, request);
+            waiting = (count == 0); // Nothing else goes out until AUTH has answered
+            count++;
+            inflight++;
+        }
+
+        if (inflight == 0 && script.eof && script.start == script.end)
+            break; // Script finished and every request answered
+
+        // --- Wait for replies (and for more script input if there is room for it) ---
+        struct pollfd fds[2];
+        int nfds = 1;
+        fds[0].fd = sock;
+        fds[0].events = POLLIN;
+        if (!script.eof && !waiting && inflight < window)
+        {
+            fds[1].fd = script_fd;
+            fds[1].events = POLLIN;
+            nfds = 2;
+        }
+        if (poll(fds, nfds, -1) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("batch: poll");
+            result = BATCH_EXIT_ERROR;
+            goto done;
+        }
+        if (nfds == 2 && (fds[1].revents & (POLLIN | POLLHUP)) && fill(&script) == -1)
+        {
+            perror("batch: read script");
+            result = BATCH_EXIT_ERROR;
+            goto done;
+        }
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR)))
+            continue;
+        if (fill(&replies) <= 0)
+        {
+            write_string(STDOUT_FILENO, "Batch: connection lost.\n");
+            result = BATCH_EXIT_ERROR;
+            goto done;
+        }
+
+        // --- Match replies to steps ---
+        while (take_line(&replies, line, sizeof(line)) != -1)
+        {
+            char *rest = strchr(line, ' ');
+            int id = atoi(line);
+            if (rest == NULL || id < 0 || id >= count || steps[id].done)
+                continue; // Not one of ours
+            rest++;
+            steps[id].done = 1;
+            steps[id].latency_us = now_us() - steps[id].sent_us;
+            inflight--;
+            int ok = (strncmp(rest, "OK", 2) == 0);
+
+            if (!quiet || !ok)
+            {
+                char out[LINE_BUFFER + 32];
+                snprintf(out, sizeof(out), "%5d %9.3f %s\n", steps[id].line, steps[id].latency_us / 1000.0, rest);
+                write_string(STDOUT_FILENO, out);
+            }
+            if (id == 0)
+            {
+                if (!ok)
+                {
+                    result = BATCH_EXIT_ERROR;
+                    goto done;
+                }
+                started_us = now_us();
+            }
+            else if (!ok)
+            {
+                failed++;
+                result = BATCH_EXIT_FAILED;
+            }
+        }
+        if (inflight == 0)
+            waiting = 0;
+    }
+
+    if (count > 0)
+    {
+        write_string(sock, "q QUIT\n");
+        print_summary(steps, count, failed, now_us() - started_us);
+    }
+
+done:
+    free(steps);
+    return result;
+}
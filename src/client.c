@@ -1,10 +1,47 @@
 #include "common.h"
+#include "session_token.h" // For TOKEN_LENGTH, TOKEN_RESUME_CMD
+#include "batch.h"         // For batch_run (-b)
+#include <sys/un.h>        // For sockaddr_un (local connections)
 
-int main()
+// Where the client remembers the last session token (for ./client -r)
+#define TOKEN_FILE ".bank_session"
+
+// Saves the token from a "Session Token: <token>" line so a later run can resume
+static void save_token(const char *text)
 {
-    int sock = 0;
+    const char *start = strstr(text, "Session Token: ");
+    if (start == NULL)
+        return;
+    start += strlen("Session Token: ");
+    if ((int)strcspn(start, "\r\n") != TOKEN_LENGTH)
+        return; // Token split across reads; keep the previous one
+
+    int fd = open(TOKEN_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1)
+        return;
+    write(fd, start, TOKEN_LENGTH);
+    close(fd);
+}
+
+// Reads the token saved by save_token. Returns 0 on success.
+static int load_token(char *token)
+{
+    int fd = open(TOKEN_FILE, O_RDONLY);
+    if (fd == -1)
+        return -1;
+    ssize_t n = read(fd, token, TOKEN_LENGTH);
+    close(fd);
+    if (n != TOKEN_LENGTH)
+        return -1;
+    token[TOKEN_LENGTH] = '\0';
+    return 0;
+}
+
+// Connects to the server over TCP loopback. Returns the socket or -1.
+static int connect_tcp()
+{
+    int sock;
     struct sockaddr_in serv_addr;
-    char buffer[MAX_BUFFER] = {0};
 
     if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0)
     {
@@ -18,14 +55,125 @@ int main()
     if (inet_pton(AF_INET, "127.0.0.1", &serv_addr.sin_addr) <= 0)
     {
         write_string(STDOUT_FILENO, "\nInvalid address/ Address not supported \n");
+        close(sock);
+        return -1;
+    }
+
+    if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+    {
+        write_string(STDOUT_FILENO, "\nConnection Failed \n");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Connects through the server's AF_UNIX socket (same host only, no TCP/IP stack involved)
+static int connect_unix(const char *path)
+{
+    int sock;
+    struct sockaddr_un serv_addr;
+
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(serv_addr.sun_path))
+    {
+        write_string(STDOUT_FILENO, "\nSocket path too long \n");
+        return -1;
+    }
+    strcpy(serv_addr.sun_path, path);
+
+    if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        write_string(STDOUT_FILENO, "\n Socket creation error \n");
         return -1;
     }
 
     if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
     {
         write_string(STDOUT_FILENO, "\nConnection Failed \n");
+        close(sock);
         return -1;
     }
+    return sock;
+}
+
+int main(int argc, char *argv[])
+{
+    int sock = 0;
+    const char *unix_path = NULL; // Set by -u / -l: connect through the local socket
+    char buffer[MAX_BUFFER] = {0};
+    char token[TOKEN_LENGTH + 1] = ""; // Non-empty: resume this session instead of logging in
+    int script_fd = -1;                // Set by -b: run this script in batch mode
+    int window = BATCH_WINDOW;
+    int quiet = 0;
+
+    // Usage: ./client            log in normally
+    //        ./client -r         resume the last session (token saved in .bank_session)
+    //        ./client -t TOKEN   resume the session with this token
+    //        ./client -l         connect through the local unix socket (UNIX_SOCKET_PATH)
+    //        ./client -u PATH    connect through the unix socket at PATH
+    //        ./client -b SCRIPT  run SCRIPT ("-" for stdin) in batch mode, see batch.h
+    //                 [-w N]     with up to N requests in flight, [-q] printing only the summary
+    int opt;
+    while ((opt = getopt(argc, argv, "rt:lu:b:w:q")) != -1)
+    {
+        if (opt == 'r')
+        {
+            if (load_token(token) == -1)
+            {
+                write_string(STDOUT_FILENO, "No saved session to resume.\n");
+                return -1;
+            }
+        }
+        else if (opt == 't' && strlen(optarg) == TOKEN_LENGTH)
+        {
+            strcpy(token, optarg);
+        }
+        else if (opt == 'l')
+        {
+            unix_path = UNIX_SOCKET_PATH;
+        }
+        else if (opt == 'u')
+        {
+            unix_path = optarg;
+        }
+        else if (opt == 'b')
+        {
+            script_fd = (my_strcmp(optarg, "-") == 0) ? STDIN_FILENO : open(optarg, O_RDONLY);
+            if (script_fd == -1)
+            {
+                perror("client: open script");
+                return BATCH_EXIT_ERROR;
+            }
+        }
+        else if (opt == 'w')
+        {
+            window = atoi(optarg);
+        }
+        else if (opt == 'q')
+        {
+            quiet = 1;
+        }
+        else
+        {
+            write_string(STDOUT_FILENO, "Usage: ./client [-r | -t token] [-l | -u socket_path] [-b script [-w window] [-q]]\n");
+            return -1;
+        }
+    }
+
+    sock = (unix_path != NULL) ? connect_unix(unix_path) : connect_tcp();
+    if (sock < 0)
+    {
+        return (script_fd != -1) ? BATCH_EXIT_ERROR : -1;
+    }
+
+    if (script_fd != -1)
+    {
+        int status = batch_run(sock, script_fd, window, quiet);
+        close(sock);
+        return status;
+    }
 
     write_string(STDOUT_FILENO, "Connected to bank server.\n");
 
@@ -39,6 +187,16 @@ int main()
         }
         buffer[read_size] = '\0';
         write_string(STDOUT_FILENO, buffer);
+        save_token(buffer);
+
+        if (token[0] != '\0' && strstr(buffer, "Enter") != NULL)
+        {
+            // First prompt of a resumed session: answer with the token instead of a role
+            read_size = sprintf(buffer, "%s %s\n", TOKEN_RESUME_CMD, token);
+            write(sock, buffer, read_size);
+            token[0] = '\0';
+            continue;
+        }
 
         if (strstr(buffer, "Enter") != NULL)
         {
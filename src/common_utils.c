@@ -1,6 +1,25 @@
 #include "common.h"
 #include <ctype.h> // For isdigit()
 #include <errno.h> // For errno
+#include <poll.h>  // For poll (waiting on non-blocking sockets)
+
+int (*fd_wait_hook)(int fd, short events) = NULL;
+
+int wait_for_fd(int fd, short events)
+{
+    if (fd_wait_hook != NULL && fd_wait_hook(fd, events) == 0)
+        return 0; // Resumed by the event loop
+
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    while (poll(&pfd, 1, -1) == -1)
+    {
+        if (errno != EINTR)
+            return -1;
+    }
+    return 0;
+}
 
 void write_string(int fd, const char *str)
 {
@@ -9,7 +28,30 @@ void write_string(int fd, const char *str)
     {
         len++;
     }
-    write(fd, str, len);
+    // Sockets can be non-blocking (event-loop sessions): finish partial writes and wait
+    // for buffer space instead of dropping the rest of the message.
+    int sent = 0;
+    while (sent < len)
+    {
+        ssize_t n = write(fd, str + sent, len - sent);
+        if (n > 0)
+        {
+            sent += n;
+        }
+        else if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            if (wait_for_fd(fd, POLLOUT) == -1)
+                return;
+        }
+        else
+        {
+            return; // Peer gone; the next read reports the disconnect
+        }
+    }
 }
 
 int my_strcmp(const char *s1, const char *s2)
@@ -22,8 +64,19 @@ int my_strcmp(const char *s1, const char *s2)
     return *(const unsigned char *)s1 - *(const unsigned char *)s2;
 }
 
+void (*client_input_hook)(int client_socket) = NULL;
+__thread uint64_t client_wait_ns = 0;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
 int read_client_input(int client_socket, char *buffer, int size)
 {
+    uint64_t started = now_ns();
     memset(buffer, 0, size);
     int total_read = 0;
     int read_size = 0;
@@ -54,12 +107,17 @@ int read_client_input(int client_socket, char *buffer, int size)
         { 
             if (errno == EINTR)
                 continue;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_for_fd(client_socket, POLLIN) == 0)
+                continue; // Non-blocking socket: resumed once input arrived
             perror("read from client");
             buffer[0] = '\0';
             return -1; 
         }
     }
     buffer[total_read] = '\0';
+    client_wait_ns += now_ns() - started;
+    if (client_input_hook != NULL)
+        client_input_hook(client_socket);
     return 0; 
 }
 
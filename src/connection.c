@@ -0,0 +1,200 @@
+// src/connection.c
+#include "connection.h" // Connection struct and prototypes
+#include <pthread.h>    // For the registry mutex
+#include <stdio.h>      // For snprintf
+#include <stdlib.h>     // For calloc, free
+
+/*
+--- Connection Deadlines ---
+
+-> read_client_input() blocks until the client types something. A client that connects and then
+   says nothing would hold its thread (and after login, its session slot) forever.
+-> Every connection therefore has one timer on the timer wheel:
+   - login phase: it must be logged in LOGIN_TIMEOUT_SECONDS after connecting.
+   - logged in:   it must send input at least every IDLE_TIMEOUT_SECONDS.
+-> Input does not touch the wheel: read_client_input() only stores a timestamp (through
+   client_input_hook). When the timer fires it compares the timestamp with the deadline and either
+   re-arms for the remaining time or reaps the connection.
+-> Reaping is shutdown(SHUT_RDWR) on the socket. The blocked read() returns 0, the handler sees a
+   normal disconnect and runs its usual cleanup (session_remove etc.), on its own thread.
+-> A graceful shutdown uses the same trick with SHUT_RD on every connection: a handler that is
+   in the middle of an operation finishes it (and can still send the reply), then its next read
+   sees EOF and it cleans up.
+*/
+
+static unsigned int login_timeout_ms = LOGIN_TIMEOUT_SECONDS * 1000;
+static unsigned int idle_timeout_ms = IDLE_TIMEOUT_SECONDS * 1000;
+
+static Connection *registry = NULL; // Doubly-linked list of open connections
+static int open_count = 0;
+static int draining = 0; // Set by connection_drain_all: new connections are closed for input at once
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static atomic_ulong reaped_login;
+static atomic_ulong reaped_idle;
+
+static __thread Connection *current_connection = NULL;
+
+void connection_set_timeouts(int login_seconds, int idle_seconds)
+{
+    if (login_seconds > 0)
+        login_timeout_ms = (unsigned int)login_seconds * 1000;
+    if (idle_seconds > 0)
+        idle_timeout_ms = (unsigned int)idle_seconds * 1000;
+}
+
+Connection *connection_current()
+{
+    return current_connection;
+}
+
+void connection_set_current(Connection *conn)
+{
+    current_connection = conn;
+}
+
+void connection_touch(Connection *conn)
+{
+    atomic_store_explicit(&conn->last_input_ms, monotonic_ms(), memory_order_relaxed);
+}
+
+// read_client_input hook: input on this thread's connection
+static void input_hook(int client_socket)
+{
+    Connection *conn = current_connection;
+    if (conn != NULL && conn->client_socket == client_socket)
+        connection_touch(conn);
+}
+
+// Timer callback (runs on the timer wheel thread)
+static void deadline_expired(void *arg)
+{
+    Connection *conn = (Connection *)arg;
+    uint64_t now = monotonic_ms();
+    uint64_t deadline;
+    ReapReason reason;
+
+    int userId = atomic_load(&conn->userId);
+    if (userId == 0)
+    {
+        deadline = conn->connected_ms + login_timeout_ms;
+        reason = REAP_LOGIN;
+    }
+    else
+    {
+        deadline = atomic_load_explicit(&conn->last_input_ms, memory_order_relaxed) + idle_timeout_ms;
+        reason = REAP_IDLE;
+    }
+
+    if (now < deadline)
+    {
+        timer_arm(&conn->deadline, (unsigned int)(deadline - now), deadline_expired, conn);
+        return;
+    }
+
+    conn->reaped = reason;
+    atomic_fetch_add_explicit(reason == REAP_LOGIN ? &reaped_login : &reaped_idle, 1, memory_order_relaxed);
+
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "Reaping %s connection from %s (user %d).\n",
+             reason == REAP_LOGIN ? "login-phase" : "idle", conn->peer, userId);
+    write_string(STDOUT_FILENO, buffer);
+
+    // Wakes the handler's blocked read() with EOF; its normal cleanup does the rest
+    shutdown(conn->client_socket, SHUT_RDWR);
+}
+
+Connection *connection_open(int client_socket)
+{
+    Connection *conn = (Connection *)calloc(1, sizeof(Connection));
+    if (conn == NULL)
+    {
+        perror("connection_open: calloc");
+        return NULL;
+    }
+    conn->client_socket = client_socket;
+    conn->connected_ms = monotonic_ms();
+    atomic_init(&conn->last_input_ms, conn->connected_ms);
+
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    strcpy(conn->peer, "local");
+    if (getpeername(client_socket, (struct sockaddr *)&peer, &peer_len) == 0)
+    {
+        if (peer.ss_family == AF_INET)
+            inet_ntop(AF_INET, &((struct sockaddr_in *)&peer)->sin_addr, conn->peer, sizeof(conn->peer));
+        else if (peer.ss_family == AF_INET6)
+            inet_ntop(AF_INET6, &((struct sockaddr_in6 *)&peer)->sin6_addr, conn->peer, sizeof(conn->peer));
+    }
+
+    pthread_mutex_lock(&registry_mutex);
+    conn->next = registry;
+    if (registry != NULL)
+        registry->prev = conn;
+    registry = conn;
+    open_count++;
+    if (draining)
+        shutdown(client_socket, SHUT_RD);
+    pthread_mutex_unlock(&registry_mutex);
+
+    client_input_hook = input_hook;
+    current_connection = conn;
+    timer_arm(&conn->deadline, login_timeout_ms, deadline_expired, conn);
+    return conn;
+}
+
+void connection_logged_in(Connection *conn, int userId)
+{
+    connection_touch(conn);
+    atomic_store(&conn->userId, userId); // The pending login deadline re-arms itself for the idle timeout
+}
+
+ReapReason connection_close(Connection *conn)
+{
+    timer_cancel(&conn->deadline); // Waits if the deadline callback is running right now
+
+    pthread_mutex_lock(&registry_mutex);
+    if (conn->prev != NULL)
+        conn->prev->next = conn->next;
+    else
+        registry = conn->next;
+    if (conn->next != NULL)
+        conn->next->prev = conn->prev;
+    open_count--;
+    pthread_mutex_unlock(&registry_mutex);
+
+    if (current_connection == conn)
+        current_connection = NULL;
+    ReapReason reason = conn->reaped;
+    free(conn);
+    return reason;
+}
+
+void connection_drain_all(int how)
+{
+    pthread_mutex_lock(&registry_mutex);
+    draining = 1;
+    for (Connection *conn = registry; conn != NULL; conn = conn->next)
+        shutdown(conn->client_socket, how);
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+int connection_open_count()
+{
+    pthread_mutex_lock(&registry_mutex);
+    int open_now = open_count;
+    pthread_mutex_unlock(&registry_mutex);
+    return open_now;
+}
+
+void connection_report(int fd)
+{
+    char buffer[160];
+    int open_now = connection_open_count();
+
+    snprintf(buffer, sizeof(buffer),
+             "Open connections: %d\nReaped (login timeout %us): %lu\nReaped (idle timeout %us): %lu\n",
+             open_now, login_timeout_ms / 1000, atomic_load(&reaped_login),
+             idle_timeout_ms / 1000, atomic_load(&reaped_idle));
+    write_string(fd, buffer);
+}
@@ -0,0 +1,320 @@
+// src/coroutine.c
+#include "coroutine.h"   // Coroutine and event-loop API
+#include "connection.h"  // For connection_current (saved per coroutine)
+#include "stats.h"       // For stats_context (saved per coroutine)
+#include "trace.h"       // For trace_track (one per coroutine)
+#include "timer_wheel.h" // For coroutine_sleep
+#include <poll.h>        // For POLLIN, POLLOUT
+#include <pthread.h>     // For loop threads
+#include <stdatomic.h>   // For counters
+#include <stdio.h>       // For snprintf
+#include <sys/epoll.h>   // For epoll_create1, epoll_ctl, epoll_wait
+#include <sys/eventfd.h> // For waking a loop from other threads
+#include <sys/mman.h>    // For coroutine stacks
+#include <ucontext.h>    // For getcontext, makecontext, swapcontext
+
+/*
+--- How a loop thread runs sessions ---
+
+-> Each coroutine has its own stack (mmap'ed, with a guard page) and a saved CPU context.
+   swapcontext() saves the loop's registers and jumps into the session; when the session calls
+   coroutine_wait_fd() it swaps back, and the loop continues with the next ready session.
+-> Readiness comes from epoll. A waiting session registers its socket with EPOLLONESHOT, so each
+   readiness event resumes it exactly once.
+-> New sessions and timer wake-ups come from other threads (acceptors, the timer wheel). They are
+   put on the loop's 'incoming' list and the loop is woken through its eventfd.
+*/
+
+typedef struct Coroutine
+{
+    ucontext_t context;
+    CoroutineEntry entry;
+    void *arg;
+    void *stack;          // mmap'ed, COROUTINE_STACK_SIZE + guard page
+    int finished;
+    int epoll_fd;         // fd currently registered with the loop's epoll (-1: none)
+    Connection *connection; // Restored as the thread's current connection when resumed
+    uint64_t client_wait_ns; // Restored as the thread's client_wait_ns when resumed
+    StatsContext stats_context; // Restored as the thread's stats_context when resumed
+    int trace_track;            // The session's spans go to their own track
+    TimerEntry sleep_timer;
+    struct EventLoop *loop;
+    struct Coroutine *next; // Run / incoming list link
+} Coroutine;
+
+typedef struct EventLoop
+{
+    int index;
+    int epoll_fd;
+    int wake_fd; // eventfd
+    pthread_t thread;
+    ucontext_t context; // The loop's own context while a coroutine runs
+    pthread_mutex_t incoming_mutex;
+    Coroutine *incoming; // Spawned or woken from another thread
+    atomic_int sessions;
+    atomic_ulong switches;
+} EventLoop;
+
+static EventLoop loops[EVENT_LOOP_MAX];
+static int loop_count = 0;
+static atomic_uint next_loop;
+static size_t page_size = 4096;
+
+static __thread EventLoop *current_loop = NULL;
+static __thread Coroutine *current_coroutine = NULL;
+
+static int fd_wait_hook_impl(int fd, short events)
+{
+    return coroutine_wait_fd(fd, events);
+}
+
+int event_loop_active()
+{
+    return loop_count > 0;
+}
+
+int coroutine_running()
+{
+    return current_coroutine != NULL;
+}
+
+// Queues co on its loop from any thread and wakes the loop
+static void make_ready(Coroutine *co)
+{
+    EventLoop *loop = co->loop;
+    pthread_mutex_lock(&loop->incoming_mutex);
+    co->next = loop->incoming;
+    loop->incoming = co;
+    pthread_mutex_unlock(&loop->incoming_mutex);
+
+    uint64_t one = 1;
+    if (write(loop->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        perror("event loop: wake");
+}
+
+static void coroutine_trampoline()
+{
+    Coroutine *co = current_coroutine;
+    co->entry(co->arg);
+    co->finished = 1;
+    // Returning switches to uc_link (the loop context)
+}
+
+static void coroutine_free(Coroutine *co)
+{
+    munmap(co->stack, COROUTINE_STACK_SIZE + page_size);
+    free(co);
+}
+
+// Switches into co until it yields or finishes
+static void resume(EventLoop *loop, Coroutine *co)
+{
+    current_coroutine = co;
+    connection_set_current(co->connection);
+    client_wait_ns = co->client_wait_ns;
+    stats_context = co->stats_context;
+    trace_track = co->trace_track;
+    atomic_fetch_add_explicit(&loop->switches, 1, memory_order_relaxed);
+    swapcontext(&loop->context, &co->context);
+    current_coroutine = NULL;
+    trace_track = 0;
+
+    if (co->finished)
+    {
+        atomic_fetch_sub_explicit(&loop->sessions, 1, memory_order_relaxed);
+        coroutine_free(co);
+    }
+}
+
+static void *loop_thread(void *arg)
+{
+    EventLoop *loop = (EventLoop *)arg;
+    current_loop = loop;
+    struct epoll_event events[64];
+
+    while (1)
+    {
+        int n = epoll_wait(loop->epoll_fd, events, 64, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            if (events[i].data.ptr == NULL)
+            {
+                uint64_t count;
+                while (read(loop->wake_fd, &count, sizeof(count)) > 0)
+                {
+                }
+                continue;
+            }
+            resume(loop, (Coroutine *)events[i].data.ptr);
+        }
+
+        // Sessions spawned or woken by other threads
+        pthread_mutex_lock(&loop->incoming_mutex);
+        Coroutine *ready = loop->incoming;
+        loop->incoming = NULL;
+        pthread_mutex_unlock(&loop->incoming_mutex);
+        while (ready != NULL)
+        {
+            Coroutine *co = ready;
+            ready = ready->next;
+            resume(loop, co);
+        }
+    }
+    return NULL;
+}
+
+int event_loop_start(int threads)
+{
+    if (threads > EVENT_LOOP_MAX)
+        threads = EVENT_LOOP_MAX;
+    long page = sysconf(_SC_PAGESIZE);
+    if (page > 0)
+        page_size = (size_t)page;
+
+    for (int i = 0; i < threads; i++)
+    {
+        EventLoop *loop = &loops[loop_count];
+        loop->index = loop_count;
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->epoll_fd == -1 || loop->wake_fd == -1)
+        {
+            perror("event loop: epoll/eventfd");
+            break;
+        }
+        struct epoll_event wake_event;
+        wake_event.events = EPOLLIN;
+        wake_event.data.ptr = NULL; // NULL marks the eventfd
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &wake_event);
+        pthread_mutex_init(&loop->incoming_mutex, NULL);
+        atomic_init(&loop->sessions, 0);
+        atomic_init(&loop->switches, 0);
+
+        if (pthread_create(&loop->thread, NULL, loop_thread, loop) != 0)
+        {
+            perror("event loop: pthread_create");
+            break;
+        }
+        pthread_detach(loop->thread);
+        loop_count++;
+    }
+
+    if (loop_count > 0)
+        fd_wait_hook = fd_wait_hook_impl;
+    return loop_count;
+}
+
+int coroutine_spawn(CoroutineEntry entry, void *arg)
+{
+    if (loop_count == 0)
+        return -1;
+
+    Coroutine *co = (Coroutine *)calloc(1, sizeof(Coroutine));
+    if (co == NULL)
+        return -1;
+    co->stats_context.handler = -1;
+    co->trace_track = trace_new_track();
+
+    // Lowest page stays PROT_NONE: a stack overflow faults instead of corrupting the heap
+    co->stack = mmap(NULL, COROUTINE_STACK_SIZE + page_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (co->stack == MAP_FAILED)
+    {
+        perror("coroutine stack");
+        free(co);
+        return -1;
+    }
+    mprotect(co->stack, page_size, PROT_NONE);
+
+    co->entry = entry;
+    co->arg = arg;
+    co->epoll_fd = -1;
+    co->loop = &loops[atomic_fetch_add(&next_loop, 1) % (unsigned)loop_count];
+
+    getcontext(&co->context);
+    co->context.uc_stack.ss_sp = (char *)co->stack + page_size;
+    co->context.uc_stack.ss_size = COROUTINE_STACK_SIZE;
+    co->context.uc_link = &co->loop->context;
+    makecontext(&co->context, coroutine_trampoline, 0);
+
+    atomic_fetch_add_explicit(&co->loop->sessions, 1, memory_order_relaxed);
+    make_ready(co);
+    return 0;
+}
+
+// Gives control back to the loop; returns when the loop resumes this coroutine
+static void yield(Coroutine *co)
+{
+    co->connection = connection_current();
+    co->client_wait_ns = client_wait_ns;
+    co->stats_context = stats_context;
+    swapcontext(&co->context, &co->loop->context);
+}
+
+int coroutine_wait_fd(int fd, short events)
+{
+    Coroutine *co = current_coroutine;
+    if (co == NULL)
+        return -1;
+
+    struct epoll_event event;
+    event.events = EPOLLONESHOT | ((events & POLLIN) ? EPOLLIN : 0) | ((events & POLLOUT) ? EPOLLOUT : 0);
+    event.data.ptr = co;
+
+    // First wait on this fd adds it; later waits re-arm the one-shot registration
+    int op = (co->epoll_fd == fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(co->loop->epoll_fd, op, fd, &event) == -1)
+    {
+        if (op == EPOLL_CTL_MOD && errno == ENOENT)
+            op = EPOLL_CTL_ADD; // fd number was closed and reused
+        else if (op == EPOLL_CTL_ADD && errno == EEXIST)
+            op = EPOLL_CTL_MOD;
+        else
+            return -1;
+        if (epoll_ctl(co->loop->epoll_fd, op, fd, &event) == -1)
+            return -1;
+    }
+    co->epoll_fd = fd;
+
+    yield(co);
+    return 0;
+}
+
+static void sleep_done(void *arg)
+{
+    make_ready((Coroutine *)arg);
+}
+
+void coroutine_sleep(unsigned int seconds)
+{
+    Coroutine *co = current_coroutine;
+    if (co == NULL)
+    {
+        sleep(seconds);
+        return;
+    }
+    timer_arm(&co->sleep_timer, seconds * 1000, sleep_done, co);
+    yield(co);
+}
+
+void event_loop_report(int fd)
+{
+    char buffer[128];
+    if (loop_count == 0)
+        return;
+    write_string(fd, "--- Event Loops ---\n");
+    for (int i = 0; i < loop_count; i++)
+    {
+        snprintf(buffer, sizeof(buffer), "Loop %d: sessions=%d switches=%lu\n", i,
+                 atomic_load(&loops[i].sessions), atomic_load(&loops[i].switches));
+        write_string(fd, buffer);
+    }
+}
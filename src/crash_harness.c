@@ -0,0 +1,384 @@
+// src/crash_harness.c
+#include "common.h"
+#include "fault.h"      // For the crash point names and FAULT_ENV
+#include <math.h>       // For fabs
+#include <signal.h>     // For kill
+#include <stdio.h>      // For snprintf, sscanf
+#include <sys/stat.h>   // For stat (journal size)
+#include <sys/wait.h>   // For waitpid
+
+/*
+--- Crash Harness (make crash-test) ---
+
+-> Each round: start ./server with one crash point armed (BANK_CRASH_POINT=point:hit, the hit
+   picked at random), drive transfers and batch transfers at it with ./loadgen until it kills
+   itself, then start it again without the fault and let run_server_recovery() clean up.
+-> Transfers only move money between load customers, so whatever the crash point, the sum of all
+   balances must be what it was before the round. After recovery the harness also checks that no
+   balance is negative and that the journal was cleared.
+-> The recovering server reports how long recovery took and how big the journal was; with -j the
+   crashed journal is padded in front with committed transfers, to see whether that time grows
+   with it.
+-> Needs ./server and ./loadgen next to it, initialized data (./admin_util), and no other server
+   on PORT. Server output goes to CRASH_LOG and RECOVERY_LOG.
+*/
+
+#define CRASH_LOG "crash_harness_crash.log"
+#define RECOVERY_LOG "crash_harness_recovery.log"
+#define CRASH_READY_SECONDS 30 // For the server to print "Server listening"
+#define CRASH_LOAD_SECONDS 60  // For the crash point to be reached before the harness kills the server
+#define CRASH_MAX_HIT 1000     // Default -n: crash at a random hit in [1, n]
+
+static const char *transfer_points[] = FAULT_TRANSFER_POINTS;
+#define POINT_COUNT ((int)(sizeof(transfer_points) / sizeof(transfer_points[0])))
+
+typedef struct
+{
+    double total;
+    int negative;
+    int accounts;
+} BalanceSum;
+
+static BalanceSum sum_balances()
+{
+    BalanceSum sum = {0, 0, 0};
+    int fd = open(ACCOUNT_FILE, O_RDONLY);
+    if (fd == -1)
+        return sum;
+    Account account;
+    while (read(fd, &account, sizeof(Account)) == sizeof(Account))
+    {
+        sum.total += account.balance;
+        sum.negative += (account.balance < 0);
+        sum.accounts++;
+    }
+    close(fd);
+    return sum;
+}
+
+static long journal_bytes()
+{
+    struct stat st;
+    return (stat(JOURNAL_FILE, &st) == 0) ? (long)st.st_size : 0;
+}
+
+// Puts groups committed transfers (two undo entries and a commit each) in front of the journal,
+// as if the crashed server had been running for much longer
+static void pad_journal(int groups)
+{
+    long size = journal_bytes();
+    char *tail = malloc(size > 0 ? size : 1);
+    int fd = open(JOURNAL_FILE, O_RDWR | O_CREAT, 0644);
+    if (fd == -1 || tail == NULL || read(fd, tail, size) != size)
+    {
+        perror("crash_harness: journal");
+        if (fd != -1)
+            close(fd);
+        free(tail);
+        return;
+    }
+
+    JournalEntry group[3];
+    memset(group, 0, sizeof(group));
+    group[0].type = TXN_START;
+    group[1].type = TXN_START;
+    group[2].type = TXN_COMMIT;
+    FILE *journal = fdopen(fd, "w");
+    rewind(journal);
+    for (int i = 0; i < groups; i++)
+        fwrite(group, sizeof(group), 1, journal);
+    fwrite(tail, 1, size, journal);
+    if (fclose(journal) != 0)
+        perror("crash_harness: journal");
+    free(tail);
+}
+
+// --- Child processes ---
+
+// fork + exec with stdout/stderr sent to log_path (or /dev/null). crash_point may be NULL.
+static pid_t spawn(char *const argv[], const char *log_path, const char *crash_point)
+{
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+
+    int out = open(log_path != NULL ? log_path : "/dev/null", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out != -1)
+    {
+        dup2(out, STDOUT_FILENO);
+        dup2(out, STDERR_FILENO);
+        close(out);
+    }
+    if (crash_point != NULL)
+        setenv(FAULT_ENV, crash_point, 1);
+    else
+        unsetenv(FAULT_ENV);
+    execv(argv[0], argv);
+    _exit(127);
+}
+
+// Returns 1 if the file contains text (the logs are small: only the start is searched)
+static int log_contains(const char *path, const char *text, char *line, int size)
+{
+    char content[16384];
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return 0;
+    ssize_t n = read(fd, content, sizeof(content) - 1);
+    close(fd);
+    if (n <= 0)
+        return 0;
+    content[n] = '\0';
+    char *found = strstr(content, text);
+    if (found == NULL)
+        return 0;
+    if (line != NULL)
+    {
+        char *end = strchr(found, '\n');
+        int len = (end != NULL) ? (int)(end - found) : (int)strlen(found);
+        if (len > size - 1)
+            len = size - 1;
+        memcpy(line, found, len);
+        line[len] = '\0';
+    }
+    return 1;
+}
+
+// Waits up to seconds for pid to exit. Returns its wait status, or -1 if it is still running.
+static int wait_exit(pid_t pid, int seconds)
+{
+    for (int waited = 0; waited < seconds * 20; waited++)
+    {
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid)
+            return status;
+        usleep(50000);
+    }
+    return -1;
+}
+
+static void kill_and_reap(pid_t pid, int sig)
+{
+    kill(pid, sig);
+    waitpid(pid, NULL, 0);
+}
+
+// Starts the server and waits until it is listening (recovery is done by then). Returns its pid or -1.
+static pid_t start_server(const char *log_path, const char *crash_point)
+{
+    char *argv[] = {"./server", "-u", "none", NULL};
+    unlink(log_path); // Or the last run's "Server listening" could be read before the child truncates it
+    pid_t pid = spawn(argv, log_path, crash_point);
+    if (pid == -1)
+        return -1;
+    for (int waited = 0; waited < CRASH_READY_SECONDS * 20; waited++)
+    {
+        if (log_contains(log_path, "Server listening", NULL, 0))
+            return pid;
+        if (waitpid(pid, NULL, WNOHANG) == pid)
+            return -1;
+        usleep(50000);
+    }
+    kill_and_reap(pid, SIGKILL);
+    return -1;
+}
+
+static int stop_server(pid_t pid)
+{
+    kill(pid, SIGTERM);
+    if (wait_exit(pid, CRASH_READY_SECONDS) == -1)
+    {
+        kill_and_reap(pid, SIGKILL);
+        return -1;
+    }
+    return 0;
+}
+
+static pid_t start_load(int sessions, int seconds, unsigned int seed)
+{
+    char sessions_arg[16], seconds_arg[16], seed_arg[16];
+    snprintf(sessions_arg, sizeof(sessions_arg), "%d", sessions);
+    snprintf(seconds_arg, sizeof(seconds_arg), "%d", seconds);
+    snprintf(seed_arg, sizeof(seed_arg), "%u", seed);
+    char *argv[] = {"./loadgen", "-c", sessions_arg, "-d", seconds_arg, "-m", "transfer=1,batch=1", "-s", seed_arg, NULL};
+    return spawn(argv, NULL, NULL);
+}
+
+static int server_running()
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    int connected = (sock != -1 && connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    if (sock != -1)
+        close(sock);
+    return connected;
+}
+
+// --- Rounds ---
+
+// One crash and recovery. Returns 0 if the invariants held, 1 if not, -1 if the round could not run.
+static int run_round(int round, const char *point, int hit, int sessions, int padding, unsigned int seed)
+{
+    char armed[96], buffer[256];
+    snprintf(armed, sizeof(armed), "%s:%d", point, hit);
+    BalanceSum before = sum_balances();
+
+    // --- Crash ---
+    pid_t server = start_server(CRASH_LOG, armed);
+    if (server == -1)
+    {
+        write_string(STDOUT_FILENO, "Server did not start, see " CRASH_LOG ".\n");
+        return -1;
+    }
+    pid_t load = start_load(sessions, CRASH_LOAD_SECONDS, seed);
+    int status = wait_exit(server, CRASH_LOAD_SECONDS + 5);
+    const char *outcome = "crashed";
+    if (status == -1)
+    {
+        outcome = "killed"; // Point not reached: a plain SIGKILL at a random moment instead
+        kill_and_reap(server, SIGKILL);
+    }
+    else if (!WIFSIGNALED(status) || WTERMSIG(status) != SIGKILL)
+    {
+        outcome = "exited";
+    }
+    if (load != -1 && wait_exit(load, 10) == -1)
+        kill_and_reap(load, SIGKILL);
+    if (padding > 0)
+        pad_journal(padding);
+    long journal_size = journal_bytes();
+
+    // --- Recover ---
+    server = start_server(RECOVERY_LOG, NULL);
+    if (server == -1)
+    {
+        write_string(STDOUT_FILENO, "Server did not restart, see " RECOVERY_LOG ".\n");
+        return -1;
+    }
+    long journal_after = journal_bytes();
+    double recovery_ms = -1;
+    long entries = 0, scanned = 0;
+    int restored = 0;
+    if (log_contains(RECOVERY_LOG, "Recovery took", buffer, sizeof(buffer)))
+        sscanf(buffer, "Recovery took %lf ms (%ld journal entries, %ld scanned, %d restored)", &recovery_ms,
+               &entries, &scanned, &restored);
+    stop_server(server);
+
+    // --- Check ---
+    BalanceSum after = sum_balances();
+    const char *verdict = "ok";
+    if (fabs(after.total - before.total) > 0.005)
+        verdict = "FAIL: money created or lost";
+    else if (after.negative > 0)
+        verdict = "FAIL: negative balance";
+    else if (journal_after != 0)
+        verdict = "FAIL: journal not cleared";
+    else if (after.accounts != before.accounts)
+        verdict = "FAIL: account count changed";
+
+    snprintf(buffer, sizeof(buffer), "%5d  %-26s %5d  %-7s %10ld %8ld %8ld %8d %11.3f  %s\n", round, point, hit,
+             outcome, journal_size, entries, scanned, restored, recovery_ms, verdict);
+    write_string(STDOUT_FILENO, buffer);
+    if (verdict[0] != 'o')
+    {
+        snprintf(buffer, sizeof(buffer), "       balances before %.2f, after %.2f\n", before.total, after.total);
+        write_string(STDOUT_FILENO, buffer);
+        return 1;
+    }
+    return 0;
+}
+
+// Usage: ./crash_harness [-r rounds] [-p point] [-c sessions] [-n max_hit] [-j groups] [-s seed]
+//   -r N   rounds (default: one per transfer crash point)
+//   -p P   always crash at point P (default: cycle through FAULT_TRANSFER_POINTS)
+//   -c N   loadgen sessions driving transfers (default 8)
+//   -n N   crash at a random hit in [1, N] of the point (default CRASH_MAX_HIT)
+//   -j N   pad the crashed journal with N older committed transfers
+//   -s N   random seed (default 1)
+int main(int argc, char *argv[])
+{
+    int rounds = POINT_COUNT, sessions = 8, max_hit = CRASH_MAX_HIT, padding = 0;
+    unsigned int seed = 1;
+    const char *fixed_point = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:p:c:n:j:s:")) != -1)
+    {
+        if (opt == 'r')
+            rounds = atoi(optarg);
+        else if (opt == 'p')
+            fixed_point = optarg;
+        else if (opt == 'c')
+            sessions = atoi(optarg);
+        else if (opt == 'n')
+            max_hit = atoi(optarg);
+        else if (opt == 'j')
+            padding = atoi(optarg);
+        else if (opt == 's')
+            seed = (unsigned int)atoi(optarg);
+        else
+        {
+            write_string(STDOUT_FILENO, "Usage: ./crash_harness [-r rounds] [-p point] [-c sessions] [-n max_hit] [-j groups] [-s seed]\n");
+            return 2;
+        }
+    }
+    if (rounds < 1 || sessions < 2 || max_hit < 1 || padding < 0)
+    {
+        write_string(STDOUT_FILENO, "Invalid options.\n");
+        return 2;
+    }
+    if (access("./server", X_OK) != 0 || access("./loadgen", X_OK) != 0)
+    {
+        write_string(STDOUT_FILENO, "Build ./server and ./loadgen first (make).\n");
+        return 2;
+    }
+    if (access(ACCOUNT_FILE, R_OK) != 0)
+    {
+        write_string(STDOUT_FILENO, "No data files: run ./admin_util first.\n");
+        return 2;
+    }
+    if (server_running())
+    {
+        write_string(STDOUT_FILENO, "A server is already listening on the port: stop it first.\n");
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    srand(seed);
+
+    // Load customers are added by loadgen; do that once, before any balances are summed
+    write_string(STDOUT_FILENO, "Preparing load customers...\n");
+    pid_t server = start_server(RECOVERY_LOG, NULL);
+    if (server == -1)
+    {
+        write_string(STDOUT_FILENO, "Server did not start, see " RECOVERY_LOG ".\n");
+        return 2;
+    }
+    pid_t load = start_load(sessions, 1, seed);
+    if (load != -1 && wait_exit(load, CRASH_READY_SECONDS) == -1)
+        kill_and_reap(load, SIGKILL);
+    stop_server(server);
+
+    write_string(STDOUT_FILENO, "round  crash point                  hit  outcome  journal B  entries  scanned restored recovery ms  invariants\n");
+    int failed = 0, aborted = 0;
+    for (int round = 1; round <= rounds; round++)
+    {
+        const char *point = (fixed_point != NULL) ? fixed_point : transfer_points[(round - 1) % POINT_COUNT];
+        int hit = 1 + rand() % max_hit;
+        int result = run_round(round, point, hit, sessions, padding, seed + round);
+        if (result == -1)
+        {
+            aborted = 1;
+            break;
+        }
+        failed += result;
+    }
+
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "%s: %d round(s) with broken invariants.\n",
+             (failed == 0 && !aborted) ? "PASS" : "FAIL", failed);
+    write_string(STDOUT_FILENO, buffer);
+    return (failed == 0 && !aborted) ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+// src/cred_cache.c
+#include "cred_cache.h" // Credential cache prototypes
+#include "metrics.h"    // For metrics_header, metrics_value
+#include <pthread.h>    // For per-shard read-write locks
+#include <stdatomic.h>  // For counters
+#include <stdio.h>      // For snprintf
+#include <stdlib.h>     // For malloc, calloc, free
+
+/*
+--- How the cache is laid out ---
+
+-> Same shape as the session registry: CRED_CACHE_SHARDS shards, each a chained hash table that
+   doubles when full. Shards use a read-write lock because almost every access is a lookup.
+-> Each shard counts invalidations (generation). cred_cache_begin returns the generation,
+   cred_cache_store only inserts if it has not moved. An invalidation of another user in the same
+   shard also moves it, which only costs one extra miss.
+*/
+
+typedef struct CredNode
+{
+    User record;
+    struct CredNode *next;
+} CredNode;
+
+typedef struct
+{
+    pthread_rwlock_t lock;
+    CredNode **buckets;
+    unsigned int bucket_count; // Always a power of two
+    unsigned int count;
+    unsigned long generation; // Bumped by every invalidation
+} CredShard;
+
+static CredShard shards[CRED_CACHE_SHARDS];
+static pthread_once_t shards_once = PTHREAD_ONCE_INIT;
+
+static atomic_ulong hits;
+static atomic_ulong misses;
+static atomic_ulong invalidations;
+
+static void init_shards()
+{
+    for (int i = 0; i < CRED_CACHE_SHARDS; i++)
+    {
+        pthread_rwlock_init(&shards[i].lock, NULL);
+        shards[i].buckets = NULL; // Allocated on first insert
+        shards[i].bucket_count = 0;
+        shards[i].count = 0;
+        shards[i].generation = 0;
+    }
+}
+
+// Fibonacci hashing spreads consecutive userIds over shards and buckets
+static unsigned int hash_user(int userId)
+{
+    return (unsigned int)userId * 2654435769u;
+}
+
+static CredShard *shard_of(unsigned int hash)
+{
+    pthread_once(&shards_once, init_shards);
+    return &shards[hash >> 26 & (CRED_CACHE_SHARDS - 1)];
+}
+
+// Finds userId's node (caller holds the shard lock)
+static CredNode *find_node(CredShard *shard, unsigned int hash, int userId)
+{
+    if (shard->bucket_count == 0)
+        return NULL;
+    for (CredNode *node = shard->buckets[hash & (shard->bucket_count - 1)]; node; node = node->next)
+    {
+        if (node->record.userId == userId)
+            return node;
+    }
+    return NULL;
+}
+
+// Doubles the bucket array of a shard (caller holds the shard lock for writing)
+static int grow_shard(CredShard *shard)
+{
+    unsigned int new_count = shard->bucket_count ? shard->bucket_count * 2 : CRED_CACHE_SHARD_BUCKETS;
+    CredNode **new_buckets = calloc(new_count, sizeof(CredNode *));
+    if (new_buckets == NULL)
+        return -1;
+
+    for (unsigned int i = 0; i < shard->bucket_count; i++)
+    {
+        CredNode *node = shard->buckets[i];
+        while (node != NULL)
+        {
+            CredNode *next = node->next;
+            unsigned int b = hash_user(node->record.userId) & (new_count - 1);
+            node->next = new_buckets[b];
+            new_buckets[b] = node;
+            node = next;
+        }
+    }
+    free(shard->buckets);
+    shard->buckets = new_buckets;
+    shard->bucket_count = new_count;
+    return 0;
+}
+
+int cred_cache_lookup(int userId, User *out)
+{
+    unsigned int hash = hash_user(userId);
+    CredShard *shard = shard_of(hash);
+
+    pthread_rwlock_rdlock(&shard->lock);
+    CredNode *node = find_node(shard, hash, userId);
+    if (node != NULL)
+        *out = node->record;
+    pthread_rwlock_unlock(&shard->lock);
+
+    atomic_fetch_add_explicit(node != NULL ? &hits : &misses, 1, memory_order_relaxed);
+    return node != NULL;
+}
+
+unsigned long cred_cache_begin(int userId)
+{
+    CredShard *shard = shard_of(hash_user(userId));
+    pthread_rwlock_rdlock(&shard->lock);
+    unsigned long ticket = shard->generation;
+    pthread_rwlock_unlock(&shard->lock);
+    return ticket;
+}
+
+void cred_cache_store(const User *record, unsigned long ticket)
+{
+    unsigned int hash = hash_user(record->userId);
+    CredShard *shard = shard_of(hash);
+
+    pthread_rwlock_wrlock(&shard->lock);
+    if (shard->generation != ticket)
+    {
+        pthread_rwlock_unlock(&shard->lock); // Changed on disk meanwhile; the next login re-reads it
+        return;
+    }
+
+    CredNode *node = find_node(shard, hash, record->userId);
+    if (node == NULL)
+    {
+        // Keep the load factor at or below 1; out of memory just means no caching
+        if (shard->count >= shard->bucket_count && grow_shard(shard) == -1 && shard->bucket_count == 0)
+        {
+            pthread_rwlock_unlock(&shard->lock);
+            return;
+        }
+        node = malloc(sizeof(CredNode));
+        if (node == NULL)
+        {
+            pthread_rwlock_unlock(&shard->lock);
+            return;
+        }
+        unsigned int b = hash & (shard->bucket_count - 1);
+        node->next = shard->buckets[b];
+        shard->buckets[b] = node;
+        shard->count++;
+    }
+    node->record = *record;
+    pthread_rwlock_unlock(&shard->lock);
+}
+
+void cred_cache_invalidate(int userId)
+{
+    unsigned int hash = hash_user(userId);
+    CredShard *shard = shard_of(hash);
+
+    pthread_rwlock_wrlock(&shard->lock);
+    shard->generation++;
+    if (shard->bucket_count > 0)
+    {
+        CredNode **link = &shard->buckets[hash & (shard->bucket_count - 1)];
+        while (*link != NULL)
+        {
+            if ((*link)->record.userId == userId)
+            {
+                CredNode *node = *link;
+                *link = node->next;
+                free(node);
+                shard->count--;
+                break;
+            }
+            link = &(*link)->next;
+        }
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    atomic_fetch_add_explicit(&invalidations, 1, memory_order_relaxed);
+}
+
+void cred_cache_report(int fd)
+{
+    char buffer[160];
+    unsigned int cached = 0;
+    pthread_once(&shards_once, init_shards);
+    for (int i = 0; i < CRED_CACHE_SHARDS; i++)
+    {
+        pthread_rwlock_rdlock(&shards[i].lock);
+        cached += shards[i].count;
+        pthread_rwlock_unlock(&shards[i].lock);
+    }
+    snprintf(buffer, sizeof(buffer), "Credential cache: %u user(s), hits=%lu misses=%lu invalidations=%lu\n",
+             cached, atomic_load(&hits), atomic_load(&misses), atomic_load(&invalidations));
+    write_string(fd, buffer);
+}
+
+void cred_cache_metrics(int fd)
+{
+    unsigned long cached = 0, buckets = 0;
+    pthread_once(&shards_once, init_shards);
+    for (int i = 0; i < CRED_CACHE_SHARDS; i++)
+    {
+        pthread_rwlock_rdlock(&shards[i].lock);
+        cached += shards[i].count;
+        buckets += shards[i].bucket_count;
+        pthread_rwlock_unlock(&shards[i].lock);
+    }
+    metrics_header(fd, "bank_cred_cache_entries", "gauge", "Users in the credential cache");
+    metrics_value(fd, "bank_cred_cache_entries", NULL, (double)cached);
+    metrics_header(fd, "bank_cred_cache_buckets", "gauge", "Hash buckets allocated by the credential cache");
+    metrics_value(fd, "bank_cred_cache_buckets", NULL, (double)buckets);
+    metrics_header(fd, "bank_cred_cache_lookups_total", "counter", "Credential cache lookups");
+    metrics_value(fd, "bank_cred_cache_lookups_total", "result=\"hit\"", (double)atomic_load(&hits));
+    metrics_value(fd, "bank_cred_cache_lookups_total", "result=\"miss\"", (double)atomic_load(&misses));
+    metrics_header(fd, "bank_cred_cache_invalidations_total", "counter", "Credential cache invalidations");
+    metrics_value(fd, "bank_cred_cache_invalidations_total", NULL, (double)atomic_load(&invalidations));
+}
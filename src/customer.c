@@ -1,15 +1,20 @@
 #include "customer.h"    // Function declarations for customer module
 #include "data_access.h" // For functions like getAccount, updateAccount, etc.
+#include "ledger.h"      // For ledger_post, ledger_transfer, ledger_transfer_batch
+#include "scheduler.h"   // For standing instructions
+#include "io_backend.h"  // For io_open, io_read (data-file scans)
+#include "hash_pool.h"   // For hashing the new password off the session thread
+#include "rate_limit.h"  // For read_menu_choice
+#include "stats.h"       // For STATS_TIME (handler latency)
 #include "common.h"      // For structs, enums, read_client_input, write_string
 #include <stdio.h>       // For sprintf
-#include <stdlib.h>      // For atof
+#include <stdlib.h>      // For atof, malloc
 #include <time.h>        // For time/timestamp
-#include <signal.h>      // For SIGKILL and kill() (for testing)
-#include <unistd.h>      // For getpid()
+#include <unistd.h>      // For close
 #include <string.h>      // For strlen, strncpy, etc.
 
 // --- Account Selection ---
-void account_selection_menu(int client_socket, User user)
+MenuExit account_selection_menu(int client_socket, User user)
 {
     char buffer[MAX_BUFFER];
     Account accounts[10]; // Allow user to have up to 10 accounts
@@ -21,7 +26,7 @@ void account_selection_menu(int client_socket, User user)
         if (count == 0)
         {
             write_string(client_socket, "You have no active accounts. Please contact your bank.\n");
-            return;
+            return MENU_LOGOUT;
         }
 
         sprintf(buffer, "\n--- Welcome, %s. Please Select an Account ---\n", user.firstName);
@@ -35,20 +40,21 @@ void account_selection_menu(int client_socket, User user)
         write_string(client_socket, buffer);
         write_string(client_socket, "Enter your choice: ");
 
-        if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        if (read_menu_choice(client_socket, buffer, MAX_BUFFER, user.userId) == -1)
         {
-            return; // Client disconnected
+            return MENU_DISCONNECTED;
         }
         int choice = atoi(buffer);
 
         if (choice > 0 && choice <= count)
         {
-            customer_menu(client_socket, user, accounts[choice - 1].accountId);
+            if (customer_menu(client_socket, user, accounts[choice - 1].accountId) == MENU_DISCONNECTED)
+                return MENU_DISCONNECTED;
         }
         else if (choice == count + 1)
         {
             write_string(client_socket, "Logging out. Goodbye!\n");
-            return;
+            return MENU_LOGOUT;
         }
         else
         {
@@ -58,7 +64,7 @@ void account_selection_menu(int client_socket, User user)
 }
 
 // --- Main Customer Menu ---
-void customer_menu(int client_socket, User user, int accountId)
+MenuExit customer_menu(int client_socket, User user, int accountId)
 {
     char buffer[MAX_BUFFER];
     while (1)
@@ -68,56 +74,62 @@ void customer_menu(int client_socket, User user, int accountId)
         if (currentAccount.accountId == -1)
         {
             write_string(client_socket, "Error accessing account details. Returning to selection.\n");
-            return;
+            return MENU_LOGOUT;
         }
         sprintf(buffer, "\n--- Customer Menu (Account: %s) ---\n", currentAccount.accountNumber);
         write_string(client_socket, buffer);
 
-        write_string(client_socket, "1. View Balance\n2. Deposit Money\n3. Withdraw Money\n4. Transfer Funds\n5. View Transaction History\n6. Apply for Loan\n7. View Loan Status\n8. View My Personal Details\n9. Add Feedback\n10. View Feedback Status\n11. Change Password\n12. Switch Account / Logout\n");
+        write_string(client_socket, "1. View Balance\n2. Deposit Money\n3. Withdraw Money\n4. Transfer Funds\n5. View Transaction History\n6. Apply for Loan\n7. View Loan Status\n8. View My Personal Details\n9. Add Feedback\n10. View Feedback Status\n11. Change Password\n12. Batch Transfer (Payroll)\n13. Standing Instructions\n14. Switch Account / Logout\n");
         write_string(client_socket, "Enter your choice: ");
 
-        if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        if (read_menu_choice(client_socket, buffer, MAX_BUFFER, user.userId) == -1)
         {
-            return;
+            return MENU_DISCONNECTED;
         }
         int choice = atoi(buffer);
         switch (choice)
         {
         case 1:
-            handle_view_balance(client_socket, accountId);
+            STATS_TIME(STAT_VIEW_BALANCE, handle_view_balance(client_socket, accountId));
             break;
         case 2:
-            handle_deposit(client_socket, accountId);
+            STATS_TIME(STAT_DEPOSIT, handle_deposit(client_socket, accountId));
             break;
         case 3:
-            handle_withdraw(client_socket, accountId);
+            STATS_TIME(STAT_WITHDRAW, handle_withdraw(client_socket, accountId));
             break;
         case 4:
-            handle_transfer_funds(client_socket, accountId);
+            STATS_TIME(STAT_TRANSFER_FUNDS, handle_transfer_funds(client_socket, accountId));
             break;
         case 5:
-            handle_view_transaction_history(client_socket, accountId);
+            STATS_TIME(STAT_TRANSACTION_HISTORY, handle_view_transaction_history(client_socket, accountId));
             break;
         case 6:
-            handle_apply_loan(client_socket, user.userId);
+            STATS_TIME(STAT_APPLY_LOAN, handle_apply_loan(client_socket, user.userId));
             break;
         case 7:
-            handle_view_loan_status(client_socket, user.userId);
+            STATS_TIME(STAT_LOAN_STATUS, handle_view_loan_status(client_socket, user.userId));
             break;
         case 8:
-            handle_view_my_details(client_socket, user);
+            STATS_TIME(STAT_VIEW_MY_DETAILS, handle_view_my_details(client_socket, user));
             break;
         case 9:
-            handle_add_feedback(client_socket, user.userId);
+            STATS_TIME(STAT_ADD_FEEDBACK, handle_add_feedback(client_socket, user.userId));
             break;
         case 10:
-            handle_view_feedback_status(client_socket, user.userId);
+            STATS_TIME(STAT_FEEDBACK_STATUS, handle_view_feedback_status(client_socket, user.userId));
             break;
         case 11:
-            handle_change_password(client_socket, user.userId);
+            STATS_TIME(STAT_CHANGE_PASSWORD, handle_change_password(client_socket, user.userId));
             break;
         case 12:
-            return;
+            STATS_TIME(STAT_BATCH_TRANSFER, handle_batch_transfer(client_socket, accountId));
+            break;
+        case 13:
+            STATS_TIME(STAT_STANDING_INSTRUCTIONS, handle_standing_instructions(client_socket, user.userId, accountId));
+            break;
+        case 14:
+            return MENU_LOGOUT;
         default:
             write_string(client_socket, "Invalid choice.\n");
         }
@@ -162,26 +174,17 @@ void handle_deposit(int client_socket, int accountId)
         return;
     }
 
-    Account account = getAccount(accountId);
-    if (account.accountId == -1)
+    Account account;
+    LedgerResult result = ledger_post(accountId, DEPOSIT, amount, &account);
+    if (result == LEDGER_NOT_FOUND)
     {
         write_string(client_socket, "Error retrieving account details.\n");
         return;
     }
 
-    account.balance += amount;
-
-    if (updateAccount(account) == 0)
+    if (result == LEDGER_OK || result == LEDGER_LOG_FAILED)
     {
-        Transaction txn;
-        txn.accountId = accountId;
-        txn.userId = account.ownerUserId;
-        txn.type = DEPOSIT;
-        txn.amount = amount;
-        txn.newBalance = account.balance;
-        strcpy(txn.otherPartyAccountNumber, "---");
-
-        if (addTransaction(txn) != 0)
+        if (result == LEDGER_LOG_FAILED)
         {
             write_string(client_socket, "CRITICAL ERROR: Deposit Succeeded but FAILED to Log Transaction.\n");
         }
@@ -217,43 +220,31 @@ void handle_withdraw(int client_socket, int accountId)
         return;
     }
 
-    Account account = getAccount(accountId);
-    if (account.accountId == -1)
+    Account account;
+    LedgerResult result = ledger_post(accountId, WITHDRAWAL, amount, &account);
+    if (result == LEDGER_NOT_FOUND)
     {
         write_string(client_socket, "Error retrieving account details.\n");
         return;
     }
 
-    if (amount > account.balance)
+    if (result == LEDGER_INSUFFICIENT)
     {
         write_string(client_socket, "Insufficient funds.\n");
     }
-    else
+    else if (result == LEDGER_OK || result == LEDGER_LOG_FAILED)
     {
-        account.balance -= amount;
-
-        if (updateAccount(account) == 0)
+        if (result == LEDGER_LOG_FAILED)
         {
-            Transaction txn;
-            txn.accountId = accountId;
-            txn.userId = account.ownerUserId;
-            txn.type = WITHDRAWAL;
-            txn.amount = amount;
-            txn.newBalance = account.balance;
-            strcpy(txn.otherPartyAccountNumber, "---");
-
-            if (addTransaction(txn) != 0)
-            {
-                write_string(client_socket, "CRITICAL ERROR: Withdrawal Succeeded but FAILED to Log Transaction.\n");
-            }
-
-            sprintf(buffer, "Withdrawal successful. New balance: ₹%.2f\n", account.balance);
-            write_string(client_socket, buffer);
-        }
-        else
-        {
-            write_string(client_socket, "Error processing withdrawal. (Write Failure)\n");
+            write_string(client_socket, "CRITICAL ERROR: Withdrawal Succeeded but FAILED to Log Transaction.\n");
         }
+
+        sprintf(buffer, "Withdrawal successful. New balance: ₹%.2f\n", account.balance);
+        write_string(client_socket, buffer);
+    }
+    else
+    {
+        write_string(client_socket, "Error processing withdrawal. (Write Failure)\n");
     }
 }
 
@@ -262,7 +253,6 @@ void handle_transfer_funds(int client_socket, int senderAccountId)
     char buffer[MAX_BUFFER];
     char receiver_acc_num[20];
     double amount;
-    JournalEntry senderUndo, receiverUndo, commitEntry; 
 
     while (1)
     {
@@ -328,78 +318,256 @@ void handle_transfer_funds(int client_socket, int senderAccountId)
         return;
     }
 
-    // ATOMIC TRANSACTION (JOURNALING) STARTS HERE
-
-    // Log the "UNDO" state for the sender
-    senderUndo.type = TXN_START;
-    senderUndo.accountId = sender_account.accountId;
-    senderUndo.oldBalance = sender_account.balance;
-    journal_log_entry(senderUndo); // This call writes and fsyncs
+    // Journaled commit (shared with the pipelined protocol)
+    LedgerResult result = ledger_transfer(sender_account.accountId, receiver_account.accountId, amount, NULL, NULL);
 
-    // Log the "UNDO" state for the receiver
-    receiverUndo.type = TXN_START;
-    receiverUndo.accountId = receiver_account.accountId;
-    receiverUndo.oldBalance = receiver_account.balance;
-    journal_log_entry(receiverUndo); // This call writes and fsyncs
+    if (result == LEDGER_OK || result == LEDGER_LOG_FAILED)
+    {
+        write_string(client_socket, "Transfer successful.\n");
+    }
+    else if (result == LEDGER_INSUFFICIENT)
+    {
+        // Balance changed between our check and the commit
+        write_string(client_socket, "Insufficient funds.\n");
+    }
+    else if (result == LEDGER_WRITE_FAILED)
+    {
+        // The server will roll back the changes on the next restart.
+        write_string(client_socket, "ERROR: Transfer failed critically. Contact support.\n");
+    }
+    else
+    {
+        write_string(client_socket, "Invalid sender or receiver account number.\n");
+    }
+}
 
-    // We are now in a crash-safe state
-    // We have logged our intention. Now we can modify data.
+// One debit, many credits, all or nothing (ledger_transfer_batch)
+void handle_batch_transfer(int client_socket, int senderAccountId)
+{
+    char buffer[MAX_BUFFER];
+    LedgerLeg *legs = malloc(sizeof(LedgerLeg) * LEDGER_BATCH_MAX);
+    if (legs == NULL)
+    {
+        write_string(client_socket, "Server is out of memory, try again later.\n");
+        return;
+    }
 
-    // Perform the transfer
-    sender_account.balance -= amount;
-    receiver_account.balance += amount;
+    int count = 0;
+    double total = 0;
+    while (count < LEDGER_BATCH_MAX)
+    {
+        sprintf(buffer, "Enter credit %d as '<account number> <amount>' (empty line to finish, '0' to cancel): ",
+                count + 1);
+        write_string(client_socket, buffer);
+        if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1 || my_strcmp(buffer, "0") == 0)
+        {
+            free(legs);
+            return;
+        }
+        if (buffer[0] == '\0')
+            break;
 
-    int update1_status = updateAccount(sender_account);
+        char accNum[MAX_BUFFER], amountText[MAX_BUFFER];
+        if (sscanf(buffer, "%s %s", accNum, amountText) != 2 || strlen(accNum) >= 20 ||
+            !is_valid_number(amountText) || atof(amountText) <= 0)
+        {
+            write_string(client_socket, "Wrong format, expected e.g. 'SB10002 2500.00'. Please try again.\n");
+            continue;
+        }
+        strcpy(legs[count].accountNumber, accNum);
+        legs[count].amount = atof(amountText);
+        total += legs[count].amount;
+        count++;
+    }
+    if (count == 0)
+    {
+        free(legs);
+        return;
+    }
 
-    // ADD THIS CRASH POINT
-    // write_string(STDOUT_FILENO, "!!! SIMULATING SERVER CRASH !!!\n");
-    // kill(getpid(), SIGKILL); // Force-kill the server
-    // --- END CRASH POINT ---
+    sprintf(buffer, "Enter 'yes' to pay %d credit(s) totalling ₹%.2f: ", count, total);
+    write_string(client_socket, buffer);
+    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1 || my_strcmp(buffer, "yes") != 0)
+    {
+        write_string(client_socket, "Batch transfer cancelled.\n");
+        free(legs);
+        return;
+    }
 
-    int update2_status = updateAccount(receiver_account);
+    Account sender;
+    int failed_leg;
+    LedgerResult result = ledger_transfer_batch(senderAccountId, legs, count, &sender, &failed_leg);
+    if (result == LEDGER_OK || result == LEDGER_LOG_FAILED)
+    {
+        if (result == LEDGER_LOG_FAILED)
+        {
+            write_string(client_socket, "CRITICAL ERROR: Batch Transfer Succeeded but FAILED to Log Transactions.\n");
+        }
+        sprintf(buffer, "Batch transfer successful: %d credit(s). New balance: ₹%.2f\n", count, sender.balance);
+    }
+    else if (result == LEDGER_WRITE_FAILED)
+    {
+        // The server will roll back the changes on the next restart.
+        sprintf(buffer, "ERROR: Batch transfer failed critically. Contact support.\n");
+    }
+    else if (failed_leg >= 0)
+    {
+        sprintf(buffer, "Batch refused, credit %d (%s): %s. Nothing was transferred.\n", failed_leg + 1,
+                legs[failed_leg].accountNumber, ledger_result_str(result));
+    }
+    else
+    {
+        sprintf(buffer, "Batch refused: %s. Nothing was transferred.\n", ledger_result_str(result));
+    }
+    write_string(client_socket, buffer);
+    free(legs);
+}
 
-    if (update1_status == 0 && update2_status == 0)
+// Reads a whole number >= 0 for a standing instruction prompt. Returns it, or -1.
+static int read_count(int client_socket, const char *prompt)
+{
+    char buffer[MAX_BUFFER];
+    write_string(client_socket, prompt);
+    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        return -1;
+    if (!is_valid_number(buffer) || strchr(buffer, '.') != NULL || strlen(buffer) > 4)
     {
-        // Success! Log the commit.
-        commitEntry.type = TXN_COMMIT;
-        commitEntry.accountId = 0;     
-        commitEntry.oldBalance = 0;     
-        journal_log_entry(commitEntry); 
+        write_string(client_socket, "Please enter a whole number.\n");
+        return -1;
+    }
+    return atoi(buffer);
+}
 
-        // Log normal user-facing transactions
-        Transaction txn_out, txn_in;
+static void add_standing_instruction(int client_socket, int userId, int accountId)
+{
+    char buffer[MAX_BUFFER];
+    StandingInstruction ins;
+    memset(&ins, 0, sizeof(ins));
+    ins.ownerUserId = userId;
+    ins.fromAccountId = accountId;
 
-        txn_out.accountId = sender_account.accountId;
-        txn_out.userId = sender_account.ownerUserId;
-        txn_out.type = TRANSFER_OUT;
-        txn_out.amount = amount;
-        txn_out.newBalance = sender_account.balance;
-        strcpy(txn_out.otherPartyAccountNumber, receiver_account.accountNumber);
-        addTransaction(txn_out);
+    write_string(client_socket, "Enter receiver's account number: ");
+    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        return;
+    if (strlen(buffer) == 0 || strlen(buffer) >= 20)
+    {
+        write_string(client_socket, "Account number not found.\n");
+        return;
+    }
+    strcpy(ins.toAccountNumber, buffer);
 
-        txn_in.accountId = receiver_account.accountId;
-        txn_in.userId = receiver_account.ownerUserId;
-        txn_in.type = TRANSFER_IN;
-        txn_in.amount = amount;
-        txn_in.newBalance = receiver_account.balance;
-        strcpy(txn_in.otherPartyAccountNumber, sender_account.accountNumber);
-        addTransaction(txn_in);
+    write_string(client_socket, "Enter amount per payment: ");
+    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        return;
+    if (!is_valid_number(buffer) || atof(buffer) <= 0 || atof(buffer) > INSTRUCTION_MAX_AMOUNT)
+    {
+        sprintf(buffer, "Amount must be a positive number up to %.2f.\n", INSTRUCTION_MAX_AMOUNT);
+        write_string(client_socket, buffer);
+        return;
+    }
+    ins.amount = atof(buffer);
 
-        write_string(client_socket, "Transfer successful.\n");
+    int days = read_count(client_socket, "Enter interval in days (0: pay once): ");
+    if (days == -1)
+        return;
+    int delay = read_count(client_socket, "Enter days until the first payment (0: today): ");
+    if (delay == -1)
+        return;
+    int runs = 0;
+    if (days > 0 && (runs = read_count(client_socket, "Enter number of payments (0: until cancelled): ")) == -1)
+        return;
+    ins.intervalSeconds = days * 86400;
+    ins.remainingRuns = runs;
+    ins.dueTime = time(NULL) + (time_t)delay * 86400;
+
+    LedgerResult result = scheduler_add(&ins);
+    if (result == LEDGER_OK)
+    {
+        struct tm timeinfo;
+        char date[25];
+        localtime_r(&ins.dueTime, &timeinfo);
+        strftime(date, sizeof(date), "%Y-%m-%d %H:%M", &timeinfo);
+        sprintf(buffer, "Standing instruction %d created. First payment: %s\n", ins.instructionId, date);
     }
     else
     {
-        // Failure! Do NOT log commit.
-        write_string(client_socket, "ERROR: Transfer failed critically. Contact support.\n");
-        // The server will roll back the changes on the next restart.
-        // We do NOT try to roll back here, as that could also fail.
-        // The recovery function is the only one that should do rollbacks.
+        sprintf(buffer, "Standing instruction not created: %s.\n", ledger_result_str(result));
+    }
+    write_string(client_socket, buffer);
+}
+
+// --- Standing Instructions (rent, SIPs) ---
+// Paid by the scheduler thread (scheduler.c), not by this session: the customer only sees the
+// schedule and the outcome of the last attempt.
+void handle_standing_instructions(int client_socket, int userId, int accountId)
+{
+    char buffer[MAX_BUFFER];
+    StandingInstruction list[INSTRUCTION_LIST_MAX];
+    struct tm timeinfo;
+    char date[25];
+
+    int count = scheduler_list(userId, list, INSTRUCTION_LIST_MAX);
+    int shown = 0;
+    write_string(client_socket, "\n--- Standing Instructions ---\n");
+    sprintf(buffer, "%-5s | %-12s | %-12s | %-10s | %-8s | %-16s | %-9s | %s\n", "ID", "TO ACC", "AMOUNT", "EVERY",
+            "LEFT", "NEXT PAYMENT", "STATUS", "LAST RESULT");
+    write_string(client_socket, buffer);
+    for (int i = 0; i < count; i++)
+    {
+        if (list[i].fromAccountId != accountId)
+            continue;
+        char every[16], left[16];
+        if (list[i].intervalSeconds == 0)
+            strcpy(every, "once");
+        else if (list[i].intervalSeconds % 86400 == 0)
+            sprintf(every, "%d day(s)", list[i].intervalSeconds / 86400);
+        else
+            sprintf(every, "%d s", list[i].intervalSeconds); // Set through the pipeline
+        if (list[i].remainingRuns == 0)
+            strcpy(left, list[i].status == INSTRUCTION_ACTIVE && list[i].intervalSeconds > 0 ? "-" : "0");
+        else
+            sprintf(left, "%d", list[i].remainingRuns);
+        if (list[i].status == INSTRUCTION_ACTIVE || list[i].status == INSTRUCTION_RUNNING)
+        {
+            localtime_r(&list[i].nextAttempt, &timeinfo);
+            strftime(date, sizeof(date), "%Y-%m-%d %H:%M", &timeinfo);
+        }
+        else
+            strcpy(date, "-");
+        snprintf(buffer, sizeof(buffer), "%-5d | %-12.19s | %-12.2f | %-10s | %-8s | %-16s | %-9s | %s\n",
+                 list[i].instructionId,
+                 list[i].toAccountNumber, list[i].amount, every, left, date, instruction_status_str(list[i].status),
+                 instruction_result_str(list[i].lastResult));
+        write_string(client_socket, buffer);
+        shown++;
+    }
+    if (shown == 0)
+        write_string(client_socket, "No standing instructions on this account.\n");
+
+    write_string(client_socket, "1. New Standing Instruction\n2. Cancel a Standing Instruction\n3. Back\n");
+    write_string(client_socket, "Enter your choice: ");
+    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        return;
+    int choice = atoi(buffer);
+    if (choice == 1)
+    {
+        add_standing_instruction(client_socket, userId, accountId);
+    }
+    else if (choice == 2)
+    {
+        int id = read_count(client_socket, "Enter the instruction ID to cancel: ");
+        if (id == -1)
+            return;
+        if (scheduler_cancel(userId, id) == 0)
+            write_string(client_socket, "Standing instruction cancelled.\n");
+        else
+            write_string(client_socket, "No active standing instruction with that ID.\n");
     }
 }
 
 void handle_view_transaction_history(int client_socket, int accountId)
 {
-    int fd = open(TRANSACTION_FILE, O_RDONLY);
+    int fd = io_open(TRANSACTION_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         write_string(client_socket, "No transactions found.\n");
@@ -439,7 +607,7 @@ void handle_view_transaction_history(int client_socket, int accountId)
     lseek(fd, 0, SEEK_SET);
 
     // read() Failure
-    while (read(fd, &txn, sizeof(Transaction)) == sizeof(Transaction))
+    while (io_read(fd, &txn, sizeof(Transaction)) == sizeof(Transaction))
     {
         if (txn.accountId == accountId)
         {
@@ -553,7 +721,7 @@ void handle_apply_loan(int client_socket, int userId)
 
 void handle_view_loan_status(int client_socket, int userId)
 {
-    int fd = open(LOAN_FILE, O_RDONLY);
+    int fd = io_open(LOAN_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         write_string(client_socket, "No loan applications found.\n");
@@ -572,7 +740,7 @@ void handle_view_loan_status(int client_socket, int userId)
     lseek(fd, 0, SEEK_SET);
 
     // read() Failure
-    while (read(fd, &loan, sizeof(Loan)) == sizeof(Loan))
+    while (io_read(fd, &loan, sizeof(Loan)) == sizeof(Loan))
     {
         if (loan.userId == userId)
         {
@@ -650,7 +818,7 @@ void handle_add_feedback(int client_socket, int userId)
 
 void handle_view_feedback_status(int client_socket, int userId)
 {
-    int fd = open(FEEDBACK_FILE, O_RDONLY);
+    int fd = io_open(FEEDBACK_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         write_string(client_socket, "No feedback history found.\n");
@@ -669,7 +837,7 @@ void handle_view_feedback_status(int client_socket, int userId)
     lseek(fd, 0, SEEK_SET);
 
     // read() Failure
-    while (read(fd, &feedback, sizeof(Feedback)) == sizeof(Feedback))
+    while (io_read(fd, &feedback, sizeof(Feedback)) == sizeof(Feedback))
     {
         if (feedback.userId == userId)
         {
@@ -735,7 +903,11 @@ void handle_change_password(int client_socket, int userId)
         return;
     }
 
-    strcpy(user.password, buffer);
+    if (hash_pool_hash(buffer, user.password) != 0)
+    {
+        write_string(client_socket, "Server busy, password not changed. Please try again.\n");
+        return;
+    }
 
     // write() Failure
     if (updateUser(user) == 0)
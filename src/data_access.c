@@ -1,4 +1,9 @@
 #include "data_access.h" 
+#include "io_backend.h" // For io_open, io_read, io_pread, io_write_fsync (syscall or io_uring)
+#include "cred_cache.h" // For cred_cache_invalidate (user records changed here)
+#include "stats.h"      // For per-primitive latency
+#include "lock_profile.h" // For lock wait/hold times
+#include "fault.h"      // For FAULT_POINT (batch account update)
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdio.h>  
@@ -6,7 +11,7 @@
 
 // --- Locking Functions ---
 
-int set_file_lock(int fd, int lock_type)
+int set_file_lock_at(int fd, int lock_type, const char *site)
 {
     struct flock fl;
     fl.l_type = lock_type;
@@ -14,7 +19,7 @@ int set_file_lock(int fd, int lock_type)
     fl.l_start = 0;
     fl.l_len = 0;
     fl.l_pid = getpid();
-    if (fcntl(fd, F_SETLKW, &fl) == -1)
+    if (lock_profile_fcntl(fd, &fl, 1, site) == -1)
     {
         perror("fcntl file lock");
         return -1;
@@ -22,7 +27,7 @@ int set_file_lock(int fd, int lock_type)
     return 0;
 }
 
-int set_record_lock(int fd, int record_num, int record_size, int lock_type)
+int set_record_lock_at(int fd, int record_num, int record_size, int lock_type, const char *site)
 {
     struct flock fl;
     fl.l_type = lock_type;
@@ -30,7 +35,7 @@ int set_record_lock(int fd, int record_num, int record_size, int lock_type)
     fl.l_start = record_num * record_size;
     fl.l_len = record_size;
     fl.l_pid = getpid();
-    if (fcntl(fd, F_SETLKW, &fl) == -1)
+    if (lock_profile_fcntl(fd, &fl, 0, site) == -1)
     {
         perror("fcntl record lock");
         return -1;
@@ -42,7 +47,7 @@ int set_record_lock(int fd, int record_num, int record_size, int lock_type)
 // Helper for ID generation
 int get_next_id_from_file(const char *filename, size_t record_size)
 {
-    int fd = open(filename, O_RDONLY);
+    int fd = io_open(filename, O_RDONLY, 0);
     if (fd == -1)
     {
         return 1;
@@ -55,7 +60,7 @@ int get_next_id_from_file(const char *filename, size_t record_size)
     if (offset != -1)
     { 
         int last_id;
-        if (read(fd, &last_id, sizeof(int)) == sizeof(int))
+        if (io_read(fd, &last_id, sizeof(int)) == sizeof(int))
         {
             next_id = last_id + 1;
         }
@@ -76,7 +81,7 @@ int get_next_transaction_id() { return get_next_id_from_file(TRANSACTION_FILE, s
 // user within the USER_FILE, not to retrieve their data.
 int find_user_record(int userId)
 {
-    int fd = open(USER_FILE, O_RDONLY);
+    int fd = io_open(USER_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         return -1;
@@ -84,7 +89,7 @@ int find_user_record(int userId)
     set_file_lock(fd, F_RDLCK);
     User user;
     int record_num = 0;
-    while (read(fd, &user, sizeof(User)) == sizeof(User))
+    while (io_read(fd, &user, sizeof(User)) == sizeof(User))
     {
         if (user.userId == userId)
         {
@@ -101,7 +106,7 @@ int find_user_record(int userId)
 
 int find_account_record_by_id(int accountId)
 {
-    int fd = open(ACCOUNT_FILE, O_RDONLY);
+    int fd = io_open(ACCOUNT_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         return -1;
@@ -109,7 +114,7 @@ int find_account_record_by_id(int accountId)
     set_file_lock(fd, F_RDLCK);
     Account account;
     int record_num = 0;
-    while (read(fd, &account, sizeof(Account)) == sizeof(Account))
+    while (io_read(fd, &account, sizeof(Account)) == sizeof(Account))
     {
         if (account.accountId == accountId)
         {
@@ -126,7 +131,7 @@ int find_account_record_by_id(int accountId)
 
 int find_account_record_by_number(char *acc_num)
 {
-    int fd = open(ACCOUNT_FILE, O_RDONLY);
+    int fd = io_open(ACCOUNT_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         return -1;
@@ -134,7 +139,7 @@ int find_account_record_by_number(char *acc_num)
     set_file_lock(fd, F_RDLCK);
     Account account;
     int record_num = 0;
-    while (read(fd, &account, sizeof(Account)) == sizeof(Account))
+    while (io_read(fd, &account, sizeof(Account)) == sizeof(Account))
     {
         if (my_strcmp(account.accountNumber, acc_num) == 0)
         {
@@ -151,7 +156,7 @@ int find_account_record_by_number(char *acc_num)
 
 int find_loan_record(int loanId)
 {
-    int fd = open(LOAN_FILE, O_RDONLY);
+    int fd = io_open(LOAN_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         return -1;
@@ -159,7 +164,7 @@ int find_loan_record(int loanId)
     set_file_lock(fd, F_RDLCK);
     Loan loan;
     int record_num = 0;
-    while (read(fd, &loan, sizeof(Loan)) == sizeof(Loan))
+    while (io_read(fd, &loan, sizeof(Loan)) == sizeof(Loan))
     {
         if (loan.loanId == loanId)
         {
@@ -176,7 +181,7 @@ int find_loan_record(int loanId)
 
 int find_feedback_record(int feedbackId)
 {
-    int fd = open(FEEDBACK_FILE, O_RDONLY);
+    int fd = io_open(FEEDBACK_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         return -1;
@@ -184,7 +189,7 @@ int find_feedback_record(int feedbackId)
     set_file_lock(fd, F_RDLCK);
     Feedback feedback;
     int record_num = 0;
-    while (read(fd, &feedback, sizeof(Feedback)) == sizeof(Feedback))
+    while (io_read(fd, &feedback, sizeof(Feedback)) == sizeof(Feedback))
     {
         if (feedback.feedbackId == feedbackId)
         {
@@ -203,7 +208,7 @@ int find_feedback_record(int feedbackId)
 // Returns 0 if found, -1 if not found
 int find_user_by_phone(const char *phone)
 {
-    int fd = open(USER_FILE, O_RDONLY);
+    int fd = io_open(USER_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         return -1;
@@ -211,7 +216,7 @@ int find_user_by_phone(const char *phone)
 
     set_file_lock(fd, F_RDLCK); 
     User user;
-    while (read(fd, &user, sizeof(User)) == sizeof(User))
+    while (io_read(fd, &user, sizeof(User)) == sizeof(User))
     {
         if (my_strcmp(user.phone, phone) == 0)
         {
@@ -229,7 +234,7 @@ int find_user_by_phone(const char *phone)
 // Returns 0 if found, -1 if not found
 int find_user_by_email(const char *email)
 {
-    int fd = open(USER_FILE, O_RDONLY);
+    int fd = io_open(USER_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         return -1;
@@ -237,7 +242,7 @@ int find_user_by_email(const char *email)
 
     set_file_lock(fd, F_RDLCK); 
     User user;
-    while (read(fd, &user, sizeof(User)) == sizeof(User))
+    while (io_read(fd, &user, sizeof(User)) == sizeof(User))
     {
         if (my_strcmp(user.email, email) == 0)
         {
@@ -256,7 +261,7 @@ int find_user_by_email(const char *email)
 // Helper function to read a specific record
 int read_record(void *record_buffer, int record_num, size_t record_size, const char *filename)
 {
-    int fd = open(filename, O_RDONLY);
+    int fd = io_open(filename, O_RDONLY, 0);
     if (fd == -1)
     {
         return -1;
@@ -269,9 +274,7 @@ int read_record(void *record_buffer, int record_num, size_t record_size, const c
         return -1;
     }
 
-    lseek(fd, record_num * record_size, SEEK_SET);
-
-    ssize_t bytes_read = read(fd, record_buffer, record_size);
+    ssize_t bytes_read = io_pread(fd, record_buffer, record_size, (off_t)record_num * record_size);
 
     set_record_lock(fd, record_num, record_size, F_UNLCK);
     close(fd);
@@ -281,6 +284,7 @@ int read_record(void *record_buffer, int record_num, size_t record_size, const c
 
 User getUser(int userId)
 {
+    StatTimer timer = stats_start(STAT_GET_USER);
     User user;
     user.userId = -1;
     int record_num = find_user_record(userId);
@@ -288,11 +292,13 @@ User getUser(int userId)
     {
         read_record(&user, record_num, sizeof(User), USER_FILE);
     }
+    stats_stop(STAT_GET_USER, timer);
     return user;
 }
 
 Account getAccount(int accountId)
 {
+    StatTimer timer = stats_start(STAT_GET_ACCOUNT);
     Account account;
     account.accountId = -1;
     int record_num = find_account_record_by_id(accountId);
@@ -300,11 +306,13 @@ Account getAccount(int accountId)
     {
         read_record(&account, record_num, sizeof(Account), ACCOUNT_FILE);
     }
+    stats_stop(STAT_GET_ACCOUNT, timer);
     return account;
 }
 
 Account getAccountByNum(char *accNum)
 {
+    StatTimer timer = stats_start(STAT_GET_ACCOUNT_BY_NUM);
     Account account;
     account.accountId = -1;
     int record_num = find_account_record_by_number(accNum);
@@ -312,11 +320,13 @@ Account getAccountByNum(char *accNum)
     {
         read_record(&account, record_num, sizeof(Account), ACCOUNT_FILE);
     }
+    stats_stop(STAT_GET_ACCOUNT_BY_NUM, timer);
     return account;
 }
 
 Loan getLoan(int loanId)
 {
+    StatTimer timer = stats_start(STAT_GET_LOAN);
     Loan loan;
     loan.loanId = -1;
     int record_num = find_loan_record(loanId);
@@ -324,11 +334,13 @@ Loan getLoan(int loanId)
     {
         read_record(&loan, record_num, sizeof(Loan), LOAN_FILE);
     }
+    stats_stop(STAT_GET_LOAN, timer);
     return loan;
 }
 
 Feedback getFeedback(int feedbackId)
 {
+    StatTimer timer = stats_start(STAT_GET_FEEDBACK);
     Feedback feedback;
     feedback.feedbackId = -1;
     int record_num = find_feedback_record(feedbackId);
@@ -336,22 +348,25 @@ Feedback getFeedback(int feedbackId)
     {
         read_record(&feedback, record_num, sizeof(Feedback), FEEDBACK_FILE);
     }
+    stats_stop(STAT_GET_FEEDBACK, timer);
     return feedback;
 }
 
 // Fills accountList with accounts owned by ownerUserId, returns count
 int getAccountsByOwnerId(int ownerUserId, Account *accountList, int maxAccounts)
 {
-    int fd = open(ACCOUNT_FILE, O_RDONLY);
+    StatTimer timer = stats_start(STAT_ACCOUNTS_BY_OWNER);
+    int fd = io_open(ACCOUNT_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
+        stats_stop(STAT_ACCOUNTS_BY_OWNER, timer);
         return 0;
     }
 
     set_file_lock(fd, F_RDLCK);
     Account account;
     int count = 0;
-    while (read(fd, &account, sizeof(Account)) == sizeof(Account))
+    while (io_read(fd, &account, sizeof(Account)) == sizeof(Account))
     {
         if (account.ownerUserId == ownerUserId && account.isActive)
         {
@@ -368,30 +383,196 @@ int getAccountsByOwnerId(int ownerUserId, Account *accountList, int maxAccounts)
     }
     set_file_lock(fd, F_UNLCK);
     close(fd);
+    stats_stop(STAT_ACCOUNTS_BY_OWNER, timer);
     return count;
 }
 
-// Data Writing/Updating Functions
+// --- Batch Access ---
 
-// Helper function to append a record
-int append_record(void *new_record, size_t record_size, const char *filename)
+typedef struct
+{
+    const char *number;
+    int index; // Position in the caller's list
+} NumberIndex;
+
+static int compare_numbers(const void *a, const void *b)
+{
+    return strncmp(((const NumberIndex *)a)->number, ((const NumberIndex *)b)->number, 20);
+}
+
+// One pass over accounts.dat for the whole list (each record is looked up in the sorted list),
+// instead of one find_account_record_by_number scan per number
+int getAccountsByNumbers(char (*accNums)[20], int count, Account *accounts, int *record_nums)
+{
+    StatTimer timer = stats_start(STAT_ACCOUNTS_BY_NUMBERS);
+    for (int i = 0; i < count; i++)
+    {
+        accounts[i].accountId = -1;
+        record_nums[i] = -1;
+    }
+    NumberIndex *sorted = malloc(sizeof(NumberIndex) * (count > 0 ? count : 1));
+    int fd = io_open(ACCOUNT_FILE, O_RDONLY, 0);
+    if (sorted == NULL || fd == -1)
+    {
+        free(sorted);
+        if (fd != -1)
+            close(fd);
+        stats_stop(STAT_ACCOUNTS_BY_NUMBERS, timer);
+        return 0;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        sorted[i].number = accNums[i];
+        sorted[i].index = i;
+    }
+    qsort(sorted, count, sizeof(NumberIndex), compare_numbers);
+
+    set_file_lock(fd, F_RDLCK);
+    Account account;
+    int record_num = 0;
+    int found = 0;
+    while (found < count && io_read(fd, &account, sizeof(Account)) == sizeof(Account))
+    {
+        NumberIndex key = {account.accountNumber, 0};
+        NumberIndex *match = bsearch(&key, sorted, count, sizeof(NumberIndex), compare_numbers);
+        if (match != NULL)
+        {
+            // The same number may be listed more than once: the copies are next to each other
+            while (match > sorted && compare_numbers(match - 1, &key) == 0)
+                match--;
+            for (; match < sorted + count && compare_numbers(match, &key) == 0; match++)
+            {
+                if (record_nums[match->index] == -1) // First record with the number wins, as in find_*
+                {
+                    accounts[match->index] = account;
+                    record_nums[match->index] = record_num;
+                    found++;
+                }
+            }
+        }
+        record_num++;
+    }
+    set_file_lock(fd, F_UNLCK);
+    close(fd);
+    free(sorted);
+    stats_stop(STAT_ACCOUNTS_BY_NUMBERS, timer);
+    return found;
+}
+
+int getAccountsAt(const int *record_nums, int count, Account *accounts)
 {
-    int fd = open(filename, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    StatTimer timer = stats_start(STAT_GET_ACCOUNTS_AT);
+    int fd = io_open(ACCOUNT_FILE, O_RDONLY, 0);
+    if (fd == -1)
+    {
+        stats_stop(STAT_GET_ACCOUNTS_AT, timer);
+        return -1;
+    }
+    int result = 0;
+    for (int i = 0; i < count && result == 0; i++)
+    {
+        if (set_record_lock(fd, record_nums[i], sizeof(Account), F_RDLCK) == -1)
+        {
+            result = -1;
+            break;
+        }
+        if (io_pread(fd, &accounts[i], sizeof(Account), (off_t)record_nums[i] * sizeof(Account)) != sizeof(Account))
+            result = -1;
+        set_record_lock(fd, record_nums[i], sizeof(Account), F_UNLCK);
+    }
+    close(fd);
+    stats_stop(STAT_GET_ACCOUNTS_AT, timer);
+    return result;
+}
+
+// Writes every record, then makes them all durable with a single fsync (update_record syncs each)
+int updateAccountsAt(const Account *accounts, const int *record_nums, int count)
+{
+    StatTimer timer = stats_start(STAT_UPDATE_ACCOUNTS_AT);
+    int fd = io_open(ACCOUNT_FILE, O_WRONLY, 0);
+    if (fd == -1)
+    {
+        perror("open for update");
+        stats_stop(STAT_UPDATE_ACCOUNTS_AT, timer);
+        return -1;
+    }
+    int result = 0;
+    for (int i = 0; i < count && result == 0; i++)
+    {
+        if (set_record_lock(fd, record_nums[i], sizeof(Account), F_WRLCK) == -1)
+        {
+            result = -1;
+            break;
+        }
+        if (io_pwrite(fd, &accounts[i], sizeof(Account), (off_t)record_nums[i] * sizeof(Account)) != sizeof(Account))
+            result = -1;
+        set_record_lock(fd, record_nums[i], sizeof(Account), F_UNLCK);
+        if (i == 0)
+            FAULT_POINT(CRASH_BATCH_MID_UPDATE); // The half-done batch recovery must undo
+    }
+    if (result == 0 && io_fsync(fd) == -1)
+        result = -1;
+    close(fd);
+    stats_stop(STAT_UPDATE_ACCOUNTS_AT, timer);
+    return result;
+}
+
+// Ids are taken from the last record while holding the append lock, so they stay unique
+int addTransactions(Transaction *transactions, int count)
+{
+    StatTimer timer = stats_start(STAT_ADD_TRANSACTIONS);
+    int fd = io_open(TRANSACTION_FILE, O_RDWR | O_APPEND | O_CREAT, 0644);
     if (fd == -1)
     {
         perror("open for append");
+        stats_stop(STAT_ADD_TRANSACTIONS, timer);
         return -1;
     }
 
     set_file_lock(fd, F_WRLCK); // Lock whole file for appending
-    ssize_t bytes_written = write(fd, new_record, record_size);
+    int next_id = 1;
+    off_t size = lseek(fd, 0, SEEK_END);
+    Transaction last;
+    if (size >= (off_t)sizeof(Transaction) &&
+        io_pread(fd, &last, sizeof(Transaction), size - sizeof(Transaction)) == sizeof(Transaction))
+    {
+        next_id = last.transactionId + 1;
+    }
+    time_t now = time(NULL);
+    for (int i = 0; i < count; i++)
+    {
+        transactions[i].transactionId = next_id + i;
+        transactions[i].timestamp = now;
+    }
+    size_t want = sizeof(Transaction) * (size_t)count;
+    ssize_t bytes_written = io_write_fsync(fd, transactions, want, -1);
+    set_file_lock(fd, F_UNLCK);
+    close(fd);
+    stats_stop(STAT_ADD_TRANSACTIONS, timer);
 
-    if (bytes_written > 0)
+    return (bytes_written == (ssize_t)want) ? 0 : -1;
+}
+
+// Data Writing/Updating Functions
+
+// Helper function to append a record
+int append_record(void *new_record, size_t record_size, const char *filename)
+{
+    StatTimer timer = stats_start(STAT_APPEND_RECORD);
+    int fd = io_open(filename, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd == -1)
     {
-        fsync(fd); // Force write to disk
+        perror("open for append");
+        stats_stop(STAT_APPEND_RECORD, timer);
+        return -1;
     }
+
+    set_file_lock(fd, F_WRLCK); // Lock whole file for appending
+    // Write + fsync (force to disk); one linked submission on the io_uring backend
+    ssize_t bytes_written = io_write_fsync(fd, new_record, record_size, -1);
     set_file_lock(fd, F_UNLCK);
     close(fd);
+    stats_stop(STAT_APPEND_RECORD, timer);
 
     return (bytes_written == (ssize_t)record_size) ? 0 : -1; 
 }
@@ -399,10 +580,12 @@ int append_record(void *new_record, size_t record_size, const char *filename)
 // Helper function to update a specific record
 int update_record(void *record_buffer, int record_num, size_t record_size, const char *filename)
 {
-    int fd = open(filename, O_WRONLY);
+    StatTimer timer = stats_start(STAT_UPDATE_RECORD);
+    int fd = io_open(filename, O_WRONLY, 0);
     if (fd == -1)
     {
         perror("open for update");
+        stats_stop(STAT_UPDATE_RECORD, timer);
         return -1;
     }
 
@@ -410,19 +593,16 @@ int update_record(void *record_buffer, int record_num, size_t record_size, const
     if (set_record_lock(fd, record_num, record_size, F_WRLCK) == -1)
     {
         close(fd);
+        stats_stop(STAT_UPDATE_RECORD, timer);
         return -1;
     }
 
-    lseek(fd, record_num * record_size, SEEK_SET);
-    ssize_t bytes_written = write(fd, record_buffer, record_size);
-
-    if (bytes_written > 0)
-    {
-        fsync(fd); // Force write to disk
-    }
+    // Write + fsync (force to disk); one linked submission on the io_uring backend
+    ssize_t bytes_written = io_write_fsync(fd, record_buffer, record_size, (off_t)record_num * record_size);
 
     set_record_lock(fd, record_num, record_size, F_UNLCK);
     close(fd);
+    stats_stop(STAT_UPDATE_RECORD, timer);
 
     return (bytes_written == (ssize_t)record_size) ? 0 : -1;
 }
@@ -458,6 +638,8 @@ int addTransaction(Transaction newTransaction)
     return append_record(&newTransaction, sizeof(Transaction), TRANSACTION_FILE);
 }
 
+void (*user_updated_hook)(int userId) = NULL;
+
 int updateUser(User userToUpdate)
 {
     int record_num = find_user_record(userToUpdate.userId);
@@ -465,7 +647,12 @@ int updateUser(User userToUpdate)
     {
         return -1;
     }
-    return update_record(&userToUpdate, record_num, sizeof(User), USER_FILE);
+    int result = update_record(&userToUpdate, record_num, sizeof(User), USER_FILE);
+    // After the write (even a failed one): a login reading the old record meanwhile is discarded
+    cred_cache_invalidate(userToUpdate.userId);
+    if (user_updated_hook != NULL)
+        user_updated_hook(userToUpdate.userId); // A token keeps the User taken at login
+    return result;
 }
 
 int updateAccount(Account accountToUpdate)
@@ -504,7 +691,7 @@ void generate_new_account_number(char *new_acc_num)
     const char *prefix = "SB"; 
     int start_num = 10001;
 
-    int fd = open(ACCOUNT_FILE, O_RDONLY);
+    int fd = io_open(ACCOUNT_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         sprintf(new_acc_num, "%s%d", prefix, start_num);
@@ -517,7 +704,7 @@ void generate_new_account_number(char *new_acc_num)
     if (lseek(fd, -sizeof(Account), SEEK_END) != -1)
     {
         Account last_account;
-        if (read(fd, &last_account, sizeof(Account)) == sizeof(Account))
+        if (io_read(fd, &last_account, sizeof(Account)) == sizeof(Account))
         {
             if (strncmp(last_account.accountNumber, prefix, strlen(prefix)) == 0)
             {
@@ -538,38 +725,57 @@ void generate_new_account_number(char *new_acc_num)
 // Journaling Functions
 
 // Appends a single journal entry
-void journal_log_entry(JournalEntry entry)
+// Appends entries to the journal (the caller holds the journal lock). A short or failed write is
+// cut off again, so the next group never starts behind half an entry. Returns 0 or -1.
+static int journal_append(const JournalEntry *entries, int count)
 {
-    int fd = open(JOURNAL_FILE, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    int fd = io_open(JOURNAL_FILE, O_WRONLY | O_APPEND | O_CREAT, 0644);
     if (fd == -1)
     {
         perror("FATAL: Could not open journal file");
-        return; // In a real system, we might halt the server
-    }
-
-    // We don't need to lock the journal, as it's append-only
-    // and each write is small enough to be "atomic" by the OS.
-    ssize_t bytes_written = write(fd, &entry, sizeof(JournalEntry));
-
-    if (bytes_written > 0)
-    {
-        fsync(fd);
+        return -1;
     }
-    else
+    size_t want = sizeof(JournalEntry) * (size_t)count;
+    off_t start = lseek(fd, 0, SEEK_END);
+    ssize_t bytes_written = io_write_fsync(fd, entries, want, -1);
+    int result = 0;
+    if (bytes_written != (ssize_t)want)
     {
         perror("FATAL: Could not write to journal file");
+        if (start != -1 && ftruncate(fd, start) == 0)
+            io_fsync(fd);
+        result = -1;
     }
     close(fd);
+    return result;
+}
+
+int journal_log_entry(JournalEntry entry)
+{
+    StatTimer timer = stats_start(STAT_JOURNAL_ENTRY);
+    int result = journal_append(&entry, 1);
+    stats_stop(STAT_JOURNAL_ENTRY, timer);
+    return result;
+}
+
+// Appends a group of journal entries with one write and one fsync. On -1 nothing of the group is
+// in the journal, and no account may be touched.
+int journal_log_entries(const JournalEntry *entries, int count)
+{
+    StatTimer timer = stats_start(STAT_JOURNAL_ENTRIES);
+    int result = journal_append(entries, count);
+    stats_stop(STAT_JOURNAL_ENTRIES, timer);
+    return result;
 }
 
 // Clears the journal file after successful recovery or commit
 void journal_log_clear()
 {
     // Open with O_TRUNC to wipe the file
-    int fd = open(JOURNAL_FILE, O_WRONLY | O_TRUNC | O_CREAT, 0644);
+    int fd = io_open(JOURNAL_FILE, O_WRONLY | O_TRUNC | O_CREAT, 0644);
     if (fd != -1)
     {
-        fsync(fd); // Ensure the truncation is written
+        io_fsync(fd); // Ensure the truncation is written
         close(fd);
     }
 }
\ No newline at end of file
@@ -0,0 +1,326 @@
+// src/data_bench.c
+#include "common.h"
+#include "data_access.h" // The primitives being measured
+#include <pthread.h>     // For contended runs
+#include <stdint.h>      // For uint64_t
+#include <stdio.h>       // For snprintf
+#include <sys/stat.h>    // For mkdir
+
+/*
+--- Data Access Microbenchmarks (make bench) ---
+
+-> For every record count given on the command line, generates users.dat, accounts.dat and
+   transactions.dat with that many records in a scratch directory (the data files are found
+   relative to the working directory), then times each primitive with random keys:
+   once on one thread and once on -t threads at the same time, like concurrent sessions.
+-> Each measurement runs for -m milliseconds (at least one call per thread).
+-> Output is CSV on stdout, one line per measurement, so runs can be diffed and plotted:
+       primitive,records,threads,ops,seconds,ns_per_op,ops_per_sec
+   Progress goes to stderr.
+*/
+
+#define BENCH_DIR_TEMPLATE "/tmp/bank_bench.XXXXXX"
+#define BENCH_WRITE_CHUNK (1 << 20) // Bytes per write() while generating data files
+#define BENCH_FIRST_ACCOUNT 10001   // Account numbers are "SB<BENCH_FIRST_ACCOUNT + index>"
+
+typedef enum
+{
+    B_FIND_USER_RECORD,
+    B_GET_ACCOUNT,
+    B_GET_ACCOUNT_BY_NUM,
+    B_UPDATE_ACCOUNT,
+    B_ADD_TRANSACTION,
+    B_GET_ACCOUNTS_BY_OWNER,
+    B_KINDS
+} BenchKind;
+
+static const char *bench_names[B_KINDS] = {"find_user_record", "getAccount", "getAccountByNum",
+                                           "updateAccount", "addTransaction", "getAccountsByOwnerId"};
+
+typedef struct
+{
+    BenchKind kind;
+    int records;
+    unsigned int seed;
+    uint64_t budget_us;
+    pthread_barrier_t *barrier;
+    unsigned long ops;
+    uint64_t elapsed_us;
+} BenchThread;
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void progress(const char *text)
+{
+    write_string(STDERR_FILENO, text);
+}
+
+// --- Synthetic Data ---
+
+// Account index (0-based) -> the record the generator wrote for it
+static Account make_account(int index)
+{
+    Account account;
+    memset(&account, 0, sizeof(account));
+    account.accountId = index + 1;
+    account.ownerUserId = index / 2 + 1; // Two accounts per customer
+    snprintf(account.accountNumber, sizeof(account.accountNumber), "SB%d", BENCH_FIRST_ACCOUNT + index);
+    account.balance = 10000.0;
+    account.isActive = 1;
+    return account;
+}
+
+// Streams count records made by fill(record, index) into path, BENCH_WRITE_CHUNK bytes per write
+static int write_file(const char *path, int count, size_t size, void (*fill)(void *, int))
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+    {
+        perror("bench: open");
+        return -1;
+    }
+    int per_chunk = BENCH_WRITE_CHUNK / size;
+    char *chunk = malloc((size_t)per_chunk * size);
+    if (chunk == NULL)
+    {
+        close(fd);
+        return -1;
+    }
+    for (int done = 0; done < count;)
+    {
+        int n = (count - done < per_chunk) ? count - done : per_chunk;
+        memset(chunk, 0, (size_t)n * size);
+        for (int i = 0; i < n; i++)
+            fill(chunk + (size_t)i * size, done + i);
+        if (write(fd, chunk, (size_t)n * size) != (ssize_t)((size_t)n * size))
+        {
+            perror("bench: write");
+            free(chunk);
+            close(fd);
+            return -1;
+        }
+        done += n;
+    }
+    free(chunk);
+    close(fd);
+    return 0;
+}
+
+static void fill_user(void *record, int index)
+{
+    User *user = record;
+    user->userId = index + 1;
+    user->role = CUSTOMER;
+    user->isActive = 1;
+    strcpy(user->password, "bench");
+    snprintf(user->firstName, sizeof(user->firstName), "User%d", index + 1);
+    snprintf(user->phone, sizeof(user->phone), "7%09d", index + 1);
+}
+
+static void fill_account(void *record, int index)
+{
+    *(Account *)record = make_account(index);
+}
+
+static void fill_transaction(void *record, int index)
+{
+    Transaction *txn = record;
+    Account account = make_account(index);
+    txn->transactionId = index + 1;
+    txn->accountId = account.accountId;
+    txn->userId = account.ownerUserId;
+    txn->type = DEPOSIT;
+    txn->amount = 100.0;
+    txn->newBalance = account.balance;
+    txn->timestamp = time(NULL);
+}
+
+static int generate(int records)
+{
+    if (write_file(USER_FILE, records, sizeof(User), fill_user) == -1 ||
+        write_file(ACCOUNT_FILE, records, sizeof(Account), fill_account) == -1 ||
+        write_file(TRANSACTION_FILE, records, sizeof(Transaction), fill_transaction) == -1)
+        return -1;
+    return 0;
+}
+
+// --- Measurement ---
+
+static void run_once(BenchKind kind, int records, unsigned int *seed)
+{
+    int index = rand_r(seed) % records;
+    Account account = make_account(index);
+    Account owned[8];
+    switch (kind)
+    {
+    case B_FIND_USER_RECORD:
+        find_user_record(index + 1);
+        break;
+    case B_GET_ACCOUNT:
+        getAccount(account.accountId);
+        break;
+    case B_GET_ACCOUNT_BY_NUM:
+        getAccountByNum(account.accountNumber);
+        break;
+    case B_UPDATE_ACCOUNT:
+        account.balance += 1.0;
+        updateAccount(account);
+        break;
+    case B_ADD_TRANSACTION:
+    {
+        Transaction txn;
+        memset(&txn, 0, sizeof(txn));
+        txn.accountId = account.accountId;
+        txn.userId = account.ownerUserId;
+        txn.type = DEPOSIT;
+        txn.amount = 1.0;
+        txn.newBalance = account.balance;
+        addTransaction(txn);
+        break;
+    }
+    default:
+        getAccountsByOwnerId(account.ownerUserId, owned, 8);
+        break;
+    }
+}
+
+static void *bench_thread(void *arg)
+{
+    BenchThread *thread = arg;
+    pthread_barrier_wait(thread->barrier);
+    uint64_t start = now_us();
+    do
+    {
+        run_once(thread->kind, thread->records, &thread->seed);
+        thread->ops++;
+    } while (now_us() - start < thread->budget_us);
+    thread->elapsed_us = now_us() - start;
+    return NULL;
+}
+
+// Runs kind on thread_count threads at once and prints its CSV line
+static void measure(BenchKind kind, int records, int thread_count, uint64_t budget_us)
+{
+    BenchThread threads[thread_count];
+    pthread_t ids[thread_count];
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, thread_count);
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        threads[i].kind = kind;
+        threads[i].records = records;
+        threads[i].seed = 12345 + i * 7919;
+        threads[i].budget_us = budget_us;
+        threads[i].barrier = &barrier;
+        threads[i].ops = 0;
+        threads[i].elapsed_us = 0;
+        if (pthread_create(&ids[i], NULL, bench_thread, &threads[i]) != 0)
+        {
+            perror("bench: pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    unsigned long ops = 0;
+    uint64_t elapsed_us = 0; // Wall time: the slowest thread
+    for (int i = 0; i < thread_count; i++)
+    {
+        pthread_join(ids[i], NULL);
+        ops += threads[i].ops;
+        if (threads[i].elapsed_us > elapsed_us)
+            elapsed_us = threads[i].elapsed_us;
+    }
+    pthread_barrier_destroy(&barrier);
+
+    double seconds = elapsed_us / 1e6;
+    char line[256];
+    snprintf(line, sizeof(line), "%s,%d,%d,%lu,%.6f,%.0f,%.1f\n", bench_names[kind], records, thread_count, ops,
+             seconds, ops ? elapsed_us * 1000.0 * thread_count / ops : 0.0, seconds > 0 ? ops / seconds : 0.0);
+    write_string(STDOUT_FILENO, line);
+}
+
+static void remove_files()
+{
+    unlink(USER_FILE);
+    unlink(ACCOUNT_FILE);
+    unlink(TRANSACTION_FILE);
+}
+
+// Generates records of each kind and measures every primitive on them. Returns 0 or -1.
+static int bench_size(int records, int thread_count, uint64_t budget_us)
+{
+    char message[128];
+    snprintf(message, sizeof(message), "Generating %d records...\n", records);
+    progress(message);
+    if (generate(records) == -1)
+        return -1;
+    for (int kind = 0; kind < B_KINDS; kind++)
+    {
+        snprintf(message, sizeof(message), "  %s\n", bench_names[kind]);
+        progress(message);
+        measure((BenchKind)kind, records, 1, budget_us);
+        if (thread_count > 1)
+            measure((BenchKind)kind, records, thread_count, budget_us);
+    }
+    remove_files();
+    return 0;
+}
+
+// Usage: ./data_bench [-t threads] [-m milliseconds] records...
+//   -t N   threads for the contended run (default 4; 1 skips it)
+//   -m MS  time per measurement (default 500)
+//   records: record counts to generate, e.g. 1000 100000 10000000 (default 1000)
+int main(int argc, char *argv[])
+{
+    int thread_count = 4;
+    int budget_ms = 500;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:m:")) != -1)
+    {
+        if (opt == 't')
+            thread_count = atoi(optarg);
+        else if (opt == 'm')
+            budget_ms = atoi(optarg);
+        else
+        {
+            write_string(STDERR_FILENO, "Usage: ./data_bench [-t threads] [-m milliseconds] records...\n");
+            return 1;
+        }
+    }
+    if (thread_count < 1 || budget_ms < 1)
+    {
+        write_string(STDERR_FILENO, "Threads and milliseconds must be positive.\n");
+        return 1;
+    }
+
+    // The data file paths are relative ("data/..."): run inside a scratch directory
+    char dir[] = BENCH_DIR_TEMPLATE;
+    if (mkdtemp(dir) == NULL || chdir(dir) == -1 || mkdir("data", 0755) == -1)
+    {
+        perror("bench: scratch directory");
+        return 1;
+    }
+
+    write_string(STDOUT_FILENO, "primitive,records,threads,ops,seconds,ns_per_op,ops_per_sec\n");
+    uint64_t budget_us = (uint64_t)budget_ms * 1000;
+    int status = 0;
+    if (optind == argc)
+        status = bench_size(1000, thread_count, budget_us);
+    for (int arg = optind; arg < argc && status == 0; arg++)
+    {
+        if (atoi(argv[arg]) > 0)
+            status = bench_size(atoi(argv[arg]), thread_count, budget_us);
+    }
+
+    remove_files();
+    rmdir("data");
+    if (chdir("/") == 0)
+        rmdir(dir);
+    return status == 0 ? 0 : 1;
+}
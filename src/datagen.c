@@ -0,0 +1,325 @@
+// src/datagen.c
+#include "datagen.h"     // Options, distributions and datagen_run
+#include "data_access.h" // For the next free ids and account number
+#include "password.h"    // For password_hash
+#include <stdint.h>      // For uint64_t
+#include <stdio.h>       // For snprintf
+
+typedef struct
+{
+    int fd;
+    char *buf;
+    size_t used;
+    unsigned long records;
+    int failed;
+} RecordWriter;
+
+static const char *first_names[] = {"Aarav", "Ananya", "Rohan", "Isha", "Kabir", "Meera", "Arjun", "Diya",
+                                    "Vivaan", "Saanvi", "Aditya", "Kavya", "Rahul", "Pooja", "Nikhil", "Sneha"};
+static const char *last_names[] = {"Sharma", "Verma", "Iyer", "Reddy", "Nair", "Patel", "Gupta", "Das",
+                                   "Menon", "Rao", "Joshi", "Kulkarni", "Singh", "Bose", "Pillai", "Mehta"};
+static const char *cities[] = {"Bangalore", "Mumbai", "Delhi", "Chennai", "Hyderabad", "Pune", "Kolkata"};
+static const char *feedback_texts[] = {"The mobile app logs me out too often.",
+                                       "Branch staff were very helpful with my KYC.",
+                                       "Please add UPI transfers to the menu.",
+                                       "Transfer took longer than expected.",
+                                       "Interest rates on savings should be higher."};
+
+#define PICK(array, rng) (array[next_random(rng) % (sizeof(array) / sizeof(array[0]))])
+
+// --- Random numbers (xorshift64*, seedable and identical on every platform) ---
+
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+// Uniform in [0, 1)
+static double next_unit(uint64_t *state)
+{
+    return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Heavy-tailed amount around base: base * 2^k * (1 + u), k geometric (half as likely per step)
+static double next_amount(uint64_t *state, double base)
+{
+    int k = 0;
+    while (k < 10 && (next_random(state) & 1))
+        k++;
+    double amount = base * (double)(1 << k) * (1.0 + next_unit(state));
+    return (double)(long)(amount * 100) / 100; // Whole paise
+}
+
+// --- Buffered writers ---
+
+static int writer_open(RecordWriter *writer, const char *path)
+{
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    writer->buf = malloc(DATAGEN_WRITE_BUFFER);
+    writer->used = 0;
+    writer->records = 0;
+    writer->failed = (writer->fd == -1 || writer->buf == NULL);
+    if (writer->failed)
+        perror(path);
+    return writer->failed ? -1 : 0;
+}
+
+static void writer_flush(RecordWriter *writer)
+{
+    size_t done = 0;
+    while (!writer->failed && done < writer->used)
+    {
+        ssize_t n = write(writer->fd, writer->buf + done, writer->used - done);
+        if (n <= 0)
+        {
+            perror("datagen: write");
+            writer->failed = 1;
+        }
+        else
+        {
+            done += n;
+        }
+    }
+    writer->used = 0;
+}
+
+static void writer_put(RecordWriter *writer, const void *record, size_t size)
+{
+    if (writer->used + size > DATAGEN_WRITE_BUFFER)
+        writer_flush(writer);
+    memcpy(writer->buf + writer->used, record, size);
+    writer->used += size;
+    writer->records++;
+}
+
+// Flushes and closes. Returns -1 if any write failed.
+static int writer_close(RecordWriter *writer)
+{
+    if (writer->fd != -1)
+    {
+        writer_flush(writer);
+        close(writer->fd);
+    }
+    free(writer->buf);
+    return writer->failed ? -1 : 0;
+}
+
+// --- Generator ---
+
+int datagen_run(const DatagenOptions *options)
+{
+    uint64_t rng = options->seed * 0x9E3779B97F4A7C15ULL + 1; // Never zero
+    int first_user = get_next_user_id();
+    int first_account = get_next_account_id();
+    int first_txn = get_next_transaction_id();
+    int first_loan = get_next_loan_id();
+    int first_feedback = get_next_feedback_id();
+    char number[20];
+    generate_new_account_number(number);
+    int first_number = atoi(number + 2); // "SB<n>"
+    time_t now = time(NULL);
+
+    char password[PASSWORD_FIELD_SIZE];
+    password_hash(DATAGEN_PASSWORD, password);
+
+    // Per account: owner and running balance (accounts.dat is written last, with final balances)
+    size_t capacity = (size_t)options->users * 3;
+    int *owners = malloc(capacity * sizeof(int));
+    double *balances = malloc(capacity * sizeof(double));
+    int employee_capacity = options->users / 25 + 16; // Twice the expected number
+    int *employees = malloc((size_t)employee_capacity * sizeof(int));
+    RecordWriter users, accounts, txns, loans, feedback;
+    RecordWriter *writers[] = {&users, &accounts, &txns, &loans, &feedback};
+    const char *paths[] = {USER_FILE, ACCOUNT_FILE, TRANSACTION_FILE, LOAN_FILE, FEEDBACK_FILE};
+    int result = 0;
+    for (int w = 0; w < 5; w++)
+    {
+        if (writer_open(writers[w], paths[w]) == -1)
+            result = -1;
+    }
+    if (owners == NULL || balances == NULL || employees == NULL)
+    {
+        perror("datagen: malloc");
+        result = -1;
+    }
+    if (result == -1)
+        goto done;
+
+    // --- Users (and which accounts each customer owns) ---
+    size_t account_count = 0;
+    int employee_count = 0;
+    User user;
+    for (int i = 0; i < options->users; i++)
+    {
+        memset(&user, 0, sizeof(user));
+        user.userId = first_user + i;
+        int roll = (int)(next_random(&rng) % 1000);
+        user.role = (roll < 5) ? MANAGER : (roll < 25) ? EMPLOYEE : CUSTOMER;
+        user.isActive = (next_random(&rng) % 100) != 0; // 1% deactivated
+        strcpy(user.password, password);
+        strcpy(user.firstName, PICK(first_names, &rng));
+        strcpy(user.lastName, PICK(last_names, &rng));
+        snprintf(user.phone, sizeof(user.phone), "9%09d", user.userId);
+        snprintf(user.email, sizeof(user.email), "%.20s.%.20s%d@example.com", user.firstName, user.lastName, user.userId);
+        snprintf(user.address, sizeof(user.address), "%d Main Road, %s", 1 + (int)(next_random(&rng) % 500),
+                 PICK(cities, &rng));
+        writer_put(&users, &user, sizeof(User));
+
+        if (user.role == EMPLOYEE && employee_count < employee_capacity)
+        {
+            employees[employee_count++] = user.userId;
+        }
+        else if (user.role == CUSTOMER)
+        {
+            int roll_accounts = (int)(next_random(&rng) % 10);
+            int owned = (roll_accounts < 6) ? 1 : (roll_accounts < 9) ? 2 : 3;
+            for (int a = 0; a < owned; a++)
+            {
+                owners[account_count] = user.userId;
+                balances[account_count] = 0;
+                account_count++;
+            }
+        }
+    }
+
+    // --- Transactions, in time order ---
+    if (account_count > 0)
+    {
+        Transaction txn;
+        size_t total = account_count * (size_t)options->txns_per_account;
+        time_t start = now - (time_t)DATAGEN_HISTORY_DAYS * 86400;
+        int next_txn = first_txn;
+
+        // Opening deposits
+        for (size_t a = 0; a < account_count; a++)
+        {
+            memset(&txn, 0, sizeof(txn));
+            txn.transactionId = next_txn++;
+            txn.accountId = first_account + (int)a;
+            txn.userId = owners[a];
+            txn.type = DEPOSIT;
+            txn.amount = next_amount(&rng, 1000.0);
+            balances[a] = txn.amount;
+            txn.newBalance = balances[a];
+            txn.timestamp = start;
+            writer_put(&txns, &txn, sizeof(Transaction));
+        }
+
+        for (size_t i = 0; i < total; i++)
+        {
+            // Squaring a uniform number favours low indexes: a few accounts are very busy
+            double u = next_unit(&rng);
+            size_t a = (size_t)(u * u * account_count);
+            int roll = (int)(next_random(&rng) % 100);
+            double amount = next_amount(&rng, 200.0);
+            memset(&txn, 0, sizeof(txn));
+            txn.transactionId = next_txn++;
+            txn.accountId = first_account + (int)a;
+            txn.userId = owners[a];
+            txn.amount = amount;
+            txn.timestamp = start + (time_t)((double)(now - start) * (i + 1) / (total + 1));
+
+            if (roll < 45 || balances[a] < amount)
+            {
+                txn.type = DEPOSIT; // Also instead of a withdrawal or transfer that would overdraw
+                balances[a] += amount;
+            }
+            else if (roll < 80 || account_count == 1)
+            {
+                txn.type = WITHDRAWAL;
+                balances[a] -= amount;
+            }
+            else
+            {
+                size_t other = (size_t)(next_random(&rng) % account_count);
+                if (other == a)
+                    other = (a + 1) % account_count;
+                txn.type = TRANSFER_OUT;
+                balances[a] -= amount;
+                snprintf(txn.otherPartyAccountNumber, sizeof(txn.otherPartyAccountNumber), "SB%d",
+                         first_number + (int)other);
+                txn.newBalance = balances[a];
+                writer_put(&txns, &txn, sizeof(Transaction));
+
+                // The receiving side gets its own record
+                balances[other] += amount;
+                txn.transactionId = next_txn++;
+                txn.accountId = first_account + (int)other;
+                txn.userId = owners[other];
+                txn.type = TRANSFER_IN;
+                snprintf(txn.otherPartyAccountNumber, sizeof(txn.otherPartyAccountNumber), "SB%d",
+                         first_number + (int)a);
+                txn.newBalance = balances[other];
+                writer_put(&txns, &txn, sizeof(Transaction));
+                continue;
+            }
+            txn.newBalance = balances[a];
+            writer_put(&txns, &txn, sizeof(Transaction));
+        }
+    }
+
+    // --- Accounts, with the balances the history ended at ---
+    Account account;
+    for (size_t a = 0; a < account_count; a++)
+    {
+        memset(&account, 0, sizeof(account));
+        account.accountId = first_account + (int)a;
+        account.ownerUserId = owners[a];
+        snprintf(account.accountNumber, sizeof(account.accountNumber), "SB%d", first_number + (int)a);
+        account.balance = balances[a];
+        account.isActive = 1;
+        writer_put(&accounts, &account, sizeof(Account));
+    }
+
+    // --- Loans and feedback (one pass over the customers' accounts) ---
+    Loan loan;
+    Feedback note;
+    int next_loan = first_loan, next_feedback = first_feedback;
+    for (size_t a = 0; a < account_count; a++)
+    {
+        if (a > 0 && owners[a] == owners[a - 1])
+            continue; // Same customer: first account only
+        if (next_random(&rng) % 100 < 8)
+        {
+            memset(&loan, 0, sizeof(loan));
+            loan.loanId = next_loan++;
+            loan.userId = owners[a];
+            loan.accountIdToDeposit = first_account + (int)a;
+            loan.amount = next_amount(&rng, 50000.0);
+            int roll = (int)(next_random(&rng) % 10);
+            loan.status = (roll < 4) ? PENDING : (roll < 6) ? PROCESSING : (roll < 9) ? APPROVED : REJECTED;
+            if (loan.status != PENDING && employee_count > 0)
+                loan.assignedToEmployeeId = employees[next_random(&rng) % employee_count];
+            writer_put(&loans, &loan, sizeof(Loan));
+        }
+        if (next_random(&rng) % 100 < 5)
+        {
+            memset(&note, 0, sizeof(note));
+            note.feedbackId = next_feedback++;
+            note.userId = owners[a];
+            strcpy(note.feedbackText, PICK(feedback_texts, &rng));
+            note.isReviewed = (int)(next_random(&rng) & 1);
+            writer_put(&feedback, &note, sizeof(Feedback));
+        }
+    }
+
+    char summary[256];
+    snprintf(summary, sizeof(summary),
+             "Generated %lu users (%d employees), %lu accounts, %lu transactions, %lu loans, %lu feedback entries.\n",
+             users.records, employee_count, accounts.records, txns.records, loans.records, feedback.records);
+    write_string(STDOUT_FILENO, summary);
+
+done:
+    for (int w = 0; w < 5; w++)
+    {
+        if (writer_close(writers[w]) == -1)
+            result = -1;
+    }
+    free(owners);
+    free(balances);
+    free(employees);
+    return result;
+}
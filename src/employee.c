@@ -2,6 +2,10 @@
 #include "employee.h"    // Function declarations for employee module
 #include "customer.h"    // For shared handle_view_my_details, handle_change_password
 #include "data_access.h" // For data access functions
+#include "io_backend.h"  // For io_open, io_read (data-file scans)
+#include "hash_pool.h"   // For hashing new passwords off the session thread
+#include "rate_limit.h"  // For read_menu_choice
+#include "stats.h"       // For STATS_TIME (handler latency)
 #include "common.h"      // For structs, enums, read_client_input, write_string
 #include <stdio.h>       // For sprintf
 #include <stdlib.h>      // For atoi
@@ -10,7 +14,7 @@
 pthread_mutex_t create_user_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // --- Employee Menu ---
-void employee_menu(int client_socket, User user)
+MenuExit employee_menu(int client_socket, User user)
 {
     char buffer[MAX_BUFFER];
     while (1)
@@ -28,37 +32,39 @@ void employee_menu(int client_socket, User user)
         write_string(client_socket, "9. Logout\n");
         write_string(client_socket, "Enter your choice: ");
 
-        read_client_input(client_socket, buffer, MAX_BUFFER);
+        // Check for disconnect (or a connection reaped by the idle timeout)
+        if (read_menu_choice(client_socket, buffer, MAX_BUFFER, user.userId) == -1)
+            return MENU_DISCONNECTED;
         int choice = atoi(buffer);
         switch (choice)
         {
         case 1:
-            handle_add_user(client_socket, CUSTOMER);
+            STATS_TIME(STAT_ADD_USER, handle_add_user(client_socket, CUSTOMER));
             break;
         case 2:
-            handle_add_new_account(client_socket);
+            STATS_TIME(STAT_ADD_NEW_ACCOUNT, handle_add_new_account(client_socket));
             break;
         case 3:
-            handle_modify_user_details(client_socket, 0);
+            STATS_TIME(STAT_MODIFY_USER, handle_modify_user_details(client_socket, 0));
             break;
         case 4:
-            handle_view_customer_transactions(client_socket);
+            STATS_TIME(STAT_CUSTOMER_TRANSACTIONS, handle_view_customer_transactions(client_socket));
             break;
         case 5:
-            handle_view_assigned_loans(client_socket, user.userId);
+            STATS_TIME(STAT_ASSIGNED_LOANS, handle_view_assigned_loans(client_socket, user.userId));
             break;
         case 6:
-            handle_process_loan(client_socket, user.userId);
+            STATS_TIME(STAT_PROCESS_LOAN, handle_process_loan(client_socket, user.userId));
             break;
         case 7:
-            handle_view_my_details(client_socket, user);
+            STATS_TIME(STAT_VIEW_MY_DETAILS, handle_view_my_details(client_socket, user));
             break; 
         case 8:
-            handle_change_password(client_socket, user.userId);
+            STATS_TIME(STAT_CHANGE_PASSWORD, handle_change_password(client_socket, user.userId));
             break;
         case 9:
             write_string(client_socket, "Logging out. Goodbye!\n");
-            return;
+            return MENU_LOGOUT;
         default:
             write_string(client_socket, "Invalid choice.\n");
         }
@@ -88,10 +94,13 @@ void handle_add_user(int client_socket, UserRole role_to_add)
         {
             write_string(client_socket, "Invalid password (empty or too long). Please try again.\n");
         }
+        else if (hash_pool_hash(buffer, new_user.password) != 0)
+        {
+            write_string(client_socket, "Server busy, could not store the password. Please try again.\n");
+        }
         else
         {
-            strcpy(new_user.password, buffer);
-            break; // Valid input
+            break; // Valid input, stored as a salted hash
         }
     }
 
@@ -181,59 +190,55 @@ void handle_add_user(int client_socket, UserRole role_to_add)
     }
 
     // Prevent Race Condition & Check Uniqueness
+    // The reply is only built under the lock and sent after unlocking: writing to the client
+    // can suspend an event-loop session, which must not happen while holding the mutex.
     pthread_mutex_lock(&create_user_mutex);
 
     // Uniqueness Check
     if (find_user_by_phone(new_user.phone) == 0)
     { 
         // 0 means "found"
-        write_string(client_socket, "Error: This phone number is already in use. Aborting.\n");
-        pthread_mutex_unlock(&create_user_mutex);
-        return;
+        strcpy(buffer, "Error: This phone number is already in use. Aborting.\n");
     }
-    if (find_user_by_email(new_user.email) == 0)
+    else if (find_user_by_email(new_user.email) == 0)
     { 
         // 0 means "found"
-        write_string(client_socket, "Error: This email address is already in use. Aborting.\n");
-        pthread_mutex_unlock(&create_user_mutex);
-        return;
+        strcpy(buffer, "Error: This email address is already in use. Aborting.\n");
     }
-
-    new_user.userId = get_next_user_id();
-
-    if (addUser(new_user) != 0)
+    else
     {
-        write_string(client_socket, "Error adding user to file.\n");
-        pthread_mutex_unlock(&create_user_mutex);
-        return;
-    }
+        new_user.userId = get_next_user_id();
 
-    if (role_to_add == CUSTOMER)
-    {
-        Account new_account;
-        new_account.ownerUserId = new_user.userId;
-        new_account.balance = 0.0;
-        new_account.isActive = 1;
-        generate_new_account_number(new_account.accountNumber);
-        new_account.accountId = get_next_account_id();
-
-        if (addAccount(new_account) == 0)
+        if (addUser(new_user) != 0)
         {
-            sprintf(buffer, "User created. New ID: %d, New Account: %s\n", new_user.userId, new_account.accountNumber);
-            write_string(client_socket, buffer);
+            strcpy(buffer, "Error adding user to file.\n");
+        }
+        else if (role_to_add == CUSTOMER)
+        {
+            Account new_account;
+            new_account.ownerUserId = new_user.userId;
+            new_account.balance = 0.0;
+            new_account.isActive = 1;
+            generate_new_account_number(new_account.accountNumber);
+            new_account.accountId = get_next_account_id();
+
+            if (addAccount(new_account) == 0)
+            {
+                sprintf(buffer, "User created. New ID: %d, New Account: %s\n", new_user.userId, new_account.accountNumber);
+            }
+            else
+            {
+                strcpy(buffer, "User created, but failed to create account.\n");
+            }
         }
         else
         {
-            write_string(client_socket, "User created, but failed to create account.\n");
+            sprintf(buffer, "User created successfully. New User ID: %d\n", new_user.userId);
         }
     }
-    else
-    {
-        sprintf(buffer, "User created successfully. New User ID: %d\n", new_user.userId);
-        write_string(client_socket, buffer);
-    }
 
     pthread_mutex_unlock(&create_user_mutex);
+    write_string(client_socket, buffer);
 }
 
 void handle_add_new_account(int client_socket)
@@ -304,42 +309,48 @@ void handle_modify_user_details(int client_socket, int admin_mode)
     }
 
     write_string(client_socket, "Enter new password (or 'skip'): ");
-    read_client_input(client_socket, buffer, MAX_BUFFER);
-    if (my_strcmp(buffer, "skip") != 0)
+    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        return; // Client disconnected: do not save half-edited details
+    if (my_strcmp(buffer, "skip") != 0 && hash_pool_hash(buffer, user.password) != 0)
     {
-        strcpy(user.password, buffer);
+        write_string(client_socket, "Server busy, password left unchanged.\n");
     }
 
     write_string(client_socket, "Enter new First Name (or 'skip'): ");
-    read_client_input(client_socket, buffer, MAX_BUFFER);
+    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        return; // Client disconnected
     if (my_strcmp(buffer, "skip") != 0)
     {
         strcpy(user.firstName, buffer);
     }
 
     write_string(client_socket, "Enter new Last Name (or 'skip'): ");
-    read_client_input(client_socket, buffer, MAX_BUFFER);
+    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        return; // Client disconnected
     if (my_strcmp(buffer, "skip") != 0)
     {
         strcpy(user.lastName, buffer);
     }
 
     write_string(client_socket, "Enter new Phone (or 'skip'): ");
-    read_client_input(client_socket, buffer, MAX_BUFFER);
+    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        return; // Client disconnected
     if (my_strcmp(buffer, "skip") != 0)
     {
         strcpy(user.phone, buffer);
     }
 
     write_string(client_socket, "Enter new Email (or 'skip'): ");
-    read_client_input(client_socket, buffer, MAX_BUFFER);
+    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        return; // Client disconnected
     if (my_strcmp(buffer, "skip") != 0)
     {
         strcpy(user.email, buffer);
     }
 
     write_string(client_socket, "Enter new Address (or 'skip'): ");
-    read_client_input(client_socket, buffer, MAX_BUFFER);
+    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        return; // Client disconnected
     if (my_strcmp(buffer, "skip") != 0)
     {
         strcpy(user.address, buffer);
@@ -349,7 +360,8 @@ void handle_modify_user_details(int client_socket, int admin_mode)
     if (admin_mode)
     {
         write_string(client_socket, "Enter new role (0=CUST, 1=EMP, 2=MAN, 3=ADMIN) (or 'skip'): ");
-        read_client_input(client_socket, buffer, MAX_BUFFER);
+        if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+            return; // Client disconnected
         if (my_strcmp(buffer, "skip") != 0)
         {
             int role_val = atoi(buffer);
@@ -397,7 +409,7 @@ void handle_view_customer_transactions(int client_socket)
 
 void handle_view_assigned_loans(int client_socket, int employeeId)
 {
-    int fd = open(LOAN_FILE, O_RDONLY);
+    int fd = io_open(LOAN_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         write_string(client_socket, "No loans found.\n");
@@ -411,7 +423,7 @@ void handle_view_assigned_loans(int client_socket, int employeeId)
 
     write_string(client_socket, "\n--- Your Assigned Loans ---\n");
     lseek(fd, 0, SEEK_SET);
-    while (read(fd, &loan, sizeof(Loan)) == sizeof(Loan))
+    while (io_read(fd, &loan, sizeof(Loan)) == sizeof(Loan))
     {
         if (loan.assignedToEmployeeId == employeeId && (loan.status == PENDING || loan.status == PROCESSING))
         {
@@ -0,0 +1,45 @@
+// src/fault.c
+#include "fault.h"     // Crash point names and FAULT_POINT
+#include <signal.h>    // For kill, SIGKILL
+#include <stdatomic.h> // For the hit counter
+#include <stdio.h>     // For snprintf
+
+int fault_armed = 0;
+static char armed_name[64];
+static long armed_hit = 1;
+static atomic_long hits;
+
+void fault_init()
+{
+    const char *spec = getenv(FAULT_ENV);
+    if (spec == NULL || spec[0] == '\0')
+        return;
+
+    snprintf(armed_name, sizeof(armed_name), "%s", spec);
+    char *colon = strchr(armed_name, ':');
+    if (colon != NULL)
+    {
+        *colon = '\0';
+        armed_hit = atol(colon + 1);
+        if (armed_hit < 1)
+            armed_hit = 1;
+    }
+    fault_armed = 1;
+
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "Fault injection: crash at hit %ld of '%s'.\n", armed_hit, armed_name);
+    write_string(STDOUT_FILENO, buffer);
+}
+
+void fault_hit(const char *name)
+{
+    if (my_strcmp(name, armed_name) != 0)
+        return;
+    if (atomic_fetch_add(&hits, 1) + 1 != armed_hit)
+        return;
+
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "!!! CRASH POINT '%s' (hit %ld) !!!\n", name, armed_hit);
+    write_string(STDOUT_FILENO, buffer);
+    kill(getpid(), SIGKILL);
+}
@@ -0,0 +1,191 @@
+// src/hash_pool.c
+#include "hash_pool.h"   // Pool API and limits
+#include "password.h"    // For password_hash, password_verify
+#include <poll.h>        // For POLLIN
+#include <pthread.h>     // For worker threads and the queue lock
+#include <stdatomic.h>   // For counters
+#include <stdint.h>      // For uint64_t
+#include <stdio.h>       // For snprintf
+#include <sys/eventfd.h> // For completion notification
+
+typedef enum
+{
+    JOB_HASH,
+    JOB_VERIFY
+} JobKind;
+
+typedef struct HashJob
+{
+    JobKind kind;
+    const char *password;
+    const char *stored_in; // JOB_VERIFY
+    char *stored_out;      // JOB_HASH
+    int result;
+    int done_fd;        // eventfd the worker signals
+    uint64_t queued_us; // When the job entered the queue
+    struct HashJob *next;
+} HashJob;
+
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static HashJob *queue_head = NULL;
+static HashJob *queue_tail = NULL;
+static int queue_depth = 0;
+static int queue_depth_max = 0;
+static int thread_count = 0;
+
+static atomic_ulong jobs_done;
+static atomic_ulong jobs_rejected;
+static atomic_ulong wait_us_total; // Time jobs spent queued
+static atomic_ulong wait_us_max;
+static atomic_ulong work_us_total; // Time spent hashing
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void run_job(HashJob *job)
+{
+    if (job->kind == JOB_HASH)
+        job->result = password_hash(job->password, job->stored_out);
+    else
+        job->result = password_verify(job->password, job->stored_in);
+}
+
+static void *worker_thread(void *arg)
+{
+    (void)arg;
+    while (1)
+    {
+        pthread_mutex_lock(&queue_mutex);
+        while (queue_head == NULL)
+            pthread_cond_wait(&queue_cond, &queue_mutex);
+        HashJob *job = queue_head;
+        queue_head = job->next;
+        if (queue_head == NULL)
+            queue_tail = NULL;
+        queue_depth--;
+        pthread_mutex_unlock(&queue_mutex);
+
+        uint64_t start = now_us();
+        unsigned long waited = (unsigned long)(start - job->queued_us);
+        atomic_fetch_add_explicit(&wait_us_total, waited, memory_order_relaxed);
+        unsigned long seen = atomic_load_explicit(&wait_us_max, memory_order_relaxed);
+        while (waited > seen && !atomic_compare_exchange_weak(&wait_us_max, &seen, waited))
+        {
+        }
+
+        run_job(job);
+        atomic_fetch_add_explicit(&work_us_total, (unsigned long)(now_us() - start), memory_order_relaxed);
+        atomic_fetch_add_explicit(&jobs_done, 1, memory_order_relaxed);
+
+        // The job lives on the waiter's stack: touch nothing after this write
+        uint64_t one = 1;
+        if (write(job->done_fd, &one, sizeof(one)) != sizeof(one))
+            perror("hash pool: signal");
+    }
+    return NULL;
+}
+
+int hash_pool_start(int threads)
+{
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker_thread, NULL) != 0)
+        {
+            perror("hash pool: pthread_create");
+            break;
+        }
+        pthread_detach(thread);
+        thread_count++;
+    }
+    return thread_count;
+}
+
+// Queues job and waits for a worker to finish it. Returns job->result or HASH_POOL_BUSY.
+static int submit(HashJob *job)
+{
+    if (thread_count == 0)
+    {
+        run_job(job); // No pool (admin_util): hash right here
+        return job->result;
+    }
+
+    job->done_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (job->done_fd == -1)
+    {
+        perror("hash pool: eventfd");
+        return HASH_POOL_BUSY;
+    }
+    job->next = NULL;
+    job->queued_us = now_us();
+
+    pthread_mutex_lock(&queue_mutex);
+    if (queue_depth >= HASH_POOL_QUEUE_MAX)
+    {
+        pthread_mutex_unlock(&queue_mutex);
+        atomic_fetch_add_explicit(&jobs_rejected, 1, memory_order_relaxed);
+        close(job->done_fd);
+        return HASH_POOL_BUSY;
+    }
+    if (queue_tail != NULL)
+        queue_tail->next = job;
+    else
+        queue_head = job;
+    queue_tail = job;
+    queue_depth++;
+    if (queue_depth > queue_depth_max)
+        queue_depth_max = queue_depth;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_mutex);
+
+    // Coroutine sessions yield here; threads sleep in poll()
+    uint64_t count;
+    while (read(job->done_fd, &count, sizeof(count)) != sizeof(count))
+        wait_for_fd(job->done_fd, POLLIN);
+    close(job->done_fd);
+    return job->result;
+}
+
+int hash_pool_hash(const char *password, char *stored)
+{
+    HashJob job;
+    job.kind = JOB_HASH;
+    job.password = password;
+    job.stored_out = stored;
+    return submit(&job);
+}
+
+int hash_pool_verify(const char *password, const char *stored)
+{
+    if (password_is_legacy(stored))
+        return password_verify(password, stored); // Plain comparison: nothing to offload
+
+    HashJob job;
+    job.kind = JOB_VERIFY;
+    job.password = password;
+    job.stored_in = stored;
+    return submit(&job);
+}
+
+void hash_pool_report(int fd)
+{
+    char buffer[256];
+    pthread_mutex_lock(&queue_mutex);
+    int depth = queue_depth;
+    int depth_max = queue_depth_max;
+    pthread_mutex_unlock(&queue_mutex);
+
+    unsigned long done = atomic_load(&jobs_done);
+    snprintf(buffer, sizeof(buffer),
+             "Hash pool: %d thread(s), queued=%d (max %d, limit %d), done=%lu rejected=%lu\n"
+             "Hash pool: avg wait %.2f ms (max %.2f ms), avg hash %.2f ms\n",
+             thread_count, depth, depth_max, HASH_POOL_QUEUE_MAX, done, atomic_load(&jobs_rejected),
+             done ? atomic_load(&wait_us_total) / 1000.0 / done : 0.0, atomic_load(&wait_us_max) / 1000.0,
+             done ? atomic_load(&work_us_total) / 1000.0 / done : 0.0);
+    write_string(fd, buffer);
+}
@@ -0,0 +1,93 @@
+// src/histogram.c
+#include "histogram.h" // Histogram layout and prototypes
+
+#define SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+
+// Values below SUB_COUNT get a bucket each; above, the top HISTOGRAM_SUB_BITS bits after the
+// leading one pick the bucket within its power of two.
+static int bucket_of(uint64_t value)
+{
+    if (value < SUB_COUNT)
+        return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - HISTOGRAM_SUB_BITS;
+    return ((shift + 1) << HISTOGRAM_SUB_BITS) + (int)((value >> shift) & (SUB_COUNT - 1));
+}
+
+// Largest value that falls into bucket
+static uint64_t bucket_upper(int bucket)
+{
+    if (bucket < SUB_COUNT)
+        return (uint64_t)bucket;
+    int shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+    uint64_t base = (uint64_t)(SUB_COUNT + (bucket & (SUB_COUNT - 1)));
+    return ((base + 1) << shift) - 1;
+}
+
+void histogram_record(Histogram *h, uint64_t value)
+{
+    h->counts[bucket_of(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max)
+        h->max = value;
+}
+
+// Single writer: a plain load and store, made atomic only so concurrent readers see whole values
+#define BUMP(field, delta) \
+    __atomic_store_n(&(field), __atomic_load_n(&(field), __ATOMIC_RELAXED) + (delta), __ATOMIC_RELAXED)
+
+void histogram_record_shared(Histogram *h, uint64_t value)
+{
+    BUMP(h->counts[bucket_of(value)], 1);
+    BUMP(h->count, 1);
+    BUMP(h->sum, value);
+    if (value > __atomic_load_n(&h->max, __ATOMIC_RELAXED))
+        __atomic_store_n(&h->max, value, __ATOMIC_RELAXED);
+}
+
+void histogram_merge_shared(Histogram *into, const Histogram *from)
+{
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+        into->counts[i] += __atomic_load_n(&from->counts[i], __ATOMIC_RELAXED);
+    into->count += __atomic_load_n(&from->count, __ATOMIC_RELAXED);
+    into->sum += __atomic_load_n(&from->sum, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&from->max, __ATOMIC_RELAXED);
+    if (max > into->max)
+        into->max = max;
+}
+
+void histogram_merge(Histogram *into, const Histogram *from)
+{
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+        into->counts[i] += from->counts[i];
+    into->count += from->count;
+    into->sum += from->sum;
+    if (from->max > into->max)
+        into->max = from->max;
+}
+
+uint64_t histogram_percentile(const Histogram *h, double percentile)
+{
+    if (h->count == 0)
+        return 0;
+    // Rank of the value we want (1-based), rounded up so p100 is the last value
+    double exact = percentile / 100.0 * h->count;
+    unsigned long rank = (unsigned long)exact;
+    if (rank < exact)
+        rank++;
+    if (rank == 0)
+        rank = 1;
+
+    unsigned long seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += h->counts[i];
+        if (seen >= rank)
+        {
+            uint64_t upper = bucket_upper(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
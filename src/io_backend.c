@@ -0,0 +1,465 @@
+// src/io_backend.c
+#include "io_backend.h"   // Backend API
+#include <linux/io_uring.h> // For the io_uring ABI (structs, opcodes, flags)
+#include <pthread.h>      // For the ring mutex
+#include <stdatomic.h>    // For counters
+#include <stdint.h>       // For uintptr_t (pointers in user_data)
+#include <stdio.h>        // For snprintf
+#include <sys/mman.h>     // For mmap of the ring buffers
+#include <sys/syscall.h>  // For __NR_io_uring_setup, __NR_io_uring_enter
+#include "fault.h"        // For FAULT_POINT
+#include "stats.h"        // For the per-file I/O accounting
+
+/*
+--- Shared io_uring ---
+
+-> io_uring is two ring buffers shared with the kernel: we write requests (SQEs) into the
+   submission queue and the kernel writes results (CQEs) into the completion queue. One
+   io_uring_enter() call submits everything queued and can also wait for completions.
+-> liburing is not required: the three syscalls are called directly and the rings are mmap'ed
+   the way liburing does it.
+-> Many session threads share one ring:
+   - Submitting is done under ring_mutex, so linked pairs (write + fsync) stay together.
+   - Waiting uses a "leader": one waiting thread sleeps in io_uring_enter(GETEVENTS). When it wakes
+     it hands every completion it finds to its owner (IoCompletion, found through user_data) and
+     wakes the other waiters, one of which becomes the next leader.
+-> inflight never exceeds the completion queue size, so completions cannot overflow.
+-> A receive on an idle socket stays in flight until the client types. At most half of the
+   completion queue is given to receives; beyond that io_recv() uses recv() directly, so idle
+   sessions can never starve data-file I/O of ring slots.
+*/
+
+typedef struct
+{
+    ssize_t result;
+    int done;
+} IoCompletion;
+
+typedef struct
+{
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned sq_entries, cq_entries;
+    unsigned inflight;  // Submitted, completion not yet reaped
+    unsigned recvs;     // Socket receives among them (they can wait for minutes)
+    int leader_active;  // A thread is waiting in io_uring_enter for completions
+    int current_pos_ok; // Kernel supports offset -1 ("use the file position")
+} Ring;
+
+static IoBackendKind backend = IO_BACKEND_SYSCALL;
+static Ring ring;
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ring_cond = PTHREAD_COND_INITIALIZER;
+
+static atomic_ulong ops_submitted;
+static atomic_ulong enter_calls;
+static atomic_ulong linked_pairs;
+static atomic_ulong syscall_ops; // Requests served by the plain syscall path
+static unsigned char fd_files[IO_TRACKED_FDS]; // StatFile of each fd, set by io_open
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int ring_setup()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = sys_io_uring_setup(IO_URING_ENTRIES, &params);
+    if (fd < 0)
+        return -1;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) && cq_size > sq_size)
+        sq_size = cq_size;
+
+    char *sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED)
+    {
+        close(fd);
+        return -1;
+    }
+    char *cq = sq;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        cq = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED)
+        {
+            munmap(sq, sq_size);
+            close(fd);
+            return -1;
+        }
+    }
+    void *sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        munmap(sq, sq_size);
+        if (cq != sq)
+            munmap(cq, cq_size);
+        close(fd);
+        return -1;
+    }
+
+    ring.fd = fd;
+    ring.sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring.sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring.sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring.sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring.cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring.cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring.cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ring.sqes = (struct io_uring_sqe *)sqes;
+    ring.sq_entries = params.sq_entries;
+    ring.cq_entries = params.cq_entries;
+    ring.current_pos_ok = (params.features & IORING_FEAT_RW_CUR_POS) != 0;
+    return 0;
+}
+
+IoBackendKind io_backend_init(IoBackendKind requested)
+{
+    backend = IO_BACKEND_SYSCALL;
+    if (requested == IO_BACKEND_URING)
+    {
+        if (ring_setup() == 0)
+            backend = IO_BACKEND_URING;
+        else
+            perror("io_uring unavailable, using blocking syscalls");
+    }
+    return backend;
+}
+
+const char *io_backend_name()
+{
+    return backend == IO_BACKEND_URING ? "io_uring" : "syscall";
+}
+
+// Hands every available completion to its owner (caller holds ring_mutex)
+static void reap_completions()
+{
+    unsigned head = *ring.cq_head;
+    unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail)
+    {
+        struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+        IoCompletion *completion = (IoCompletion *)(uintptr_t)cqe->user_data;
+        completion->result = cqe->res;
+        completion->done = 1;
+        ring.inflight--;
+        head++;
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+}
+
+static int all_done(IoCompletion *completions, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (!completions[i].done)
+            return 0;
+    }
+    return 1;
+}
+
+// Queues count prepared SQEs, submits them and blocks until all of their completions arrived.
+// sqes[i].user_data is overwritten with &completions[i].
+static void ring_submit_and_wait(struct io_uring_sqe *templates, IoCompletion *completions, unsigned count)
+{
+    pthread_mutex_lock(&ring_mutex);
+    while (ring.inflight + count > ring.cq_entries ||
+           *ring.sq_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) + count > ring.sq_entries)
+    {
+        pthread_cond_wait(&ring_cond, &ring_mutex);
+    }
+
+    unsigned tail = *ring.sq_tail;
+    for (unsigned i = 0; i < count; i++)
+    {
+        unsigned index = (tail + i) & *ring.sq_mask;
+        ring.sqes[index] = templates[i];
+        ring.sqes[index].user_data = (uint64_t)(uintptr_t)&completions[i];
+        ring.sq_array[index] = index;
+        completions[i].done = 0;
+    }
+    __atomic_store_n(ring.sq_tail, tail + count, __ATOMIC_RELEASE);
+    ring.inflight += count;
+
+    // Submitting under the mutex keeps a linked pair inside one submission
+    int submitted;
+    do
+    {
+        submitted = sys_io_uring_enter(ring.fd, count, 0, 0);
+    } while (submitted < 0 && errno == EINTR);
+    atomic_fetch_add_explicit(&enter_calls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ops_submitted, count, memory_order_relaxed);
+    if (submitted < 0)
+    {
+        // Nothing was consumed: take our entries back and report the error to every caller
+        int saved_errno = errno;
+        __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+        ring.inflight -= count;
+        for (unsigned i = 0; i < count; i++)
+        {
+            completions[i].result = -saved_errno;
+            completions[i].done = 1;
+        }
+        pthread_mutex_unlock(&ring_mutex);
+        return;
+    }
+
+    // Wait for our completions, taking turns as the leader that reaps the queue
+    while (!all_done(completions, count))
+    {
+        if (!ring.leader_active)
+        {
+            ring.leader_active = 1;
+            pthread_mutex_unlock(&ring_mutex);
+            sys_io_uring_enter(ring.fd, 0, 1, IORING_ENTER_GETEVENTS);
+            atomic_fetch_add_explicit(&enter_calls, 1, memory_order_relaxed);
+            pthread_mutex_lock(&ring_mutex);
+            reap_completions();
+            ring.leader_active = 0;
+            pthread_cond_broadcast(&ring_cond);
+        }
+        else
+        {
+            pthread_cond_wait(&ring_cond, &ring_mutex);
+        }
+    }
+    pthread_mutex_unlock(&ring_mutex);
+}
+
+// Runs one request on the ring and converts the result to the syscall convention
+static ssize_t ring_single(struct io_uring_sqe *sqe)
+{
+    IoCompletion completion;
+    ring_submit_and_wait(sqe, &completion, 1);
+    if (completion.result < 0)
+    {
+        errno = (int)-completion.result;
+        return -1;
+    }
+    return completion.result;
+}
+
+static void prep_rw(struct io_uring_sqe *sqe, int opcode, int fd, const void *buf, size_t len, off_t offset)
+{
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (unsigned char)opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = (unsigned)len;
+    sqe->off = (uint64_t)offset; // -1 means "current file position"
+}
+
+// The ring serves the request unless it needs the file position and the kernel cannot do that
+static int use_ring(off_t offset)
+{
+    if (backend != IO_BACKEND_URING)
+        return 0;
+    return offset != -1 || ring.current_pos_ok;
+}
+
+// --- Data files ---
+
+int io_open(const char *path, int flags, mode_t mode)
+{
+    int fd = open(path, flags, mode);
+    if (fd >= 0 && fd < IO_TRACKED_FDS)
+        __atomic_store_n(&fd_files[fd], (unsigned char)stats_file_of(path), __ATOMIC_RELAXED);
+    return fd;
+}
+
+static StatFile file_of(int fd)
+{
+    if (fd < 0 || fd >= IO_TRACKED_FDS)
+        return STAT_FILE_OTHER;
+    return (StatFile)__atomic_load_n(&fd_files[fd], __ATOMIC_RELAXED);
+}
+
+static ssize_t ring_rw(int opcode, int fd, const void *buf, size_t len, off_t offset)
+{
+    struct io_uring_sqe sqe;
+    prep_rw(&sqe, opcode, fd, buf, len, offset);
+    return ring_single(&sqe);
+}
+
+ssize_t io_read(int fd, void *buf, size_t len)
+{
+    ssize_t result;
+    if (!use_ring(-1))
+    {
+        atomic_fetch_add_explicit(&syscall_ops, 1, memory_order_relaxed);
+        result = read(fd, buf, len);
+    }
+    else
+        result = ring_rw(IORING_OP_READ, fd, buf, len, -1);
+    stats_io(file_of(fd), STAT_IO_READ, result, 0);
+    return result;
+}
+
+ssize_t io_pread(int fd, void *buf, size_t len, off_t offset)
+{
+    ssize_t result;
+    if (!use_ring(offset))
+    {
+        atomic_fetch_add_explicit(&syscall_ops, 1, memory_order_relaxed);
+        result = pread(fd, buf, len, offset);
+    }
+    else
+        result = ring_rw(IORING_OP_READ, fd, buf, len, offset);
+    stats_io(file_of(fd), STAT_IO_READ, result, 0);
+    return result;
+}
+
+ssize_t io_write(int fd, const void *buf, size_t len)
+{
+    ssize_t result;
+    if (!use_ring(-1))
+    {
+        atomic_fetch_add_explicit(&syscall_ops, 1, memory_order_relaxed);
+        result = write(fd, buf, len);
+    }
+    else
+        result = ring_rw(IORING_OP_WRITE, fd, buf, len, -1);
+    stats_io(file_of(fd), STAT_IO_WRITE, result, 0);
+    return result;
+}
+
+ssize_t io_pwrite(int fd, const void *buf, size_t len, off_t offset)
+{
+    ssize_t result;
+    if (!use_ring(offset))
+    {
+        atomic_fetch_add_explicit(&syscall_ops, 1, memory_order_relaxed);
+        result = pwrite(fd, buf, len, offset);
+    }
+    else
+        result = ring_rw(IORING_OP_WRITE, fd, buf, len, offset);
+    stats_io(file_of(fd), STAT_IO_WRITE, result, 0);
+    return result;
+}
+
+int io_fsync(int fd)
+{
+    uint64_t started = stats_clock();
+    int result;
+    if (backend != IO_BACKEND_URING)
+    {
+        atomic_fetch_add_explicit(&syscall_ops, 1, memory_order_relaxed);
+        result = fsync(fd);
+    }
+    else
+        result = ring_rw(IORING_OP_FSYNC, fd, NULL, 0, 0) < 0 ? -1 : 0;
+    stats_io(file_of(fd), STAT_IO_FSYNC, 0, started);
+    return result;
+}
+
+ssize_t io_write_fsync(int fd, const void *buf, size_t len, off_t offset)
+{
+    if (!use_ring(offset))
+    {
+        atomic_fetch_add_explicit(&syscall_ops, 2, memory_order_relaxed);
+        ssize_t written = (offset == -1) ? write(fd, buf, len) : pwrite(fd, buf, len, offset);
+        stats_io(file_of(fd), STAT_IO_WRITE, written, 0);
+        FAULT_POINT(CRASH_IO_BEFORE_FSYNC); // Only reachable here: the ring submits both at once
+        if (written <= 0)
+            return written;
+        uint64_t started = stats_clock();
+        int synced = fsync(fd);
+        stats_io(file_of(fd), STAT_IO_FSYNC, 0, started);
+        return synced == -1 ? -1 : written;
+    }
+
+    // IOSQE_IO_LINK: the fsync only starts after the write finished, and is cancelled if the
+    // write failed or was short. Both go to the kernel in one io_uring_enter().
+    struct io_uring_sqe pair[2];
+    IoCompletion results[2];
+    prep_rw(&pair[0], IORING_OP_WRITE, fd, buf, len, offset);
+    pair[0].flags = IOSQE_IO_LINK;
+    prep_rw(&pair[1], IORING_OP_FSYNC, fd, NULL, 0, 0);
+    uint64_t started = stats_clock(); // The fsync's time includes the linked write's
+    ring_submit_and_wait(pair, results, 2);
+    atomic_fetch_add_explicit(&linked_pairs, 1, memory_order_relaxed);
+    stats_io(file_of(fd), STAT_IO_WRITE, results[0].result, 0);
+    if (results[0].result == (ssize_t)len)
+        stats_io(file_of(fd), STAT_IO_FSYNC, 0, started);
+
+    if (results[0].result < 0)
+    {
+        errno = (int)-results[0].result;
+        return -1;
+    }
+    if (results[0].result == (ssize_t)len && results[1].result < 0)
+    {
+        errno = (int)-results[1].result;
+        return -1;
+    }
+    return results[0].result;
+}
+
+ssize_t io_recv(int fd, void *buf, size_t len)
+{
+    if (backend != IO_BACKEND_URING)
+    {
+        atomic_fetch_add_explicit(&syscall_ops, 1, memory_order_relaxed);
+        return recv(fd, buf, len, 0);
+    }
+    pthread_mutex_lock(&ring_mutex);
+    int reserved = ring.recvs < ring.cq_entries / 2;
+    if (reserved)
+        ring.recvs++;
+    pthread_mutex_unlock(&ring_mutex);
+    if (!reserved)
+    {
+        atomic_fetch_add_explicit(&syscall_ops, 1, memory_order_relaxed);
+        return recv(fd, buf, len, 0);
+    }
+
+    struct io_uring_sqe sqe;
+    prep_rw(&sqe, IORING_OP_RECV, fd, buf, len, 0);
+    ssize_t received = ring_single(&sqe);
+    int saved_errno = errno;
+
+    pthread_mutex_lock(&ring_mutex);
+    ring.recvs--;
+    pthread_mutex_unlock(&ring_mutex);
+    errno = saved_errno;
+    return received;
+}
+
+ssize_t io_send(int fd, const void *buf, size_t len)
+{
+    if (backend != IO_BACKEND_URING)
+    {
+        atomic_fetch_add_explicit(&syscall_ops, 1, memory_order_relaxed);
+        return send(fd, buf, len, MSG_NOSIGNAL);
+    }
+    struct io_uring_sqe sqe;
+    prep_rw(&sqe, IORING_OP_SEND, fd, buf, len, 0);
+    sqe.msg_flags = MSG_NOSIGNAL;
+    return ring_single(&sqe);
+}
+
+void io_backend_report(int fd)
+{
+    char buffer[256];
+    unsigned long submitted = atomic_load(&ops_submitted);
+    unsigned long enters = atomic_load(&enter_calls);
+    snprintf(buffer, sizeof(buffer),
+             "--- I/O Backend (%s) ---\nRing ops: %lu in %lu io_uring_enter calls (%lu write+fsync pairs)\n"
+             "Syscall ops: %lu\n",
+             io_backend_name(), submitted, enters, atomic_load(&linked_pairs), atomic_load(&syscall_ops));
+    write_string(fd, buffer);
+}
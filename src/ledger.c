@@ -0,0 +1,714 @@
+// src/ledger.c
+#define _GNU_SOURCE // For F_OFD_SETLKW (open file description locks)
+#include "ledger.h"      // LedgerResult and prototypes
+#include "data_access.h" // For getAccount, updateAccount, addTransaction, journal_log_entry (and the batch versions)
+#include "common.h"      // For structs, enums
+#include "io_backend.h"  // For io_open, io_pread
+#include "fault.h"       // For FAULT_POINT
+#include "stats.h"       // For STATS_TIME
+#include "trace.h"       // For the lock wait spans
+#include <pthread.h>     // For mutexes
+#include <stdio.h>       // For perror
+#include <stdlib.h>      // For qsort, bsearch
+#include <sys/stat.h>    // For fstat
+#include <string.h>      // For strcpy
+
+/*
+--- Ledger ---
+
+-> Every balance change is a read-modify-write of an Account record. Two threads changing the same
+   account at once (e.g. two pipelined deposits on one connection) would otherwise lose an update.
+-> account_stripes: a fixed set of mutexes, an account uses the stripe (accountId % ACCOUNT_STRIPES).
+   A transfer takes both stripes, always lowest index first, so two opposite transfers cannot deadlock.
+-> journal_mutex: run_server_recovery() only looks at the *tail* of the journal, so the
+   TXN_START ... TXN_COMMIT group of one transfer must never interleave with another one.
+-> During a hot restart two server processes serve clients at the same time, and mutexes only
+   exclude threads of one process. So every account lock is backed by an OFD byte lock in
+   LEDGER_LOCK_FILE (byte accountId + 1; byte 0 is the journal). OFD locks belong to the open
+   file, not the process, so they exclude the other server without tripping over the fcntl
+   record locks data_access.c takes on the .dat files. Bytes are always taken in ascending order.
+-> A batch transfer locks all its accounts the same way: stripes ascending, then bytes ascending
+   (consecutive bytes as one range).
+-> Recovery only rolls back the group after the *last* commit. So a group whose update or commit
+   write failed cannot be left behind for it: the next commit would bury it. While the locks are
+   still held, abandon_group() writes the undo balances back and closes the group with a commit.
+   If that fails too, the ledger stops taking writes (ledger_halted) until a restart recovers it.
+*/
+
+#define ACCOUNT_STRIPES 64
+
+static pthread_mutex_t account_stripes[ACCOUNT_STRIPES];
+static pthread_once_t stripes_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t journal_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int lock_fd = -1; // LEDGER_LOCK_FILE, opened once by init_stripes
+
+static void init_stripes()
+{
+    for (int i = 0; i < ACCOUNT_STRIPES; i++)
+    {
+        pthread_mutex_init(&account_stripes[i], NULL);
+    }
+    lock_fd = open(LEDGER_LOCK_FILE, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lock_fd == -1)
+        perror("ledger: open lock file"); // Still safe within this process
+}
+
+// Takes (F_WRLCK) or drops (F_UNLCK) the cross-process lock on bytes [first, first + count)
+static void ofd_lock_range(int first, int count, short type)
+{
+    if (lock_fd == -1)
+        return;
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = first;
+    lock.l_len = count;
+    while (fcntl(lock_fd, F_OFD_SETLKW, &lock) == -1 && errno == EINTR)
+    {
+    }
+}
+
+// Same for one byte of the lock file
+static void ofd_lock(int byte, short type)
+{
+    ofd_lock_range(byte, 1, type);
+}
+
+static int lock_byte_of(int accountId)
+{
+    return accountId < 0 ? 0 : accountId + 1;
+}
+
+// journal_mutex plus its cross-process byte
+static void lock_journal()
+{
+    uint64_t wait_start = trace_begin();
+    pthread_mutex_lock(&journal_mutex);
+    ofd_lock(0, F_WRLCK);
+    trace_end("wait journal lock", wait_start);
+}
+
+static void unlock_journal()
+{
+    ofd_lock(0, F_UNLCK);
+    pthread_mutex_unlock(&journal_mutex);
+}
+
+static int stripe_of(int accountId)
+{
+    if (accountId < 0)
+        accountId = -accountId;
+    return accountId % ACCOUNT_STRIPES;
+}
+
+static void lock_accounts(int accountA, int accountB)
+{
+    pthread_once(&stripes_once, init_stripes);
+    uint64_t wait_start = trace_begin();
+    int a = stripe_of(accountA);
+    int b = stripe_of(accountB);
+    if (a == b)
+    {
+        pthread_mutex_lock(&account_stripes[a]);
+    }
+    else
+    {
+        pthread_mutex_lock(&account_stripes[a < b ? a : b]);
+        pthread_mutex_lock(&account_stripes[a < b ? b : a]);
+    }
+
+    int low = lock_byte_of(accountA < accountB ? accountA : accountB);
+    int high = lock_byte_of(accountA < accountB ? accountB : accountA);
+    ofd_lock(low, F_WRLCK);
+    if (high != low)
+        ofd_lock(high, F_WRLCK);
+    trace_end("wait account locks", wait_start);
+}
+
+static void unlock_accounts(int accountA, int accountB)
+{
+    ofd_lock(lock_byte_of(accountA), F_UNLCK);
+    if (accountB != accountA)
+        ofd_lock(lock_byte_of(accountB), F_UNLCK);
+
+    int a = stripe_of(accountA);
+    int b = stripe_of(accountB);
+    pthread_mutex_unlock(&account_stripes[a]);
+    if (a != b)
+    {
+        pthread_mutex_unlock(&account_stripes[b]);
+    }
+}
+
+// Set when a failed group could not be undone: it must stay the journal tail for recovery
+static int ledger_halted = 0;
+
+static int is_halted()
+{
+    return __atomic_load_n(&ledger_halted, __ATOMIC_ACQUIRE);
+}
+
+// Called with the journal and every account of the group locked, after the undo balances were
+// written back (restored == 1) or not. A commit closes the group, so later groups and unjournaled
+// deposits cannot be rolled back with it.
+static void abandon_group(int restored)
+{
+    JournalEntry commitEntry;
+    commitEntry.type = TXN_COMMIT;
+    commitEntry.accountId = 0;
+    commitEntry.oldBalance = 0;
+    if (restored && journal_log_entry(commitEntry) == 0)
+        return;
+    perror("FATAL: Failed transfer could not be undone, refusing ledger writes until restart");
+    __atomic_store_n(&ledger_halted, 1, __ATOMIC_RELEASE);
+}
+
+static LedgerResult post(int accountId, TransactionType type, double amount, Account *updated)
+{
+    lock_accounts(accountId, accountId);
+    if (is_halted())
+    {
+        unlock_accounts(accountId, accountId);
+        return LEDGER_WRITE_FAILED;
+    }
+
+    Account account = getAccount(accountId);
+    if (account.accountId == -1)
+    {
+        unlock_accounts(accountId, accountId);
+        return LEDGER_NOT_FOUND;
+    }
+    if (type == WITHDRAWAL && amount > account.balance)
+    {
+        unlock_accounts(accountId, accountId);
+        return LEDGER_INSUFFICIENT;
+    }
+
+    account.balance += (type == WITHDRAWAL) ? -amount : amount;
+    if (updateAccount(account) != 0)
+    {
+        unlock_accounts(accountId, accountId);
+        return LEDGER_WRITE_FAILED;
+    }
+    FAULT_POINT(CRASH_POST_AFTER_UPDATE);
+    unlock_accounts(accountId, accountId);
+
+    if (updated != NULL)
+        *updated = account;
+
+    Transaction txn;
+    txn.accountId = accountId;
+    txn.userId = account.ownerUserId;
+    txn.type = type;
+    txn.amount = amount;
+    txn.newBalance = account.balance;
+    strcpy(txn.otherPartyAccountNumber, "---");
+    if (addTransaction(txn) != 0)
+    {
+        return LEDGER_LOG_FAILED;
+    }
+    return LEDGER_OK;
+}
+
+static LedgerResult transfer(int senderAccountId, int receiverAccountId, double amount, Account *sender,
+                             Account *receiver)
+{
+    JournalEntry senderUndo, receiverUndo, commitEntry;
+
+    if (senderAccountId == receiverAccountId)
+        return LEDGER_SAME_ACCOUNT;
+
+    lock_accounts(senderAccountId, receiverAccountId);
+
+    Account sender_account = getAccount(senderAccountId);
+    Account receiver_account = getAccount(receiverAccountId);
+
+    // Validation Checks (against the balances we now hold the locks for)
+    LedgerResult result = LEDGER_OK;
+    if (sender_account.accountId == -1 || receiver_account.accountId == -1)
+        result = LEDGER_NOT_FOUND;
+    else if (sender_account.isActive == 0 || receiver_account.isActive == 0)
+        result = LEDGER_INACTIVE;
+    else if (sender_account.balance < amount)
+        result = LEDGER_INSUFFICIENT;
+
+    if (result != LEDGER_OK)
+    {
+        unlock_accounts(senderAccountId, receiverAccountId);
+        return result;
+    }
+
+    // ATOMIC TRANSACTION (JOURNALING) STARTS HERE
+    lock_journal();
+    if (is_halted())
+    {
+        unlock_journal();
+        unlock_accounts(senderAccountId, receiverAccountId);
+        return LEDGER_WRITE_FAILED;
+    }
+    FAULT_POINT(CRASH_JOURNAL_BEFORE_START);
+
+    // Log the "UNDO" state for the sender and the receiver
+    senderUndo.type = TXN_START;
+    senderUndo.accountId = sender_account.accountId;
+    senderUndo.oldBalance = sender_account.balance;
+    receiverUndo.type = TXN_START;
+    receiverUndo.accountId = receiver_account.accountId;
+    receiverUndo.oldBalance = receiver_account.balance;
+
+    // One write and one fsync for both: the journal holds both undo entries or neither
+    JournalEntry undo[2] = {senderUndo, receiverUndo};
+    int logged = journal_log_entries(undo, 2);
+    FAULT_POINT(CRASH_JOURNAL_AFTER_START);
+    if (logged != 0)
+    {
+        // Nothing was logged and no account was touched
+        unlock_journal();
+        unlock_accounts(senderAccountId, receiverAccountId);
+        return LEDGER_WRITE_FAILED;
+    }
+
+    // We are now in a crash-safe state
+    // We have logged our intention. Now we can modify data.
+
+    // Perform the transfer
+    sender_account.balance -= amount;
+    receiver_account.balance += amount;
+
+    int update1_status = updateAccount(sender_account);
+    FAULT_POINT(CRASH_TRANSFER_BETWEEN_UPDATES); // The half-done state recovery must undo
+    int update2_status = updateAccount(receiver_account);
+
+    int committed = -1;
+    if (update1_status == 0 && update2_status == 0)
+    {
+        // Success! Log the commit.
+        FAULT_POINT(CRASH_TRANSFER_BEFORE_COMMIT);
+        commitEntry.type = TXN_COMMIT;
+        commitEntry.accountId = 0;
+        commitEntry.oldBalance = 0;
+        committed = journal_log_entry(commitEntry);
+        FAULT_POINT(CRASH_TRANSFER_AFTER_COMMIT);
+    }
+
+    if (committed != 0)
+    {
+        // Failure! Undo it now, under the locks: a later commit would hide this group from recovery
+        sender_account.balance = senderUndo.oldBalance;
+        receiver_account.balance = receiverUndo.oldBalance;
+        int restored = (updateAccount(sender_account) == 0 && updateAccount(receiver_account) == 0);
+        abandon_group(restored);
+        unlock_journal();
+        unlock_accounts(senderAccountId, receiverAccountId);
+        return LEDGER_WRITE_FAILED; // Nothing moved: no history for it
+    }
+
+    unlock_journal();
+    unlock_accounts(senderAccountId, receiverAccountId);
+
+    if (sender != NULL)
+        *sender = sender_account;
+    if (receiver != NULL)
+        *receiver = receiver_account;
+
+    // Log normal user-facing transactions
+    Transaction txn_out, txn_in;
+
+    txn_out.accountId = sender_account.accountId;
+    txn_out.userId = sender_account.ownerUserId;
+    txn_out.type = TRANSFER_OUT;
+    txn_out.amount = amount;
+    txn_out.newBalance = sender_account.balance;
+    strcpy(txn_out.otherPartyAccountNumber, receiver_account.accountNumber);
+
+    txn_in.accountId = receiver_account.accountId;
+    txn_in.userId = receiver_account.ownerUserId;
+    txn_in.type = TRANSFER_IN;
+    txn_in.amount = amount;
+    txn_in.newBalance = receiver_account.balance;
+    strcpy(txn_in.otherPartyAccountNumber, sender_account.accountNumber);
+
+    int log1_status = addTransaction(txn_out);
+    int log2_status = addTransaction(txn_in);
+    return (log1_status == 0 && log2_status == 0) ? LEDGER_OK : LEDGER_LOG_FAILED;
+}
+
+// --- Batch Transfer ---
+
+typedef struct
+{
+    int accountId;
+    int first_leg;  // Reported if this account fails a check (-1: the sender)
+    double credit;  // Sum of the legs to this account (0 for the sender)
+    double running; // Balance after the legs so far (for the history rows)
+} BatchParty;
+
+static int compare_parties(const void *a, const void *b)
+{
+    int x = ((const BatchParty *)a)->accountId;
+    int y = ((const BatchParty *)b)->accountId;
+    return (x > y) - (x < y);
+}
+
+// Calls ofd_lock_range once per run of consecutive lock bytes (parties sorted by accountId)
+static void ofd_lock_parties(const BatchParty *parties, int count, short type)
+{
+    int i = 0;
+    while (i < count)
+    {
+        int run = 1;
+        while (i + run < count && parties[i + run].accountId == parties[i].accountId + run)
+            run++;
+        ofd_lock_range(lock_byte_of(parties[i].accountId), run, type);
+        i += run;
+    }
+}
+
+// Every stripe involved, each once and ascending, then the lock bytes ascending: the order
+// lock_accounts uses, so a batch and a transfer sharing accounts cannot deadlock
+static void lock_parties(const BatchParty *parties, int count)
+{
+    pthread_once(&stripes_once, init_stripes);
+    uint64_t wait_start = trace_begin();
+    char used[ACCOUNT_STRIPES] = {0};
+    for (int i = 0; i < count; i++)
+        used[stripe_of(parties[i].accountId)] = 1;
+    for (int stripe = 0; stripe < ACCOUNT_STRIPES; stripe++)
+    {
+        if (used[stripe])
+            pthread_mutex_lock(&account_stripes[stripe]);
+    }
+    ofd_lock_parties(parties, count, F_WRLCK);
+    trace_end("wait account locks", wait_start);
+}
+
+static void unlock_parties(const BatchParty *parties, int count)
+{
+    // Exactly the bytes taken: other threads of this process hold other bytes of the same lock fd
+    ofd_lock_parties(parties, count, F_UNLCK);
+    char used[ACCOUNT_STRIPES] = {0};
+    for (int i = 0; i < count; i++)
+        used[stripe_of(parties[i].accountId)] = 1;
+    for (int stripe = 0; stripe < ACCOUNT_STRIPES; stripe++)
+    {
+        if (used[stripe])
+            pthread_mutex_unlock(&account_stripes[stripe]);
+    }
+}
+
+static BatchParty *find_party(BatchParty *parties, int count, int accountId)
+{
+    BatchParty key;
+    key.accountId = accountId;
+    return bsearch(&key, parties, count, sizeof(BatchParty), compare_parties);
+}
+
+static LedgerResult transfer_batch(int senderAccountId, const LedgerLeg *legs, int count, Account *sender,
+                                   int *failed_leg)
+{
+    *failed_leg = -1;
+    if (count < 1 || count > LEDGER_BATCH_MAX)
+        return LEDGER_BAD_BATCH;
+    double total = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!(legs[i].amount > 0))
+        {
+            *failed_leg = i;
+            return LEDGER_BAD_BATCH;
+        }
+        total += legs[i].amount;
+    }
+
+    char(*numbers)[20] = malloc(sizeof(*numbers) * count);
+    Account *receivers = malloc(sizeof(Account) * count);
+    int *leg_records = malloc(sizeof(int) * count);
+    BatchParty *parties = malloc(sizeof(BatchParty) * (count + 1));
+    Account *accounts = malloc(sizeof(Account) * (count + 1));
+    int *records = malloc(sizeof(int) * (count + 1));
+    JournalEntry *undo = malloc(sizeof(JournalEntry) * (count + 1));
+    Transaction *history = malloc(sizeof(Transaction) * 2 * count);
+    LedgerResult result = LEDGER_OK;
+    int party_count = 0;
+    int locked = 0;
+    if (numbers == NULL || receivers == NULL || leg_records == NULL || parties == NULL || accounts == NULL ||
+        records == NULL || undo == NULL || history == NULL)
+    {
+        result = LEDGER_WRITE_FAILED;
+        goto done;
+    }
+
+    // --- Validate up front: one scan of accounts.dat for every receiver ---
+    for (int i = 0; i < count; i++)
+    {
+        memcpy(numbers[i], legs[i].accountNumber, sizeof(numbers[i]));
+        numbers[i][sizeof(numbers[i]) - 1] = '\0';
+    }
+    getAccountsByNumbers(numbers, count, receivers, leg_records);
+    for (int i = 0; i < count && result == LEDGER_OK; i++)
+    {
+        if (leg_records[i] == -1)
+            result = LEDGER_NOT_FOUND;
+        else if (receivers[i].accountId == senderAccountId)
+            result = LEDGER_SAME_ACCOUNT;
+        else if (!receivers[i].isActive)
+            result = LEDGER_INACTIVE;
+        if (result != LEDGER_OK)
+            *failed_leg = i;
+    }
+    if (result != LEDGER_OK)
+        goto done;
+
+    // One party per account: the sender, then the receivers with their legs added up
+    parties[0].accountId = senderAccountId;
+    parties[0].first_leg = -1;
+    parties[0].credit = 0;
+    party_count = 1;
+    for (int i = 0; i < count; i++)
+    {
+        parties[party_count].accountId = receivers[i].accountId;
+        parties[party_count].first_leg = i;
+        parties[party_count].credit = legs[i].amount;
+        party_count++;
+    }
+    qsort(parties, party_count, sizeof(BatchParty), compare_parties);
+    int merged = 0;
+    for (int i = 0; i < party_count; i++)
+    {
+        if (merged > 0 && parties[merged - 1].accountId == parties[i].accountId)
+        {
+            BatchParty *party = &parties[merged - 1];
+            party->credit += parties[i].credit;
+            if (parties[i].first_leg < party->first_leg)
+                party->first_leg = parties[i].first_leg;
+        }
+        else
+        {
+            parties[merged++] = parties[i];
+        }
+    }
+    party_count = merged;
+
+    // Record numbers never change (accounts are only appended), so they are looked up once
+    for (int i = 0; i < party_count; i++)
+    {
+        BatchParty *party = &parties[i];
+        if (party->first_leg == -1)
+            records[i] = find_account_record_by_id(senderAccountId);
+        else
+            records[i] = leg_records[party->first_leg];
+        if (records[i] == -1)
+        {
+            result = LEDGER_NOT_FOUND; // Only the sender can be missing here
+            goto done;
+        }
+    }
+
+    lock_parties(parties, party_count);
+    locked = 1;
+
+    // Re-read every balance under the locks
+    if (getAccountsAt(records, party_count, accounts) != 0)
+    {
+        result = LEDGER_NOT_FOUND;
+        goto done;
+    }
+    BatchParty *sender_party = find_party(parties, party_count, senderAccountId);
+    Account *sender_account = &accounts[sender_party - parties];
+    for (int i = 0; i < party_count && result == LEDGER_OK; i++)
+    {
+        if (accounts[i].accountId != parties[i].accountId)
+            result = LEDGER_NOT_FOUND;
+        else if (!accounts[i].isActive)
+            result = LEDGER_INACTIVE;
+        if (result != LEDGER_OK)
+            *failed_leg = parties[i].first_leg;
+    }
+    if (result == LEDGER_OK && sender_account->balance < total)
+        result = LEDGER_INSUFFICIENT;
+    if (result != LEDGER_OK)
+        goto done;
+
+    // --- One journal group: all undo entries, all records, one commit ---
+    lock_journal();
+    if (is_halted())
+    {
+        unlock_journal();
+        result = LEDGER_WRITE_FAILED;
+        goto done;
+    }
+    FAULT_POINT(CRASH_JOURNAL_BEFORE_START);
+    for (int i = 0; i < party_count; i++)
+    {
+        undo[i].type = TXN_START;
+        undo[i].accountId = accounts[i].accountId;
+        undo[i].oldBalance = accounts[i].balance;
+        parties[i].running = accounts[i].balance;
+    }
+    if (journal_log_entries(undo, party_count) != 0) // One write and one fsync for the whole group
+    {
+        unlock_journal(); // Nothing was changed: there is nothing to undo
+        result = LEDGER_WRITE_FAILED;
+        goto done;
+    }
+    FAULT_POINT(CRASH_JOURNAL_AFTER_START);
+
+    for (int i = 0; i < party_count; i++)
+    {
+        accounts[i].balance += (&accounts[i] == sender_account) ? -total : parties[i].credit;
+    }
+    int committed = -1;
+    if (updateAccountsAt(accounts, records, party_count) == 0)
+    {
+        FAULT_POINT(CRASH_TRANSFER_BEFORE_COMMIT);
+        JournalEntry commitEntry;
+        commitEntry.type = TXN_COMMIT;
+        commitEntry.accountId = 0;
+        commitEntry.oldBalance = 0;
+        committed = journal_log_entry(commitEntry);
+        FAULT_POINT(CRASH_TRANSFER_AFTER_COMMIT);
+    }
+    if (committed != 0)
+    {
+        // Undo the whole group while every party is still locked (see abandon_group)
+        for (int i = 0; i < party_count; i++)
+        {
+            accounts[i].balance = undo[i].oldBalance;
+        }
+        abandon_group(updateAccountsAt(accounts, records, party_count) == 0);
+        unlock_journal();
+        result = LEDGER_WRITE_FAILED; // Nothing moved: no history for it
+        goto done;
+    }
+    unlock_journal();
+    unlock_parties(parties, party_count);
+    locked = 0;
+
+    if (sender != NULL)
+        *sender = *sender_account;
+
+    // --- History: a TRANSFER_OUT and a TRANSFER_IN per leg, one append ---
+    for (int i = 0; i < count; i++)
+    {
+        BatchParty *receiver_party = find_party(parties, party_count, receivers[i].accountId);
+        sender_party->running -= legs[i].amount;
+        receiver_party->running += legs[i].amount;
+
+        Transaction *txn_out = &history[2 * i];
+        txn_out->accountId = sender_account->accountId;
+        txn_out->userId = sender_account->ownerUserId;
+        txn_out->type = TRANSFER_OUT;
+        txn_out->amount = legs[i].amount;
+        txn_out->newBalance = sender_party->running;
+        strcpy(txn_out->otherPartyAccountNumber, receivers[i].accountNumber);
+
+        Transaction *txn_in = &history[2 * i + 1];
+        txn_in->accountId = receivers[i].accountId;
+        txn_in->userId = receivers[i].ownerUserId;
+        txn_in->type = TRANSFER_IN;
+        txn_in->amount = legs[i].amount;
+        txn_in->newBalance = receiver_party->running;
+        strcpy(txn_in->otherPartyAccountNumber, sender_account->accountNumber);
+    }
+    if (addTransactions(history, 2 * count) != 0)
+        result = LEDGER_LOG_FAILED;
+
+done:
+    if (locked)
+        unlock_parties(parties, party_count);
+    free(history);
+    free(undo);
+    free(records);
+    free(accounts);
+    free(parties);
+    free(leg_records);
+    free(receivers);
+    free(numbers);
+    return result;
+}
+
+int ledger_checkpoint()
+{
+    pthread_once(&stripes_once, init_stripes);
+    lock_journal(); // No transfer (of this or a sibling process) can be between START and COMMIT now
+
+    int cleared = 0;
+    int fd = io_open(JOURNAL_FILE, O_RDONLY, 0);
+    if (fd == -1)
+    {
+        cleared = 1; // No journal, nothing to recover
+    }
+    else
+    {
+        struct stat st;
+        JournalEntry last;
+        if (fstat(fd, &st) == -1)
+            st.st_size = -1;
+        if (st.st_size == 0)
+            cleared = 1;
+        else if (st.st_size > 0 && st.st_size % sizeof(JournalEntry) == 0 &&
+                 io_pread(fd, &last, sizeof(last), st.st_size - sizeof(last)) == sizeof(last) &&
+                 last.type == TXN_COMMIT)
+        {
+            journal_log_clear();
+            cleared = 1;
+        }
+        close(fd);
+    }
+
+    unlock_journal();
+    return cleared ? 0 : -1;
+}
+
+const char *ledger_result_str(LedgerResult result)
+{
+    switch (result)
+    {
+    case LEDGER_OK:
+        return "OK";
+    case LEDGER_NOT_FOUND:
+        return "Account not found";
+    case LEDGER_INACTIVE:
+        return "Account inactive";
+    case LEDGER_SAME_ACCOUNT:
+        return "Cannot transfer to the same account";
+    case LEDGER_INSUFFICIENT:
+        return "Insufficient funds";
+    case LEDGER_WRITE_FAILED:
+        return "Write failure";
+    case LEDGER_LOG_FAILED:
+        return "Transaction log failure";
+    case LEDGER_BAD_BATCH:
+        return "Invalid batch";
+    case LEDGER_BAD_AMOUNT:
+        return "Amount out of range";
+    }
+    return "Unknown error";
+}
+
+LedgerResult ledger_post(int accountId, TransactionType type, double amount, Account *updated)
+{
+    LedgerResult result;
+    STATS_TIME(STAT_LEDGER_POST, result = post(accountId, type, amount, updated));
+    return result;
+}
+
+LedgerResult ledger_transfer(int senderAccountId, int receiverAccountId, double amount,
+                             Account *sender, Account *receiver)
+{
+    LedgerResult result;
+    STATS_TIME(STAT_LEDGER_TRANSFER, result = transfer(senderAccountId, receiverAccountId, amount, sender, receiver));
+    return result;
+}
+
+LedgerResult ledger_transfer_batch(int senderAccountId, const LedgerLeg *legs, int count, Account *sender,
+                                   int *failed_leg)
+{
+    LedgerResult result;
+    int leg = -1;
+    STATS_TIME(STAT_LEDGER_TRANSFER_BATCH, result = transfer_batch(senderAccountId, legs, count, sender, &leg));
+    if (failed_leg != NULL)
+        *failed_leg = leg;
+    return result;
+}
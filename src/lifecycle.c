@@ -0,0 +1,302 @@
+// src/lifecycle.c
+#define _GNU_SOURCE // For pipe2, F_OFD_SETLK
+#include "lifecycle.h"  // Lifecycle API and timeouts
+#include "connection.h" // For connection_drain_all, connection_open_count
+#include "ledger.h"     // For ledger_checkpoint
+#include "listener.h"   // For listener_stop, listener_export
+#include "scheduler.h"  // For scheduler_stop
+#include <limits.h>     // For PATH_MAX
+#include <poll.h>       // For waiting on the ready pipe
+#include <signal.h>     // For sigset_t, sigwaitinfo
+#include <stdio.h>      // For snprintf
+#include <sys/wait.h>   // For waitpid
+
+extern char **environ;
+
+#define LIFECYCLE_MAX_CALLBACKS 8
+#define ENV_MAX 256 // Environment entries passed on to the new process
+
+static sigset_t managed_signals; // Blocked everywhere, received by lifecycle_run
+static struct
+{
+    int sig;
+    SignalCallback callback;
+} callbacks[LIFECYCLE_MAX_CALLBACKS];
+static int callback_count = 0;
+
+static char exe_path[PATH_MAX]; // Binary to execute on a hot restart
+static char **saved_argv;
+static const char *inherited_listeners = NULL;
+static int ready_fd = -1;
+static int instance_fd = -1; // INSTANCE_LOCK_FILE, locked for as long as the process lives
+
+void lifecycle_init(int argc, char *argv[])
+{
+    (void)argc;
+    saved_argv = argv;
+
+    // The path the server was started with, so a restart picks up a newly deployed binary.
+    // /proc/self/exe would name the old (possibly deleted) file.
+    if (strchr(argv[0], '/') == NULL || realpath(argv[0], exe_path) == NULL)
+    {
+        ssize_t n = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+        exe_path[n > 0 ? n : 0] = '\0';
+    }
+
+    inherited_listeners = getenv(LISTEN_FDS_ENV);
+    const char *ready = getenv(READY_FD_ENV);
+    if (ready != NULL)
+    {
+        ready_fd = atoi(ready);
+        fcntl(ready_fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    sigemptyset(&managed_signals);
+    sigaddset(&managed_signals, SIGTERM);
+    sigaddset(&managed_signals, SIGINT);
+    sigaddset(&managed_signals, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &managed_signals, NULL);
+}
+
+int lifecycle_lock_instance()
+{
+    const char *inherited = getenv(LOCK_FD_ENV);
+    if (inherited != NULL)
+    {
+        // The same open file description as the previous process: the lock is already ours
+        instance_fd = atoi(inherited);
+        fcntl(instance_fd, F_SETFD, FD_CLOEXEC);
+        return 0;
+    }
+    instance_fd = open(INSTANCE_LOCK_FILE, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (instance_fd == -1)
+    {
+        perror("open instance lock");
+        return -1;
+    }
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_len = 1;
+    if (fcntl(instance_fd, F_OFD_SETLK, &lock) == -1)
+    {
+        close(instance_fd);
+        instance_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void lifecycle_on_signal(int sig, SignalCallback callback)
+{
+    if (callback_count == LIFECYCLE_MAX_CALLBACKS)
+        return;
+    callbacks[callback_count].sig = sig;
+    callbacks[callback_count].callback = callback;
+    callback_count++;
+    sigaddset(&managed_signals, sig);
+    pthread_sigmask(SIG_BLOCK, &managed_signals, NULL);
+}
+
+const char *lifecycle_inherited_listeners()
+{
+    return inherited_listeners;
+}
+
+void lifecycle_ready()
+{
+    if (ready_fd == -1)
+        return;
+    char byte = 1;
+    if (write(ready_fd, &byte, 1) != 1)
+        perror("lifecycle: ready");
+    close(ready_fd);
+    ready_fd = -1;
+}
+
+// Waits up to timeout_ms for all connections to close. A further SIGTERM/SIGINT cuts the wait short.
+// Returns 1 if none is left.
+static int wait_for_connections(int timeout_ms)
+{
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGTERM);
+    sigaddset(&stop_signals, SIGINT);
+    struct timespec step = {0, 100 * 1000000L};
+
+    for (int waited = 0; connection_open_count() > 0; waited += 100)
+    {
+        if (waited >= timeout_ms)
+            return 0;
+        if (sigtimedwait(&stop_signals, NULL, &step) > 0)
+        {
+            write_string(STDOUT_FILENO, "Second stop signal, closing sessions now.\n");
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+--- Draining ---
+
+-> listener_stop: no new connections (in a hot restart the sockets stay open in the new process).
+-> scheduler_stop: the batch of standing instructions being paid is recorded, then the scheduler
+   lock is released (in a hot restart the new process takes over the schedule).
+-> SHUT_RD on every connection: a session in the middle of an operation completes it and still
+   sends the reply; its next read sees EOF and it ends as if the client had left.
+-> Only if every session ended is the journal checkpointed. A session still running after the
+   timeout may be inside a transfer, so the journal is then left for run_server_recovery.
+*/
+static void drain_and_exit(int release_socket_file)
+{
+    char buffer[128];
+    listener_stop(release_socket_file);
+    scheduler_stop();
+    snprintf(buffer, sizeof(buffer), "Draining: stopped accepting, waiting for %d connection(s)...\n",
+             connection_open_count());
+    write_string(STDOUT_FILENO, buffer);
+
+    connection_drain_all(SHUT_RD);
+    if (!wait_for_connections(DRAIN_TIMEOUT_SECONDS * 1000))
+    {
+        connection_drain_all(SHUT_RDWR);
+        wait_for_connections(2000);
+    }
+
+    int left = connection_open_count();
+    if (left > 0)
+    {
+        snprintf(buffer, sizeof(buffer), "%d connection(s) did not finish; journal left for recovery.\n", left);
+        write_string(STDOUT_FILENO, buffer);
+    }
+    else if (ledger_checkpoint() == 0)
+    {
+        write_string(STDOUT_FILENO, "Journal checkpointed.\n");
+    }
+    else
+    {
+        write_string(STDOUT_FILENO, "Journal ends in an open transaction; left for recovery.\n");
+    }
+    write_string(STDOUT_FILENO, "Server stopped.\n");
+    exit(EXIT_SUCCESS);
+}
+
+/*
+--- Hot Restart ---
+
+-> The listening sockets are not close-on-exec, so execve() passes them to the new process;
+   LISTEN_FDS_ENV tells it which fd is which. The locked INSTANCE_LOCK_FILE is passed the same
+   way (LOCK_FD_ENV): an OFD lock belongs to the open file description, so it stays held while
+   either process has it open. Client sockets (accept4 with SOCK_CLOEXEC),
+   the epoll/eventfd/io_uring descriptors and the ready pipe's read end are not inherited.
+-> The new process skips run_server_recovery(): this process may be in the middle of a transfer,
+   and rolling it back underneath would corrupt balances. The ledger's OFD locks keep the two
+   processes from updating the same account at the same time.
+-> If the new binary does not report ready in time it is killed and this process keeps serving.
+*/
+static void hot_restart()
+{
+    char buffer[PATH_MAX + 80];
+    char listen_spec[LISTENER_MAX * 80];
+    char listen_env[sizeof(listen_spec) + 32];
+    char ready_env[32];
+    char lock_env[32];
+    char *envp[ENV_MAX];
+    int ready_pipe[2];
+
+    if (listener_export(listen_spec, sizeof(listen_spec)) <= 0 || pipe2(ready_pipe, O_CLOEXEC) == -1)
+    {
+        write_string(STDOUT_FILENO, "Hot restart failed: cannot hand over the listeners.\n");
+        return;
+    }
+    snprintf(listen_env, sizeof(listen_env), "%s=%s", LISTEN_FDS_ENV, listen_spec);
+    snprintf(ready_env, sizeof(ready_env), "%s=%d", READY_FD_ENV, ready_pipe[1]);
+    snprintf(lock_env, sizeof(lock_env), "%s=%d", LOCK_FD_ENV, instance_fd);
+
+    // Our own environment minus the variables of the restart that started us
+    int n = 0;
+    for (char **env = environ; *env != NULL && n < ENV_MAX - 4; env++)
+    {
+        if (strncmp(*env, LISTEN_FDS_ENV "=", strlen(LISTEN_FDS_ENV) + 1) != 0 &&
+            strncmp(*env, READY_FD_ENV "=", strlen(READY_FD_ENV) + 1) != 0 &&
+            strncmp(*env, LOCK_FD_ENV "=", strlen(LOCK_FD_ENV) + 1) != 0)
+            envp[n++] = *env;
+    }
+    envp[n++] = listen_env;
+    envp[n++] = ready_env;
+    envp[n++] = lock_env;
+    envp[n] = NULL;
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        // Only async-signal-safe calls between fork and exec (other threads' locks are frozen)
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, NULL);
+        fcntl(ready_pipe[1], F_SETFD, 0);
+        fcntl(instance_fd, F_SETFD, 0); // Shared description: the lock outlives this process
+        execve(exe_path, saved_argv, envp);
+        _exit(127);
+    }
+    close(ready_pipe[1]);
+    if (child == -1)
+    {
+        perror("hot restart: fork");
+        close(ready_pipe[0]);
+        return;
+    }
+
+    snprintf(buffer, sizeof(buffer), "Hot restart: started %s as PID %d, waiting for it to serve...\n",
+             exe_path, (int)child);
+    write_string(STDOUT_FILENO, buffer);
+
+    // One byte: ready. EOF or timeout: the new process died or hangs.
+    struct pollfd wait_ready = {ready_pipe[0], POLLIN, 0};
+    char byte = 0;
+    int ready = poll(&wait_ready, 1, RESTART_READY_TIMEOUT_SECONDS * 1000) == 1 &&
+                read(ready_pipe[0], &byte, 1) == 1;
+    close(ready_pipe[0]);
+
+    if (!ready)
+    {
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+        write_string(STDOUT_FILENO, "Hot restart aborted: new process did not become ready. Still serving.\n");
+        return;
+    }
+
+    snprintf(buffer, sizeof(buffer), "PID %d is serving; this process now drains.\n", (int)child);
+    write_string(STDOUT_FILENO, buffer);
+    drain_and_exit(0); // The socket file now belongs to the new process
+}
+
+void lifecycle_run()
+{
+    char buffer[64];
+    while (1)
+    {
+        int sig = sigwaitinfo(&managed_signals, NULL);
+        if (sig == -1)
+            continue; // EINTR
+
+        if (sig == SIGTERM || sig == SIGINT)
+        {
+            snprintf(buffer, sizeof(buffer), "\nReceived %s, shutting down.\n", sig == SIGTERM ? "SIGTERM" : "SIGINT");
+            write_string(STDOUT_FILENO, buffer);
+            drain_and_exit(1);
+        }
+        else if (sig == SIGUSR2)
+        {
+            hot_restart();
+        }
+
+        for (int i = 0; i < callback_count; i++)
+        {
+            if (callbacks[i].sig == sig)
+                callbacks[i].callback(sig);
+        }
+    }
+}
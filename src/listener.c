@@ -0,0 +1,350 @@
+// src/listener.c
+#define _GNU_SOURCE // For accept4
+#include "listener.h"  // Acceptor prototypes and limits
+#include <poll.h>      // For waiting on the listening socket and the stop signal
+#include <pthread.h>   // For acceptor threads
+#include <stdatomic.h> // For lock-free counters
+#include <stdio.h>     // For perror, snprintf
+#include <sys/eventfd.h> // For the stop signal
+#include <sys/stat.h>  // For chmod
+#include <sys/un.h>    // For sockaddr_un
+
+/*
+--- Multi-Acceptor Listening ---
+
+-> With a single accept loop every new connection waits for one thread. When many clients connect
+   at once (branch opening time) the accept queue grows and connection setup latency spikes.
+-> Here each acceptor thread owns its own listening socket on the same port. SO_REUSEPORT lets all
+   of them bind 0.0.0.0:PORT and the kernel hashes incoming connections across the sockets, so
+   accepts run in parallel on different cores.
+-> If the kernel refuses SO_REUSEPORT, all acceptor threads call accept() on the first socket.
+   That still works (the kernel wakes one waiter per connection), it is just not load-balanced.
+-> Clients on the same host can use an AF_UNIX socket instead. It skips the whole TCP/IP stack
+   (no checksums, no loopback routing, no ACKs), so each request/reply costs fewer CPU cycles.
+   The accepted fd is an ordinary stream socket, so handle_client cannot tell the difference.
+-> Acceptors poll() their socket together with a shared eventfd. listener_stop() signals the
+   eventfd, so accepting can end without shutting the sockets down, which matters for a hot
+   restart: the new process keeps accepting on the very same sockets.
+*/
+
+typedef struct
+{
+    int index;
+    int server_fd;
+    char label[64];             // "tcp:8080" or "unix:/path" (for statistics)
+    pthread_t thread;
+    int started;                // Thread was created
+    atomic_ulong accepted;      // Connections handed to the callback
+    atomic_ulong accept_errors; // accept() failures
+} Acceptor;
+
+static Acceptor acceptors[LISTENER_MAX];
+static int acceptor_count = 0;
+static ConnectionCallback connection_callback = NULL;
+static int stop_fd = -1;        // eventfd, readable once listener_stop() was called
+static char unix_path[108] = ""; // Bound AF_UNIX path (removed by listener_stop)
+
+// Sets O_NONBLOCK: several acceptors (or two processes) may be woken for one connection
+static void set_nonblocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// Creates, binds and listens one TCP socket. Returns the fd or -1.
+static int open_socket(int port, int reuse_port)
+{
+    // --- Socket Setup (socket, bind, listen) ---
+    // The kernel allocates a socket descriptor (like a file handle).
+    // AF_INET → IPv4 domain.
+    // SOCK_STREAM → TCP connection (reliable, connection-oriented).
+    // Returns a file descriptor (like 3, 4, etc.).
+    // (Linux treats sockets just like files — read/write works the same way.)
+    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_fd == -1)
+    {
+        perror("socket failed");
+        return -1;
+    }
+
+    // SO_REUSEADDR: a restarted server can bind while old connections sit in TIME_WAIT.
+    // SO_REUSEPORT: several sockets may bind the same port (one per acceptor).
+    int on = 1;
+    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (reuse_port && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1)
+    {
+        close(server_fd);
+        return -1;
+    }
+
+    // INADDR_ANY → Listen on all available network interfaces (localhost + LAN IP).
+    // htons() ensures correct endianness (big-endian order, required by TCP/IP).
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;         // IPv4
+    address.sin_addr.s_addr = INADDR_ANY; // Accept connections on any local IP (0.0.0.0)
+    address.sin_port = htons(port);       // Host to Network Short: converts port to network byte order
+
+    // The kernel associates this socket with the IP + Port (e.g., 0.0.0.0:8080).
+    // Without bind(), your server wouldn’t have an address for clients to connect to.
+    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        perror("bind failed");
+        close(server_fd);
+        return -1;
+    }
+
+    // Tells the OS: “I’m ready to accept incoming TCP connection requests.”
+    // The backlog is the number of clients that can wait in queue while the acceptor is busy.
+    if (listen(server_fd, LISTEN_BACKLOG) < 0)
+    {
+        perror("listen");
+        close(server_fd);
+        return -1;
+    }
+    return server_fd;
+}
+
+int listener_open(int count, int port)
+{
+    if (count < 1)
+        count = 1;
+    if (count > LISTENER_MAX)
+        count = LISTENER_MAX;
+
+    int shared_fd = -1; // Set when SO_REUSEPORT is not available
+    for (int i = 0; i < count; i++)
+    {
+        int fd = (shared_fd != -1) ? shared_fd : open_socket(port, 1);
+        if (fd == -1 && i == 0)
+        {
+            // No SO_REUSEPORT (or port busy): try one plain socket for everybody
+            write_string(STDOUT_FILENO, "SO_REUSEPORT unavailable, acceptors will share one socket.\n");
+            fd = shared_fd = open_socket(port, 0);
+        }
+        if (fd == -1)
+            break;
+
+        acceptors[i].index = i;
+        acceptors[i].server_fd = fd;
+        snprintf(acceptors[i].label, sizeof(acceptors[i].label), "tcp:%d", port);
+        set_nonblocking(fd);
+        atomic_init(&acceptors[i].accepted, 0);
+        atomic_init(&acceptors[i].accept_errors, 0);
+        acceptor_count = i + 1;
+    }
+    return acceptor_count > 0 ? acceptor_count : -1;
+}
+
+int listener_open_unix(const char *path)
+{
+    if (acceptor_count >= LISTENER_MAX)
+        return -1;
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        write_string(STDOUT_FILENO, "Unix socket path too long.\n");
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_fd == -1)
+    {
+        perror("unix socket failed");
+        return -1;
+    }
+
+    // A socket file left behind by a previous run would make bind() fail with EADDRINUSE
+    unlink(path);
+    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        perror("unix bind failed");
+        close(server_fd);
+        return -1;
+    }
+    chmod(path, 0660); // Connecting needs write permission: owner and group (the teller front-ends)
+
+    if (listen(server_fd, LISTEN_BACKLOG) < 0)
+    {
+        perror("unix listen");
+        close(server_fd);
+        unlink(path);
+        return -1;
+    }
+
+    Acceptor *acceptor = &acceptors[acceptor_count];
+    acceptor->index = acceptor_count;
+    acceptor->server_fd = server_fd;
+    snprintf(acceptor->label, sizeof(acceptor->label), "unix:%s", path);
+    snprintf(unix_path, sizeof(unix_path), "%s", path);
+    set_nonblocking(server_fd);
+    atomic_init(&acceptor->accepted, 0);
+    atomic_init(&acceptor->accept_errors, 0);
+    acceptor_count++;
+    return 0;
+}
+
+static void *acceptor_loop(void *arg)
+{
+    Acceptor *acceptor = (Acceptor *)arg;
+    struct sockaddr_storage address; // Large enough for IPv4 and AF_UNIX peers
+    socklen_t addrlen;
+
+    struct pollfd waits[2];
+    waits[0].fd = acceptor->server_fd;
+    waits[0].events = POLLIN;
+    waits[1].fd = stop_fd;
+    waits[1].events = POLLIN;
+
+    // --- Accept Loop ---
+    while (1)
+    {
+        // Sleep until a client is waiting or listener_stop() was called
+        if (poll(waits, 2, -1) == -1 && errno != EINTR)
+        {
+            perror("acceptor poll");
+            break;
+        }
+        if (waits[1].revents != 0)
+            break;
+        if (waits[0].revents == 0)
+            continue;
+
+        // What accept() does internally:
+        // It blocks (waits) until a client connects.
+        // When a client connects, the OS completes the TCP 3-way handshake and
+        // creates a new socket specifically for this client (different from server_fd).
+        // server_fd still listens for new clients, while new_socket is used for one client.
+        addrlen = sizeof(address);
+        // SOCK_CLOEXEC: a hot-restarted server must not inherit client connections
+        int new_socket = accept4(acceptor->server_fd, (struct sockaddr *)&address, &addrlen, SOCK_CLOEXEC);
+        if (new_socket < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+                continue; // Another acceptor (or process) took this connection
+            atomic_fetch_add_explicit(&acceptor->accept_errors, 1, memory_order_relaxed);
+            if (errno == EBADF || errno == EINVAL)
+                break; // Listening socket was closed or shut down
+            perror("accept");
+            continue; // Continue listening even if accept fails
+        }
+        atomic_fetch_add_explicit(&acceptor->accepted, 1, memory_order_relaxed);
+        connection_callback(new_socket);
+    }
+    return NULL;
+}
+
+void listener_run(ConnectionCallback on_accept)
+{
+    connection_callback = on_accept;
+    if (stop_fd == -1)
+        stop_fd = eventfd(0, EFD_CLOEXEC);
+    for (int i = 0; i < acceptor_count; i++)
+    {
+        if (pthread_create(&acceptors[i].thread, NULL, acceptor_loop, &acceptors[i]) != 0)
+        {
+            perror("pthread_create acceptor");
+            continue;
+        }
+        acceptors[i].started = 1;
+    }
+}
+
+void listener_join()
+{
+    for (int i = 0; i < acceptor_count; i++)
+    {
+        if (acceptors[i].started)
+            pthread_join(acceptors[i].thread, NULL);
+        acceptors[i].started = 0;
+    }
+}
+
+void listener_stop(int release)
+{
+    uint64_t one = 1;
+    if (stop_fd != -1 && write(stop_fd, &one, sizeof(one)) != sizeof(one))
+        perror("listener_stop");
+    listener_join();
+
+    for (int i = 0; i < acceptor_count; i++)
+    {
+        int fd = acceptors[i].server_fd;
+        if (fd == -1)
+            continue;
+        close(fd);
+        for (int j = i; j < acceptor_count; j++)
+        {
+            if (acceptors[j].server_fd == fd)
+                acceptors[j].server_fd = -1; // Shared socket: close it once
+        }
+    }
+    if (release && unix_path[0] != '\0')
+        unlink(unix_path);
+}
+
+int listener_export(char *spec, size_t size)
+{
+    size_t used = 0;
+    spec[0] = '\0';
+    for (int i = 0; i < acceptor_count; i++)
+    {
+        int n = snprintf(spec + used, size - used, "%s%d=%s", i ? ";" : "", acceptors[i].server_fd, acceptors[i].label);
+        if (n < 0 || (size_t)n >= size - used)
+            return -1;
+        used += n;
+    }
+    return acceptor_count;
+}
+
+int listener_adopt(const char *spec)
+{
+    char copy[LISTENER_MAX * 80];
+    snprintf(copy, sizeof(copy), "%s", spec);
+
+    char *saveptr = NULL;
+    for (char *item = strtok_r(copy, ";", &saveptr); item != NULL && acceptor_count < LISTENER_MAX;
+         item = strtok_r(NULL, ";", &saveptr))
+    {
+        char *label = strchr(item, '=');
+        if (label == NULL)
+            continue;
+        *label++ = '\0';
+        int fd = atoi(item);
+        if (fd < 0 || fcntl(fd, F_GETFD) == -1)
+            continue; // Not actually inherited
+
+        Acceptor *acceptor = &acceptors[acceptor_count];
+        acceptor->index = acceptor_count;
+        acceptor->server_fd = fd;
+        snprintf(acceptor->label, sizeof(acceptor->label), "%s", label);
+        if (strncmp(label, "unix:", 5) == 0)
+            snprintf(unix_path, sizeof(unix_path), "%s", label + 5);
+        set_nonblocking(fd);
+        atomic_init(&acceptor->accepted, 0);
+        atomic_init(&acceptor->accept_errors, 0);
+        acceptor_count++;
+    }
+    return acceptor_count > 0 ? acceptor_count : -1;
+}
+
+void listener_report(int fd)
+{
+    char buffer[160];
+    unsigned long total = 0;
+    write_string(fd, "--- Acceptors ---\n");
+    for (int i = 0; i < acceptor_count; i++)
+    {
+        unsigned long accepted = atomic_load_explicit(&acceptors[i].accepted, memory_order_relaxed);
+        unsigned long errors = atomic_load_explicit(&acceptors[i].accept_errors, memory_order_relaxed);
+        total += accepted;
+        snprintf(buffer, sizeof(buffer), "Acceptor %d (%s, fd %d): accepted=%lu errors=%lu\n",
+                 acceptors[i].index, acceptors[i].label, acceptors[i].server_fd, accepted, errors);
+        write_string(fd, buffer);
+    }
+    snprintf(buffer, sizeof(buffer), "Total accepted: %lu\n", total);
+    write_string(fd, buffer);
+}
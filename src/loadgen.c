@@ -0,0 +1,560 @@
+// src/loadgen.c
+#include "common.h"
+#include "data_access.h" // For seeding load customers (addUser, addAccount)
+#include "password.h"    // For password_hash
+#include "pipeline.h"    // For PIPELINE_HELLO, PIPELINE_MAX_LINE
+#include "ledger.h"      // For LEDGER_BATCH_MAX
+#include "histogram.h"   // For per-operation latency histograms
+#include <netinet/tcp.h> // For TCP_NODELAY
+#include <signal.h>      // For ignoring SIGPIPE
+#include <stdint.h>      // For uint64_t
+#include <stdio.h>       // For snprintf, sscanf
+#include <sys/un.h>      // For sockaddr_un (-l)
+
+/*
+--- Load Generator ---
+
+-> Opens N sessions against a local server, each logged in as a different customer through the
+   pipelined protocol (a user may only be logged in once). Every session runs a closed loop: send
+   one operation, wait for its reply, record the latency, pick the next operation from the mix.
+-> Load customers are ordinary customers named LOADGEN_FIRST_NAME with password
+   LOADGEN_PASSWORD and one account. Missing ones are added to the data files before the run.
+-> Sessions connect and log in first, then start together, so login cost (password hashing) is
+   not part of the measured window.
+-> Deposits, withdrawals and transfers move LOADGEN_AMOUNT, so balances barely change however
+   long the run. A batch (-m batch=N) pays LOADGEN_AMOUNT to each of -b other load customers in
+   one BATCH request; the report adds how many credits per second that made.
+*/
+
+#define LOADGEN_FIRST_NAME "Load"
+#define LOADGEN_PASSWORD "load123"
+#define LOADGEN_BALANCE 1000000.00
+#define LOADGEN_AMOUNT "1.00"
+#define LOADGEN_MAX_SESSIONS 4096
+#define LOADGEN_BATCH_LEGS 10 // Default credits per batch (-b)
+#define LOADGEN_DEFAULT_MIX "balance=40,deposit=20,withdraw=15,transfer=15,history=10"
+
+typedef enum
+{
+    OP_BALANCE,
+    OP_DEPOSIT,
+    OP_WITHDRAW,
+    OP_TRANSFER,
+    OP_HISTORY,
+    OP_BATCH,
+    OP_KINDS
+} LoadOp;
+
+static const char *op_names[OP_KINDS] = {"balance", "deposit", "withdraw", "transfer", "history", "batch"};
+
+typedef struct
+{
+    int userId;
+    char accountNumber[20];
+} LoadCustomer;
+
+typedef struct
+{
+    int index; // Session number (= its customer)
+    unsigned int seed;
+    int fd;
+    int start, end;
+    char buf[MAX_BUFFER * 4];
+    int logged_in;
+    Histogram latency[OP_KINDS];
+    unsigned long errors[OP_KINDS];
+    unsigned long rate_limited;
+} LoadSession;
+
+static LoadCustomer *customers;
+static int customer_count;
+static int weights[OP_KINDS];
+static int weight_total;
+static const char *unix_path = NULL;
+static int batch_legs = LOADGEN_BATCH_LEGS;
+static volatile int running = 1;
+static uint64_t deadline_us;
+static pthread_barrier_t start_barrier;
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// --- Load Customers ---
+
+// Collects up to wanted load customers (with their first account) from the data files
+static int find_customers(int wanted)
+{
+    int fd = open(USER_FILE, O_RDONLY);
+    if (fd == -1)
+        return 0;
+    User user;
+    int count = 0;
+    while (count < wanted && read(fd, &user, sizeof(User)) == sizeof(User))
+    {
+        if (user.role == CUSTOMER && user.isActive && my_strcmp(user.firstName, LOADGEN_FIRST_NAME) == 0)
+        {
+            customers[count].userId = user.userId;
+            customers[count].accountNumber[0] = '\0';
+            count++;
+        }
+    }
+    close(fd);
+
+    // One pass over the accounts instead of getAccountsByOwnerId per customer
+    fd = open(ACCOUNT_FILE, O_RDONLY);
+    if (fd == -1)
+        return 0;
+    Account account;
+    while (read(fd, &account, sizeof(Account)) == sizeof(Account))
+    {
+        if (!account.isActive)
+            continue;
+        for (int i = 0; i < count; i++)
+        {
+            if (customers[i].userId == account.ownerUserId && customers[i].accountNumber[0] == '\0')
+            {
+                strcpy(customers[i].accountNumber, account.accountNumber);
+                break;
+            }
+        }
+    }
+    close(fd);
+
+    // Customers without an account are of no use; compact them away
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (customers[i].accountNumber[0] != '\0')
+            customers[kept++] = customers[i];
+    }
+    return kept;
+}
+
+// Adds one load customer with one funded account. Returns 0 or -1.
+static int add_customer()
+{
+    User user;
+    memset(&user, 0, sizeof(user));
+    int userId = get_next_user_id();
+    user.role = CUSTOMER;
+    user.isActive = 1;
+    password_hash(LOADGEN_PASSWORD, user.password);
+    strcpy(user.firstName, LOADGEN_FIRST_NAME);
+    snprintf(user.lastName, sizeof(user.lastName), "Customer%d", userId);
+    snprintf(user.phone, sizeof(user.phone), "5%09d", userId);
+    snprintf(user.email, sizeof(user.email), "load%d@loadgen.local", userId);
+    strcpy(user.address, "Load generator");
+    if (addUser(user) == -1)
+        return -1;
+
+    Account account;
+    memset(&account, 0, sizeof(account));
+    account.ownerUserId = userId;
+    account.balance = LOADGEN_BALANCE;
+    account.isActive = 1;
+    generate_new_account_number(account.accountNumber);
+    return addAccount(account);
+}
+
+// --- Mix ---
+
+// Parses "balance=40,deposit=20,..." (operations left out get weight 0). Returns 0 or -1.
+static int parse_mix(const char *text)
+{
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", text);
+    memset(weights, 0, sizeof(weights));
+    weight_total = 0;
+
+    char *save = NULL;
+    for (char *item = strtok_r(copy, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save))
+    {
+        char *equals = strchr(item, '=');
+        if (equals == NULL)
+            return -1;
+        *equals = '\0';
+        int op = 0;
+        while (op < OP_KINDS && my_strcmp(op_names[op], item) != 0)
+            op++;
+        int weight = atoi(equals + 1);
+        if (op == OP_KINDS || weight < 0)
+            return -1;
+        weights[op] = weight;
+        weight_total += weight;
+    }
+    return weight_total > 0 ? 0 : -1;
+}
+
+static LoadOp pick_op(unsigned int *seed)
+{
+    int roll = rand_r(seed) % weight_total;
+    for (int op = 0; op < OP_KINDS; op++)
+    {
+        if (roll < weights[op])
+            return (LoadOp)op;
+        roll -= weights[op];
+    }
+    return OP_BALANCE;
+}
+
+// --- Sessions ---
+
+static int connect_server()
+{
+    int sock;
+    if (unix_path != NULL)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, unix_path, sizeof(addr.sun_path) - 1);
+        sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sock != -1 && connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+        {
+            close(sock);
+            return -1;
+        }
+        return sock;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock != -1 && connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        close(sock);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return sock;
+}
+
+// Reads one reply line into out. Returns its length or -1 if the connection closed.
+static int recv_line(LoadSession *session, char *out, int size)
+{
+    while (1)
+    {
+        for (int i = session->start; i < session->end; i++)
+        {
+            if (session->buf[i] == '\n')
+            {
+                int len = i - session->start;
+                if (len > size - 1)
+                    len = size - 1;
+                memcpy(out, session->buf + session->start, len);
+                out[len] = '\0';
+                session->start = i + 1;
+                return len;
+            }
+        }
+        if (session->start > 0)
+        {
+            memmove(session->buf, session->buf + session->start, session->end - session->start);
+            session->end -= session->start;
+            session->start = 0;
+        }
+        if (session->end == (int)sizeof(session->buf))
+            session->end = 0; // Overlong line: drop it
+        ssize_t n = read(session->fd, session->buf + session->end, sizeof(session->buf) - session->end);
+        if (n <= 0)
+        {
+            if (n == -1 && errno == EINTR)
+                continue;
+            return -1;
+        }
+        session->end += n;
+    }
+}
+
+// Switches to the pipelined protocol and logs in as this session's customer. Returns 0 or -1.
+static int session_login(LoadSession *session)
+{
+    char line[MAX_BUFFER];
+    session->fd = connect_server();
+    if (session->fd == -1)
+        return -1;
+    write_string(session->fd, PIPELINE_HELLO "\n");
+    do
+    {
+        if (recv_line(session, line, sizeof(line)) == -1)
+            return -1;
+    } while (strstr(line, "PIPELINE READY") == NULL);
+
+    LoadCustomer *customer = &customers[session->index];
+    snprintf(line, sizeof(line), "a AUTH %d %s\n", customer->userId, LOADGEN_PASSWORD);
+    write_string(session->fd, line);
+    if (recv_line(session, line, sizeof(line)) == -1 || strncmp(line, "a OK", 4) != 0)
+    {
+        char message[MAX_BUFFER + 64];
+        snprintf(message, sizeof(message), "Session %d (user %d): %s\n", session->index, customer->userId, line);
+        write_string(STDOUT_FILENO, message);
+        return -1;
+    }
+    return 0;
+}
+
+static void *session_thread(void *arg)
+{
+    LoadSession *session = (LoadSession *)arg;
+    session->logged_in = (session_login(session) == 0);
+    pthread_barrier_wait(&start_barrier); // Logged in (or failed)
+    pthread_barrier_wait(&start_barrier); // Deadline set: go
+
+    LoadCustomer *me = &customers[session->index];
+    char request[PIPELINE_MAX_LINE], reply[MAX_BUFFER];
+    unsigned long id = 0;
+    while (session->logged_in && running && now_us() < deadline_us)
+    {
+        LoadOp op = pick_op(&session->seed);
+        id++;
+        switch (op)
+        {
+        case OP_BALANCE:
+            snprintf(request, sizeof(request), "%lu BALANCE %s\n", id, me->accountNumber);
+            break;
+        case OP_DEPOSIT:
+            snprintf(request, sizeof(request), "%lu DEPOSIT %s %s\n", id, me->accountNumber, LOADGEN_AMOUNT);
+            break;
+        case OP_WITHDRAW:
+            snprintf(request, sizeof(request), "%lu WITHDRAW %s %s\n", id, me->accountNumber, LOADGEN_AMOUNT);
+            break;
+        case OP_TRANSFER:
+        {
+            // Any other load customer; with a single session, to itself is refused by the server
+            int other = rand_r(&session->seed) % customer_count;
+            if (other == session->index && customer_count > 1)
+                other = (other + 1) % customer_count;
+            snprintf(request, sizeof(request), "%lu TRANSFER %s %s %s\n", id, me->accountNumber,
+                     customers[other].accountNumber, LOADGEN_AMOUNT);
+            break;
+        }
+        case OP_BATCH:
+        {
+            int len = snprintf(request, sizeof(request), "%lu BATCH %s ", id, me->accountNumber);
+            for (int leg = 0; leg < batch_legs; leg++)
+            {
+                int other = rand_r(&session->seed) % customer_count;
+                if (other == session->index && customer_count > 1)
+                    other = (other + 1) % customer_count;
+                len += snprintf(request + len, sizeof(request) - len, "%s%s:%s", leg > 0 ? "," : "",
+                                customers[other].accountNumber, LOADGEN_AMOUNT);
+            }
+            snprintf(request + len, sizeof(request) - len, "\n");
+            break;
+        }
+        default:
+            snprintf(request, sizeof(request), "%lu HISTORY %s 10\n", id, me->accountNumber);
+            break;
+        }
+
+        uint64_t sent = now_us();
+        write_string(session->fd, request);
+        if (recv_line(session, reply, sizeof(reply)) == -1)
+        {
+            write_string(STDOUT_FILENO, "Connection lost.\n");
+            break;
+        }
+        histogram_record(&session->latency[op], now_us() - sent);
+        char *status = strchr(reply, ' ');
+        if (status == NULL || strncmp(status + 1, "OK", 2) != 0)
+        {
+            session->errors[op]++;
+            if (status != NULL && strstr(status, "Rate limited") != NULL)
+                session->rate_limited++;
+        }
+    }
+
+    if (session->fd != -1)
+    {
+        write_string(session->fd, "q QUIT\n");
+        close(session->fd);
+    }
+    return NULL;
+}
+
+// --- Report ---
+
+static void print_report(LoadSession *sessions, int count, double seconds)
+{
+    Histogram total, merged;
+    unsigned long total_errors = 0, rate_limited = 0;
+    int logged_in = 0;
+    char buffer[256];
+    memset(&total, 0, sizeof(total));
+
+    for (int i = 0; i < count; i++)
+    {
+        logged_in += sessions[i].logged_in;
+        rate_limited += sessions[i].rate_limited;
+    }
+    snprintf(buffer, sizeof(buffer), "\n--- Load Report: %d/%d sessions, %.1f s ---\n", logged_in, count, seconds);
+    write_string(STDOUT_FILENO, buffer);
+    write_string(STDOUT_FILENO, "operation     count    errors     ops/s   p50 ms   p99 ms  p999 ms   max ms\n");
+
+    for (int op = 0; op <= OP_KINDS; op++)
+    {
+        const char *name = "total";
+        unsigned long errors = 0;
+        if (op < OP_KINDS)
+        {
+            name = op_names[op];
+            memset(&merged, 0, sizeof(merged));
+            for (int i = 0; i < count; i++)
+            {
+                histogram_merge(&merged, &sessions[i].latency[op]);
+                errors += sessions[i].errors[op];
+            }
+            histogram_merge(&total, &merged);
+            total_errors += errors;
+            if (merged.count == 0)
+                continue;
+        }
+        else
+        {
+            merged = total;
+            errors = total_errors;
+        }
+        snprintf(buffer, sizeof(buffer), "%-9s %9lu %9lu %9.0f %8.3f %8.3f %8.3f %8.3f\n", name, merged.count, errors,
+                 merged.count / seconds, histogram_percentile(&merged, 50) / 1000.0,
+                 histogram_percentile(&merged, 99) / 1000.0, histogram_percentile(&merged, 99.9) / 1000.0,
+                 merged.max / 1000.0);
+        write_string(STDOUT_FILENO, buffer);
+    }
+    if (weights[OP_BATCH] > 0)
+    {
+        memset(&merged, 0, sizeof(merged));
+        unsigned long failed = 0;
+        for (int i = 0; i < count; i++)
+        {
+            histogram_merge(&merged, &sessions[i].latency[OP_BATCH]);
+            failed += sessions[i].errors[OP_BATCH];
+        }
+        snprintf(buffer, sizeof(buffer), "batch: %d credits each, %.0f credits/s\n", batch_legs,
+                 (merged.count - failed) * (double)batch_legs / seconds);
+        write_string(STDOUT_FILENO, buffer);
+    }
+    if (rate_limited > 0)
+    {
+        snprintf(buffer, sizeof(buffer), "%lu requests were rate limited: raise the limits in %s for load runs.\n",
+                 rate_limited, "data/rate_limits.conf");
+        write_string(STDOUT_FILENO, buffer);
+    }
+}
+
+static void stop_run(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+// Usage: ./loadgen [-c sessions] [-d seconds] [-m mix] [-b legs] [-s seed] [-l | -u unix_path]
+//   -c N   concurrent sessions, one load customer each (default 16)
+//   -d S   measured duration in seconds (default 10)
+//   -m MIX operation weights, default LOADGEN_DEFAULT_MIX
+//   -b N   credits per batch operation (default LOADGEN_BATCH_LEGS, at most LEDGER_BATCH_MAX)
+//   -s N   random seed (default 1): the same seed gives the same operation sequence
+//   -l/-u  connect through the server's unix socket instead of TCP loopback
+int main(int argc, char *argv[])
+{
+    int session_count = 16, seconds = 10;
+    unsigned int seed = 1;
+    const char *mix = LOADGEN_DEFAULT_MIX;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:d:m:b:s:lu:")) != -1)
+    {
+        if (opt == 'c')
+            session_count = atoi(optarg);
+        else if (opt == 'd')
+            seconds = atoi(optarg);
+        else if (opt == 'm')
+            mix = optarg;
+        else if (opt == 'b')
+            batch_legs = atoi(optarg);
+        else if (opt == 's')
+            seed = (unsigned int)atoi(optarg);
+        else if (opt == 'l')
+            unix_path = UNIX_SOCKET_PATH;
+        else if (opt == 'u')
+            unix_path = optarg;
+        else
+        {
+            write_string(STDOUT_FILENO,
+                         "Usage: ./loadgen [-c sessions] [-d seconds] [-m mix] [-b legs] [-s seed] [-l | -u unix_path]\n");
+            return 1;
+        }
+    }
+    if (session_count < 1 || session_count > LOADGEN_MAX_SESSIONS || seconds < 1 || batch_legs < 1 ||
+        batch_legs > LEDGER_BATCH_MAX || parse_mix(mix) == -1)
+    {
+        write_string(STDOUT_FILENO, "Invalid options. Mix example: " LOADGEN_DEFAULT_MIX "\n");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, stop_run); // Ctrl+C ends the run early but still prints the report
+
+    // --- Seed customers ---
+    customers = calloc(session_count, sizeof(LoadCustomer));
+    LoadSession *sessions = calloc(session_count, sizeof(LoadSession));
+    pthread_t *threads = calloc(session_count, sizeof(pthread_t));
+    if (customers == NULL || sessions == NULL || threads == NULL)
+    {
+        perror("loadgen: calloc");
+        return 1;
+    }
+    customer_count = find_customers(session_count);
+    if (customer_count < session_count)
+    {
+        char buffer[128];
+        snprintf(buffer, sizeof(buffer), "Adding %d load customer(s) to %s...\n", session_count - customer_count,
+                 USER_FILE);
+        write_string(STDOUT_FILENO, buffer);
+        for (int i = customer_count; i < session_count; i++)
+        {
+            if (add_customer() == -1)
+            {
+                perror("loadgen: add customer");
+                return 1;
+            }
+        }
+        customer_count = find_customers(session_count);
+    }
+    if (customer_count < session_count)
+    {
+        write_string(STDOUT_FILENO, "Could not find the load customers after seeding.\n");
+        return 1;
+    }
+
+    // --- Run ---
+    pthread_barrier_init(&start_barrier, NULL, session_count + 1);
+    int started = 0;
+    for (; started < session_count; started++)
+    {
+        sessions[started].index = started;
+        sessions[started].seed = seed + started * 7919;
+        sessions[started].fd = -1;
+        if (pthread_create(&threads[started], NULL, session_thread, &sessions[started]) != 0)
+        {
+            perror("loadgen: pthread_create");
+            return 1;
+        }
+    }
+
+    // Once everybody is logged in (or failed to), the clock starts
+    pthread_barrier_wait(&start_barrier);
+    uint64_t start = now_us();
+    deadline_us = start + (uint64_t)seconds * 1000000;
+    pthread_barrier_wait(&start_barrier);
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    print_report(sessions, session_count, (now_us() - start) / 1e6);
+    return 0;
+}
@@ -0,0 +1,331 @@
+// src/lock_profile.c
+#include "lock_profile.h" // Limits and prototypes
+#include "metrics.h"      // For metrics_header, metrics_value
+#include "stats.h"        // For stats_lock_waited (slow-operation log)
+#include <stdatomic.h>    // For the counters
+#include <stdint.h>       // For uint64_t, uintptr_t
+#include <stdio.h>        // For snprintf
+#include <sys/stat.h>     // For fstat (which file a lock is on)
+
+typedef enum
+{
+    HOLD_FILE_READ,
+    HOLD_FILE_WRITE,
+    HOLD_RECORD_READ,
+    HOLD_RECORD_WRITE,
+    HOLD_KINDS
+} HoldKind;
+
+typedef struct
+{
+    atomic_int used;
+    dev_t dev;
+    ino_t ino;
+    atomic_int holders[HOLD_KINDS]; // Threads of this process holding each kind of lock right now
+    char name[32];                  // Base name of the file
+} LockFile;
+
+typedef struct
+{
+    atomic_int used;
+    LockFile *file;
+    HoldKind kind;
+    const char *site;
+    atomic_ulong acquisitions;
+    atomic_ulong contended; // F_SETLK failed: had to wait for another process
+    atomic_ulong overlaps;  // Another thread held a conflicting lock on the file
+    atomic_ulong wait_ns, max_wait_ns;
+    atomic_ulong hold_ns, max_hold_ns;
+} LockSite;
+
+// A lock the calling thread holds (for its hold time)
+typedef struct
+{
+    int fd;
+    off_t start, len;
+    uint64_t acquired_ns;
+    LockSite *site;
+} HeldLock;
+
+static int enabled = 0;
+static LockFile files[LOCK_PROFILE_FILES];
+static LockSite sites[LOCK_PROFILE_SITES];
+static pthread_mutex_t insert_mutex = PTHREAD_MUTEX_INITIALIZER; // Only taken to add a file or site
+static atomic_ulong untracked;                                    // Tables full, or fstat failed
+static __thread HeldLock held[LOCK_PROFILE_HELD];
+static __thread int held_count = 0;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static void store_max(atomic_ulong *max, unsigned long value)
+{
+    unsigned long seen = atomic_load_explicit(max, memory_order_relaxed);
+    while (value > seen && !atomic_compare_exchange_weak_explicit(max, &seen, value, memory_order_relaxed,
+                                                                  memory_order_relaxed))
+    {
+    }
+}
+
+// --- Tables (open addressing; entries are added, never removed) ---
+
+static LockFile *find_file(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+        return NULL;
+    unsigned long start = (unsigned long)st.st_ino % LOCK_PROFILE_FILES;
+    for (int probe = 0; probe < LOCK_PROFILE_FILES; probe++)
+    {
+        LockFile *file = &files[(start + probe) % LOCK_PROFILE_FILES];
+        if (!atomic_load_explicit(&file->used, memory_order_acquire))
+        {
+            pthread_mutex_lock(&insert_mutex);
+            if (!atomic_load_explicit(&file->used, memory_order_relaxed))
+            {
+                file->dev = st.st_dev;
+                file->ino = st.st_ino;
+                char link[64], path[256];
+                snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+                ssize_t n = readlink(link, path, sizeof(path) - 1);
+                path[n > 0 ? n : 0] = '\0';
+                const char *base = strrchr(path, '/');
+                snprintf(file->name, sizeof(file->name), "%s", base != NULL ? base + 1 : "?");
+                atomic_store_explicit(&file->used, 1, memory_order_release);
+            }
+            pthread_mutex_unlock(&insert_mutex);
+        }
+        if (file->ino == st.st_ino && file->dev == st.st_dev)
+            return file;
+    }
+    return NULL;
+}
+
+static LockSite *find_site(LockFile *file, HoldKind kind, const char *site_name)
+{
+    uintptr_t hash = ((uintptr_t)file * 31 + (uintptr_t)site_name) * 4 + kind;
+    unsigned long start = (unsigned long)(hash % LOCK_PROFILE_SITES);
+    for (int probe = 0; probe < LOCK_PROFILE_SITES; probe++)
+    {
+        LockSite *site = &sites[(start + probe) % LOCK_PROFILE_SITES];
+        if (!atomic_load_explicit(&site->used, memory_order_acquire))
+        {
+            pthread_mutex_lock(&insert_mutex);
+            if (!atomic_load_explicit(&site->used, memory_order_relaxed))
+            {
+                site->file = file;
+                site->kind = kind;
+                site->site = site_name;
+                atomic_store_explicit(&site->used, 1, memory_order_release);
+            }
+            pthread_mutex_unlock(&insert_mutex);
+        }
+        if (site->file == file && site->kind == kind && site->site == site_name)
+            return site;
+    }
+    return NULL;
+}
+
+// Would a lock of this kind wait for the holders, if fcntl locks excluded threads?
+static int conflicts(LockFile *file, HoldKind kind)
+{
+    int h[HOLD_KINDS];
+    for (int i = 0; i < HOLD_KINDS; i++)
+        h[i] = atomic_load_explicit(&file->holders[i], memory_order_relaxed);
+    switch (kind)
+    {
+    case HOLD_FILE_WRITE:
+        return h[HOLD_FILE_READ] + h[HOLD_FILE_WRITE] + h[HOLD_RECORD_READ] + h[HOLD_RECORD_WRITE] > 0;
+    case HOLD_FILE_READ:
+        return h[HOLD_FILE_WRITE] + h[HOLD_RECORD_WRITE] > 0;
+    case HOLD_RECORD_WRITE:
+        return h[HOLD_FILE_READ] + h[HOLD_FILE_WRITE] > 0; // Two records: only if the same one
+    default:
+        return h[HOLD_FILE_WRITE] > 0;
+    }
+}
+
+// --- Held locks of the calling thread ---
+
+static void forget_held(int index, uint64_t now)
+{
+    LockSite *site = held[index].site;
+    unsigned long hold = now - held[index].acquired_ns;
+    atomic_fetch_add_explicit(&site->hold_ns, hold, memory_order_relaxed);
+    store_max(&site->max_hold_ns, hold);
+    atomic_fetch_sub_explicit(&site->file->holders[site->kind], 1, memory_order_relaxed);
+    held[index] = held[--held_count];
+}
+
+static void release(int fd, const struct flock *fl)
+{
+    for (int i = 0; i < held_count; i++)
+    {
+        if (held[i].fd == fd && held[i].start == fl->l_start && held[i].len == fl->l_len)
+        {
+            forget_held(i, now_ns());
+            return;
+        }
+    }
+}
+
+// --- API ---
+
+void lock_profile_enable()
+{
+    enabled = 1;
+}
+
+int lock_profile_fcntl(int fd, struct flock *fl, int whole_file, const char *site_name)
+{
+    if (!enabled)
+        return fcntl(fd, F_SETLKW, fl);
+    if (fl->l_type == F_UNLCK)
+    {
+        int result = fcntl(fd, F_SETLK, fl); // Unlocking never waits
+        release(fd, fl);
+        return result;
+    }
+
+    HoldKind kind = (whole_file ? HOLD_FILE_READ : HOLD_RECORD_READ) + (fl->l_type == F_WRLCK);
+    LockFile *file = find_file(fd);
+    LockSite *site = (file != NULL) ? find_site(file, kind, site_name) : NULL;
+    if (site == NULL)
+    {
+        atomic_fetch_add_explicit(&untracked, 1, memory_order_relaxed);
+        return fcntl(fd, F_SETLKW, fl);
+    }
+
+    uint64_t started = now_ns();
+    int contended = 0;
+    int result = fcntl(fd, F_SETLK, fl);
+    if (result == -1 && (errno == EAGAIN || errno == EACCES))
+    {
+        contended = 1;
+        result = fcntl(fd, F_SETLKW, fl);
+    }
+    if (result == -1)
+        return -1;
+    uint64_t acquired = now_ns();
+
+    atomic_fetch_add_explicit(&site->acquisitions, 1, memory_order_relaxed);
+    if (contended)
+    {
+        atomic_fetch_add_explicit(&site->contended, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&site->wait_ns, acquired - started, memory_order_relaxed);
+        store_max(&site->max_wait_ns, acquired - started);
+        stats_lock_waited(acquired - started);
+    }
+    if (conflicts(file, kind))
+        atomic_fetch_add_explicit(&site->overlaps, 1, memory_order_relaxed);
+
+    // A lock still listed on this fd was dropped by close() without an unlock
+    for (int i = 0; i < held_count; i++)
+    {
+        if (held[i].fd == fd)
+        {
+            forget_held(i, acquired);
+            break;
+        }
+    }
+    if (held_count < LOCK_PROFILE_HELD)
+    {
+        atomic_fetch_add_explicit(&file->holders[kind], 1, memory_order_relaxed);
+        held[held_count].fd = fd;
+        held[held_count].start = fl->l_start;
+        held[held_count].len = fl->l_len;
+        held[held_count].acquired_ns = acquired;
+        held[held_count].site = site;
+        held_count++;
+    }
+    return 0;
+}
+
+// --- Report ---
+
+static int by_contention(const void *a, const void *b)
+{
+    const LockSite *x = *(const LockSite *const *)a;
+    const LockSite *y = *(const LockSite *const *)b;
+    unsigned long keys_x[3] = {atomic_load(&x->wait_ns), atomic_load(&x->overlaps), atomic_load(&x->hold_ns)};
+    unsigned long keys_y[3] = {atomic_load(&y->wait_ns), atomic_load(&y->overlaps), atomic_load(&y->hold_ns)};
+    for (int i = 0; i < 3; i++)
+    {
+        if (keys_x[i] != keys_y[i])
+            return keys_x[i] < keys_y[i] ? 1 : -1;
+    }
+    return 0;
+}
+
+void lock_profile_report(int fd)
+{
+    static const char *kind_names[HOLD_KINDS] = {"file R", "file W", "rec R", "rec W"};
+    LockSite *used[LOCK_PROFILE_SITES];
+    int count = 0;
+    for (int i = 0; i < LOCK_PROFILE_SITES; i++)
+    {
+        if (atomic_load_explicit(&sites[i].used, memory_order_acquire) &&
+            atomic_load_explicit(&sites[i].acquisitions, memory_order_relaxed) > 0)
+            used[count++] = &sites[i];
+    }
+    qsort(used, count, sizeof(used[0]), by_contention);
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "Lock profile (%d of %d lock sites; times in ms):\n",
+             count < LOCK_PROFILE_TOP ? count : LOCK_PROFILE_TOP, count);
+    write_string(fd, buffer);
+    snprintf(buffer, sizeof(buffer), "  %-16s %-6s %-30s %9s %8s %9s %8s %8s %10s %8s\n", "file", "lock", "site",
+             "acquired", "waited", "wait", "max", "overlap", "held", "max");
+    write_string(fd, buffer);
+    for (int i = 0; i < count && i < LOCK_PROFILE_TOP; i++)
+    {
+        LockSite *site = used[i];
+        snprintf(buffer, sizeof(buffer), "  %-16s %-6s %-30.30s %9lu %8lu %9.2f %8.2f %8lu %10.2f %8.2f\n",
+                 site->file->name, kind_names[site->kind], site->site, atomic_load(&site->acquisitions),
+                 atomic_load(&site->contended), atomic_load(&site->wait_ns) / 1e6,
+                 atomic_load(&site->max_wait_ns) / 1e6, atomic_load(&site->overlaps),
+                 atomic_load(&site->hold_ns) / 1e6, atomic_load(&site->max_hold_ns) / 1e6);
+        write_string(fd, buffer);
+    }
+    if (count == 0)
+        write_string(fd, "  (no file locks taken yet)\n");
+    unsigned long skipped = atomic_load(&untracked);
+    if (skipped > 0)
+    {
+        snprintf(buffer, sizeof(buffer), "  %lu lock(s) not profiled (tables full)\n", skipped);
+        write_string(fd, buffer);
+    }
+}
+
+void lock_profile_metrics(int fd)
+{
+    static const char *kind_labels[HOLD_KINDS] = {"file_read", "file_write", "record_read", "record_write"};
+    static const char *names[] = {"bank_lock_acquisitions_total", "bank_lock_contended_total",
+                                  "bank_lock_wait_seconds_total", "bank_lock_hold_seconds_total",
+                                  "bank_lock_overlaps_total"};
+    static const char *help[] = {"fcntl locks taken", "Locks that had to wait for another process",
+                                 "Time spent waiting for fcntl locks", "Time fcntl locks were held",
+                                 "Locks taken while another thread held a conflicting one"};
+    char labels[160];
+    for (int m = 0; m < 5; m++)
+    {
+        metrics_header(fd, names[m], "counter", help[m]);
+        for (int i = 0; i < LOCK_PROFILE_SITES; i++)
+        {
+            LockSite *site = &sites[i];
+            if (!atomic_load_explicit(&site->used, memory_order_acquire) ||
+                atomic_load_explicit(&site->acquisitions, memory_order_relaxed) == 0)
+                continue;
+            double values[5] = {(double)atomic_load(&site->acquisitions), (double)atomic_load(&site->contended),
+                                atomic_load(&site->wait_ns) / 1e9, atomic_load(&site->hold_ns) / 1e9,
+                                (double)atomic_load(&site->overlaps)};
+            snprintf(labels, sizeof(labels), "file=\"%s\",lock=\"%s\",site=\"%s\"", site->file->name,
+                     kind_labels[site->kind], site->site);
+            metrics_value(fd, names[m], labels, values[m]);
+        }
+    }
+}
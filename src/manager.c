@@ -1,6 +1,9 @@
 #include "manager.h"     // Function declarations for manager module
 #include "customer.h"    // For shared handle_view_my_details, handle_change_password
 #include "data_access.h" // For data access functions
+#include "io_backend.h"  // For io_open, io_read, io_write_fsync
+#include "rate_limit.h"  // For read_menu_choice
+#include "stats.h"       // For STATS_TIME (handler latency)
 #include "common.h"      // For structs, enums, read_client_input, write_string
 #include <stdio.h>       // For sprintf
 #include <stdlib.h>      // For atoi
@@ -9,7 +12,7 @@
 #include <unistd.h>      // For lseek, close
 
 // Manager Menu
-void manager_menu(int client_socket, User user)
+MenuExit manager_menu(int client_socket, User user)
 {
     char buffer[MAX_BUFFER];
     while (1)
@@ -25,30 +28,30 @@ void manager_menu(int client_socket, User user)
         write_string(client_socket, "Enter your choice: ");
 
         // Check for disconnect
-        if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
-            return;
+        if (read_menu_choice(client_socket, buffer, MAX_BUFFER, user.userId) == -1)
+            return MENU_DISCONNECTED;
 
         int choice = atoi(buffer);
         switch (choice)
         {
         case 1:
-            handle_set_account_status(client_socket, 0);
+            STATS_TIME(STAT_SET_ACCOUNT_STATUS, handle_set_account_status(client_socket, 0));
             break;
         case 2:
-            handle_assign_loan(client_socket);
+            STATS_TIME(STAT_ASSIGN_LOAN, handle_assign_loan(client_socket));
             break;
         case 3:
-            handle_review_feedback(client_socket);
+            STATS_TIME(STAT_REVIEW_FEEDBACK, handle_review_feedback(client_socket));
             break;
         case 4:
-            handle_view_my_details(client_socket, user);
+            STATS_TIME(STAT_VIEW_MY_DETAILS, handle_view_my_details(client_socket, user));
             break;
         case 5:
-            handle_change_password(client_socket, user.userId);
+            STATS_TIME(STAT_CHANGE_PASSWORD, handle_change_password(client_socket, user.userId));
             break;
         case 6:
             write_string(client_socket, "Logging out. Goodbye!\n");
-            return;
+            return MENU_LOGOUT;
         default:
             write_string(client_socket, "Invalid choice.\n");
         }
@@ -103,11 +106,11 @@ void handle_set_account_status(int client_socket, int admin_mode)
     }
     else
     {
-        write_string(client_socket, "User status updated successfully.\n");
+        write_string(client_socket, "User status updated successfully.\n"); // updateUser revoked the tokens
     }
 
     // Update ALL accounts owned by this user
-    int fd_acct = open(ACCOUNT_FILE, O_RDWR);
+    int fd_acct = io_open(ACCOUNT_FILE, O_RDWR, 0);
     if (fd_acct == -1)
     {
         write_string(client_socket, "Could not open account file to update account statuses.\n");
@@ -128,7 +131,7 @@ void handle_set_account_status(int client_socket, int admin_mode)
     lseek(fd_acct, 0, SEEK_SET); // Rewind to start
 
     // Loop through all account records
-    while (read(fd_acct, &account, sizeof(Account)) == sizeof(Account))
+    while (io_read(fd_acct, &account, sizeof(Account)) == sizeof(Account))
     {
         if (account.ownerUserId == target_user_id)
         {
@@ -137,31 +140,17 @@ void handle_set_account_status(int client_socket, int admin_mode)
             { 
                 // Only update if needed
                 account.isActive = new_status;
-                // Seek back to the beginning of this record to overwrite it
-                if (lseek(fd_acct, record_num * sizeof(Account), SEEK_SET) == -1)
+                // Overwrite this record in place and force it to disk (write + fsync).
+                // A positioned write leaves the file position alone, so the scan continues
+                // with the next record.
+                if (io_write_fsync(fd_acct, &account, sizeof(Account), (off_t)record_num * sizeof(Account)) != sizeof(Account))
                 {
-                    perror("lseek back failed");
+                    perror("write update failed");
                     error_count++;
                 }
                 else
                 {
-                    // Write the updated record
-                    if (write(fd_acct, &account, sizeof(Account)) != sizeof(Account))
-                    {
-                        perror("write update failed");
-                        error_count++;
-                    }
-                    else
-                    {
-                        // Force write to disk for durability
-                        fsync(fd_acct);
-                        update_count++;
-                    }
-                }
-                // Seek forward to the start of the *next* record to continue reading
-                if (lseek(fd_acct, (record_num + 1) * sizeof(Account), SEEK_SET) == -1 && errno != 0)
-                {
-                    perror("lseek forward failed");
+                    update_count++;
                 }
             }
         }
@@ -193,7 +182,7 @@ void handle_assign_loan(int client_socket)
     int found = 0;
 
     // --- Display unassigned loans ---
-    int fd_loan = open(LOAN_FILE, O_RDONLY);
+    int fd_loan = io_open(LOAN_FILE, O_RDONLY, 0);
     if (fd_loan == -1)
     {
         write_string(client_socket, "No loans found or error opening file.\n");
@@ -204,7 +193,7 @@ void handle_assign_loan(int client_socket)
     Loan loan;
     write_string(client_socket, "\n--- Unassigned Loans (Status: PENDING) ---\n");
     lseek(fd_loan, 0, SEEK_SET); // Rewind
-    while (read(fd_loan, &loan, sizeof(Loan)) == sizeof(Loan))
+    while (io_read(fd_loan, &loan, sizeof(Loan)) == sizeof(Loan))
     {
         if (loan.assignedToEmployeeId == 0 && loan.status == PENDING)
         {
@@ -292,7 +281,7 @@ void handle_review_feedback(int client_socket)
     int found = 0;
 
     // Display unreviewed feedback
-    int fd_feedback = open(FEEDBACK_FILE, O_RDONLY);
+    int fd_feedback = io_open(FEEDBACK_FILE, O_RDONLY, 0);
     if (fd_feedback == -1)
     {
         write_string(client_socket, "No feedback found or error opening file.\n");
@@ -303,7 +292,7 @@ void handle_review_feedback(int client_socket)
     Feedback feedback;
     write_string(client_socket, "\n--- Unreviewed Feedback ---\n");
     lseek(fd_feedback, 0, SEEK_SET); // Rewind
-    while (read(fd_feedback, &feedback, sizeof(Feedback)) == sizeof(Feedback))
+    while (io_read(fd_feedback, &feedback, sizeof(Feedback)) == sizeof(Feedback))
     {
         if (feedback.isReviewed == 0)
         {
@@ -0,0 +1,176 @@
+// src/metrics.c
+#define _GNU_SOURCE // For accept4, memfd_create
+#include "metrics.h"     // Metrics endpoint API
+#include <stdatomic.h>   // For the scrape counters
+#include <stdio.h>       // For snprintf
+#include <sys/mman.h>    // For memfd_create
+#include <sys/sendfile.h> // For sendfile (page to socket)
+
+static int listen_fd = -1;
+static int metrics_port = 0;
+static MetricsWriter page_writer = NULL;
+static atomic_ulong scrapes;
+static atomic_ulong bad_requests;
+
+// Reads the request head (up to the blank line). Returns its length, or -1.
+static int read_request(int fd, char *request, size_t size)
+{
+    size_t total = 0;
+    while (total < size - 1)
+    {
+        ssize_t n = recv(fd, request + total, size - 1 - total, 0);
+        if (n <= 0)
+            return -1;
+        total += (size_t)n;
+        request[total] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL)
+            return (int)total;
+    }
+    return (int)total; // Longer than we care about: the request line is in there
+}
+
+static void send_all(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return;
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void send_response(int fd, const char *status, const char *content_type, off_t length)
+{
+    char head[256];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %ld\r\nConnection: close\r\n\r\n",
+                     status, content_type, (long)length);
+    send_all(fd, head, (size_t)n);
+}
+
+static void serve(int client)
+{
+    char request[1024];
+    if (read_request(client, request, sizeof(request)) == -1)
+        return;
+    int is_get = strncmp(request, "GET ", 4) == 0;
+    const char *path = request + 4;
+    if (!is_get || !(strncmp(path, "/metrics ", 9) == 0 || strncmp(path, "/ ", 2) == 0))
+    {
+        atomic_fetch_add_explicit(&bad_requests, 1, memory_order_relaxed);
+        const char *body = "Only GET /metrics is served here.\n";
+        send_response(client, is_get ? "404 Not Found" : "405 Method Not Allowed", "text/plain", (off_t)strlen(body));
+        send_all(client, body, strlen(body));
+        return;
+    }
+
+    int page = memfd_create("metrics", MFD_CLOEXEC);
+    if (page == -1)
+    {
+        send_response(client, "500 Internal Server Error", "text/plain", 0);
+        return;
+    }
+    page_writer(page);
+    off_t length = lseek(page, 0, SEEK_CUR);
+    send_response(client, "200 OK", "text/plain; version=0.0.4", length);
+    off_t offset = 0;
+    while (offset < length)
+    {
+        if (sendfile(client, page, &offset, (size_t)(length - offset)) <= 0)
+            break;
+    }
+    close(page);
+    atomic_fetch_add_explicit(&scrapes, 1, memory_order_relaxed);
+}
+
+static void *metrics_thread(void *arg)
+{
+    (void)arg;
+    struct timeval timeout = {METRICS_IO_TIMEOUT_SECONDS, 0};
+    while (1)
+    {
+        int client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client == -1)
+        {
+            if (errno != EINTR && errno != ECONNABORTED)
+                usleep(100000); // Out of fds: do not spin
+            continue;
+        }
+        // A scraper that stops reading or writing only holds this thread for the timeout
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        serve(client);
+        close(client);
+    }
+    return NULL;
+}
+
+int metrics_start(int port, MetricsWriter writer)
+{
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1)
+    {
+        perror("metrics: socket");
+        return -1;
+    }
+    // SO_REUSEPORT: the new process of a hot restart binds while the old one still serves
+    int on = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Never reachable from other machines
+    address.sin_port = htons((unsigned short)port);
+    if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) == -1 || listen(listen_fd, 16) == -1)
+    {
+        perror("metrics: bind");
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    page_writer = writer;
+    metrics_port = port;
+    pthread_t thread_id;
+    if (pthread_create(&thread_id, NULL, metrics_thread, NULL) != 0)
+    {
+        perror("metrics: pthread_create");
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+    pthread_detach(thread_id);
+    return 0;
+}
+
+void metrics_header(int fd, const char *name, const char *type, const char *help)
+{
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    write_string(fd, buffer);
+}
+
+void metrics_value(int fd, const char *name, const char *labels, double value)
+{
+    char buffer[256];
+    if (labels != NULL && labels[0] != '\0')
+        snprintf(buffer, sizeof(buffer), "%s{%s} %.15g\n", name, labels, value);
+    else
+        snprintf(buffer, sizeof(buffer), "%s %.15g\n", name, value);
+    write_string(fd, buffer);
+}
+
+void metrics_report(int fd)
+{
+    char buffer[128];
+    if (listen_fd == -1)
+        snprintf(buffer, sizeof(buffer), "Metrics endpoint: off\n");
+    else
+        snprintf(buffer, sizeof(buffer), "Metrics endpoint: 127.0.0.1:%d/metrics, %lu scrape(s), %lu bad request(s)\n",
+                 metrics_port, atomic_load(&scrapes), atomic_load(&bad_requests));
+    write_string(fd, buffer);
+}
@@ -0,0 +1,277 @@
+// src/password.c
+#include "password.h" // Verifier format and prototypes
+#include <stdint.h>   // For uint32_t, uint64_t
+
+// --- SHA-256 (FIPS 180-4) ---
+
+typedef struct
+{
+    uint32_t state[8];
+    uint64_t length; // Bytes hashed so far
+    unsigned char block[64];
+    size_t used; // Bytes waiting in block
+} Sha256;
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_compress(uint32_t state[8], const unsigned char block[64])
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 |
+               (uint32_t)block[i * 4 + 2] << 8 | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+static void sha256_init(Sha256 *ctx)
+{
+    static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+static void sha256_update(Sha256 *ctx, const unsigned char *data, size_t len)
+{
+    ctx->length += len;
+    while (len > 0)
+    {
+        size_t take = 64 - ctx->used;
+        if (take > len)
+            take = len;
+        memcpy(ctx->block + ctx->used, data, take);
+        ctx->used += take;
+        data += take;
+        len -= take;
+        if (ctx->used == 64)
+        {
+            sha256_compress(ctx->state, ctx->block);
+            ctx->used = 0;
+        }
+    }
+}
+
+static void sha256_final(Sha256 *ctx, unsigned char digest[32])
+{
+    uint64_t bits = ctx->length * 8;
+
+    // 0x80, zeros up to 56 mod 64, then the message length in bits (big-endian)
+    ctx->block[ctx->used++] = 0x80;
+    if (ctx->used > 56)
+    {
+        memset(ctx->block + ctx->used, 0, 64 - ctx->used);
+        sha256_compress(ctx->state, ctx->block);
+        ctx->used = 0;
+    }
+    memset(ctx->block + ctx->used, 0, 56 - ctx->used);
+    for (int i = 0; i < 8; i++)
+        ctx->block[56 + i] = (unsigned char)(bits >> (56 - 8 * i));
+    sha256_compress(ctx->state, ctx->block);
+
+    for (int i = 0; i < 8; i++)
+    {
+        digest[i * 4] = (unsigned char)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char)ctx->state[i];
+    }
+}
+
+// --- PBKDF2-HMAC-SHA256 (RFC 8018), first output block only ---
+
+/*
+-> HMAC(key, m) = H((key ^ opad) || H((key ^ ipad) || m)). The two padded-key blocks are the same
+   for every iteration, so they are compressed once and each iteration resumes from those states:
+   two compressions per iteration instead of four.
+*/
+static void pbkdf2_sha256(const char *password, const unsigned char *salt, size_t salt_len,
+                          int iterations, unsigned char out[32])
+{
+    unsigned char key[64] = {0};
+    size_t password_len = strlen(password);
+    if (password_len > 64)
+    {
+        Sha256 ctx;
+        sha256_init(&ctx);
+        sha256_update(&ctx, (const unsigned char *)password, password_len);
+        sha256_final(&ctx, key);
+    }
+    else
+    {
+        memcpy(key, password, password_len);
+    }
+
+    unsigned char pad[64];
+    Sha256 inner_start, outer_start;
+    for (int i = 0; i < 64; i++)
+        pad[i] = key[i] ^ 0x36;
+    sha256_init(&inner_start);
+    sha256_update(&inner_start, pad, 64);
+    for (int i = 0; i < 64; i++)
+        pad[i] = key[i] ^ 0x5c;
+    sha256_init(&outer_start);
+    sha256_update(&outer_start, pad, 64);
+
+    // U1 = HMAC(password, salt || INT(1))
+    unsigned char u[32];
+    unsigned char block_index[4] = {0, 0, 0, 1};
+    Sha256 ctx = inner_start;
+    sha256_update(&ctx, salt, salt_len);
+    sha256_update(&ctx, block_index, 4);
+    sha256_final(&ctx, u);
+    ctx = outer_start;
+    sha256_update(&ctx, u, 32);
+    sha256_final(&ctx, u);
+    memcpy(out, u, 32);
+
+    // U2..Un, XORed into the output
+    for (int n = 1; n < iterations; n++)
+    {
+        ctx = inner_start;
+        sha256_update(&ctx, u, 32);
+        sha256_final(&ctx, u);
+        ctx = outer_start;
+        sha256_update(&ctx, u, 32);
+        sha256_final(&ctx, u);
+        for (int i = 0; i < 32; i++)
+            out[i] ^= u[i];
+    }
+}
+
+// --- Verifier Encoding ---
+
+static const char alphabet[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+// Encodes len bytes (a multiple of 3) as 4 characters per 3 bytes. Returns characters written.
+static int encode64(const unsigned char *bytes, size_t len, char *out)
+{
+    int n = 0;
+    for (size_t i = 0; i + 2 < len; i += 3)
+    {
+        uint32_t v = (uint32_t)bytes[i] << 16 | (uint32_t)bytes[i + 1] << 8 | bytes[i + 2];
+        for (int shift = 18; shift >= 0; shift -= 6)
+            out[n++] = alphabet[(v >> shift) & 63];
+    }
+    out[n] = '\0';
+    return n;
+}
+
+// Decodes what encode64 wrote. Returns 0, or -1 on characters outside the alphabet.
+static int decode64(const char *in, size_t chars, unsigned char *bytes)
+{
+    for (size_t i = 0; i < chars; i += 4)
+    {
+        uint32_t v = 0;
+        for (int j = 0; j < 4; j++)
+        {
+            const char *pos = strchr(alphabet, in[i + j]);
+            if (in[i + j] == '\0' || pos == NULL)
+                return -1;
+            v = v << 6 | (uint32_t)(pos - alphabet);
+        }
+        bytes[i / 4 * 3] = (unsigned char)(v >> 16);
+        bytes[i / 4 * 3 + 1] = (unsigned char)(v >> 8);
+        bytes[i / 4 * 3 + 2] = (unsigned char)v;
+    }
+    return 0;
+}
+
+#define SALT_CHARS (PASSWORD_SALT_BYTES / 3 * 4)
+#define HASH_CHARS (PASSWORD_HASH_BYTES / 3 * 4)
+
+int password_is_legacy(const char *stored)
+{
+    return strncmp(stored, PASSWORD_SCHEME, strlen(PASSWORD_SCHEME)) != 0;
+}
+
+int password_hash(const char *password, char *stored)
+{
+    unsigned char salt[PASSWORD_SALT_BYTES];
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd == -1)
+    {
+        perror("password: open /dev/urandom");
+        return -1;
+    }
+    ssize_t got = read(fd, salt, sizeof(salt));
+    close(fd);
+    if (got != (ssize_t)sizeof(salt))
+        return -1;
+
+    unsigned char digest[32];
+    pbkdf2_sha256(password, salt, sizeof(salt), PASSWORD_HASH_ITERATIONS, digest);
+
+    // "$1$" + salt + "$" + hash
+    int n = sprintf(stored, "%s", PASSWORD_SCHEME);
+    n += encode64(salt, sizeof(salt), stored + n);
+    stored[n++] = '$';
+    encode64(digest, PASSWORD_HASH_BYTES, stored + n);
+    return 0;
+}
+
+int password_verify(const char *password, const char *stored)
+{
+    if (password_is_legacy(stored))
+        return my_strcmp(stored, password) == 0;
+
+    const char *salt_text = stored + strlen(PASSWORD_SCHEME);
+    if (strlen(salt_text) != SALT_CHARS + 1 + HASH_CHARS || salt_text[SALT_CHARS] != '$')
+        return 0; // Damaged verifier: nothing matches it
+
+    unsigned char salt[PASSWORD_SALT_BYTES];
+    unsigned char expected[PASSWORD_HASH_BYTES];
+    if (decode64(salt_text, SALT_CHARS, salt) == -1 ||
+        decode64(salt_text + SALT_CHARS + 1, HASH_CHARS, expected) == -1)
+        return 0;
+
+    unsigned char digest[32];
+    pbkdf2_sha256(password, salt, sizeof(salt), PASSWORD_HASH_ITERATIONS, digest);
+
+    // Compare every byte, so the time taken does not reveal how much of the hash matched
+    unsigned char diff = 0;
+    for (int i = 0; i < PASSWORD_HASH_BYTES; i++)
+        diff |= digest[i] ^ expected[i];
+    return diff == 0;
+}
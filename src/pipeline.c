@@ -0,0 +1,830 @@
+// src/pipeline.c
+#include "pipeline.h"    // Protocol description and pipeline_session
+#include "server.h"      // For check_login
+#include "session.h"     // For session_add, session_remove
+#include "session_token.h" // For token_issue, token_resume
+#include "data_access.h" // For getAccountByNum, getAccountsByOwnerId, set_file_lock
+#include "ledger.h"      // For ledger_post, ledger_transfer, ledger_transfer_batch
+#include "scheduler.h"   // For SCHEDULE, INSTRUCTIONS, CANCEL
+#include "connection.h"  // For connection_logged_in
+#include "io_backend.h"  // For io_recv, io_send, io_open, io_read
+#include "rate_limit.h"  // For per-request and login throttling
+#include "stats.h"       // For per-operation latency, stats_set_user
+#include "trace.h"       // For the request parsing span
+#include "common.h"      // For structs, enums, write_string
+#include <netinet/tcp.h> // For TCP_NODELAY
+#include <poll.h>        // For POLLIN, POLLOUT
+#include <pthread.h>     // For worker threads
+#include <stdarg.h>      // For va_list
+#include <stdio.h>       // For snprintf
+#include <stdlib.h>      // For malloc, free, atof, atoi
+#include <string.h>      // For strtok_r, strlen
+
+/*
+--- Pipelined Session ---
+
+-> One reader (the session thread itself) parses request lines and puts them on a queue.
+-> PIPELINE_WORKERS worker threads take requests off the queue and execute them, so a slow
+   request (e.g. HISTORY scanning transactions.dat) does not hold up the ones behind it.
+-> Every reply is one write() done while holding write_mutex, so replies from different workers
+   never interleave on the socket.
+-> inflight counts queued + executing requests. The reader waits when it reaches
+   PIPELINE_MAX_INFLIGHT, which pushes back on the client through TCP flow control.
+*/
+
+typedef struct PipelineRequest
+{
+    struct PipelineRequest *next;
+    char line[]; // Allocated to the line's length (a BATCH line may be up to PIPELINE_MAX_LINE)
+} PipelineRequest;
+
+typedef struct
+{
+    int client_socket;
+    User user;
+    char token[TOKEN_LENGTH + 1]; // Session token for RESUME
+    pthread_mutex_t write_mutex;  // Serializes replies on the socket
+    pthread_mutex_t queue_mutex;  // Protects the queue, inflight and closing
+    pthread_cond_t queue_cond;    // A request was queued (or the session is closing)
+    pthread_cond_t space_cond;    // A request finished
+    PipelineRequest *head, *tail; // FIFO of requests not yet picked up by a worker
+    int inflight;                 // Queued + executing
+    int closing;                  // Reader is done, workers exit once the queue is empty
+} PipelineConn;
+
+// Buffered line reader (read_client_input reads one byte per syscall)
+typedef struct
+{
+    int fd;
+    char buf[4096];
+    int start;
+    int end;
+} LineReader;
+
+// Reads one line (without the newline) into out. Returns its length, or -1 on disconnect.
+// A length >= size means the line was longer than out and was cut off.
+static int read_line(LineReader *reader, char *out, int size)
+{
+    int len = 0;
+    while (1)
+    {
+        while (reader->start < reader->end)
+        {
+            char c = reader->buf[reader->start++];
+            if (c == '\n')
+            {
+                out[len < size ? len : size - 1] = '\0';
+                if (client_input_hook != NULL)
+                    client_input_hook(reader->fd); // Counts as activity for the idle timeout
+                return len;
+            }
+            if (c != '\r')
+            {
+                if (len < size - 1)
+                    out[len] = c; // Anything past size - 1 is dropped, but still counted
+                len++;
+            }
+        }
+
+        ssize_t n = io_recv(reader->fd, reader->buf, sizeof(reader->buf));
+        if (n == 0)
+            return -1; // Client disconnected
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_for_fd(reader->fd, POLLIN) == 0)
+                continue; // Non-blocking socket: poll until data arrived
+            return -1;
+        }
+        reader->start = 0;
+        reader->end = (int)n;
+    }
+}
+
+// Writes the whole reply under the connection's write lock
+static void send_reply(PipelineConn *conn, const char *text, size_t len)
+{
+    pthread_mutex_lock(&conn->write_mutex);
+    size_t sent = 0;
+    while (sent < len)
+    {
+        // io_send uses MSG_NOSIGNAL: a client that already hung up must not kill the server with SIGPIPE
+        ssize_t n = io_send(conn->client_socket, text + sent, len - sent);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && wait_for_fd(conn->client_socket, POLLOUT) == 0)
+            continue; // Non-blocking socket: poll for buffer space
+        if (n <= 0)
+            break;
+        sent += n;
+    }
+    pthread_mutex_unlock(&conn->write_mutex);
+}
+
+// Appends to a reply being built in buffer, never past size - 2 (room for the final '\n').
+// Returns the new length: an oversized payload is cut, not written past the end.
+static size_t vappend_reply(char *buffer, size_t size, size_t len, const char *fmt, va_list args)
+{
+    if (len >= size - 2)
+        return size - 2;
+    int n = vsnprintf(buffer + len, size - 1 - len, fmt, args);
+    if (n < 0)
+        return len;
+    len += (size_t)n;
+    return len > size - 2 ? size - 2 : len;
+}
+
+static size_t append_reply(char *buffer, size_t size, size_t len, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    len = vappend_reply(buffer, size, len, fmt, args);
+    va_end(args);
+    return len;
+}
+
+static void reply(PipelineConn *conn, const char *id, const char *status, const char *fmt, ...)
+{
+    char buffer[MAX_BUFFER];
+    size_t len = append_reply(buffer, sizeof(buffer), 0, "%s %s", id, status);
+    if (fmt != NULL)
+    {
+        len = append_reply(buffer, sizeof(buffer), len, " ");
+        va_list args;
+        va_start(args, fmt);
+        len = vappend_reply(buffer, sizeof(buffer), len, fmt, args);
+        va_end(args);
+    }
+    buffer[len++] = '\n';
+    send_reply(conn, buffer, len);
+}
+
+// The client's id is echoed in every reply: a longer one is refused before anything runs
+static int id_too_long(const char *line)
+{
+    size_t id_len = strcspn(line, " ");
+    return id_len > PIPELINE_MAX_ID;
+}
+
+// Parses a strictly positive amount. Returns 0 if the text is not one.
+static int parse_amount(const char *text, double *amount)
+{
+    if (text == NULL || !is_valid_number(text))
+        return 0;
+    *amount = atof(text);
+    return *amount > 0;
+}
+
+// Looks up accNum and checks that it belongs to the logged-in customer.
+// Returns NULL on success, otherwise the error to send back.
+static const char *get_own_account(PipelineConn *conn, char *accNum, Account *account)
+{
+    if (accNum == NULL || strlen(accNum) >= 20)
+        return "Invalid account number";
+    *account = getAccountByNum(accNum);
+    if (account->accountId == -1)
+        return "Account not found";
+    if (account->ownerUserId != conn->user.userId)
+        return "Account does not belong to you";
+    return NULL;
+}
+
+static void op_accounts(PipelineConn *conn, const char *id)
+{
+    Account accounts[10]; // Same limit as account_selection_menu
+    int count = getAccountsByOwnerId(conn->user.userId, accounts, 10);
+
+    char buffer[MAX_BUFFER];
+    size_t len = append_reply(buffer, sizeof(buffer), 0, "%s OK %d", id, count);
+    for (int i = 0; i < count; i++)
+    {
+        len = append_reply(buffer, sizeof(buffer), len, " %s:%.2f", accounts[i].accountNumber,
+                           accounts[i].balance);
+    }
+    buffer[len++] = '\n';
+    send_reply(conn, buffer, len);
+}
+
+static void op_balance(PipelineConn *conn, const char *id, char *accNum)
+{
+    Account account;
+    const char *error = get_own_account(conn, accNum, &account);
+    if (error != NULL)
+    {
+        reply(conn, id, "ERR", "%s", error);
+        return;
+    }
+    reply(conn, id, "OK", "%s %.2f", account.accountNumber, account.balance);
+}
+
+static void op_post(PipelineConn *conn, const char *id, TransactionType type, char *accNum, char *amountText)
+{
+    Account account;
+    double amount;
+    const char *error = get_own_account(conn, accNum, &account);
+    if (error != NULL)
+    {
+        reply(conn, id, "ERR", "%s", error);
+        return;
+    }
+    if (!parse_amount(amountText, &amount))
+    {
+        reply(conn, id, "ERR", "Invalid amount");
+        return;
+    }
+    if (!account.isActive)
+    {
+        reply(conn, id, "ERR", "%s", ledger_result_str(LEDGER_INACTIVE));
+        return;
+    }
+
+    LedgerResult result = ledger_post(account.accountId, type, amount, &account);
+    if (result == LEDGER_OK || result == LEDGER_LOG_FAILED)
+    {
+        // The balance did change even if the history entry could not be written
+        reply(conn, id, "OK", "%.2f", account.balance);
+    }
+    else
+    {
+        reply(conn, id, "ERR", "%s", ledger_result_str(result));
+    }
+}
+
+static void op_transfer(PipelineConn *conn, const char *id, char *fromAccNum, char *toAccNum, char *amountText)
+{
+    Account sender, receiver;
+    double amount;
+    const char *error = get_own_account(conn, fromAccNum, &sender);
+    if (error != NULL)
+    {
+        reply(conn, id, "ERR", "%s", error);
+        return;
+    }
+    if (toAccNum == NULL || strlen(toAccNum) >= 20)
+    {
+        reply(conn, id, "ERR", "Invalid account number");
+        return;
+    }
+    if (!parse_amount(amountText, &amount))
+    {
+        reply(conn, id, "ERR", "Invalid amount");
+        return;
+    }
+    receiver = getAccountByNum(toAccNum);
+    if (receiver.accountId == -1)
+    {
+        reply(conn, id, "ERR", "%s", ledger_result_str(LEDGER_NOT_FOUND));
+        return;
+    }
+
+    LedgerResult result = ledger_transfer(sender.accountId, receiver.accountId, amount, &sender, &receiver);
+    if (result == LEDGER_OK || result == LEDGER_LOG_FAILED)
+    {
+        reply(conn, id, "OK", "%.2f", sender.balance);
+    }
+    else
+    {
+        reply(conn, id, "ERR", "%s", ledger_result_str(result));
+    }
+}
+
+static void op_history(PipelineConn *conn, const char *id, char *accNum, char *limitText)
+{
+    Account account;
+    const char *error = get_own_account(conn, accNum, &account);
+    if (error != NULL)
+    {
+        reply(conn, id, "ERR", "%s", error);
+        return;
+    }
+    int limit = (limitText != NULL) ? atoi(limitText) : PIPELINE_HISTORY_LIMIT;
+    if (limit <= 0 || limit > 1000)
+        limit = PIPELINE_HISTORY_LIMIT;
+
+    int fd = io_open(TRANSACTION_FILE, O_RDONLY, 0);
+    if (fd == -1)
+    {
+        reply(conn, id, "OK", "0");
+        return;
+    }
+    if (set_file_lock(fd, F_RDLCK) == -1)
+    {
+        close(fd);
+        reply(conn, id, "ERR", "Error locking transaction file");
+        return;
+    }
+
+    // Keep the newest 'limit' matches in a ring
+    Transaction *recent = malloc(sizeof(Transaction) * limit);
+    if (recent == NULL)
+    {
+        set_file_lock(fd, F_UNLCK);
+        close(fd);
+        reply(conn, id, "ERR", "Out of memory");
+        return;
+    }
+    Transaction txn;
+    int matches = 0;
+    while (io_read(fd, &txn, sizeof(Transaction)) == sizeof(Transaction))
+    {
+        if (txn.accountId == account.accountId)
+        {
+            recent[matches % limit] = txn;
+            matches++;
+        }
+    }
+    set_file_lock(fd, F_UNLCK);
+    close(fd);
+
+    int count = (matches < limit) ? matches : limit;
+    size_t capacity = 64 + (size_t)count * 96;
+    char *out = malloc(capacity);
+    if (out == NULL)
+    {
+        free(recent);
+        reply(conn, id, "ERR", "Out of memory");
+        return;
+    }
+    size_t len = append_reply(out, capacity, 0, "%s OK %d", id, count);
+    static const char *type_names[] = {"DEPOSIT", "WITHDRAWAL", "TRANSFER_OUT", "TRANSFER_IN"};
+    for (int i = matches - count; i < matches; i++)
+    {
+        Transaction *t = &recent[i % limit];
+        const char *type = (t->type >= DEPOSIT && t->type <= TRANSFER_IN) ? type_names[t->type] : "UNKNOWN";
+        len = append_reply(out, capacity, len, " %d,%s,%.2f,%.2f,%.19s,%ld", t->transactionId, type, t->amount,
+                           t->newBalance, t->otherPartyAccountNumber, (long)t->timestamp);
+    }
+    out[len++] = '\n';
+    send_reply(conn, out, len);
+    free(out);
+    free(recent);
+}
+
+// legsText: <toAccNum>:<amount>[,<toAccNum>:<amount>...]
+static void op_batch(PipelineConn *conn, const char *id, char *fromAccNum, char *legsText)
+{
+    Account sender;
+    const char *error = get_own_account(conn, fromAccNum, &sender);
+    if (error != NULL)
+    {
+        reply(conn, id, "ERR", "%s", error);
+        return;
+    }
+    if (legsText == NULL)
+    {
+        reply(conn, id, "ERR", "Missing legs");
+        return;
+    }
+    int count = 1;
+    for (const char *c = legsText; *c != '\0'; c++)
+        count += (*c == ',');
+    if (count > LEDGER_BATCH_MAX)
+    {
+        reply(conn, id, "ERR", "At most %d legs per batch", LEDGER_BATCH_MAX);
+        return;
+    }
+    LedgerLeg *legs = malloc(sizeof(LedgerLeg) * count);
+    if (legs == NULL)
+    {
+        reply(conn, id, "ERR", "Out of memory");
+        return;
+    }
+
+    char *save = NULL;
+    int parsed = 0;
+    for (char *leg = strtok_r(legsText, ",", &save); leg != NULL; leg = strtok_r(NULL, ",", &save))
+    {
+        char *colon = strchr(leg, ':');
+        if (colon != NULL)
+            *colon = '\0';
+        if (colon == NULL || strlen(leg) == 0 || strlen(leg) >= sizeof(legs[parsed].accountNumber) ||
+            !parse_amount(colon + 1, &legs[parsed].amount))
+        {
+            reply(conn, id, "ERR", "leg %d: expected <accNum>:<amount>", parsed + 1);
+            free(legs);
+            return;
+        }
+        strcpy(legs[parsed].accountNumber, leg);
+        parsed++;
+    }
+
+    int failed_leg;
+    LedgerResult result = ledger_transfer_batch(sender.accountId, legs, parsed, &sender, &failed_leg);
+    if (result == LEDGER_OK || result == LEDGER_LOG_FAILED)
+        reply(conn, id, "OK", "%.2f %d", sender.balance, parsed);
+    else if (failed_leg >= 0)
+        reply(conn, id, "ERR", "leg %d: %s", failed_leg + 1, ledger_result_str(result));
+    else
+        reply(conn, id, "ERR", "%s", ledger_result_str(result));
+    free(legs);
+}
+
+// Parses a whole number >= 0 (seconds, counts). Returns 0 if the text is not one.
+static int parse_count(const char *text, int *value)
+{
+    if (text == NULL || strlen(text) > 9)
+        return 0;
+    for (const char *c = text; *c != '\0'; c++)
+    {
+        if (*c < '0' || *c > '9')
+            return 0;
+    }
+    *value = atoi(text);
+    return 1;
+}
+
+static void op_schedule(PipelineConn *conn, const char *id, char *fromAccNum, char *toAccNum, char *amountText,
+                        char *everyText, char *delayText, char *countText)
+{
+    Account sender;
+    StandingInstruction ins;
+    int delay = 0;
+    memset(&ins, 0, sizeof(ins));
+    const char *error = get_own_account(conn, fromAccNum, &sender);
+    if (error != NULL)
+    {
+        reply(conn, id, "ERR", "%s", error);
+        return;
+    }
+    if (toAccNum == NULL || strlen(toAccNum) >= 20)
+    {
+        reply(conn, id, "ERR", "Invalid account number");
+        return;
+    }
+    if (!parse_amount(amountText, &ins.amount) || ins.amount > INSTRUCTION_MAX_AMOUNT)
+    {
+        reply(conn, id, "ERR", "Invalid amount");
+        return;
+    }
+    if (!parse_count(everyText, &ins.intervalSeconds) || (delayText != NULL && !parse_count(delayText, &delay)) ||
+        (countText != NULL && !parse_count(countText, &ins.remainingRuns)))
+    {
+        reply(conn, id, "ERR", "Invalid schedule");
+        return;
+    }
+    ins.ownerUserId = conn->user.userId;
+    ins.fromAccountId = sender.accountId;
+    strcpy(ins.toAccountNumber, toAccNum);
+    ins.dueTime = time(NULL) + delay;
+
+    LedgerResult result = scheduler_add(&ins);
+    if (result == LEDGER_OK)
+        reply(conn, id, "OK", "%d %ld", ins.instructionId, (long)ins.dueTime);
+    else
+        reply(conn, id, "ERR", "%s", ledger_result_str(result));
+}
+
+static void op_instructions(PipelineConn *conn, const char *id)
+{
+    StandingInstruction list[INSTRUCTION_LIST_MAX];
+    int count = scheduler_list(conn->user.userId, list, INSTRUCTION_LIST_MAX);
+
+    char buffer[64 + INSTRUCTION_LIST_MAX * 128];
+    size_t len = append_reply(buffer, sizeof(buffer), 0, "%s OK %d", id, count);
+    for (int i = 0; i < count; i++)
+    {
+        StandingInstruction *ins = &list[i];
+        len = append_reply(buffer, sizeof(buffer), len, " %d,%.19s,%.19s,%.2f,%d,%ld,%s,%d,%d,%d",
+                           ins->instructionId, ins->fromAccountNumber, ins->toAccountNumber, ins->amount,
+                           ins->intervalSeconds, (long)ins->nextAttempt, instruction_status_str(ins->status),
+                           ins->totalRuns, ins->totalFailures, ins->remainingRuns);
+    }
+    buffer[len++] = '\n';
+    send_reply(conn, buffer, len);
+}
+
+static void op_cancel(PipelineConn *conn, const char *id, char *instructionText)
+{
+    int instructionId;
+    if (!parse_count(instructionText, &instructionId) || scheduler_cancel(conn->user.userId, instructionId) == -1)
+        reply(conn, id, "ERR", "No active standing instruction with that id");
+    else
+        reply(conn, id, "OK", "%d", instructionId);
+}
+
+// Runs one request line on a worker thread
+static void execute_request(PipelineConn *conn, char *line)
+{
+    uint64_t parse_start = trace_begin();
+    char *save = NULL;
+    char *id = strtok_r(line, " ", &save);
+    char *op = strtok_r(NULL, " ", &save);
+    char *arg1 = strtok_r(NULL, " ", &save);
+    char *arg2 = strtok_r(NULL, " ", &save);
+    char *arg3 = strtok_r(NULL, " ", &save);
+    char *arg4 = strtok_r(NULL, " ", &save);
+    char *arg5 = strtok_r(NULL, " ", &save);
+    char *arg6 = strtok_r(NULL, " ", &save);
+    trace_end("parse request", parse_start);
+
+    if (id == NULL)
+        return;
+    if (op == NULL)
+        reply(conn, id, "ERR", "Missing operation");
+    else if (my_strcmp(op, "PING") == 0)
+        reply(conn, id, "OK", "PONG");
+    else if (my_strcmp(op, "ACCOUNTS") == 0)
+        STATS_TIME(STAT_OP_ACCOUNTS, op_accounts(conn, id));
+    else if (my_strcmp(op, "BALANCE") == 0)
+        STATS_TIME(STAT_OP_BALANCE, op_balance(conn, id, arg1));
+    else if (my_strcmp(op, "DEPOSIT") == 0)
+        STATS_TIME(STAT_OP_DEPOSIT, op_post(conn, id, DEPOSIT, arg1, arg2));
+    else if (my_strcmp(op, "WITHDRAW") == 0)
+        STATS_TIME(STAT_OP_WITHDRAW, op_post(conn, id, WITHDRAWAL, arg1, arg2));
+    else if (my_strcmp(op, "TRANSFER") == 0)
+        STATS_TIME(STAT_OP_TRANSFER, op_transfer(conn, id, arg1, arg2, arg3));
+    else if (my_strcmp(op, "HISTORY") == 0)
+        STATS_TIME(STAT_OP_HISTORY, op_history(conn, id, arg1, arg2));
+    else if (my_strcmp(op, "BATCH") == 0)
+        STATS_TIME(STAT_OP_BATCH, op_batch(conn, id, arg1, arg2));
+    else if (my_strcmp(op, "SCHEDULE") == 0)
+        STATS_TIME(STAT_OP_SCHEDULE, op_schedule(conn, id, arg1, arg2, arg3, arg4, arg5, arg6));
+    else if (my_strcmp(op, "INSTRUCTIONS") == 0)
+        STATS_TIME(STAT_OP_INSTRUCTIONS, op_instructions(conn, id));
+    else if (my_strcmp(op, "CANCEL") == 0)
+        STATS_TIME(STAT_OP_CANCEL, op_cancel(conn, id, arg1));
+    else if (my_strcmp(op, "AUTH") == 0)
+        reply(conn, id, "ERR", "Already authenticated");
+    else
+        reply(conn, id, "ERR", "Unknown operation");
+}
+
+static void *pipeline_worker(void *arg)
+{
+    PipelineConn *conn = (PipelineConn *)arg;
+    stats_set_user(conn->user.userId);
+    while (1)
+    {
+        pthread_mutex_lock(&conn->queue_mutex);
+        while (conn->head == NULL && !conn->closing)
+        {
+            pthread_cond_wait(&conn->queue_cond, &conn->queue_mutex);
+        }
+        PipelineRequest *request = conn->head;
+        if (request == NULL)
+        {
+            // Closing and nothing left to do
+            pthread_mutex_unlock(&conn->queue_mutex);
+            break;
+        }
+        conn->head = request->next;
+        if (conn->head == NULL)
+            conn->tail = NULL;
+        pthread_mutex_unlock(&conn->queue_mutex);
+
+        execute_request(conn, request->line);
+        free(request);
+
+        pthread_mutex_lock(&conn->queue_mutex);
+        conn->inflight--;
+        pthread_cond_broadcast(&conn->space_cond);
+        pthread_mutex_unlock(&conn->queue_mutex);
+    }
+    return NULL;
+}
+
+// Handles the mandatory first request (AUTH or RESUME). Returns 1 if the session may continue.
+static int pipeline_auth(PipelineConn *conn, char *line)
+{
+    char *save = NULL;
+    char *id = strtok_r(line, " ", &save);
+    char *op = strtok_r(NULL, " ", &save);
+    char *arg1 = strtok_r(NULL, " ", &save);
+    char *arg2 = strtok_r(NULL, " ", &save);
+    char token[TOKEN_LENGTH + 1];
+    User user;
+
+    if (id == NULL)
+        return 0;
+    if (op != NULL && my_strcmp(op, TOKEN_RESUME_CMD) == 0 && arg1 != NULL)
+    {
+        // Resume: no credential lookup
+        if (token_resume(arg1, &user) != 0)
+        {
+            reply(conn, id, "ERR", "Session token invalid or expired");
+            return 0;
+        }
+        strcpy(token, arg1);
+    }
+    else if (op != NULL && my_strcmp(op, "AUTH") == 0 && arg1 != NULL && arg2 != NULL)
+    {
+        if (strlen(arg2) >= 50)
+        {
+            reply(conn, id, "ERR", "Invalid User ID or Password");
+            return 0;
+        }
+        Connection *current = connection_current();
+        RateResult limited = rate_limit_login(atoi(arg1), current != NULL ? current->peer : "local");
+        if (limited != RATE_OK)
+        {
+            reply(conn, id, "ERR", "Too many attempts, try again later");
+            return 0;
+        }
+        STATS_TIME(STAT_CHECK_LOGIN, user = check_login(atoi(arg1), arg2));
+        if (user.userId == LOGIN_DEACTIVATED)
+        {
+            reply(conn, id, "ERR", "Account deactivated");
+            return 0;
+        }
+        if (user.userId == LOGIN_BUSY)
+        {
+            reply(conn, id, "ERR", "Server busy, retry AUTH");
+            return 0;
+        }
+        if (user.userId <= 0)
+        {
+            reply(conn, id, "ERR", "Invalid User ID or Password");
+            return 0;
+        }
+        token[0] = '\0';
+    }
+    else
+    {
+        reply(conn, id, "ERR", "First request must be AUTH <userId> <password> or RESUME <token>");
+        return 0;
+    }
+
+    if (user.role != CUSTOMER)
+    {
+        reply(conn, id, "ERR", "Pipelined sessions are for customers only");
+        return 0;
+    }
+
+    int sessionStatus = session_add(user.userId);
+    if (sessionStatus == SESSION_DUPLICATE)
+    {
+        reply(conn, id, "ERR", "User already logged in");
+        return 0;
+    }
+    if (sessionStatus == SESSION_FULL)
+    {
+        reply(conn, id, "ERR", "Server full");
+        return 0;
+    }
+
+    if (token[0] == '\0' && token_issue(&user, token) != 0)
+    {
+        strcpy(token, "-"); // Session works, it just cannot be resumed
+    }
+    conn->user = user;
+    strcpy(conn->token, token);
+    if (connection_current() != NULL)
+        connection_logged_in(connection_current(), user.userId); // Authenticated: idle timeout from now on
+    stats_set_user(user.userId); // Named in slow-op log lines
+    reply(conn, id, "OK", "%d %s %s", user.userId, user.firstName, token);
+    return 1;
+}
+
+void pipeline_session(int client_socket)
+{
+    PipelineConn conn;
+    memset(&conn, 0, sizeof(conn));
+    conn.client_socket = client_socket;
+    pthread_mutex_init(&conn.write_mutex, NULL);
+    pthread_mutex_init(&conn.queue_mutex, NULL);
+    pthread_cond_init(&conn.queue_cond, NULL);
+    pthread_cond_init(&conn.space_cond, NULL);
+
+    LineReader reader;
+    reader.fd = client_socket;
+    reader.start = 0;
+    reader.end = 0;
+
+    // Replies are small and independent: send each at once instead of letting Nagle hold it
+    // until the previous one is acknowledged (~40 ms with delayed ACKs). No-op on unix sockets.
+    int one = 1;
+    setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    char line[PIPELINE_MAX_LINE];
+    write_string(client_socket, "PIPELINE READY\n");
+
+    // --- Authentication (synchronous) ---
+    int len;
+    do
+    {
+        len = read_line(&reader, line, sizeof(line));
+    } while (len == 0);
+    if (len != -1 && id_too_long(line))
+    {
+        reply(&conn, "?", "ERR", "Request id longer than %d bytes", PIPELINE_MAX_ID);
+        goto cleanup;
+    }
+    if (len == -1 || !pipeline_auth(&conn, line))
+    {
+        goto cleanup;
+    }
+    write_string(STDOUT_FILENO, "Pipeline session started.\n");
+
+    // --- Workers ---
+    pthread_t workers[PIPELINE_WORKERS];
+    int worker_count = 0;
+    for (int i = 0; i < PIPELINE_WORKERS; i++)
+    {
+        if (pthread_create(&workers[worker_count], NULL, pipeline_worker, &conn) == 0)
+        {
+            worker_count++;
+        }
+    }
+    if (worker_count == 0)
+    {
+        perror("pipeline: pthread_create");
+        session_remove(conn.user.userId);
+        goto cleanup;
+    }
+
+    // --- Reader loop ---
+    Connection *current = connection_current();
+    const char *peer = current != NULL ? current->peer : "local";
+    int quit = 0;
+    while ((len = read_line(&reader, line, sizeof(line))) != -1)
+    {
+        if (len == 0)
+            continue;
+        if (len >= (int)sizeof(line))
+        {
+            // Never run a cut-off request (a BATCH would silently lose legs). Its id may be
+            // anything up to the whole line, so it is not echoed.
+            reply(&conn, "?", "ERR", "Request longer than %d bytes", PIPELINE_MAX_LINE - 1);
+            continue;
+        }
+
+        if (id_too_long(line))
+        {
+            reply(&conn, "?", "ERR", "Request id longer than %d bytes", PIPELINE_MAX_ID);
+            continue;
+        }
+
+        // QUIT is answered by the reader once everything before it has replied
+        char *space = strchr(line, ' ');
+        if (space != NULL && my_strcmp(space + 1, "QUIT") == 0)
+        {
+            pthread_mutex_lock(&conn.queue_mutex);
+            while (conn.inflight > 0)
+            {
+                pthread_cond_wait(&conn.space_cond, &conn.queue_mutex);
+            }
+            pthread_mutex_unlock(&conn.queue_mutex);
+            *space = '\0';
+            reply(&conn, line, "OK", "BYE");
+            quit = 1;
+            break;
+        }
+
+        // Over a limit: answered by the reader, never queued for a worker
+        RateResult limited = rate_limit_request(conn.user.userId, peer);
+        if (limited != RATE_OK)
+        {
+            if (space != NULL)
+                *space = '\0';
+            reply(&conn, line, "ERR", "Rate limited (%s)", rate_limit_str(limited));
+            continue;
+        }
+
+        PipelineRequest *request = malloc(sizeof(PipelineRequest) + len + 1);
+        if (request == NULL)
+        {
+            perror("pipeline: malloc");
+            break;
+        }
+        memcpy(request->line, line, len + 1);
+        request->next = NULL;
+
+        pthread_mutex_lock(&conn.queue_mutex);
+        while (conn.inflight >= PIPELINE_MAX_INFLIGHT)
+        {
+            pthread_cond_wait(&conn.space_cond, &conn.queue_mutex);
+        }
+        if (conn.tail == NULL)
+            conn.head = request;
+        else
+            conn.tail->next = request;
+        conn.tail = request;
+        conn.inflight++;
+        pthread_cond_signal(&conn.queue_cond);
+        pthread_mutex_unlock(&conn.queue_mutex);
+    }
+
+    // --- Shutdown: workers finish whatever is still queued, then exit ---
+    pthread_mutex_lock(&conn.queue_mutex);
+    conn.closing = 1;
+    pthread_cond_broadcast(&conn.queue_cond);
+    pthread_mutex_unlock(&conn.queue_mutex);
+    for (int i = 0; i < worker_count; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    session_remove(conn.user.userId);
+
+    // QUIT ends the session for good; a dropped connection may still RESUME
+    if (quit)
+        token_revoke(conn.token);
+    else
+        token_touch(conn.token);
+
+cleanup:
+    pthread_cond_destroy(&conn.space_cond);
+    pthread_cond_destroy(&conn.queue_cond);
+    pthread_mutex_destroy(&conn.queue_mutex);
+    pthread_mutex_destroy(&conn.write_mutex);
+}
@@ -0,0 +1,315 @@
+// src/rate_limit.c
+#include "rate_limit.h"  // Limits, result codes and prototypes
+#include "connection.h"  // For the current connection's peer address
+#include "timer_wheel.h" // For the sweep timer
+#include <pthread.h>     // For stripe mutexes and the config lock
+#include <stdatomic.h>   // For rejection counters
+#include <stdint.h>      // For uint64_t
+#include <stdio.h>       // For snprintf
+
+/*
+--- Buckets ---
+
+-> All per-key buckets live in one hash table. The key packs the kind into its top bits, so user
+   17's request bucket and user 17's login bucket are different entries. Addresses are hashed
+   (FNV-1a, 64 bit) into the key; a collision would only make two addresses share a bucket.
+-> Tokens are refilled lazily: a bucket remembers when it was last charged and adds
+   rate * elapsed on the next charge. No timer per bucket.
+-> The sweep frees buckets that have refilled completely. Such a bucket behaves exactly like a
+   new one, so freeing it changes nothing except memory use.
+*/
+
+typedef struct
+{
+    double rate;  // Tokens per second (0: unlimited)
+    double burst; // Bucket capacity
+} RateLimit;
+
+typedef struct RateBucket
+{
+    uint64_t key;
+    double tokens;
+    uint64_t last_us;
+    struct RateBucket *next;
+} RateBucket;
+
+static const char *kind_names[RATE_KINDS] = {"", "user", "address", "global", "login"};
+
+static RateLimit limits[RATE_KINDS] = {{0, 0}, {RATE_USER_DEFAULT}, {RATE_ADDRESS_DEFAULT}, {RATE_GLOBAL_DEFAULT}, {RATE_LOGIN_DEFAULT}};
+static pthread_rwlock_t limits_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static RateBucket *buckets[RATE_BUCKETS];
+static pthread_mutex_t stripes[RATE_LOCK_STRIPES];
+static pthread_once_t stripes_once = PTHREAD_ONCE_INIT;
+static RateBucket global_bucket; // key unused
+static pthread_mutex_t global_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static atomic_ulong rejected[RATE_KINDS];
+static TimerEntry sweep_timer;
+
+static void init_stripes()
+{
+    for (int i = 0; i < RATE_LOCK_STRIPES; i++)
+        pthread_mutex_init(&stripes[i], NULL);
+}
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static uint64_t make_key(RateResult kind, uint64_t id)
+{
+    return (uint64_t)kind << 60 | (id & 0x0fffffffffffffffULL);
+}
+
+static uint64_t address_key(const char *address)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (; *address != '\0'; address++)
+        hash = (hash ^ (unsigned char)*address) * 1099511628211ULL;
+    return make_key(RATE_ADDRESS, hash);
+}
+
+// Refills bucket for the time since its last charge (caller holds its lock)
+static void refill(RateBucket *bucket, RateLimit limit, uint64_t now)
+{
+    bucket->tokens += limit.rate * (double)(now - bucket->last_us) / 1e6;
+    if (bucket->tokens > limit.burst)
+        bucket->tokens = limit.burst;
+    bucket->last_us = now;
+}
+
+// Takes (delta -1) or returns (delta +1) a token from the bucket of key. Returns 0 if granted.
+static int charge(uint64_t key, RateLimit limit, int delta, uint64_t now)
+{
+    if (limit.rate <= 0)
+        return 0;
+
+    if (key == 0)
+    {
+        pthread_mutex_lock(&global_mutex);
+        refill(&global_bucket, limit, now);
+        int ok = (delta > 0 || global_bucket.tokens >= 1.0);
+        if (ok)
+            global_bucket.tokens += delta;
+        pthread_mutex_unlock(&global_mutex);
+        return ok ? 0 : -1;
+    }
+
+    pthread_once(&stripes_once, init_stripes);
+    unsigned int index = (unsigned int)((key * 11400714819323198485ULL) >> 52) % RATE_BUCKETS;
+    pthread_mutex_t *stripe = &stripes[index % RATE_LOCK_STRIPES];
+    pthread_mutex_lock(stripe);
+
+    RateBucket *bucket = buckets[index];
+    while (bucket != NULL && bucket->key != key)
+        bucket = bucket->next;
+    if (bucket == NULL)
+    {
+        bucket = malloc(sizeof(RateBucket));
+        if (bucket == NULL)
+        {
+            pthread_mutex_unlock(stripe);
+            return 0; // Out of memory: fail open rather than lock everybody out
+        }
+        bucket->key = key;
+        bucket->tokens = limit.burst;
+        bucket->last_us = now;
+        bucket->next = buckets[index];
+        buckets[index] = bucket;
+    }
+
+    refill(bucket, limit, now);
+    int ok = (delta > 0 || bucket->tokens >= 1.0);
+    if (ok)
+        bucket->tokens += delta;
+    pthread_mutex_unlock(stripe);
+    return ok ? 0 : -1;
+}
+
+// Charges keys[0..count) in order. If one is empty, the ones already charged get their token back.
+static RateResult charge_all(const uint64_t *keys, const RateResult *kinds, int count)
+{
+    uint64_t now = now_us();
+    RateLimit snapshot[RATE_KINDS];
+    pthread_rwlock_rdlock(&limits_lock);
+    memcpy(snapshot, limits, sizeof(snapshot));
+    pthread_rwlock_unlock(&limits_lock);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (charge(keys[i], snapshot[kinds[i]], -1, now) == -1)
+        {
+            for (int j = 0; j < i; j++)
+                charge(keys[j], snapshot[kinds[j]], +1, now);
+            atomic_fetch_add_explicit(&rejected[kinds[i]], 1, memory_order_relaxed);
+            return kinds[i];
+        }
+    }
+    return RATE_OK;
+}
+
+RateResult rate_limit_request(int userId, const char *address)
+{
+    // Most specific first: a single noisy user is stopped before it drains the shared buckets
+    uint64_t keys[3] = {make_key(RATE_USER, (uint64_t)(unsigned int)userId), address_key(address), 0};
+    RateResult kinds[3] = {RATE_USER, RATE_ADDRESS, RATE_GLOBAL};
+    return charge_all(keys, kinds, 3);
+}
+
+RateResult rate_limit_login(int userId, const char *address)
+{
+    uint64_t keys[3] = {make_key(RATE_LOGIN, (uint64_t)(unsigned int)userId), address_key(address), 0};
+    RateResult kinds[3] = {RATE_LOGIN, RATE_ADDRESS, RATE_GLOBAL};
+    return charge_all(keys, kinds, 3);
+}
+
+int read_menu_choice(int client_socket, char *buffer, int size, int userId)
+{
+    Connection *conn = connection_current();
+    while (1)
+    {
+        if (read_client_input(client_socket, buffer, size) == -1)
+            return -1;
+        RateResult result = rate_limit_request(userId, conn != NULL ? conn->peer : "local");
+        if (result == RATE_OK)
+            return 0;
+
+        char message[128];
+        snprintf(message, sizeof(message), "Too many requests (%s). Slow down and enter your choice again: ",
+                 rate_limit_str(result));
+        write_string(client_socket, message);
+    }
+}
+
+const char *rate_limit_str(RateResult result)
+{
+    switch (result)
+    {
+    case RATE_USER:
+        return "per-user limit";
+    case RATE_ADDRESS:
+        return "per-address limit";
+    case RATE_GLOBAL:
+        return "server limit";
+    case RATE_LOGIN:
+        return "too many login attempts";
+    default:
+        return "ok";
+    }
+}
+
+int rate_limit_load(const char *path)
+{
+    RateLimit loaded[RATE_KINDS] = {{0, 0}, {RATE_USER_DEFAULT}, {RATE_ADDRESS_DEFAULT}, {RATE_GLOBAL_DEFAULT}, {RATE_LOGIN_DEFAULT}};
+
+    int fd = open(path, O_RDONLY);
+    if (fd != -1)
+    {
+        char text[4096];
+        ssize_t n = read(fd, text, sizeof(text) - 1);
+        close(fd);
+        text[n > 0 ? n : 0] = '\0';
+
+        int line_no = 0;
+        for (char *line = text, *end; line != NULL; line = end)
+        {
+            end = strchr(line, '\n');
+            if (end != NULL)
+                *end++ = '\0';
+            line_no++;
+            char name[16];
+            double rate, burst;
+            char *comment = strchr(line, '#');
+            if (comment != NULL)
+                *comment = '\0';
+            int fields = sscanf(line, "%15s %lf %lf", name, &rate, &burst);
+            if (fields <= 0)
+                continue; // Blank or comment
+
+            int kind = RATE_USER;
+            while (kind < RATE_KINDS && strcmp(kind_names[kind], name) != 0)
+                kind++;
+            if (fields != 3 || kind == RATE_KINDS || rate < 0 || burst < 1)
+            {
+                char message[128];
+                snprintf(message, sizeof(message), "%s:%d: expected 'user|address|global|login <rate> <burst>'\n",
+                         path, line_no);
+                write_string(STDOUT_FILENO, message);
+                return -1;
+            }
+            loaded[kind].rate = rate;
+            loaded[kind].burst = burst;
+        }
+    }
+
+    pthread_rwlock_wrlock(&limits_lock);
+    memcpy(limits, loaded, sizeof(limits));
+    pthread_rwlock_unlock(&limits_lock);
+    return 0;
+}
+
+// Timer callback: frees buckets that have refilled completely, then re-arms itself
+static void sweep(void *arg)
+{
+    (void)arg;
+    RateLimit snapshot[RATE_KINDS];
+    pthread_rwlock_rdlock(&limits_lock);
+    memcpy(snapshot, limits, sizeof(snapshot));
+    pthread_rwlock_unlock(&limits_lock);
+
+    pthread_once(&stripes_once, init_stripes);
+    uint64_t now = now_us();
+    for (unsigned int index = 0; index < RATE_BUCKETS; index++)
+    {
+        pthread_mutex_t *stripe = &stripes[index % RATE_LOCK_STRIPES];
+        pthread_mutex_lock(stripe);
+        RateBucket **link = &buckets[index];
+        while (*link != NULL)
+        {
+            RateBucket *bucket = *link;
+            RateLimit limit = snapshot[bucket->key >> 60];
+            refill(bucket, limit, now);
+            if (limit.rate <= 0 || bucket->tokens >= limit.burst)
+            {
+                *link = bucket->next;
+                free(bucket);
+            }
+            else
+            {
+                link = &bucket->next;
+            }
+        }
+        pthread_mutex_unlock(stripe);
+    }
+    timer_arm(&sweep_timer, RATE_SWEEP_SECONDS * 1000, sweep, NULL);
+}
+
+void rate_limit_start()
+{
+    if (rate_limit_load(RATE_LIMIT_CONFIG) == -1)
+        write_string(STDOUT_FILENO, "Rate limits: config has errors, using the built-in defaults.\n");
+    global_bucket.tokens = limits[RATE_GLOBAL].burst;
+    global_bucket.last_us = now_us();
+    timer_arm(&sweep_timer, RATE_SWEEP_SECONDS * 1000, sweep, NULL);
+}
+
+void rate_limit_report(int fd)
+{
+    char buffer[160];
+    write_string(fd, "--- Rate Limits (rate/s, burst, rejected) ---\n");
+    pthread_rwlock_rdlock(&limits_lock);
+    for (int kind = RATE_USER; kind < RATE_KINDS; kind++)
+    {
+        if (limits[kind].rate > 0)
+            snprintf(buffer, sizeof(buffer), "%-8s %8.1f %8.0f %10lu\n", kind_names[kind], limits[kind].rate,
+                     limits[kind].burst, atomic_load(&rejected[kind]));
+        else
+            snprintf(buffer, sizeof(buffer), "%-8s unlimited\n", kind_names[kind]);
+        write_string(fd, buffer);
+    }
+    pthread_rwlock_unlock(&limits_lock);
+}
@@ -0,0 +1,637 @@
+// src/scheduler.c
+#define _GNU_SOURCE // For F_OFD_SETLK (open file description locks)
+#include "scheduler.h"   // Standing instruction API
+#include "data_access.h" // For set_record_lock, set_file_lock, getAccount, getAccountsByNumbers
+#include "io_backend.h"  // For io_open, io_pread, io_pwrite, io_fsync, io_write_fsync
+#include "metrics.h"     // For metrics_header, metrics_value
+#include "stats.h"       // For STATS_TIME
+#include <pthread.h>     // For the scheduler thread
+#include <stdatomic.h>   // For the outcome counters
+#include <stdio.h>       // For snprintf, perror
+#include <stdlib.h>      // For qsort, realloc
+#include <sys/stat.h>    // For fstat (records appended since the last look)
+
+typedef struct
+{
+    time_t when;
+    int record_num;
+} HeapEntry;
+
+typedef struct
+{
+    int record_num;
+    StandingInstruction instruction; // As claimed
+    int receiverAccountId;           // -1: no such account number
+    LedgerResult result;
+    int interrupted; // Found RUNNING at takeover, not paid again
+} DueRun;
+
+// Only the scheduler thread touches the heap, the batch and the log buffer
+static HeapEntry *heap = NULL;
+static int heap_count = 0, heap_capacity = 0;
+static int known_records = 0; // Records of INSTRUCTION_FILE already in the heap (or finished)
+static DueRun runs[SCHEDULER_BATCH];
+static char log_lines[SCHEDULER_BATCH * 256];
+
+// fcntl record locks belong to the process and any close() of the file drops all of them, so
+// every open/close of INSTRUCTION_FILE in this process happens under records_mutex
+static pthread_mutex_t records_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t wake_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond; // CLOCK_MONOTONIC, set up by scheduler_start
+static int wake_pending = 0, stopping = 0;
+static pthread_t thread_id;
+static int started = 0;
+static int lock_fd = -1;
+static atomic_int owner;
+static atomic_int queued;
+static atomic_ulong batches, paid, failed, retried, given_up, interrupted;
+
+static void heap_push(time_t when, int record_num)
+{
+    if (heap_count == heap_capacity)
+    {
+        int capacity = heap_capacity > 0 ? heap_capacity * 2 : 256;
+        HeapEntry *grown = realloc(heap, sizeof(HeapEntry) * (size_t)capacity);
+        if (grown == NULL)
+            return; // The record is still ACTIVE: the next takeover finds it
+        heap = grown;
+        heap_capacity = capacity;
+    }
+    int i = heap_count++;
+    while (i > 0 && heap[(i - 1) / 2].when > when)
+    {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i].when = when;
+    heap[i].record_num = record_num;
+}
+
+static HeapEntry heap_pop()
+{
+    HeapEntry top = heap[0];
+    HeapEntry last = heap[--heap_count];
+    int i = 0;
+    while (2 * i + 1 < heap_count)
+    {
+        int child = 2 * i + 1;
+        if (child + 1 < heap_count && heap[child + 1].when < heap[child].when)
+            child++;
+        if (heap[child].when >= last.when)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+const char *instruction_status_str(InstructionStatus status)
+{
+    switch (status)
+    {
+    case INSTRUCTION_ACTIVE:
+        return "Active";
+    case INSTRUCTION_RUNNING:
+        return "Running";
+    case INSTRUCTION_DONE:
+        return "Done";
+    case INSTRUCTION_CANCELLED:
+        return "Cancelled";
+    case INSTRUCTION_FAILED:
+        return "Failed";
+    }
+    return "Unknown";
+}
+
+const char *instruction_result_str(int lastResult)
+{
+    if (lastResult == INSTRUCTION_NOT_RUN)
+        return "not run yet";
+    if (lastResult == INSTRUCTION_INTERRUPTED)
+        return "interrupted by a restart (not retried)";
+    return ledger_result_str((LedgerResult)lastResult);
+}
+
+// --- Outcome of one run ---
+
+// The run is over (paid, given up or interrupted): schedule the next one or finish
+static void finish_run(StandingInstruction *ins, time_t now, int was_paid)
+{
+    ins->failures = 0;
+    if (ins->intervalSeconds == 0)
+    {
+        ins->status = was_paid ? INSTRUCTION_DONE : INSTRUCTION_FAILED;
+        return;
+    }
+    if (ins->remainingRuns > 0 && --ins->remainingRuns == 0)
+    {
+        ins->status = INSTRUCTION_DONE;
+        return;
+    }
+    // Runs missed while no server was up are skipped, not paid one after another
+    time_t next = ins->dueTime + ins->intervalSeconds;
+    if (next <= now)
+        next += ((now - next) / ins->intervalSeconds + 1) * ins->intervalSeconds;
+    ins->dueTime = next;
+    ins->nextAttempt = next;
+    ins->status = INSTRUCTION_ACTIVE;
+}
+
+// Applies run's outcome to the record. Returns the action for the run log.
+static const char *apply_outcome(StandingInstruction *ins, const DueRun *run, time_t now)
+{
+    const char *action;
+    ins->lastAttempt = now;
+    if (run->interrupted)
+    {
+        ins->lastResult = INSTRUCTION_INTERRUPTED;
+        finish_run(ins, now, 1);
+        action = "skipped";
+        atomic_fetch_add_explicit(&interrupted, 1, memory_order_relaxed);
+    }
+    else if (run->result == LEDGER_OK || run->result == LEDGER_LOG_FAILED) // The money moved either way
+    {
+        ins->lastResult = run->result;
+        ins->totalRuns++;
+        finish_run(ins, now, 1);
+        action = "paid";
+        atomic_fetch_add_explicit(&paid, 1, memory_order_relaxed);
+    }
+    else
+    {
+        ins->lastResult = run->result;
+        ins->totalFailures++;
+        ins->failures++;
+        atomic_fetch_add_explicit(&failed, 1, memory_order_relaxed);
+        time_t retry = now + ((time_t)INSTRUCTION_RETRY_SECONDS << (ins->failures - 1));
+        if (run->result == LEDGER_SAME_ACCOUNT) // Never going to work
+        {
+            ins->status = INSTRUCTION_FAILED;
+            action = "stopped";
+        }
+        else if (ins->failures <= INSTRUCTION_MAX_RETRIES &&
+                 (ins->intervalSeconds == 0 || retry < ins->dueTime + ins->intervalSeconds))
+        {
+            ins->nextAttempt = retry;
+            ins->status = INSTRUCTION_ACTIVE;
+            action = "retry";
+            atomic_fetch_add_explicit(&retried, 1, memory_order_relaxed);
+        }
+        else
+        {
+            finish_run(ins, now, 0);
+            action = "given up";
+            atomic_fetch_add_explicit(&given_up, 1, memory_order_relaxed);
+        }
+    }
+    return action;
+}
+
+// --- Loading (takeover, new records) ---
+
+// Pushes the records appended since the last call. At takeover (known_records 0) a record still
+// RUNNING lost its outcome to a crash: it becomes a run to record, not to pay.
+static int load_records(int fd, int takeover)
+{
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+        return 0;
+    int records = (int)(st.st_size / (off_t)sizeof(StandingInstruction));
+    int found = 0;
+    StandingInstruction ins;
+    for (int r = known_records; r < records; r++)
+    {
+        if (io_pread(fd, &ins, sizeof(ins), (off_t)r * sizeof(ins)) != sizeof(ins))
+            break;
+        known_records = r + 1;
+        if (ins.status == INSTRUCTION_ACTIVE)
+            heap_push(ins.nextAttempt, r);
+        else if (takeover && ins.status == INSTRUCTION_RUNNING && found < SCHEDULER_BATCH)
+        {
+            runs[found].record_num = r;
+            runs[found].instruction = ins;
+            runs[found].interrupted = 1;
+            found++;
+        }
+    }
+    atomic_store(&queued, heap_count);
+    return found;
+}
+
+// --- The batch ---
+
+static int compare_runs(const void *a, const void *b)
+{
+    const DueRun *x = (const DueRun *)a, *y = (const DueRun *)b;
+    if (x->instruction.fromAccountId != y->instruction.fromAccountId)
+        return x->instruction.fromAccountId < y->instruction.fromAccountId ? -1 : 1;
+    return x->record_num - y->record_num;
+}
+
+// 1. Claim: due ACTIVE records become RUNNING (one fsync). Returns the number claimed.
+static int claim_due(int fd, time_t now)
+{
+    int count = 0;
+    while (heap_count > 0 && heap[0].when <= now && count < SCHEDULER_BATCH)
+    {
+        HeapEntry entry = heap_pop();
+        StandingInstruction ins;
+        set_record_lock(fd, entry.record_num, sizeof(ins), F_WRLCK);
+        off_t offset = (off_t)entry.record_num * sizeof(ins);
+        if (io_pread(fd, &ins, sizeof(ins), offset) == sizeof(ins) && ins.status == INSTRUCTION_ACTIVE)
+        {
+            if (ins.nextAttempt > now) // An old heap entry: the record has moved on
+                heap_push(ins.nextAttempt, entry.record_num);
+            else
+            {
+                ins.status = INSTRUCTION_RUNNING;
+                if (io_pwrite(fd, &ins, sizeof(ins), offset) == sizeof(ins))
+                {
+                    runs[count].record_num = entry.record_num;
+                    runs[count].instruction = ins;
+                    runs[count].interrupted = 0;
+                    count++;
+                }
+                else
+                    heap_push(now + INSTRUCTION_RETRY_SECONDS, entry.record_num);
+            }
+        }
+        set_record_lock(fd, entry.record_num, sizeof(ins), F_UNLCK);
+    }
+    if (count > 0 && io_fsync(fd) == -1)
+        perror("scheduler: fsync claim");
+    return count;
+}
+
+// 2. Pay: one batch transfer per paying account, single transfers if a leg is refused (not on a
+//    write failure: every leg records that)
+static void pay_runs(int count)
+{
+    static char numbers[SCHEDULER_BATCH][20];
+    static Account receivers[SCHEDULER_BATCH];
+    static int record_nums[SCHEDULER_BATCH];
+    static LedgerLeg legs[SCHEDULER_BATCH];
+
+    qsort(runs, count, sizeof(DueRun), compare_runs);
+    for (int i = 0; i < count; i++)
+        memcpy(numbers[i], runs[i].instruction.toAccountNumber, 20);
+    getAccountsByNumbers(numbers, count, receivers, record_nums);
+    for (int i = 0; i < count; i++)
+        runs[i].receiverAccountId = record_nums[i] == -1 ? -1 : receivers[i].accountId;
+
+    int first = 0;
+    while (first < count)
+    {
+        int from = runs[first].instruction.fromAccountId;
+        int end = first + 1;
+        while (end < count && runs[end].instruction.fromAccountId == from)
+            end++;
+
+        Account sender, receiver;
+        int failed_leg;
+        LedgerResult result = LEDGER_BAD_BATCH;
+        if (end - first > 1)
+        {
+            for (int i = first; i < end; i++)
+            {
+                memcpy(legs[i - first].accountNumber, runs[i].instruction.toAccountNumber, 20);
+                legs[i - first].amount = runs[i].instruction.amount;
+            }
+            result = ledger_transfer_batch(from, legs, end - first, &sender, &failed_leg);
+        }
+        for (int i = first; i < end; i++)
+        {
+            if (result == LEDGER_OK || result == LEDGER_LOG_FAILED || result == LEDGER_WRITE_FAILED)
+                runs[i].result = result; // Paid, or the disk failed: retrying leg by leg would not help
+            else if (runs[i].receiverAccountId == -1)
+                runs[i].result = LEDGER_NOT_FOUND;
+            else
+                runs[i].result = ledger_transfer(from, runs[i].receiverAccountId, runs[i].instruction.amount, &sender,
+                                                 &receiver);
+        }
+        first = end;
+    }
+}
+
+static int format_log_line(char *line, size_t size, const StandingInstruction *ins, const DueRun *run,
+                           const char *action, time_t now)
+{
+    char stamp[32], due[32];
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    gmtime_r(&run->instruction.dueTime, &utc);
+    strftime(due, sizeof(due), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    int n = snprintf(line, size,
+                     "%s instruction=%d user=%d from=%s to=%s amount=%.2f due=%s attempt=%d result=\"%s\" "
+                     "action=\"%s\"\n",
+                     stamp, ins->instructionId, ins->ownerUserId, ins->fromAccountNumber, ins->toAccountNumber,
+                     ins->amount, due, run->instruction.failures + 1,
+                     instruction_result_str(run->interrupted ? INSTRUCTION_INTERRUPTED : (int)run->result), action);
+    return n < (int)size ? n : (int)size - 1;
+}
+
+// 3. Record: outcome and next run in every record (one fsync), one run log line each (one write)
+static void record_runs(int fd, int count, time_t now)
+{
+    size_t used = 0;
+    pthread_mutex_lock(&records_mutex);
+    for (int i = 0; i < count; i++)
+    {
+        StandingInstruction ins;
+        off_t offset = (off_t)runs[i].record_num * sizeof(ins);
+        set_record_lock(fd, runs[i].record_num, sizeof(ins), F_WRLCK);
+        if (io_pread(fd, &ins, sizeof(ins), offset) != sizeof(ins))
+            ins = runs[i].instruction;
+        int cancelled = ins.status == INSTRUCTION_CANCELLED; // While it was being paid
+        const char *action = apply_outcome(&ins, &runs[i], now);
+        if (cancelled)
+            ins.status = INSTRUCTION_CANCELLED;
+        if (io_pwrite(fd, &ins, sizeof(ins), offset) != sizeof(ins))
+            perror("scheduler: record run");
+        set_record_lock(fd, runs[i].record_num, sizeof(ins), F_UNLCK);
+        if (ins.status == INSTRUCTION_ACTIVE)
+            heap_push(ins.nextAttempt, runs[i].record_num);
+        used += (size_t)format_log_line(log_lines + used, sizeof(log_lines) - used, &ins, &runs[i], action, now);
+    }
+    if (io_fsync(fd) == -1)
+        perror("scheduler: fsync outcome");
+    pthread_mutex_unlock(&records_mutex);
+    atomic_store(&queued, heap_count);
+
+    int log_fd = io_open(SCHEDULER_LOG_FILE, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (log_fd == -1 || io_write_fsync(log_fd, log_lines, used, -1) != (ssize_t)used)
+        perror("scheduler: run log");
+    if (log_fd != -1)
+        close(log_fd);
+}
+
+static void run_batch(int fd, time_t now)
+{
+    pthread_mutex_lock(&records_mutex);
+    int count = claim_due(fd, now);
+    pthread_mutex_unlock(&records_mutex);
+    if (count == 0)
+        return;
+    pay_runs(count); // Without records_mutex: a customer can list or cancel meanwhile
+    record_runs(fd, count, now);
+    atomic_fetch_add_explicit(&batches, 1, memory_order_relaxed);
+}
+
+// --- Thread ---
+
+static int take_ownership()
+{
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_len = 1;
+    return fcntl(lock_fd, F_OFD_SETLK, &lock) == 0; // Never waits: the other process may run for hours
+}
+
+static void *scheduler_thread(void *arg)
+{
+    (void)arg;
+    int fd = -1;
+    while (1)
+    {
+        pthread_mutex_lock(&wake_mutex);
+        int stop = stopping;
+        pthread_mutex_unlock(&wake_mutex);
+        if (stop)
+            break;
+
+        if (!atomic_load(&owner) && lock_fd != -1 && take_ownership())
+        {
+            pthread_mutex_lock(&records_mutex);
+            fd = io_open(INSTRUCTION_FILE, O_RDWR | O_CREAT, 0644);
+            heap_count = 0;
+            known_records = 0;
+            int cut_off = fd == -1 ? 0 : load_records(fd, 1);
+            pthread_mutex_unlock(&records_mutex);
+            if (fd == -1)
+                perror("scheduler: open");
+            else
+            {
+                atomic_store(&owner, 1);
+                if (cut_off > 0)
+                    record_runs(fd, cut_off, time(NULL));
+            }
+        }
+
+        time_t now = time(NULL);
+        if (atomic_load(&owner))
+        {
+            pthread_mutex_lock(&records_mutex);
+            load_records(fd, 0); // Appended by a session of this or another process
+            pthread_mutex_unlock(&records_mutex);
+            if (heap_count > 0 && heap[0].when <= now)
+            {
+                STATS_TIME(STAT_SCHEDULER_BATCH, run_batch(fd, now));
+                now = time(NULL);
+            }
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        long wait_ms = SCHEDULER_POLL_MS;
+        if (atomic_load(&owner) && heap_count > 0 && (heap[0].when - now) * 1000 < wait_ms)
+            wait_ms = heap[0].when <= now ? 0 : (long)(heap[0].when - now) * 1000;
+        deadline.tv_sec += wait_ms / 1000;
+        deadline.tv_nsec += (wait_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_mutex_lock(&wake_mutex);
+        while (!wake_pending && !stopping)
+        {
+            if (pthread_cond_timedwait(&wake_cond, &wake_mutex, &deadline) == ETIMEDOUT)
+                break;
+        }
+        wake_pending = 0;
+        pthread_mutex_unlock(&wake_mutex);
+    }
+    if (fd != -1)
+    {
+        pthread_mutex_lock(&records_mutex);
+        close(fd);
+        pthread_mutex_unlock(&records_mutex);
+    }
+    return NULL;
+}
+
+static void wake_scheduler()
+{
+    pthread_mutex_lock(&wake_mutex);
+    wake_pending = 1;
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_mutex);
+}
+
+void scheduler_start()
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC); // Wall clock jumps do not stretch the sleep
+    pthread_cond_init(&wake_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    lock_fd = open(SCHEDULER_LOCK_FILE, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lock_fd == -1)
+    {
+        perror("scheduler: open lock file");
+        return;
+    }
+    if (pthread_create(&thread_id, NULL, scheduler_thread, NULL) != 0)
+    {
+        perror("scheduler: pthread_create");
+        close(lock_fd);
+        lock_fd = -1;
+        return;
+    }
+    started = 1;
+}
+
+void scheduler_stop()
+{
+    if (!started)
+        return;
+    pthread_mutex_lock(&wake_mutex);
+    stopping = 1;
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_mutex);
+    pthread_join(thread_id, NULL); // Its batch is recorded before it returns
+    started = 0;
+    atomic_store(&owner, 0);
+    close(lock_fd); // Drops the OFD lock: the next server takes over
+    lock_fd = -1;
+}
+
+// --- Customer side ---
+
+LedgerResult scheduler_add(StandingInstruction *ins)
+{
+    if (!(ins->amount > 0 && ins->amount <= INSTRUCTION_MAX_AMOUNT))
+        return LEDGER_BAD_AMOUNT;
+    Account from = getAccount(ins->fromAccountId);
+    if (from.accountId == -1 || from.ownerUserId != ins->ownerUserId)
+        return LEDGER_NOT_FOUND;
+    Account to = getAccountByNum(ins->toAccountNumber);
+    if (to.accountId == -1)
+        return LEDGER_NOT_FOUND;
+    if (!from.isActive || !to.isActive)
+        return LEDGER_INACTIVE;
+    if (to.accountId == from.accountId)
+        return LEDGER_SAME_ACCOUNT;
+
+    strcpy(ins->fromAccountNumber, from.accountNumber);
+    ins->status = INSTRUCTION_ACTIVE;
+    ins->failures = 0;
+    ins->lastResult = INSTRUCTION_NOT_RUN;
+    ins->nextAttempt = ins->dueTime;
+    ins->lastAttempt = 0;
+    ins->totalRuns = 0;
+    ins->totalFailures = 0;
+
+    LedgerResult result = LEDGER_WRITE_FAILED;
+    pthread_mutex_lock(&records_mutex);
+    int fd = io_open(INSTRUCTION_FILE, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (fd != -1)
+    {
+        set_file_lock(fd, F_WRLCK); // Id and position are decided together
+        off_t size = lseek(fd, 0, SEEK_END);
+        ins->instructionId = (int)(size / (off_t)sizeof(StandingInstruction)) + 1;
+        if (io_write_fsync(fd, ins, sizeof(*ins), -1) == sizeof(*ins))
+            result = LEDGER_OK;
+        set_file_lock(fd, F_UNLCK);
+        close(fd);
+    }
+    pthread_mutex_unlock(&records_mutex);
+    if (result == LEDGER_OK)
+        wake_scheduler();
+    return result;
+}
+
+int scheduler_list(int ownerUserId, StandingInstruction *list, int max)
+{
+    int count = 0;
+    pthread_mutex_lock(&records_mutex);
+    int fd = io_open(INSTRUCTION_FILE, O_RDONLY, 0);
+    if (fd != -1)
+    {
+        StandingInstruction ins;
+        set_file_lock(fd, F_RDLCK);
+        while (io_read(fd, &ins, sizeof(ins)) == sizeof(ins))
+        {
+            if (ins.ownerUserId != ownerUserId || ins.status == INSTRUCTION_CANCELLED)
+                continue;
+            if (count == max) // Keep the newest
+            {
+                memmove(list, list + 1, sizeof(StandingInstruction) * (size_t)(max - 1));
+                count--;
+            }
+            list[count++] = ins;
+        }
+        set_file_lock(fd, F_UNLCK);
+        close(fd);
+    }
+    pthread_mutex_unlock(&records_mutex);
+    return count;
+}
+
+int scheduler_cancel(int ownerUserId, int instructionId)
+{
+    int result = -1;
+    if (instructionId < 1)
+        return -1;
+    pthread_mutex_lock(&records_mutex);
+    int fd = io_open(INSTRUCTION_FILE, O_RDWR, 0);
+    if (fd != -1)
+    {
+        StandingInstruction ins;
+        int record_num = instructionId - 1;
+        off_t offset = (off_t)record_num * sizeof(ins);
+        set_record_lock(fd, record_num, sizeof(ins), F_WRLCK);
+        if (io_pread(fd, &ins, sizeof(ins), offset) == sizeof(ins) && ins.ownerUserId == ownerUserId &&
+            (ins.status == INSTRUCTION_ACTIVE || ins.status == INSTRUCTION_RUNNING))
+        {
+            ins.status = INSTRUCTION_CANCELLED; // A run being paid right now still completes
+            if (io_write_fsync(fd, &ins, sizeof(ins), offset) == sizeof(ins))
+                result = 0;
+        }
+        set_record_lock(fd, record_num, sizeof(ins), F_UNLCK);
+        close(fd);
+    }
+    pthread_mutex_unlock(&records_mutex);
+    return result;
+}
+
+// --- Reports ---
+
+void scheduler_report(int fd)
+{
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "Scheduler: %s, %d queued, %lu batch(es), %lu paid, %lu failed (%lu retried, %lu given up), "
+             "%lu interrupted\n",
+             atomic_load(&owner) ? "running here" : "standby (another server schedules)", atomic_load(&queued),
+             atomic_load(&batches), atomic_load(&paid), atomic_load(&failed), atomic_load(&retried),
+             atomic_load(&given_up), atomic_load(&interrupted));
+    write_string(fd, buffer);
+}
+
+void scheduler_metrics(int fd)
+{
+    metrics_header(fd, "bank_scheduler_owner", "gauge", "1 if this server runs the standing instructions");
+    metrics_value(fd, "bank_scheduler_owner", NULL, atomic_load(&owner));
+    metrics_header(fd, "bank_scheduler_queued", "gauge", "Active standing instructions waiting for their run");
+    metrics_value(fd, "bank_scheduler_queued", NULL, atomic_load(&queued));
+    metrics_header(fd, "bank_scheduler_runs_total", "counter", "Standing instruction runs by outcome");
+    metrics_value(fd, "bank_scheduler_runs_total", "outcome=\"paid\"", (double)atomic_load(&paid));
+    metrics_value(fd, "bank_scheduler_runs_total", "outcome=\"failed\"", (double)atomic_load(&failed));
+    metrics_value(fd, "bank_scheduler_runs_total", "outcome=\"interrupted\"", (double)atomic_load(&interrupted));
+}
@@ -5,23 +5,92 @@
 #include "employee.h"    // For employee_menu
 #include "manager.h"     // For manager_menu
 #include "admin.h"       // For admin_menu
+#include "pipeline.h"    // For pipeline_session
+#include "session.h"     // For session_add, session_remove
+#include "session_token.h" // For token_issue, token_resume
+#include "listener.h"    // For listener_open, listener_run
+#include "connection.h"  // For idle/login deadlines
+#include "io_backend.h"  // For io_backend_init, io_open, io_pread
+#include "coroutine.h"   // For event-loop sessions (-e)
+#include "lifecycle.h"   // For graceful shutdown and hot restart
+#include "cred_cache.h"  // For the check_login fast path
+#include "hash_pool.h"   // For offloaded password verification
+#include "password.h"    // For password_is_legacy
+#include "rate_limit.h"  // For login and request throttling
+#include "fault.h"       // For crash points (BANK_CRASH_POINT)
+#include "stats.h"       // For handler latency (admin menu, SIGUSR1)
+#include "lock_profile.h" // For file lock wait/hold times
+#include "metrics.h"     // For the loopback metrics endpoint (-m)
+#include "slow_log.h"    // For the slow-operation log (-s)
+#include "trace.h"       // For span tracing (SIGQUIT, admin menu)
+#include "scheduler.h"   // For standing instructions
+#include <signal.h>      // For ignoring SIGPIPE
 #include <pthread.h>     // For threading
 #include <stdlib.h>      // For malloc, free, atoi
 #include <unistd.h>      // For close
 #include <stdio.h>       // For perror
+#include <sys/stat.h>    // For fstat/stat (journal and data file sizes)
+#include <time.h>        // For clock_gettime (recovery timing)
 
-// Session Management Globals
-#define MAX_SESSIONS 100 // Maximum concurrent logged-in users
-int activeUserIds[MAX_SESSIONS];
-int activeUserCount = 0;
-pthread_mutex_t sessionMutex = PTHREAD_MUTEX_INITIALIZER; // Mutex to protect the list
+// Replaces a plain password from before hashing existed with a verifier (best effort)
+static void upgrade_legacy_password(User record, char *password)
+{
+    char stored[PASSWORD_FIELD_SIZE];
+    if (hash_pool_hash(password, stored) != 0)
+        return; // Pool busy: upgrade on a later login
+
+    User current = getUser(record.userId);
+    if (current.userId != record.userId || my_strcmp(current.password, record.password) != 0)
+        return; // Changed meanwhile
+    strcpy(current.password, stored);
+    if (updateUser(current) == 0)
+    {
+        char buffer[80];
+        sprintf(buffer, "Upgraded stored password of user %d to a salted hash.\n", record.userId);
+        write_string(STDOUT_FILENO, buffer);
+    }
+}
+
+// Applies the login rules to a user record: password must match and the user must be active.
+// Returns the record on success, or a LOGIN_* code in userId.
+static User verify_login(const User *record, char *password)
+{
+    User result;
+    result.userId = LOGIN_NOT_FOUND;
+
+    // The expensive hash runs on the hashing pool, never on this session's thread
+    int match = hash_pool_verify(password, record->password);
+    if (match == HASH_POOL_BUSY)
+    {
+        result.userId = LOGIN_BUSY;
+        return result;
+    }
+    if (!match)
+        return result; // Wrong password looks the same as an unknown user
+    if (!record->isActive)
+    {
+        result.userId = LOGIN_DEACTIVATED;
+        return result;
+    }
+    if (password_is_legacy(record->password))
+        upgrade_legacy_password(*record, password);
+    return *record;
+}
 
 // Core Login Function
 // (Remains here as it's central authentication logic)
 User check_login(int userId, char *password)
 {
     User user_to_find;
-    user_to_find.userId = 0; // Default: not found
+    user_to_find.userId = LOGIN_NOT_FOUND; // Default: not found
+
+    // Fast path: record cached by an earlier login (no disk access at all)
+    if (cred_cache_lookup(userId, &user_to_find))
+    {
+        return verify_login(&user_to_find, password);
+    }
+    user_to_find.userId = LOGIN_NOT_FOUND;
+    unsigned long ticket = cred_cache_begin(userId); // Before reading, see cred_cache.h
 
     // Use Data Access Layer functions (could be implemented here or called)
     int record_num = find_user_record(userId);
@@ -30,10 +99,10 @@ User check_login(int userId, char *password)
         return user_to_find; // Not found
     }
 
-    int fd = open(USER_FILE, O_RDONLY);
+    int fd = io_open(USER_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
-        user_to_find.userId = -1; // Error reading file
+        user_to_find.userId = LOGIN_ERROR; // Error reading file
         perror("check_login: open user file");
         return user_to_find;
     }
@@ -42,123 +111,203 @@ User check_login(int userId, char *password)
     if (set_record_lock(fd, record_num, sizeof(User), F_RDLCK) == -1)
     {
         close(fd);
-        user_to_find.userId = -1; // Locking error
+        user_to_find.userId = LOGIN_ERROR; // Locking error
         return user_to_find;
     }
 
-    lseek(fd, record_num * sizeof(User), SEEK_SET);
-
     User user_from_file;
-    if (read(fd, &user_from_file, sizeof(User)) == sizeof(User))
+    ssize_t got = io_pread(fd, &user_from_file, sizeof(User), (off_t)record_num * sizeof(User));
+
+    // Unlock the record (before hashing, which takes far longer than the read)
+    set_record_lock(fd, record_num, sizeof(User), F_UNLCK);
+    close(fd);
+
+    if (got == sizeof(User))
     {
         // Verify ID, Password, and Active status
-        if (user_from_file.userId == userId && my_strcmp(user_from_file.password, password) == 0)
+        if (user_from_file.userId == userId)
         {
-            if (user_from_file.isActive)
-            {
-                user_to_find = user_from_file; // Success! Copy details
-            }
-            else
-            {
-                user_to_find.userId = -2; // Deactivated
-            }
+            cred_cache_store(&user_from_file, ticket);
+            user_to_find = verify_login(&user_from_file, password);
         }
         // If password doesn't match, userId remains 0 (not found)
     }
     else
     {
-        user_to_find.userId = -1; // Read error
+        user_to_find.userId = LOGIN_ERROR; // Read error
         perror("check_login: read user record");
     }
 
-    // Unlock the record
-    set_record_lock(fd, record_num, sizeof(User), F_UNLCK);
-    close(fd);
-
     return user_to_find;
 }
 
 // --- NEW: Server Recovery Function ---
+/*
+-> The journal is never trimmed while the server runs (a graceful shutdown clears it), so after a
+   crash it can hold millions of committed groups. Only the tail matters: everything after the
+   last TXN_COMMIT is an unfinished transfer. So the file is read backwards, MAX_BUFFER entries at
+   a time, and the scan stops at the first commit found. Recovery time no longer grows with the
+   journal.
+-> A torn last entry (crash in the middle of a write) is ignored: its transfer never got as far as
+   updating an account.
+*/
 void run_server_recovery()
 {
     write_string(STDOUT_FILENO, "Server starting... Checking journal for recovery...\n");
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
 
-    int fd = open(JOURNAL_FILE, O_RDONLY);
+    int fd = io_open(JOURNAL_FILE, O_RDONLY, 0);
     if (fd == -1)
     {
         write_string(STDOUT_FILENO, "No journal file found. Starting clean.\n");
         return; // No journal, nothing to recover
     }
 
-    JournalEntry entries[MAX_BUFFER]; // Read journal into memory
-    int entry_count = 0;
-    JournalEntry entry;
-
-    // Read all entries
-    while (read(fd, &entry, sizeof(JournalEntry)) == sizeof(JournalEntry))
+    struct stat st;
+    long entry_count = (fstat(fd, &st) == 0) ? (long)(st.st_size / (off_t)sizeof(JournalEntry)) : 0;
+    char buffer[160]; // For sprintf
+    if (entry_count > 0 && st.st_size % (off_t)sizeof(JournalEntry) != 0)
     {
-        if (entry_count < MAX_BUFFER)
-        {
-            entries[entry_count] = entry;
-            entry_count++;
-        }
-        else
-        {
-            write_string(STDOUT_FILENO, "Warning: Journal log too large, may not recover all entries.\n");
-            break;
-        }
+        sprintf(buffer, "Ignoring %ld trailing byte(s) of a torn journal entry.\n",
+                (long)(st.st_size % (off_t)sizeof(JournalEntry)));
+        write_string(STDOUT_FILENO, buffer);
     }
-    close(fd);
-
     if (entry_count == 0)
     {
+        close(fd);
         write_string(STDOUT_FILENO, "Journal is empty. Starting clean.\n");
         return; // Journal is empty
     }
 
-    // Check the *last* entry in the log
-    if (entries[entry_count - 1].type == TXN_COMMIT)
-    {
-        write_string(STDOUT_FILENO, "Last transaction was committed. Journal is clean.\n");
-        journal_log_clear(); // Clean up the log
-        return;
-    }
-
-    // --- If we are here, the last transaction FAILED ---
-    write_string(STDOUT_FILENO, "Incomplete transaction found! Starting rollback...\n");
+    JournalEntry entries[MAX_BUFFER];
+    long end = entry_count; // Entries [0, end) not scanned yet
+    long scanned = 0;
     int rollbacks = 0;
-    char buffer[100]; // For sprintf
+    int found_commit = 0;
 
-    // Iterate backwards through the log
-    for (int i = entry_count - 1; i >= 0; i--)
+    // Iterate backwards through the log, one block at a time
+    while (end > 0 && !found_commit)
     {
-        if (entries[i].type == TXN_COMMIT)
+        long first = (end > MAX_BUFFER) ? end - MAX_BUFFER : 0;
+        size_t want = (size_t)(end - first) * sizeof(JournalEntry);
+        if (io_pread(fd, entries, want, (off_t)first * (off_t)sizeof(JournalEntry)) != (ssize_t)want)
         {
-            // We found the end of the *previous* successful transaction
-            // Stop here.
+            perror("recovery: read journal");
             break;
         }
 
-        if (entries[i].type == TXN_START)
+        for (long i = end - first - 1; i >= 0; i--)
         {
-            // This is an "UNDO" entry
-            Account acc = getAccount(entries[i].accountId);
-            if (acc.accountId != -1)
+            scanned++;
+            if (entries[i].type == TXN_COMMIT)
             {
-                // Check if rollback is even needed (maybe we crashed before write)
-                if (acc.balance != entries[i].oldBalance)
+                // We found the end of the *previous* successful transaction
+                // Stop here.
+                found_commit = 1;
+                break;
+            }
+
+            if (scanned == 1)
+                write_string(STDOUT_FILENO, "Incomplete transaction found! Starting rollback...\n");
+
+            if (entries[i].type == TXN_START)
+            {
+                // This is an "UNDO" entry
+                Account acc = getAccount(entries[i].accountId);
+                if (acc.accountId != -1)
                 {
-                    acc.balance = entries[i].oldBalance; // Restore old balance
-                    updateAccount(acc);                  // This will write and fsync
-                    rollbacks++;
+                    // Check if rollback is even needed (maybe we crashed before write)
+                    if (acc.balance != entries[i].oldBalance)
+                    {
+                        acc.balance = entries[i].oldBalance; // Restore old balance
+                        updateAccount(acc);                  // This will write and fsync
+                        rollbacks++;
+                        FAULT_POINT(CRASH_RECOVERY_MID_ROLLBACK); // Recovery must be repeatable
+                    }
                 }
             }
         }
+        end = first;
     }
+    close(fd);
 
-    sprintf(buffer, "Rollback complete. Restored %d record(s).\n", rollbacks);
-    write_string(STDOUT_FILENO, buffer);
+    if (scanned == 1 && found_commit)
+    {
+        write_string(STDOUT_FILENO, "Last transaction was committed. Journal is clean.\n");
+    }
+    else
+    {
+        sprintf(buffer, "Rollback complete. Restored %d record(s).\n", rollbacks);
+        write_string(STDOUT_FILENO, buffer);
+    }
     journal_log_clear(); // Clean up the log for the next start
+
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    double ms = (finished.tv_sec - started.tv_sec) * 1e3 + (finished.tv_nsec - started.tv_nsec) / 1e6;
+    sprintf(buffer, "Recovery took %.3f ms (%ld journal entries, %ld scanned, %d restored).\n", ms,
+            entry_count, scanned, rollbacks);
+    write_string(STDOUT_FILENO, buffer);
+}
+
+// Disarms the connection's deadline and closes the socket
+static void end_connection(Connection *conn, int client_socket)
+{
+    if (conn != NULL && connection_close(conn) != REAP_NONE)
+        write_string(STDOUT_FILENO, "Connection was reaped by the timeout.\n");
+    close(client_socket);
+}
+
+// A pipelined connection leaving its event loop (see coroutine.h)
+typedef struct
+{
+    int client_socket;
+    Connection *conn;
+} PipelineHandoff;
+
+static void run_pipeline(int client_socket, Connection *conn)
+{
+    pipeline_session(client_socket);
+    end_connection(conn, client_socket);
+    write_string(STDOUT_FILENO, "Pipeline session ended.\n");
+}
+
+static void *pipeline_thread(void *arg)
+{
+    PipelineHandoff handoff = *(PipelineHandoff *)arg;
+    free(arg);
+    connection_set_current(handoff.conn);
+    run_pipeline(handoff.client_socket, handoff.conn);
+    return NULL;
+}
+
+// Runs the pipelined session on a new thread when called from a coroutine, in place otherwise
+static void start_pipeline(int client_socket, Connection *conn)
+{
+    if (coroutine_running())
+    {
+        pthread_t thread_id;
+        PipelineHandoff *handoff = (PipelineHandoff *)malloc(sizeof(PipelineHandoff));
+        if (handoff != NULL)
+        {
+            handoff->client_socket = client_socket;
+            handoff->conn = conn;
+            fcntl(client_socket, F_SETFL, fcntl(client_socket, F_GETFL) & ~O_NONBLOCK);
+            if (pthread_create(&thread_id, NULL, pipeline_thread, handoff) == 0)
+            {
+                pthread_detach(thread_id);
+                connection_set_current(NULL); // The thread owns conn now
+                return;
+            }
+            perror("pipeline: pthread_create");
+            free(handoff);
+            fcntl(client_socket, F_SETFL, fcntl(client_socket, F_GETFL) | O_NONBLOCK);
+        }
+        write_string(client_socket, "? ERR Server busy\n");
+        end_connection(conn, client_socket);
+        return;
+    }
+    run_pipeline(client_socket, conn);
 }
 
 /*
@@ -167,7 +316,7 @@ void run_server_recovery()
 -> The handle_client function is the "brain" for a single, isolated client connection.
 -> When a client connects, the main function in server.c creates a new thread, and this one function is the
    entire life's work of that thread. Its job is to:
--> Authenticate and verify the user (Role, ID, Password).
+-> Authenticate and verify the user (Role, ID, Password), or resume a session from its token.
 -> Check if that user is already logged in (Session Management).
 -> Dispatch the user to their correct "department" (the role-specific menus like customer_menu).
 -> Wait for them to log out.
@@ -190,6 +339,12 @@ void *handle_client(void *client_socket_ptr)
     int roleChoice = 0;
     UserRole expectedRole;
     int loginSuccess = 0;
+    int resumed = 0;                   // Set when the client presented a valid session token
+    char token[TOKEN_LENGTH + 1] = ""; // This session's token (issued or resumed)
+    MenuExit menuExit = MENU_DISCONNECTED; // How the role menu ended (decides the token's fate)
+
+    // Arms the login deadline; input keeps pushing the idle deadline back (see connection.c)
+    Connection *conn = connection_open(client_socket);
 
     // write_string / read_client_input: These are our custom utility functions.
     // write_string is a wrapper around the write system call, which sends bytes of data to the client's socket
@@ -206,7 +361,31 @@ void *handle_client(void *client_socket_ptr)
         write_string(client_socket, " 1. Administrator\n 2. Manager\n 3. Employee\n 4. Customer\n");
         write_string(client_socket, "Enter choice (1-4): ");
         if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
-            return NULL; // Client disconnected
+        {
+            end_connection(conn, client_socket);
+            return NULL; // Client disconnected (or timed out)
+        }
+
+        // Machine clients switch this connection to the pipelined protocol (see pipeline.h)
+        if (my_strcmp(buffer, PIPELINE_HELLO) == 0)
+        {
+            start_pipeline(client_socket, conn);
+            return NULL;
+        }
+
+        // Returning clients skip role selection and credentials: "RESUME <token>"
+        if (strncmp(buffer, TOKEN_RESUME_CMD " ", strlen(TOKEN_RESUME_CMD) + 1) == 0)
+        {
+            char *presented = buffer + strlen(TOKEN_RESUME_CMD) + 1;
+            if (token_resume(presented, &user) == 0)
+            {
+                strcpy(token, presented);
+                resumed = 1;
+                break;
+            }
+            write_string(client_socket, "Session token invalid or expired. Please log in.\n");
+            continue;
+        }
         roleChoice = atoi(buffer);
 
         // --- Correct Mapping Logic ---
@@ -236,230 +415,446 @@ void *handle_client(void *client_socket_ptr)
         }
     }
 
-    // --- Get Credentials ---
-    int userIdInput;
-    char password[50];
-    write_string(client_socket, "Enter User ID: ");
-    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
-        return NULL; // Client disconnected
-    userIdInput = atoi(buffer);
-    write_string(client_socket, "Enter Password: ");
-    if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
-        return NULL; // Client disconnected
-    strcpy(password, buffer);
+    if (!resumed)
+    {
+        // --- Get Credentials ---
+        int userIdInput;
+        char password[50];
+        write_string(client_socket, "Enter User ID: ");
+        if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        {
+            end_connection(conn, client_socket);
+            return NULL; // Client disconnected (or timed out)
+        }
+        userIdInput = atoi(buffer);
+        write_string(client_socket, "Enter Password: ");
+        if (read_client_input(client_socket, buffer, MAX_BUFFER) == -1)
+        {
+            end_connection(conn, client_socket);
+            return NULL; // Client disconnected (or timed out)
+        }
+        strncpy(password, buffer, sizeof(password) - 1);
+        password[sizeof(password) - 1] = '\0';
 
-    // --- Authentication ---
-    user = check_login(userIdInput, password);
+        // --- Authentication ---
+        // Throttled attempts never reach check_login: no record read, no hash computed
+        RateResult limited = rate_limit_login(userIdInput, conn != NULL ? conn->peer : "local");
+        if (limited != RATE_OK)
+        {
+            write_string(client_socket, "Login failed: Too many attempts, try again later.\n");
+            end_connection(conn, client_socket);
+            return NULL;
+        }
+        STATS_TIME(STAT_CHECK_LOGIN, user = check_login(userIdInput, password));
+    }
 
     // --- Verification and Session Check ---
-    if (user.userId <= 0)
+    if (!resumed && user.userId <= 0)
     {
-        if (user.userId == -2)
+        if (user.userId == LOGIN_DEACTIVATED)
         {
             write_string(client_socket, "Login failed: Your account is deactivated. Contact support.\n");
         }
+        else if (user.userId == LOGIN_BUSY)
+        {
+            write_string(client_socket, "Login failed: Server busy, please try again in a moment.\n");
+        }
         else
         {
             write_string(client_socket, "Login failed: Invalid User ID or Password.\n");
         }
     }
-    else if (user.role != expectedRole)
+    else if (!resumed && user.role != expectedRole)
     { // Role mismatch
         write_string(STDOUT_FILENO, "Login failed: Role mismatch.\n");
         write_string(client_socket, "Login failed: Your User ID does not match the selected role.\n");
     }
     else
     {
-        // Key Concept: pthread_mutex_t (Mutex)
-
-        // sessionMutex, activeUserIds, and activeUserCount are global variables. This means all threads
-        // can see and change them.
-
-        // A race condition could happen if two threads try to add a user to the activeUserIds array at
-        // the exact same time.
-
-        // A mutex (Mutual Exclusion) is like a " key" Only the thread holding the key can enter
-        // the "critical section" (the code that modifies the global variables).
-
-        // pthread_mutex_lock(&sessionMutex); acquires the key. If another thread has it, this thread will
-        // wait until it's released.
-
-        // pthread_mutex_unlock(&sessionMutex); releases the key so another waiting thread can proceed.
-
-        pthread_mutex_lock(&sessionMutex);
-        int alreadyLoggedIn = 0;
-        for (int i = 0; i < activeUserCount; i++)
-        {
-            if (activeUserIds[i] == user.userId)
-            {
-                alreadyLoggedIn = 1;
-                break;
-            }
-        }
-        if (alreadyLoggedIn)
+        int sessionStatus = session_add(user.userId);
+        if (sessionStatus == SESSION_DUPLICATE)
         {
-            pthread_mutex_unlock(&sessionMutex);
             write_string(STDOUT_FILENO, "Login failed: User already logged in.\n");
             write_string(client_socket, "ERROR: This user is already logged in elsewhere.\n");
-            sleep(1); // <-- ADD THIS LINE to allow message to send
+            coroutine_sleep(1); // Allow message to send (does not block an event loop)
         }
-        else if (activeUserCount >= MAX_SESSIONS)
+        else if (sessionStatus == SESSION_FULL)
         {
-            pthread_mutex_unlock(&sessionMutex);
             write_string(STDOUT_FILENO, "Login failed: Server full.\n");
             write_string(client_socket, "ERROR: Server is currently full. Please try again later.\n");
-            sleep(1); // <-- ADD THIS LINE to allow message to send
+            coroutine_sleep(1); // Allow message to send (does not block an event loop)
         }
         else
         {
             // *** SUCCESS CASE ***
-            activeUserIds[activeUserCount] = user.userId;
-            activeUserCount++;
-            pthread_mutex_unlock(&sessionMutex);
             loginSuccess = 1; // Set the success flag ONLY HERE
+            if (conn != NULL)
+                connection_logged_in(conn, user.userId); // Login deadline → idle deadline
+            stats_set_user(user.userId); // Named in slow-op log lines
 
-            write_string(STDOUT_FILENO, "Login success, session added.\n");
-            write_string(client_socket, "Login Successful!\n");
+            if (resumed)
+            {
+                write_string(STDOUT_FILENO, "Session resumed from token.\n");
+                write_string(client_socket, "Session resumed.\n");
+            }
+            else
+            {
+                write_string(STDOUT_FILENO, "Login success, session added.\n");
+                write_string(client_socket, "Login Successful!\n");
+
+                // Token lets the client reconnect without logging in again
+                if (token_issue(&user, token) == 0)
+                {
+                    sprintf(buffer, "Session Token: %s\n", token);
+                    write_string(client_socket, buffer);
+                }
+            }
 
             // --- Menu Dispatch (Calls functions from other modules) ---
             switch (user.role)
             {
             case CUSTOMER:
-                account_selection_menu(client_socket, user);
+                menuExit = account_selection_menu(client_socket, user);
                 break;
             case EMPLOYEE:
-                employee_menu(client_socket, user);
+                menuExit = employee_menu(client_socket, user);
                 break;
             case MANAGER:
-                manager_menu(client_socket, user);
+                menuExit = manager_menu(client_socket, user);
                 break;
             case ADMINISTRATOR:
-                admin_menu(client_socket, user);
+                menuExit = admin_menu(client_socket, user);
                 break;
             }
         }
     }
 
     // --- Session Cleanup ---
+    if (token[0] != '\0')
+    {
+        // Logged out through the menu: the token is done.
+        // Connection dropped: keep the token so the client can resume.
+        if (menuExit == MENU_LOGOUT)
+            token_revoke(token);
+        else
+            token_touch(token);
+    }
     if (loginSuccess == 1)
     {
-        pthread_mutex_lock(&sessionMutex);
-        for (int i = 0; i < activeUserCount; i++)
+        if (session_remove(user.userId) == 0)
         {
-            if (activeUserIds[i] == user.userId)
-            {
-                // Swap-and-pop
-                activeUserIds[i] = activeUserIds[activeUserCount - 1];
-                activeUserCount--;
-                write_string(STDOUT_FILENO, "Session removed.\n");
-                break;
-            }
+            write_string(STDOUT_FILENO, "Session removed.\n");
         }
-        pthread_mutex_unlock(&sessionMutex);
     }
 
-    close(client_socket);
+    end_connection(conn, client_socket);
     write_string(STDOUT_FILENO, "Client session ended.\n");
     return NULL;
 }
 
-// --- Main Server Setup (Threaded) ---
-int main()
+// Prints server-wide counters (used by the admin "Server Statistics" menu entry)
+void server_report_stats(int fd)
 {
-    int server_fd;              // File descriptor for the server socket (used to listen for connections).
-    int new_socket;             // File descriptor for a client’s socket (used to communicate with one client).
-    struct sockaddr_in address; // Structure containing the IP address and port details.
-    int addrlen = sizeof(address);
-    pthread_t thread_id; // Stores the thread handle when a new thread is created.
-
-    // --- Socket Setup (socket, bind, listen - same as before) ---
-    // The kernel allocates a socket descriptor (like a file handle).
-    // AF_INET → IPv4 domain.
-    // SOCK_STREAM → TCP connection (reliable, connection-oriented).
-    // Returns a file descriptor (like 3, 4, etc.).
-    // (Linux treats sockets just like files — read/write works the same way.)
+    char buffer[128];
+    sprintf(buffer, "Active sessions: %d\nLive session tokens: %d\n", session_count(), token_count());
+    write_string(fd, buffer);
+    cred_cache_report(fd);
+    hash_pool_report(fd);
+    rate_limit_report(fd);
+    connection_report(fd);
+    listener_report(fd);
+    io_backend_report(fd);
+    event_loop_report(fd);
+    lock_profile_report(fd);
+    metrics_report(fd);
+    slow_log_report(fd);
+    scheduler_report(fd);
+}
 
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0)
+// The metrics page (metrics.h): runs on the metrics thread, reads the same counters as the reports
+static void write_metrics(int fd)
+{
+    static const char *files[] = {USER_FILE, ACCOUNT_FILE, TRANSACTION_FILE, LOAN_FILE, FEEDBACK_FILE,
+                                  INSTRUCTION_FILE};
+    static const size_t record_sizes[] = {sizeof(User), sizeof(Account), sizeof(Transaction), sizeof(Loan),
+                                          sizeof(Feedback), sizeof(StandingInstruction)};
+    char labels[96];
+    metrics_header(fd, "bank_active_sessions", "gauge", "Logged-in sessions");
+    metrics_value(fd, "bank_active_sessions", NULL, session_count());
+    metrics_header(fd, "bank_session_tokens", "gauge", "Live session resume tokens");
+    metrics_value(fd, "bank_session_tokens", NULL, token_count());
+
+    struct stat st;
+    metrics_header(fd, "bank_journal_bytes", "gauge", "Size of the transfer journal in bytes");
+    metrics_value(fd, "bank_journal_bytes", NULL, stat(JOURNAL_FILE, &st) == 0 ? (double)st.st_size : 0);
+    // The data files are the only "indexes" there are: every lookup scans one of them
+    metrics_header(fd, "bank_data_file_records", "gauge", "Records in each data file (what a full scan reads)");
+    for (int i = 0; i < 6; i++)
     {
-        perror("socket failed");
-        exit(EXIT_FAILURE);
+        snprintf(labels, sizeof(labels), "file=\"%s\"", strrchr(files[i], '/') + 1);
+        metrics_value(fd, "bank_data_file_records", labels,
+                      stat(files[i], &st) == 0 ? (double)(st.st_size / (off_t)record_sizes[i]) : 0);
     }
+    cred_cache_metrics(fd);
+    stats_metrics(fd);
+    lock_profile_metrics(fd);
+    scheduler_metrics(fd);
+}
 
-    // INADDR_ANY → Listen on all available network interfaces (localhost + LAN IP).
-    // htons() ensures correct endianness (big-endian order, required by TCP/IP).
-
-    address.sin_family = AF_INET;         // IPv4
-    address.sin_addr.s_addr = INADDR_ANY; // Accept connections on any local IP (0.0.0.0)
-    address.sin_port = htons(PORT);       // Host to Network Short: converts port to network byte order
+// Coroutine entry for event-loop mode
+static void run_client_coroutine(void *client_socket_ptr)
+{
+    handle_client(client_socket_ptr);
+}
 
-    // The kernel associates this socket with the IP + Port (e.g., 0.0.0.0:8080).
-    // It ensures no other process is using the same port.
-    // Without bind(), your server wouldn’t have an address for clients to connect to.
+// Acceptor callback: one thread per client connection (or one coroutine with -e)
+static void start_client_thread(int new_socket)
+{
+    pthread_t thread_id; // Stores the thread handle when a new thread is created.
 
-    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    // Allocate memory for client socket pointer to pass to thread
+    int *client_sock_ptr = (int *)malloc(sizeof(int));
+    if (client_sock_ptr == NULL)
     {
-        perror("bind failed");
-        exit(EXIT_FAILURE);
+        perror("malloc for client socket ptr");
+        close(new_socket); // Clean up the accepted socket
+        return;            // Skip creating thread
     }
+    *client_sock_ptr = new_socket;
 
-    // Tells the OS: “I’m ready to accept incoming TCP connection requests.”
-    // The 10 is the backlog — number of clients that can wait in queue while the server is busy.
-    // At this point:
-    // The server socket is passive, waiting for connection requests.
+    if (event_loop_active())
+    {
+        // Non-blocking, so a session waiting for input yields instead of blocking its loop
+        fcntl(new_socket, F_SETFL, fcntl(new_socket, F_GETFL) | O_NONBLOCK);
+        if (coroutine_spawn(run_client_coroutine, client_sock_ptr) == 0)
+        {
+            write_string(STDOUT_FILENO, "New client connected, session scheduled.\n");
+            return;
+        }
+        fcntl(new_socket, F_SETFL, fcntl(new_socket, F_GETFL) & ~O_NONBLOCK); // Fall back to a thread
+    }
 
-    if (listen(server_fd, 10) < 0)
+    // Create the thread to handle the client
+    if (pthread_create(&thread_id, NULL, handle_client, (void *)client_sock_ptr) != 0)
     {
-        perror("listen");
-        exit(EXIT_FAILURE);
+        perror("pthread_create failed");
+        close(new_socket);     // Clean up socket
+        free(client_sock_ptr); // Clean up allocated memory
     }
+    else
+    {
+        pthread_detach(thread_id); // Detach thread for automatic cleanup
+        write_string(STDOUT_FILENO, "New client connected, thread created.\n");
+    }
+}
 
-    // --- CALL RECOVERY FUNCTION ---
-    run_server_recovery();
-    // --- END ---
+// SIGHUP (on the main thread, via lifecycle_run): re-read the rate limits
+static void reload_rate_limits(int sig)
+{
+    (void)sig;
+    if (rate_limit_load(RATE_LIMIT_CONFIG) == 0)
+        write_string(STDOUT_FILENO, "Rate limits reloaded.\n");
+    else
+        write_string(STDOUT_FILENO, "Rate limits unchanged: config has errors.\n");
+}
 
-    write_string(STDOUT_FILENO, "Server listening on port 8080 (Threaded & Modular)...\n");
+// SIGUSR1: handler latency, I/O accounting and the lock profile to stdout, without logging in as admin
+static void dump_stats(int sig)
+{
+    (void)sig;
+    write_string(STDOUT_FILENO, "\n--- Handler Latency (SIGUSR1) ---\n");
+    stats_report(STDOUT_FILENO);
+    stats_io_report(STDOUT_FILENO);
+    lock_profile_report(STDOUT_FILENO);
+}
 
-    // --- Accept Loop (Creates threads) ---
-    while (1)
-    {
-        // What accept() does internally:
-        // It blocks (waits) until a client connects.
-        // When a client (e.g., from telnet or another program) connects, the OS:
-        // Establishes a TCP 3-way handshake.
-        // Creates a new socket specifically for this client (different from server_fd).
-        // Returns that new socket descriptor as new_socket.
-        // Now, server_fd still listens for new clients, while new_socket is used for communication with one client.
+// SIGQUIT: the span rings to TRACE_FILE (Chrome trace format)
+static void dump_trace(int sig)
+{
+    (void)sig;
+    char buffer[128];
+    long spans = trace_dump(TRACE_FILE);
+    if (spans < 0)
+        snprintf(buffer, sizeof(buffer), "Trace: could not write %s\n", TRACE_FILE);
+    else
+        snprintf(buffer, sizeof(buffer), "Trace: %ld span(s) written to %s\n", spans, TRACE_FILE);
+    write_string(STDOUT_FILENO, buffer);
+}
 
-        if ((new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen)) < 0)
+// --- Main Server Setup (Threaded) ---
+// Usage: ./server [-a acceptors] [-u unix_path] [-o io_backend] [-e loops] [-l login_timeout] [-i idle_timeout] [-w hash_threads] [-m metrics_port] [-s slow_ms]
+//   -a N   number of acceptor threads, each with its own SO_REUSEPORT socket (default: one per CPU)
+//   -u P   path of the AF_UNIX socket for local clients (default UNIX_SOCKET_PATH, "none" disables it)
+//   -o B   I/O backend for data files and pipelined sockets: "syscall" (default) or "uring"
+//   -e N   run sessions as coroutines on N event-loop threads instead of one thread per client
+//   -l S   seconds a new connection gets to log in (default LOGIN_TIMEOUT_SECONDS)
+//   -i S   seconds a logged-in connection may stay silent (default IDLE_TIMEOUT_SECONDS)
+//   -w N   password hashing threads (default HASH_POOL_THREADS)
+//   -m N   loopback port of the metrics endpoint (default METRICS_PORT, 0: off)
+//   -s N   log operations slower than N ms to SLOW_LOG_FILE (default SLOW_OP_THRESHOLD_MS, 0: off)
+// Signals: SIGTERM/SIGINT drain and exit, SIGUSR2 re-executes the binary without closing the sockets,
+//          SIGHUP reloads RATE_LIMIT_CONFIG, SIGUSR1 prints handler latency, SIGQUIT writes TRACE_FILE
+// Environment: BANK_CRASH_POINT=name[:N] crashes the server at a named point (see fault.h)
+int main(int argc, char *argv[])
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int acceptor_count = (cpus > 0) ? (int)cpus : 1;
+    char buffer[128];
+
+    int opt;
+    int login_timeout = LOGIN_TIMEOUT_SECONDS;
+    int idle_timeout = IDLE_TIMEOUT_SECONDS;
+    const char *unix_path = UNIX_SOCKET_PATH;
+    IoBackendKind io_kind = IO_BACKEND_SYSCALL;
+    int loop_threads = 0; // 0: thread per client
+    int hash_threads = HASH_POOL_THREADS;
+    int metrics_port = METRICS_PORT;
+    int slow_ms = SLOW_OP_THRESHOLD_MS;
+    while ((opt = getopt(argc, argv, "a:u:o:e:l:i:w:m:s:")) != -1)
+    {
+        if (opt == 'a' && atoi(optarg) > 0)
         {
-            perror("accept");
-            continue; // Continue listening even if accept fails
+            acceptor_count = atoi(optarg);
         }
-
-        // Allocate memory for client socket pointer to pass to thread
-        int *client_sock_ptr = (int *)malloc(sizeof(int));
-        if (client_sock_ptr == NULL)
+        else if (opt == 'u')
         {
-            perror("malloc for client socket ptr");
-            close(new_socket); // Clean up the accepted socket
-            continue;          // Skip creating thread
+            unix_path = (my_strcmp(optarg, "none") == 0) ? NULL : optarg;
         }
-        *client_sock_ptr = new_socket;
-
-        // Create the thread to handle the client
-        if (pthread_create(&thread_id, NULL, handle_client, (void *)client_sock_ptr) != 0)
+        else if (opt == 'o' && (my_strcmp(optarg, "uring") == 0 || my_strcmp(optarg, "syscall") == 0))
         {
-            perror("pthread_create failed");
-            close(new_socket);     // Clean up socket
-            free(client_sock_ptr); // Clean up allocated memory
+            io_kind = (my_strcmp(optarg, "uring") == 0) ? IO_BACKEND_URING : IO_BACKEND_SYSCALL;
+        }
+        else if (opt == 'e' && atoi(optarg) > 0)
+        {
+            loop_threads = atoi(optarg);
+        }
+        else if (opt == 'l' && atoi(optarg) > 0)
+        {
+            login_timeout = atoi(optarg);
+        }
+        else if (opt == 'i' && atoi(optarg) > 0)
+        {
+            idle_timeout = atoi(optarg);
+        }
+        else if (opt == 'w' && atoi(optarg) > 0)
+        {
+            hash_threads = atoi(optarg);
+        }
+        else if (opt == 'm' && atoi(optarg) >= 0)
+        {
+            metrics_port = atoi(optarg);
+        }
+        else if (opt == 's' && atoi(optarg) >= 0)
+        {
+            slow_ms = atoi(optarg);
         }
         else
         {
-            pthread_detach(thread_id); // Detach thread for automatic cleanup
-            write_string(STDOUT_FILENO, "New client connected, thread created.\n");
+            write_string(STDOUT_FILENO, "Usage: ./server [-a acceptors] [-u unix_path|none] [-o syscall|uring] [-e loops] [-l login_timeout] [-i idle_timeout] [-w hash_threads] [-m metrics_port] [-s slow_ms]\n");
+            exit(EXIT_FAILURE);
         }
     }
-    close(server_fd); // Should technically be reached on server shutdown signal
+    connection_set_timeouts(login_timeout, idle_timeout);
+    fault_init(); // Crash points, armed only for crash testing
+    stats_enable(); // Handler and data access latency histograms, I/O accounting
+    lock_profile_enable(); // Wait and hold times of the data file locks
+    trace_enable(); // Per-thread span rings (dumped on SIGQUIT)
+
+    // Before any thread exists: SIGTERM/SIGINT/SIGUSR2 are then only seen by lifecycle_run
+    lifecycle_init(argc, argv);
+    lifecycle_on_signal(SIGHUP, reload_rate_limits);
+    lifecycle_on_signal(SIGUSR1, dump_stats);
+    lifecycle_on_signal(SIGQUIT, dump_trace);
+
+    // A reaped (shut down) socket must make write() fail with EPIPE, not kill the process
+    signal(SIGPIPE, SIG_IGN);
+
+    // Before binding: SO_REUSEPORT would let a second server share the port and then recover
+    // (roll back) the journal of the one that is running
+    if (lifecycle_lock_instance() == -1)
+    {
+        write_string(STDOUT_FILENO, "Another server is already running on this data directory (" INSTANCE_LOCK_FILE
+                                    " is locked).\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Started by a hot restart: the previous process's listening sockets are already open
+    const char *inherited = lifecycle_inherited_listeners();
+    if (inherited != NULL && (acceptor_count = listener_adopt(inherited)) != -1)
+    {
+        unix_path = NULL; // Part of the inherited set (listed by the acceptor report)
+    }
+    else
+    {
+        inherited = NULL;
+        // Listening sockets are bound before recovery, so clients queue instead of being refused
+        acceptor_count = listener_open(acceptor_count, PORT);
+        if (acceptor_count == -1)
+        {
+            exit(EXIT_FAILURE);
+        }
+        // Co-located clients (teller front-ends) can skip TCP loopback; TCP keeps working if this fails
+        if (unix_path != NULL && listener_open_unix(unix_path) == -1)
+        {
+            write_string(STDOUT_FILENO, "Unix socket unavailable, serving TCP only.\n");
+            unix_path = NULL;
+        }
+    }
+
+    // Chosen before recovery, which already reads the journal through it
+    io_backend_init(io_kind);
+
+    // --- CALL RECOVERY FUNCTION ---
+    // Not after a hot restart: the old process is still running and may be inside a transfer
+    if (inherited == NULL)
+        run_server_recovery();
+    // --- END ---
+
+    timer_wheel_start();  // Drives connection deadlines and the token sweep
+    hash_pool_start(hash_threads); // Caps the CPU logins can spend on password hashing
+    rate_limit_start();   // Loads RATE_LIMIT_CONFIG (re-read on SIGHUP)
+    token_start_reaper(); // Expires session tokens in the background
+    user_updated_hook = token_revoke_user; // Role/password changes must not survive in a token
+    if (loop_threads > 0)
+    {
+        loop_threads = event_loop_start(loop_threads);
+        if (loop_threads == 0)
+            write_string(STDOUT_FILENO, "Event loops unavailable, using one thread per client.\n");
+    }
+    // Its own thread and socket: scrapes never reach the acceptors or the sessions
+    if (metrics_port > 0 && metrics_start(metrics_port, write_metrics) == -1)
+        metrics_port = 0;
+    slow_log_start(slow_ms); // Logger thread: sessions only queue the entries
+    scheduler_start();       // Standing instructions (waits for the lock during a hot restart)
+
+    sprintf(buffer, "Server listening on port %d with %d acceptor(s), %s I/O (Threaded & Modular)...\n",
+            PORT, acceptor_count, io_backend_name());
+    write_string(STDOUT_FILENO, buffer);
+    if (unix_path != NULL)
+    {
+        sprintf(buffer, "Local clients: unix socket %s\n", unix_path);
+        write_string(STDOUT_FILENO, buffer);
+    }
+    if (metrics_port > 0)
+    {
+        sprintf(buffer, "Metrics: http://127.0.0.1:%d/metrics\n", metrics_port);
+        write_string(STDOUT_FILENO, buffer);
+    }
+    if (event_loop_active())
+    {
+        sprintf(buffer, "Sessions run as coroutines on %d event loop(s).\n", loop_threads);
+        write_string(STDOUT_FILENO, buffer);
+    }
+
+    if (inherited != NULL)
+        write_string(STDOUT_FILENO, "Took over the listening sockets of the previous server (hot restart).\n");
+
+    // --- Accept Loops (each creates one thread per client) ---
+    listener_run(start_client_thread);
+    lifecycle_ready(); // A previous process (hot restart) may now stop accepting
+
+    // The main thread handles SIGTERM/SIGINT (drain and exit) and SIGUSR2 (hot restart)
+    lifecycle_run();
     return 0;
 }
 
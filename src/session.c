@@ -0,0 +1,162 @@
+// src/session.c
+#include "session.h" // Session registry prototypes
+#include <pthread.h> // For per-shard mutexes
+#include <stdlib.h>  // For malloc, calloc, free
+
+/*
+--- Session Registry ---
+
+-> A set of logged-in userIds, used to stop the same user from logging in twice.
+-> The set is split into SESSION_SHARDS shards. A userId always lands in the same shard
+   (chosen by its hash), and each shard has its own mutex. Two logins only wait for each
+   other if they hash to the same shard.
+-> Each shard is a small chained hash table that doubles its bucket array when it gets full,
+   so there is no fixed limit on the number of sessions and check-and-insert stays O(1).
+*/
+
+typedef struct SessionNode
+{
+    int userId;
+    struct SessionNode *next;
+} SessionNode;
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    SessionNode **buckets;
+    unsigned int bucket_count; // Always a power of two
+    unsigned int count;
+} SessionShard;
+
+static SessionShard shards[SESSION_SHARDS];
+static pthread_once_t shards_once = PTHREAD_ONCE_INIT;
+
+static void init_shards()
+{
+    for (int i = 0; i < SESSION_SHARDS; i++)
+    {
+        pthread_mutex_init(&shards[i].mutex, NULL);
+        shards[i].buckets = NULL; // Allocated on first insert
+        shards[i].bucket_count = 0;
+        shards[i].count = 0;
+    }
+}
+
+// Fibonacci hashing spreads consecutive userIds over shards and buckets
+static unsigned int hash_user(int userId)
+{
+    return (unsigned int)userId * 2654435769u;
+}
+
+static SessionShard *shard_of(unsigned int hash)
+{
+    pthread_once(&shards_once, init_shards);
+    return &shards[hash >> 26 & (SESSION_SHARDS - 1)];
+}
+
+// Doubles the bucket array of a shard (caller holds the shard mutex)
+static int grow_shard(SessionShard *shard)
+{
+    unsigned int new_count = shard->bucket_count ? shard->bucket_count * 2 : SESSION_SHARD_BUCKETS;
+    SessionNode **new_buckets = calloc(new_count, sizeof(SessionNode *));
+    if (new_buckets == NULL)
+        return -1;
+
+    for (unsigned int i = 0; i < shard->bucket_count; i++)
+    {
+        SessionNode *node = shard->buckets[i];
+        while (node != NULL)
+        {
+            SessionNode *next = node->next;
+            unsigned int b = hash_user(node->userId) & (new_count - 1);
+            node->next = new_buckets[b];
+            new_buckets[b] = node;
+            node = next;
+        }
+    }
+    free(shard->buckets);
+    shard->buckets = new_buckets;
+    shard->bucket_count = new_count;
+    return 0;
+}
+
+int session_add(int userId)
+{
+    unsigned int hash = hash_user(userId);
+    SessionShard *shard = shard_of(hash);
+
+    pthread_mutex_lock(&shard->mutex);
+    if (shard->bucket_count > 0)
+    {
+        for (SessionNode *node = shard->buckets[hash & (shard->bucket_count - 1)]; node; node = node->next)
+        {
+            if (node->userId == userId)
+            {
+                pthread_mutex_unlock(&shard->mutex);
+                return SESSION_DUPLICATE;
+            }
+        }
+    }
+
+    // Keep the load factor at or below 1
+    if (shard->count >= shard->bucket_count && grow_shard(shard) == -1 && shard->bucket_count == 0)
+    {
+        pthread_mutex_unlock(&shard->mutex);
+        return SESSION_FULL;
+    }
+
+    SessionNode *node = malloc(sizeof(SessionNode));
+    if (node == NULL)
+    {
+        pthread_mutex_unlock(&shard->mutex);
+        return SESSION_FULL;
+    }
+    unsigned int b = hash & (shard->bucket_count - 1);
+    node->userId = userId;
+    node->next = shard->buckets[b];
+    shard->buckets[b] = node;
+    shard->count++;
+    pthread_mutex_unlock(&shard->mutex);
+    return SESSION_ADDED;
+}
+
+int session_remove(int userId)
+{
+    unsigned int hash = hash_user(userId);
+    SessionShard *shard = shard_of(hash);
+    int removed = -1;
+
+    pthread_mutex_lock(&shard->mutex);
+    if (shard->bucket_count > 0)
+    {
+        SessionNode **link = &shard->buckets[hash & (shard->bucket_count - 1)];
+        while (*link != NULL)
+        {
+            if ((*link)->userId == userId)
+            {
+                SessionNode *node = *link;
+                *link = node->next;
+                free(node);
+                shard->count--;
+                removed = 0;
+                break;
+            }
+            link = &(*link)->next;
+        }
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    return removed;
+}
+
+int session_count()
+{
+    pthread_once(&shards_once, init_shards);
+    int total = 0;
+    for (int i = 0; i < SESSION_SHARDS; i++)
+    {
+        pthread_mutex_lock(&shards[i].mutex);
+        total += shards[i].count;
+        pthread_mutex_unlock(&shards[i].mutex);
+    }
+    return total;
+}
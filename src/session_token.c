@@ -0,0 +1,242 @@
+// src/session_token.c
+#include "session_token.h" // Token prototypes and limits
+#include "timer_wheel.h"   // For the periodic sweep timer
+#include <pthread.h>       // For stripe mutexes
+#include <stdio.h>         // For perror, sprintf
+#include <stdlib.h>        // For malloc, free
+#include <string.h>        // For memcpy, strlen
+#include <time.h>          // For clock_gettime
+
+/*
+--- Session Tokens ---
+
+-> After a successful login the server hands out an opaque token (TOKEN_LENGTH random hex chars).
+-> A client that reconnects sends "RESUME <token>" at the role prompt. The server finds the token in
+   this table and continues with the cached User, without the role/ID/password dialogue and without
+   reading users.dat.
+-> The table is a fixed array of hash buckets. Buckets are protected by TOKEN_LOCK_STRIPES mutexes
+   (bucket % stripes), so lookups of different tokens rarely wait on each other.
+-> Expiry uses CLOCK_MONOTONIC, so changing the wall clock does not expire or revive tokens.
+   A periodic timer on the timer wheel fires every TOKEN_SWEEP_SECONDS and frees the expired entries.
+*/
+
+#define TOKEN_BUCKETS 4096
+#define TOKEN_LOCK_STRIPES 64
+
+typedef struct TokenNode
+{
+    char token[TOKEN_LENGTH + 1];
+    User user;
+    time_t expires_at; // CLOCK_MONOTONIC seconds
+    struct TokenNode *next;
+} TokenNode;
+
+static TokenNode *buckets[TOKEN_BUCKETS];
+static pthread_mutex_t stripes[TOKEN_LOCK_STRIPES];
+static pthread_once_t stripes_once = PTHREAD_ONCE_INIT;
+
+static void init_stripes()
+{
+    for (int i = 0; i < TOKEN_LOCK_STRIPES; i++)
+    {
+        pthread_mutex_init(&stripes[i], NULL);
+    }
+}
+
+static time_t monotonic_seconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+// The token is random, so its first hex digits are already a good hash
+static unsigned int bucket_of(const char *token)
+{
+    unsigned int hash = 0;
+    for (int i = 0; i < 8 && token[i] != '\0'; i++)
+    {
+        char c = token[i];
+        hash = hash * 16 + (unsigned int)((c >= '0' && c <= '9') ? c - '0' : (c | 0x20) - 'a' + 10) % 16;
+    }
+    return hash % TOKEN_BUCKETS;
+}
+
+static pthread_mutex_t *lock_bucket(unsigned int bucket)
+{
+    pthread_once(&stripes_once, init_stripes);
+    pthread_mutex_t *stripe = &stripes[bucket % TOKEN_LOCK_STRIPES];
+    pthread_mutex_lock(stripe);
+    return stripe;
+}
+
+// Random bytes from the kernel, hex encoded
+static int generate_token(char *token_out)
+{
+    unsigned char bytes[TOKEN_LENGTH / 2];
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd == -1)
+    {
+        perror("token: open /dev/urandom");
+        return -1;
+    }
+    ssize_t got = read(fd, bytes, sizeof(bytes));
+    close(fd);
+    if (got != (ssize_t)sizeof(bytes))
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof(bytes); i++)
+    {
+        sprintf(token_out + i * 2, "%02x", bytes[i]);
+    }
+    token_out[TOKEN_LENGTH] = '\0';
+    return 0;
+}
+
+int token_issue(const User *user, char *token_out)
+{
+    TokenNode *node = malloc(sizeof(TokenNode));
+    if (node == NULL)
+        return -1;
+    if (generate_token(node->token) == -1)
+    {
+        free(node);
+        return -1;
+    }
+    node->user = *user;
+    node->expires_at = monotonic_seconds() + TOKEN_TTL_SECONDS;
+
+    unsigned int bucket = bucket_of(node->token);
+    pthread_mutex_t *stripe = lock_bucket(bucket);
+    node->next = buckets[bucket];
+    buckets[bucket] = node;
+    pthread_mutex_unlock(stripe);
+
+    memcpy(token_out, node->token, TOKEN_LENGTH + 1);
+    return 0;
+}
+
+int token_resume(const char *token, User *user_out)
+{
+    if (strlen(token) != TOKEN_LENGTH)
+        return -1;
+
+    unsigned int bucket = bucket_of(token);
+    time_t now = monotonic_seconds();
+    int result = -1;
+
+    pthread_mutex_t *stripe = lock_bucket(bucket);
+    for (TokenNode *node = buckets[bucket]; node != NULL; node = node->next)
+    {
+        if (my_strcmp(node->token, token) == 0)
+        {
+            if (node->expires_at > now)
+            {
+                *user_out = node->user;
+                node->expires_at = now + TOKEN_TTL_SECONDS;
+                result = 0;
+            }
+            break; // Expired entries are left for the reaper
+        }
+    }
+    pthread_mutex_unlock(stripe);
+    return result;
+}
+
+void token_touch(const char *token)
+{
+    unsigned int bucket = bucket_of(token);
+    pthread_mutex_t *stripe = lock_bucket(bucket);
+    for (TokenNode *node = buckets[bucket]; node != NULL; node = node->next)
+    {
+        if (my_strcmp(node->token, token) == 0)
+        {
+            node->expires_at = monotonic_seconds() + TOKEN_TTL_SECONDS;
+            break;
+        }
+    }
+    pthread_mutex_unlock(stripe);
+}
+
+void token_revoke(const char *token)
+{
+    unsigned int bucket = bucket_of(token);
+    pthread_mutex_t *stripe = lock_bucket(bucket);
+    TokenNode **link = &buckets[bucket];
+    while (*link != NULL)
+    {
+        if (my_strcmp((*link)->token, token) == 0)
+        {
+            TokenNode *node = *link;
+            *link = node->next;
+            free(node);
+            break;
+        }
+        link = &(*link)->next;
+    }
+    pthread_mutex_unlock(stripe);
+}
+
+// Removes every node matching (userId, or expired when userId == 0). Returns how many were freed.
+static int sweep(int userId, time_t now)
+{
+    int removed = 0;
+    for (unsigned int bucket = 0; bucket < TOKEN_BUCKETS; bucket++)
+    {
+        pthread_mutex_t *stripe = lock_bucket(bucket);
+        TokenNode **link = &buckets[bucket];
+        while (*link != NULL)
+        {
+            TokenNode *node = *link;
+            int match = (userId != 0) ? node->user.userId == userId : node->expires_at <= now;
+            if (match)
+            {
+                *link = node->next;
+                free(node);
+                removed++;
+            }
+            else
+            {
+                link = &node->next;
+            }
+        }
+        pthread_mutex_unlock(stripe);
+    }
+    return removed;
+}
+
+void token_revoke_user(int userId)
+{
+    sweep(userId, 0);
+}
+
+int token_count()
+{
+    int count = 0;
+    for (unsigned int bucket = 0; bucket < TOKEN_BUCKETS; bucket++)
+    {
+        pthread_mutex_t *stripe = lock_bucket(bucket);
+        for (TokenNode *node = buckets[bucket]; node != NULL; node = node->next)
+        {
+            count++;
+        }
+        pthread_mutex_unlock(stripe);
+    }
+    return count;
+}
+
+// Timer wheel callback: sweeps expired tokens and re-arms itself
+static TimerEntry sweep_timer;
+
+static void token_sweep_tick(void *arg)
+{
+    (void)arg;
+    sweep(0, monotonic_seconds());
+    timer_arm(&sweep_timer, TOKEN_SWEEP_SECONDS * 1000, token_sweep_tick, NULL);
+}
+
+void token_start_reaper()
+{
+    timer_arm(&sweep_timer, TOKEN_SWEEP_SECONDS * 1000, token_sweep_tick, NULL);
+}
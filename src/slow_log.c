@@ -0,0 +1,121 @@
+// src/slow_log.c
+#include "slow_log.h"  // Slow-operation log API
+#include "stats.h"     // For StatsContext, stats_set_slow_hook, stats_name
+#include <pthread.h>   // For the logger thread and the queue mutex
+#include <stdatomic.h> // For counters
+#include <stdio.h>     // For snprintf
+
+typedef struct
+{
+    struct timespec when; // CLOCK_REALTIME at the end of the operation
+    StatId handler;
+    uint64_t elapsed_ns;
+    StatsContext context;
+} SlowOp;
+
+static SlowOp queue[SLOW_LOG_QUEUE];
+static unsigned int queue_head = 0, queue_count = 0;
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static int log_fd = -1;
+static int threshold = 0; // ms, 0 while off
+static atomic_ulong logged;
+static atomic_ulong dropped;
+
+// Runs on the session's thread, inside stats_stop: copy and go
+static void enqueue(StatId id, const StatsContext *context, uint64_t elapsed_ns)
+{
+    SlowOp op;
+    clock_gettime(CLOCK_REALTIME, &op.when);
+    op.handler = id;
+    op.elapsed_ns = elapsed_ns;
+    op.context = *context;
+
+    pthread_mutex_lock(&queue_mutex);
+    if (queue_count == SLOW_LOG_QUEUE)
+    {
+        pthread_mutex_unlock(&queue_mutex);
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+    queue[(queue_head + queue_count) % SLOW_LOG_QUEUE] = op;
+    queue_count++;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_mutex);
+}
+
+static void write_entry(const SlowOp *op)
+{
+    char stamp[32], line[512];
+    struct tm utc;
+    gmtime_r(&op->when.tv_sec, &utc);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &utc);
+    const StatsContext *c = &op->context;
+    int n = snprintf(line, sizeof(line),
+                     "%s.%03ldZ slow_op handler=\"%s\" user=%d elapsed_ms=%.3f records_scanned=%lu read_bytes=%lu "
+                     "lock_waits=%lu lock_wait_ms=%.3f fsyncs=%lu\n",
+                     stamp, op->when.tv_nsec / 1000000, stats_name(op->handler), c->user_id, op->elapsed_ns / 1e6,
+                     (unsigned long)c->reads, (unsigned long)c->read_bytes, (unsigned long)c->lock_waits,
+                     c->lock_wait_ns / 1e6, (unsigned long)c->fsyncs);
+    if (n > (int)sizeof(line) - 1)
+        n = (int)sizeof(line) - 1;
+    if (write(log_fd, line, (size_t)n) == n) // O_APPEND: one write per line keeps lines whole
+        atomic_fetch_add_explicit(&logged, 1, memory_order_relaxed);
+}
+
+static void *logger_thread(void *arg)
+{
+    (void)arg;
+    SlowOp batch[SLOW_LOG_QUEUE];
+    while (1)
+    {
+        pthread_mutex_lock(&queue_mutex);
+        while (queue_count == 0)
+            pthread_cond_wait(&queue_cond, &queue_mutex);
+        unsigned int count = queue_count;
+        for (unsigned int i = 0; i < count; i++)
+            batch[i] = queue[(queue_head + i) % SLOW_LOG_QUEUE];
+        queue_head = (queue_head + count) % SLOW_LOG_QUEUE;
+        queue_count = 0;
+        pthread_mutex_unlock(&queue_mutex);
+
+        for (unsigned int i = 0; i < count; i++)
+            write_entry(&batch[i]);
+    }
+    return NULL;
+}
+
+int slow_log_start(int threshold_ms)
+{
+    if (threshold_ms <= 0)
+        return 0;
+    log_fd = open(SLOW_LOG_FILE, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (log_fd == -1)
+    {
+        perror("slow log: open");
+        return -1;
+    }
+    pthread_t thread_id;
+    if (pthread_create(&thread_id, NULL, logger_thread, NULL) != 0)
+    {
+        perror("slow log: pthread_create");
+        close(log_fd);
+        log_fd = -1;
+        return -1;
+    }
+    pthread_detach(thread_id);
+    threshold = threshold_ms;
+    stats_set_slow_hook((uint64_t)threshold_ms * 1000000, enqueue);
+    return 0;
+}
+
+void slow_log_report(int fd)
+{
+    char buffer[160];
+    if (threshold == 0)
+        snprintf(buffer, sizeof(buffer), "Slow-op log: off\n");
+    else
+        snprintf(buffer, sizeof(buffer), "Slow-op log (%s, >= %d ms): %lu logged, %lu dropped (queue full)\n",
+                 SLOW_LOG_FILE, threshold, atomic_load(&logged), atomic_load(&dropped));
+    write_string(fd, buffer);
+}
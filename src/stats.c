@@ -0,0 +1,494 @@
+// src/stats.c
+#include "stats.h"     // StatId, StatTimer and prototypes
+#include "histogram.h" // For the per-thread latency histograms
+#include "metrics.h"   // For metrics_header, metrics_value
+#include "trace.h"     // Every timer also ends in a span
+#include <pthread.h>   // For the shard registry
+#include <stdio.h>     // For snprintf
+#include <time.h>      // For clock_gettime
+
+static const char *stat_names[STAT_COUNT] = {
+    "check_login",
+    "handle_view_balance",
+    "handle_deposit",
+    "handle_withdraw",
+    "handle_transfer_funds",
+    "handle_view_transaction_history",
+    "handle_apply_loan",
+    "handle_view_loan_status",
+    "handle_view_my_details",
+    "handle_add_feedback",
+    "handle_view_feedback_status",
+    "handle_change_password",
+    "handle_batch_transfer",
+    "handle_standing_instructions",
+    "handle_add_user",
+    "handle_add_new_account",
+    "handle_modify_user_details",
+    "handle_view_customer_transactions",
+    "handle_view_assigned_loans",
+    "handle_process_loan",
+    "handle_set_account_status",
+    "handle_assign_loan",
+    "handle_review_feedback",
+    "pipeline ACCOUNTS",
+    "pipeline BALANCE",
+    "pipeline DEPOSIT",
+    "pipeline WITHDRAW",
+    "pipeline TRANSFER",
+    "pipeline HISTORY",
+    "pipeline BATCH",
+    "pipeline SCHEDULE",
+    "pipeline INSTRUCTIONS",
+    "pipeline CANCEL",
+    "scheduler batch",
+    "ledger_post",
+    "ledger_transfer",
+    "ledger_transfer_batch",
+    "getUser",
+    "getAccount",
+    "getAccountByNum",
+    "getLoan",
+    "getFeedback",
+    "getAccountsByOwnerId",
+    "getAccountsByNumbers",
+    "getAccountsAt",
+    "append_record",
+    "update_record",
+    "updateAccountsAt",
+    "addTransactions",
+    "journal_log_entry",
+    "journal_log_entries",
+};
+
+static const char *file_names[STAT_FILE_COUNT] = {
+    "users.dat", "accounts.dat", "transactions.dat", "loans.dat", "feedback.dat", "journal.log", "instructions.dat",
+    "(other)",
+};
+
+static const char *fsync_span_names[STAT_FILE_COUNT] = {
+    "fsync users.dat", "fsync accounts.dat", "fsync transactions.dat", "fsync loans.dat",
+    "fsync feedback.dat", "fsync journal.log", "fsync instructions.dat", "fsync (other)",
+};
+
+static const char *file_paths[STAT_FILE_OTHER] = {
+    USER_FILE, ACCOUNT_FILE, TRANSACTION_FILE, LOAN_FILE, FEEDBACK_FILE, JOURNAL_FILE, INSTRUCTION_FILE,
+};
+
+#define NO_HANDLER STAT_COUNT // Column for I/O outside any timed handler
+
+typedef struct
+{
+    uint64_t reads, read_bytes;
+    uint64_t writes, written_bytes;
+    uint64_t fsyncs, fsync_ns, max_fsync_ns;
+} IoCounters;
+
+typedef struct StatsShard
+{
+    Histogram latency[STAT_COUNT]; // Nanoseconds; written only by the owning thread
+    IoCounters io[STAT_FILE_COUNT][STAT_COUNT + 1]; // [file][originating handler]; owner writes only
+    struct StatsShard *prev, *next;
+} StatsShard;
+
+static int enabled = 0;
+static pthread_mutex_t shards_mutex = PTHREAD_MUTEX_INITIALIZER; // Registry only, never while recording
+static StatsShard *shards = NULL;
+static Histogram retired[STAT_COUNT]; // Shards of exited threads, merged
+static IoCounters retired_io[STAT_FILE_COUNT][STAT_COUNT + 1];
+static pthread_key_t shard_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static __thread StatsShard *my_shard = NULL;
+__thread StatsContext stats_context = {-1, 0, 0, 0, 0, 0, 0};
+static uint64_t slow_threshold_ns = 0;
+static StatsSlowHook slow_hook = NULL;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+// Adds from into into. from may still be written by its owner: every field is loaded once.
+static void merge_io(IoCounters *into, const IoCounters *from)
+{
+    into->reads += __atomic_load_n(&from->reads, __ATOMIC_RELAXED);
+    into->read_bytes += __atomic_load_n(&from->read_bytes, __ATOMIC_RELAXED);
+    into->writes += __atomic_load_n(&from->writes, __ATOMIC_RELAXED);
+    into->written_bytes += __atomic_load_n(&from->written_bytes, __ATOMIC_RELAXED);
+    into->fsyncs += __atomic_load_n(&from->fsyncs, __ATOMIC_RELAXED);
+    into->fsync_ns += __atomic_load_n(&from->fsync_ns, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&from->max_fsync_ns, __ATOMIC_RELAXED);
+    if (max > into->max_fsync_ns)
+        into->max_fsync_ns = max;
+}
+
+static void merge_io_table(IoCounters into[][STAT_COUNT + 1], IoCounters from[][STAT_COUNT + 1])
+{
+    for (int f = 0; f < STAT_FILE_COUNT; f++)
+    {
+        for (int h = 0; h <= STAT_COUNT; h++)
+            merge_io(&into[f][h], &from[f][h]);
+    }
+}
+
+// Thread exit: fold the shard into retired so its counts outlive the thread
+static void retire_shard(void *arg)
+{
+    StatsShard *shard = (StatsShard *)arg;
+    pthread_mutex_lock(&shards_mutex);
+    for (int i = 0; i < STAT_COUNT; i++)
+        histogram_merge(&retired[i], &shard->latency[i]);
+    merge_io_table(retired_io, shard->io);
+    if (shard->prev != NULL)
+        shard->prev->next = shard->next;
+    else
+        shards = shard->next;
+    if (shard->next != NULL)
+        shard->next->prev = shard->prev;
+    pthread_mutex_unlock(&shards_mutex);
+    free(shard);
+}
+
+static void make_key()
+{
+    pthread_key_create(&shard_key, retire_shard);
+}
+
+static StatsShard *get_shard()
+{
+    if (my_shard != NULL)
+        return my_shard;
+    pthread_once(&key_once, make_key);
+    StatsShard *shard = calloc(1, sizeof(StatsShard));
+    if (shard == NULL)
+        return NULL;
+    pthread_mutex_lock(&shards_mutex);
+    shard->next = shards;
+    if (shards != NULL)
+        shards->prev = shard;
+    shards = shard;
+    pthread_mutex_unlock(&shards_mutex);
+    pthread_setspecific(shard_key, shard);
+    my_shard = shard;
+    return shard;
+}
+
+void stats_enable()
+{
+    enabled = 1;
+}
+
+void stats_set_slow_hook(uint64_t threshold_ns, StatsSlowHook hook)
+{
+    slow_threshold_ns = threshold_ns;
+    slow_hook = hook;
+}
+
+const char *stats_name(StatId id)
+{
+    return stat_names[id];
+}
+
+void stats_set_user(int userId)
+{
+    stats_context.user_id = userId;
+}
+
+void stats_lock_waited(uint64_t waited_ns)
+{
+    stats_context.lock_waits++;
+    stats_context.lock_wait_ns += waited_ns;
+}
+
+StatTimer stats_start(StatId id)
+{
+    StatTimer timer = {0, 0, -1};
+    if (!enabled)
+        return timer;
+    timer.start_ns = now_ns();
+    timer.client_wait_ns = client_wait_ns;
+    timer.outer_handler = stats_context.handler;
+    if (stats_context.handler < 0)
+    {
+        // Outermost: the per-operation counters start from here
+        stats_context.handler = id;
+        stats_context.reads = stats_context.read_bytes = stats_context.fsyncs = 0;
+        stats_context.lock_waits = stats_context.lock_wait_ns = 0;
+    }
+    return timer;
+}
+
+void stats_stop(StatId id, StatTimer timer)
+{
+    if (timer.start_ns == 0)
+        return;
+    stats_context.handler = timer.outer_handler;
+    uint64_t end = now_ns();
+    trace_span(stat_names[id], timer.start_ns, end);
+    uint64_t elapsed = end - timer.start_ns;
+    uint64_t waited = client_wait_ns - timer.client_wait_ns;
+    elapsed = (waited < elapsed) ? elapsed - waited : 0;
+    StatsShard *shard = get_shard();
+    if (shard != NULL)
+        histogram_record_shared(&shard->latency[id], elapsed);
+    if (timer.outer_handler < 0 && slow_hook != NULL && slow_threshold_ns > 0 && elapsed >= slow_threshold_ns)
+        slow_hook(id, &stats_context, elapsed);
+}
+
+// All shards' histograms added up (calloc'ed, NULL if out of memory); threads: live shards
+static Histogram *merge_latency(int *threads)
+{
+    Histogram *merged = calloc(STAT_COUNT, sizeof(Histogram));
+    if (merged == NULL)
+        return NULL;
+    *threads = 0;
+    pthread_mutex_lock(&shards_mutex);
+    for (int i = 0; i < STAT_COUNT; i++)
+        histogram_merge(&merged[i], &retired[i]);
+    for (StatsShard *shard = shards; shard != NULL; shard = shard->next)
+    {
+        for (int i = 0; i < STAT_COUNT; i++)
+            histogram_merge_shared(&merged[i], &shard->latency[i]);
+        (*threads)++;
+    }
+    pthread_mutex_unlock(&shards_mutex);
+    return merged;
+}
+
+void stats_report(int fd)
+{
+    int threads;
+    Histogram *merged = merge_latency(&threads);
+    if (merged == NULL)
+        return;
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "Latency (us, server time without client input; %d live thread shard(s)):\n"
+             "  %-34s %9s %9s %9s %9s %9s %9s\n",
+             threads, "", "count", "mean", "p50", "p90", "p99", "max");
+    write_string(fd, buffer);
+    int shown = 0;
+    for (int i = 0; i < STAT_COUNT; i++)
+    {
+        Histogram *h = &merged[i];
+        if (h->count == 0)
+            continue;
+        snprintf(buffer, sizeof(buffer), "  %-34s %9lu %9.1f %9.1f %9.1f %9.1f %9.1f\n", stat_names[i], h->count,
+                 (double)h->sum / h->count / 1000.0, histogram_percentile(h, 50) / 1000.0,
+                 histogram_percentile(h, 90) / 1000.0, histogram_percentile(h, 99) / 1000.0, h->max / 1000.0);
+        write_string(fd, buffer);
+        shown++;
+    }
+    if (shown == 0)
+        write_string(fd, "  (nothing recorded yet)\n");
+    free(merged);
+}
+
+// --- I/O Accounting ---
+
+StatFile stats_file_of(const char *path)
+{
+    for (int f = 0; f < STAT_FILE_OTHER; f++)
+    {
+        if (strcmp(path, file_paths[f]) == 0)
+            return (StatFile)f;
+    }
+    return STAT_FILE_OTHER;
+}
+
+uint64_t stats_clock()
+{
+    return enabled ? now_ns() : 0;
+}
+
+#define BUMP(field, amount) __atomic_store_n(&(field), (field) + (amount), __ATOMIC_RELAXED)
+
+void stats_io(StatFile file, StatIoKind kind, ssize_t bytes, uint64_t started)
+{
+    if (!enabled)
+        return;
+    StatsShard *shard = get_shard();
+    if (shard == NULL)
+        return;
+    int handler = stats_context.handler;
+    IoCounters *c = &shard->io[file][handler < 0 ? NO_HANDLER : handler];
+    uint64_t moved = bytes > 0 ? (uint64_t)bytes : 0;
+    switch (kind)
+    {
+    case STAT_IO_READ:
+        BUMP(c->reads, 1);
+        BUMP(c->read_bytes, moved);
+        stats_context.reads++;
+        stats_context.read_bytes += moved;
+        break;
+    case STAT_IO_WRITE:
+        BUMP(c->writes, 1);
+        BUMP(c->written_bytes, moved);
+        break;
+    case STAT_IO_FSYNC:
+    {
+        uint64_t ended = started != 0 ? now_ns() : 0;
+        uint64_t took = ended - started;
+        trace_span(fsync_span_names[file], started, ended);
+        BUMP(c->fsyncs, 1);
+        stats_context.fsyncs++;
+        BUMP(c->fsync_ns, took);
+        if (took > c->max_fsync_ns)
+            __atomic_store_n(&c->max_fsync_ns, took, __ATOMIC_RELAXED);
+        break;
+    }
+    }
+}
+
+typedef struct
+{
+    int file, handler;
+    uint64_t bytes;
+} IoRow;
+
+static int by_bytes(const void *a, const void *b)
+{
+    const IoRow *x = (const IoRow *)a;
+    const IoRow *y = (const IoRow *)b;
+    if (x->bytes != y->bytes)
+        return x->bytes < y->bytes ? 1 : -1;
+    return 0;
+}
+
+static void write_io_line(int fd, const char *file, const char *handler, const IoCounters *c)
+{
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "  %-16s %-34.34s %9lu %10.1f %9lu %10.1f %7lu %9.2f %8.2f\n", file, handler,
+             (unsigned long)c->reads, c->read_bytes / 1024.0, (unsigned long)c->writes, c->written_bytes / 1024.0,
+             (unsigned long)c->fsyncs, c->fsyncs > 0 ? (double)c->fsync_ns / c->fsyncs / 1e6 : 0.0,
+             c->max_fsync_ns / 1e6);
+    write_string(fd, buffer);
+}
+
+// All shards' I/O counters added up (calloc'ed, NULL if out of memory)
+static IoCounters (*merge_io_all())[STAT_COUNT + 1]
+{
+    IoCounters(*merged)[STAT_COUNT + 1] = calloc(STAT_FILE_COUNT, sizeof(*merged));
+    if (merged == NULL)
+        return NULL;
+    pthread_mutex_lock(&shards_mutex);
+    merge_io_table(merged, retired_io);
+    for (StatsShard *shard = shards; shard != NULL; shard = shard->next)
+        merge_io_table(merged, shard->io);
+    pthread_mutex_unlock(&shards_mutex);
+    return merged;
+}
+
+void stats_io_report(int fd)
+{
+    IoCounters(*merged)[STAT_COUNT + 1] = merge_io_all();
+    if (merged == NULL)
+        return;
+
+    char header[256];
+    snprintf(header, sizeof(header), "  %-16s %-34s %9s %10s %9s %10s %7s %9s %8s\n", "file", "handler", "reads",
+             "read KiB", "writes", "write KiB", "fsyncs", "fsync ms", "max");
+    write_string(fd, "I/O per data file (fsync ms: mean per fsync):\n");
+    write_string(fd, header);
+
+    IoRow rows[STAT_FILE_COUNT * (STAT_COUNT + 1)];
+    int count = 0;
+    for (int f = 0; f < STAT_FILE_COUNT; f++)
+    {
+        IoCounters total = {0, 0, 0, 0, 0, 0, 0};
+        for (int h = 0; h <= STAT_COUNT; h++)
+        {
+            IoCounters *c = &merged[f][h];
+            merge_io(&total, c);
+            if (c->reads + c->writes + c->fsyncs == 0)
+                continue;
+            rows[count].file = f;
+            rows[count].handler = h;
+            rows[count].bytes = c->read_bytes + c->written_bytes;
+            count++;
+        }
+        if (total.reads + total.writes + total.fsyncs > 0)
+            write_io_line(fd, file_names[f], "(all)", &total);
+    }
+    if (count == 0)
+    {
+        write_string(fd, "  (no data file I/O yet)\n");
+        free(merged);
+        return;
+    }
+
+    qsort(rows, count, sizeof(rows[0]), by_bytes);
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "I/O by originating handler (%d of %d, most bytes first):\n",
+             count < STATS_IO_TOP ? count : STATS_IO_TOP, count);
+    write_string(fd, buffer);
+    write_string(fd, header);
+    for (int i = 0; i < count && i < STATS_IO_TOP; i++)
+    {
+        const char *handler = rows[i].handler == NO_HANDLER ? "(no handler)" : stat_names[rows[i].handler];
+        write_io_line(fd, file_names[rows[i].file], handler, &merged[rows[i].file][rows[i].handler]);
+    }
+    free(merged);
+}
+
+// --- Metrics (Prometheus text format) ---
+
+void stats_metrics(int fd)
+{
+    static const double quantiles[] = {0.5, 0.9, 0.99};
+    char labels[160];
+    int threads;
+    Histogram *latency = merge_latency(&threads);
+    if (latency != NULL)
+    {
+        metrics_header(fd, "bank_handler_latency_seconds", "summary",
+                       "Server time per handler, pipelined op, ledger call and data primitive (_count: calls)");
+        for (int i = 0; i < STAT_COUNT; i++)
+        {
+            Histogram *h = &latency[i];
+            if (h->count == 0)
+                continue;
+            for (int q = 0; q < 3; q++)
+            {
+                snprintf(labels, sizeof(labels), "handler=\"%s\",quantile=\"%g\"", stat_names[i], quantiles[q]);
+                metrics_value(fd, "bank_handler_latency_seconds", labels,
+                              histogram_percentile(h, quantiles[q] * 100) / 1e9);
+            }
+            snprintf(labels, sizeof(labels), "handler=\"%s\"", stat_names[i]);
+            metrics_value(fd, "bank_handler_latency_seconds_sum", labels, h->sum / 1e9);
+            metrics_value(fd, "bank_handler_latency_seconds_count", labels, (double)h->count);
+        }
+        free(latency);
+    }
+
+    IoCounters(*io)[STAT_COUNT + 1] = merge_io_all();
+    if (io == NULL)
+        return;
+    static const char *io_names[] = {"bank_io_reads_total", "bank_io_read_bytes_total", "bank_io_writes_total",
+                                     "bank_io_written_bytes_total", "bank_io_fsyncs_total",
+                                     "bank_io_fsync_seconds_total"};
+    static const char *io_help[] = {"Data file read calls", "Bytes read from data files", "Data file write calls",
+                                    "Bytes written to data files", "fsyncs of data files",
+                                    "Time spent in fsync of data files"};
+    for (int m = 0; m < 6; m++)
+    {
+        metrics_header(fd, io_names[m], "counter", io_help[m]);
+        for (int f = 0; f < STAT_FILE_COUNT; f++)
+        {
+            for (int h = 0; h <= STAT_COUNT; h++)
+            {
+                IoCounters *c = &io[f][h];
+                if (c->reads + c->writes + c->fsyncs == 0)
+                    continue;
+                uint64_t values[6] = {c->reads, c->read_bytes, c->writes, c->written_bytes, c->fsyncs, c->fsync_ns};
+                snprintf(labels, sizeof(labels), "file=\"%s\",handler=\"%s\"", file_names[f],
+                         h == NO_HANDLER ? "none" : stat_names[h]);
+                metrics_value(fd, io_names[m], labels, m == 5 ? values[m] / 1e9 : (double)values[m]);
+            }
+        }
+    }
+    free(io);
+}
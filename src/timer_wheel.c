@@ -0,0 +1,232 @@
+// src/timer_wheel.c
+#include "timer_wheel.h" // Timer API and wheel geometry
+#include "common.h"      // For write_string, perror
+#include <pthread.h>     // For the tick thread and the wheel mutex
+#include <time.h>        // For clock_gettime, clock_nanosleep
+
+/*
+--- Hierarchical Timer Wheel ---
+
+-> Thousands of connections each need a deadline. A sorted list would cost O(n) per insert, so
+   deadlines are kept in a "wheel": an array of TIMER_WHEEL_SIZE slots, one per tick. Arming a
+   timer drops it into the slot of its expiry tick (O(1)), and every tick the thread fires the
+   whole slot at once.
+-> One wheel of 64 slots only covers 6.4 seconds, so there are TIMER_WHEEL_LEVELS wheels. Level 1
+   slots are 64 ticks wide, level 2 slots 64*64 ticks, and so on. Whenever a lower level wraps
+   around, the next slot of the level above is "cascaded": its timers are re-inserted and land in
+   lower levels, closer to their exact tick.
+-> Callbacks run on the tick thread, one at a time, without the wheel mutex held. timer_cancel()
+   waits for a running callback, which is what makes it safe to free the owner after cancelling.
+*/
+
+#define TIMER_WHEEL_SIZE (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SIZE - 1)
+#define TIMER_MAX_DELTA ((uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+static TimerLink wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+static uint64_t next_tick = 0; // Next tick the thread will process
+static uint64_t start_ms = 0;  // monotonic_ms() of tick 0
+static TimerEntry *running_timer = NULL;
+static pthread_mutex_t wheel_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t callback_done = PTHREAD_COND_INITIALIZER;
+static pthread_once_t wheel_once = PTHREAD_ONCE_INIT;
+
+uint64_t monotonic_ms()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+static void list_init(TimerLink *head)
+{
+    head->prev = head;
+    head->next = head;
+}
+
+static void list_unlink(TimerLink *link)
+{
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->prev = link;
+    link->next = link;
+}
+
+static void list_append(TimerLink *head, TimerLink *link)
+{
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+// Moves every node of 'from' to the (empty) list 'to'
+static void list_splice(TimerLink *from, TimerLink *to)
+{
+    list_init(to);
+    if (from->next == from)
+        return;
+    to->next = from->next;
+    to->prev = from->prev;
+    to->next->prev = to;
+    to->prev->next = to;
+    list_init(from);
+}
+
+static void init_wheel()
+{
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        for (int slot = 0; slot < TIMER_WHEEL_SIZE; slot++)
+        {
+            list_init(&wheel[level][slot]);
+        }
+    }
+    start_ms = monotonic_ms();
+}
+
+// Puts an entry in the slot matching its expiry (caller holds wheel_mutex)
+static void wheel_insert(TimerEntry *timer)
+{
+    if (timer->expires < next_tick)
+        timer->expires = next_tick;
+    uint64_t delta = timer->expires - next_tick;
+    if (delta >= TIMER_MAX_DELTA)
+    {
+        timer->expires = next_tick + TIMER_MAX_DELTA - 1;
+        delta = TIMER_MAX_DELTA - 1;
+    }
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= ((uint64_t)1 << (TIMER_WHEEL_BITS * (level + 1))))
+    {
+        level++;
+    }
+    int slot = (timer->expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    list_append(&wheel[level][slot], &timer->link);
+}
+
+// Re-inserts every timer of one upper-level slot. Returns the slot index.
+static int cascade(int level)
+{
+    int slot = (next_tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    TimerLink pending;
+    list_splice(&wheel[level][slot], &pending);
+    while (pending.next != &pending)
+    {
+        TimerEntry *timer = (TimerEntry *)pending.next;
+        list_unlink(&timer->link);
+        wheel_insert(timer);
+    }
+    return slot;
+}
+
+// Processes one tick (caller holds wheel_mutex; it is released while callbacks run)
+static void run_tick()
+{
+    int slot = next_tick & TIMER_WHEEL_MASK;
+    if (slot == 0)
+    {
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+        {
+            if (cascade(level) != 0)
+                break;
+        }
+    }
+    next_tick++;
+
+    TimerLink expired;
+    list_splice(&wheel[0][slot], &expired);
+    while (expired.next != &expired)
+    {
+        TimerEntry *timer = (TimerEntry *)expired.next;
+        list_unlink(&timer->link);
+        timer->armed = 0;
+        running_timer = timer;
+
+        pthread_mutex_unlock(&wheel_mutex);
+        timer->callback(timer->arg);
+        pthread_mutex_lock(&wheel_mutex);
+
+        running_timer = NULL;
+        pthread_cond_broadcast(&callback_done);
+    }
+}
+
+static void *tick_thread(void *arg)
+{
+    (void)arg;
+    while (1)
+    {
+        // Sleep until the next tick boundary (absolute, so ticks do not drift)
+        uint64_t wake_ms = start_ms + next_tick * TIMER_TICK_MS;
+        struct timespec wake;
+        wake.tv_sec = wake_ms / 1000;
+        wake.tv_nsec = (wake_ms % 1000) * 1000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR)
+        {
+        }
+
+        // Catch up on every tick that is due (e.g. after the machine was suspended)
+        uint64_t due_tick = (monotonic_ms() - start_ms) / TIMER_TICK_MS;
+        pthread_mutex_lock(&wheel_mutex);
+        while (next_tick <= due_tick)
+        {
+            run_tick();
+        }
+        pthread_mutex_unlock(&wheel_mutex);
+    }
+    return NULL;
+}
+
+void timer_wheel_start()
+{
+    pthread_once(&wheel_once, init_wheel);
+    pthread_t thread_id;
+    if (pthread_create(&thread_id, NULL, tick_thread, NULL) != 0)
+    {
+        perror("timer wheel: pthread_create");
+        return;
+    }
+    pthread_detach(thread_id);
+}
+
+void timer_arm(TimerEntry *timer, unsigned int delay_ms, TimerCallback callback, void *arg)
+{
+    pthread_once(&wheel_once, init_wheel);
+    pthread_mutex_lock(&wheel_mutex);
+    if (timer->armed)
+    {
+        list_unlink(&timer->link);
+    }
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->expires = next_tick + (delay_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+    timer->armed = 1;
+    wheel_insert(timer);
+    pthread_mutex_unlock(&wheel_mutex);
+}
+
+int timer_cancel(TimerEntry *timer)
+{
+    int was_pending = 0;
+    pthread_mutex_lock(&wheel_mutex);
+    if (timer->armed)
+    {
+        list_unlink(&timer->link);
+        timer->armed = 0;
+        was_pending = 1;
+    }
+    while (running_timer == timer)
+    {
+        pthread_cond_wait(&callback_done, &wheel_mutex);
+    }
+    // The callback may have re-armed the entry while we waited
+    if (timer->armed)
+    {
+        list_unlink(&timer->link);
+        timer->armed = 0;
+    }
+    pthread_mutex_unlock(&wheel_mutex);
+    return was_pending;
+}
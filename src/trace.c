@@ -0,0 +1,217 @@
+// src/trace.c
+#include "trace.h"       // Span tracing API
+#include <pthread.h>     // For the ring registry
+#include <stdatomic.h>   // For the track counter
+#include <stdio.h>       // For snprintf
+#include <sys/syscall.h> // For SYS_gettid
+
+typedef struct
+{
+    uint64_t seq; // 2*i+1 while span i is written, 2*i+2 once it is complete
+    const char *name;
+    uint64_t start_ns, end_ns;
+    int track;
+} TraceSlot;
+
+typedef struct TraceRing
+{
+    TraceSlot slots[TRACE_RING_SPANS];
+    uint64_t written; // Spans ever written into this ring (the owner's index)
+    int in_use;       // Owned by a live thread (under registry_mutex)
+    struct TraceRing *next;
+} TraceRing;
+
+static int enabled = 0;
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER; // Ring list only, never while recording
+static TraceRing *rings = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static __thread TraceRing *my_ring = NULL;
+static __thread int my_tid = 0;
+static atomic_int next_track = TRACE_COROUTINE_TRACKS;
+__thread int trace_track = 0;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+// Thread exit: the ring keeps its spans for the dump until a new thread takes it over
+static void release_ring(void *arg)
+{
+    TraceRing *ring = (TraceRing *)arg;
+    pthread_mutex_lock(&registry_mutex);
+    ring->in_use = 0;
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+static void make_key()
+{
+    pthread_key_create(&ring_key, release_ring);
+}
+
+static TraceRing *get_ring()
+{
+    if (my_ring != NULL)
+        return my_ring;
+    pthread_once(&key_once, make_key);
+    pthread_mutex_lock(&registry_mutex);
+    TraceRing *ring = rings;
+    while (ring != NULL && ring->in_use)
+        ring = ring->next;
+    if (ring == NULL)
+    {
+        ring = calloc(1, sizeof(TraceRing));
+        if (ring == NULL)
+        {
+            pthread_mutex_unlock(&registry_mutex);
+            return NULL;
+        }
+        ring->next = rings;
+        rings = ring;
+    }
+    ring->in_use = 1;
+    pthread_mutex_unlock(&registry_mutex);
+    pthread_setspecific(ring_key, ring);
+    my_ring = ring;
+    my_tid = (int)syscall(SYS_gettid);
+    return ring;
+}
+
+void trace_enable()
+{
+    enabled = 1;
+}
+
+uint64_t trace_begin()
+{
+    return enabled ? now_ns() : 0;
+}
+
+void trace_span(const char *name, uint64_t start_ns, uint64_t end_ns)
+{
+    if (!enabled || start_ns == 0)
+        return;
+    TraceRing *ring = get_ring();
+    if (ring == NULL)
+        return;
+    uint64_t i = ring->written;
+    TraceSlot *slot = &ring->slots[i % TRACE_RING_SPANS];
+    __atomic_store_n(&slot->seq, 2 * i + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE); // The odd seq is visible before any field changes
+    __atomic_store_n(&slot->name, name, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->start_ns, start_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->end_ns, end_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->track, trace_track != 0 ? trace_track : my_tid, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, 2 * i + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->written, i + 1, __ATOMIC_RELEASE);
+}
+
+void trace_end(const char *name, uint64_t start_ns)
+{
+    if (start_ns != 0)
+        trace_span(name, start_ns, now_ns());
+}
+
+int trace_new_track()
+{
+    return atomic_fetch_add_explicit(&next_track, 1, memory_order_relaxed);
+}
+
+// --- Dump (Chrome trace event format) ---
+
+typedef struct
+{
+    int fd;
+    size_t used;
+    char data[65536];
+} DumpBuffer;
+
+static void flush(DumpBuffer *out)
+{
+    size_t done = 0;
+    while (done < out->used)
+    {
+        ssize_t n = write(out->fd, out->data + done, out->used - done);
+        if (n <= 0)
+            break;
+        done += (size_t)n;
+    }
+    out->used = 0;
+}
+
+static void append(DumpBuffer *out, const char *text, int len)
+{
+    if (out->used + (size_t)len > sizeof(out->data))
+        flush(out);
+    memcpy(out->data + out->used, text, (size_t)len);
+    out->used += (size_t)len;
+}
+
+// Copies span i of ring into copy. Returns 0 if it was overwritten meanwhile.
+static int read_slot(TraceRing *ring, uint64_t i, TraceSlot *copy)
+{
+    TraceSlot *slot = &ring->slots[i % TRACE_RING_SPANS];
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq != 2 * i + 2)
+        return 0;
+    copy->name = __atomic_load_n(&slot->name, __ATOMIC_RELAXED);
+    copy->start_ns = __atomic_load_n(&slot->start_ns, __ATOMIC_RELAXED);
+    copy->end_ns = __atomic_load_n(&slot->end_ns, __ATOMIC_RELAXED);
+    copy->track = __atomic_load_n(&slot->track, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE); // The fields are read before seq is checked again
+    return __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq;
+}
+
+long trace_dump(const char *path)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+        return -1;
+    DumpBuffer *out = malloc(sizeof(DumpBuffer));
+    if (out == NULL)
+    {
+        close(fd);
+        return -1;
+    }
+    out->fd = fd;
+    out->used = 0;
+
+    char line[256];
+    int pid = (int)getpid();
+    int len = snprintf(line, sizeof(line),
+                       "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                       "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"bank server\"}}",
+                       pid);
+    append(out, line, len);
+
+    long spans = 0;
+    pthread_mutex_lock(&registry_mutex);
+    for (TraceRing *ring = rings; ring != NULL; ring = ring->next)
+    {
+        uint64_t written = __atomic_load_n(&ring->written, __ATOMIC_ACQUIRE);
+        uint64_t first = written > TRACE_RING_SPANS ? written - TRACE_RING_SPANS : 0;
+        for (uint64_t i = first; i < written; i++)
+        {
+            TraceSlot span;
+            if (!read_slot(ring, i, &span))
+                continue;
+            len = snprintf(line, sizeof(line),
+                           ",\n{\"name\":\"%s\",\"cat\":\"bank\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,"
+                           "\"tid\":%d}",
+                           span.name, span.start_ns / 1000.0, (span.end_ns - span.start_ns) / 1000.0, pid,
+                           span.track);
+            append(out, line, len);
+            spans++;
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+
+    append(out, "\n]}\n", 4);
+    flush(out);
+    free(out);
+    close(fd);
+    return spans;
+}